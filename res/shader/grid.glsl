@@ -8,7 +8,9 @@ layout(location = 2) in vec4 color;
 layout(location = 3) in vec2 uv0;
 layout(location = 4) in float grid_scale;
 
-layout(location = 0) uniform mat4 pr_matrix;
+layout(std140, row_major, binding = 0) uniform Camera {
+    mat4 pr_matrix;
+};
 layout(location = 4) uniform mat4 ml_matrix;
 
 out float v_unit_scale;
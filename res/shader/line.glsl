@@ -2,10 +2,12 @@
 
 #ifdef VERTEX
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec4 color;
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec4 color;         // @Format: u8_norm
 
-layout(location = 0) uniform mat4 pr_matrix;
+layout(std140, row_major, binding = 0) uniform Camera {
+    mat4 pr_matrix;
+};
 layout(location = 4) uniform mat4 ml_matrix;
 
 out vec4 v_color;
@@ -13,7 +15,7 @@ out vec4 v_color;
 void main() {
     v_color = color;
 
-    gl_Position = pr_matrix * ml_matrix * vec4(position, 1.0);
+    gl_Position = pr_matrix * ml_matrix * vec4(position, 0.0, 1.0);
 }
 
 #endif
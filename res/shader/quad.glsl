@@ -2,27 +2,28 @@
 
 #ifdef VERTEX
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec4 color;
-layout(location = 2) in vec2 uv0;
-layout(location = 3) in float tex_index;
-layout(location = 4) in float mask_index;
-
-layout(location = 0) uniform mat4 pr_matrix;
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec4 color;         // @Format: u8_norm
+layout(location = 2) in vec2 uv0;           // @Format: u16_norm
+layout(location = 3) in ivec2 slots;        // @Format: s16
+
+layout(std140, row_major, binding = 0) uniform Camera {
+    mat4 pr_matrix;
+};
 layout(location = 4) uniform mat4 ml_matrix;
 
 out vec4 v_color;
 out vec2 v_uv0;
-out float v_tex_index;
-out float v_mask_index;
+flat out int v_tex_index;
+flat out int v_mask_index;
 
 void main() {
     v_color = color;
     v_uv0 = uv0;
-    v_tex_index = tex_index;
-    v_mask_index = mask_index;
+    v_tex_index = slots.x;
+    v_mask_index = slots.y;
 
-    gl_Position = pr_matrix * ml_matrix * vec4(position, 1.0);
+    gl_Position = pr_matrix * ml_matrix * vec4(position, 0.0, 1.0);
 }
 
 #endif
@@ -33,14 +34,14 @@ layout(location = 0) out vec4 color;
 
 in vec4 v_color;
 in vec2 v_uv0;
-in float v_tex_index;
-in float v_mask_index;
+flat in int v_tex_index;
+flat in int v_mask_index;
 
 layout(location = 8) uniform sampler2D u_textures[32];
 
 void main() {
-    int tex_index = int(v_tex_index);
-    int mask_index = int(v_mask_index);
+    int tex_index = v_tex_index;
+    int mask_index = v_mask_index;
 
     // Base color.
     if (tex_index == -1) {
@@ -50,9 +51,16 @@ void main() {
         color = texture(u_textures[tex_index], v_uv0);
     }
 
-    // Applying mask.
+    // Applying mask, distance field masks have their slot offset by 32.
     if (mask_index != -1) {
-        color.w = texture(u_textures[mask_index], v_uv0).x * color.w;
+        if (mask_index >= 32) {
+            float d = texture(u_textures[mask_index - 32], v_uv0).x;
+            float w = max(fwidth(d), 0.0001);
+            color.w = smoothstep(0.5 - w, 0.5 + w, d) * color.w;
+        }
+        else {
+            color.w = texture(u_textures[mask_index], v_uv0).x * color.w;
+        }
     }
 
 
@@ -0,0 +1,74 @@
+#version 430 core
+
+#ifdef VERTEX
+
+layout(location = 0) in vec2 center;
+layout(location = 1) in vec2 half_extents;
+layout(location = 2) in float rot;
+layout(location = 3) in vec4 color;         // @Format: u8_norm
+layout(location = 4) in vec4 uv_rect;
+layout(location = 5) in ivec2 slots;        // @Format: s16
+
+layout(std140, row_major, binding = 0) uniform Camera {
+    mat4 pr_matrix;
+};
+layout(location = 4) uniform mat4 ml_matrix;
+
+out vec4 v_color;
+out vec2 v_uv0;
+flat out int v_tex_index;
+flat out int v_mask_index;
+
+void main() {
+    // Corners in triangle strip order: bottom left, bottom right, top left, top right.
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    vec2 local = (corner * 2.0 - 1.0) * half_extents;
+
+    float c = cos(rot);
+    float s = sin(rot);
+    vec2 position = center + vec2(local.x * c - local.y * s, local.x * s + local.y * c);
+
+    v_color = color;
+    v_uv0 = mix(uv_rect.xy, uv_rect.zw, corner);
+    v_tex_index = slots.x;
+    v_mask_index = slots.y;
+
+    gl_Position = pr_matrix * ml_matrix * vec4(position, 0.0, 1.0);
+}
+
+#endif
+
+#ifdef FRAGMENT
+
+layout(location = 0) out vec4 color;
+
+in vec4 v_color;
+in vec2 v_uv0;
+flat in int v_tex_index;
+flat in int v_mask_index;
+
+layout(location = 8) uniform sampler2D u_textures[32];
+
+void main() {
+    // Base color.
+    if (v_tex_index == -1) {
+        color = v_color;
+    }
+    else {
+        color = texture(u_textures[v_tex_index], v_uv0);
+    }
+
+    // Applying mask, distance field masks have their slot offset by 32.
+    if (v_mask_index != -1) {
+        if (v_mask_index >= 32) {
+            float d = texture(u_textures[v_mask_index - 32], v_uv0).x;
+            float w = max(fwidth(d), 0.0001);
+            color.w = smoothstep(0.5 - w, 0.5 + w, d) * color.w;
+        }
+        else {
+            color.w = texture(u_textures[v_mask_index], v_uv0).x * color.w;
+        }
+    }
+}
+
+#endif
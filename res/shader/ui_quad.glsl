@@ -2,19 +2,21 @@
 
 #ifdef VERTEX
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec4 color;
-layout(location = 2) in vec2 uv0;
-layout(location = 3) in vec2 size;
-layout(location = 4) in float mask_index;
-
-layout(location = 0) uniform mat4 pr_matrix;
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec4 color;         // @Format: u8_norm
+layout(location = 2) in vec2 uv0;           // @Format: u16_norm
+layout(location = 3) in vec2 size;          // @Format: half
+layout(location = 4) in int mask_index;     // @Format: s16
+
+layout(std140, row_major, binding = 0) uniform Camera {
+    mat4 pr_matrix;
+};
 layout(location = 4) uniform mat4 ml_matrix;
 
 out vec4 v_color;
 out vec2 v_uv0;
 out vec2 v_size;
-out float v_mask_index;
+flat out int v_mask_index;
 
 void main() {
     v_color = color;
@@ -22,7 +24,7 @@ void main() {
     v_size = size;
     v_mask_index = mask_index;
 
-    gl_Position = pr_matrix * ml_matrix * vec4(position, 1.0);
+    gl_Position = pr_matrix * ml_matrix * vec4(position, 0.0, 1.0);
 }
 
 #endif
@@ -37,14 +39,14 @@ layout(location = 8) uniform sampler2D u_textures[32];
 in vec4 v_color;
 in vec2 v_uv0;
 in vec2 v_size;
-in float v_mask_index;
+flat in int v_mask_index;
 
 #define ROUNDNESS 3.0
 #define BORDER 1.0
 #define AA 1.0
 
 void main() {
-    int mask_index = int(v_mask_index);
+    int mask_index = v_mask_index;
 
     if (mask_index == -1) {
         vec2 uv = (v_uv0 - 0.5) * 2;
@@ -61,6 +63,12 @@ void main() {
         vec3 fill_rgb = mix(vec3(0.0, 0.0, 0.0), v_color.xyz, fill);
 
         color = vec4(fill_rgb, alpha);
+    } else if (mask_index >= 32) {
+        // Distance field mask, its slot is offset by 32.
+        float d = texture(u_textures[mask_index - 32], v_uv0).x;
+        float w = max(fwidth(d), 0.0001);
+        color = v_color;
+        color.w = smoothstep(0.5 - w, 0.5 + w, d) * color.w;
     } else {
         color = v_color;
         color.w = texture(u_textures[mask_index], v_uv0).x * color.w;
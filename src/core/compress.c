@@ -0,0 +1,328 @@
+#include "core/compress.h"
+#include "core/core.h"
+#include "core/type.h"
+#include "core/file.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Block compression.
+ */
+
+#define COMPRESS_MIN_MATCH      4
+#define COMPRESS_MAX_OFFSET     0xffff
+#define COMPRESS_HASH_BITS      12
+
+static inline u32 compress_read32(u8 *ptr) {
+    u32 value;
+    memcpy(&value, ptr, 4);
+    return value;
+}
+
+static inline u32 compress_hash(u32 sequence) {
+    return (sequence * 2654435761u) >> (32 - COMPRESS_HASH_BITS);
+}
+
+/**
+ * Writes length that didn't fit into 4 bits of the token as a run of 255 bytes terminated by the smaller one.
+ */
+static inline u8 *compress_write_length(u8 *op, u32 length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (u8)length;
+    return op;
+}
+
+/**
+ * Emits single sequence of literals optionally followed by a match, match_length of 0 means there is no match.
+ * Returns NULL if sequence doesn't fit into the output.
+ */
+static u8 *compress_write_sequence(u8 *op, u8 *op_end, u8 *literals, u32 literal_length, u32 offset, u32 match_length) {
+    if ((u64)(op_end - op) < 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1) {
+        return NULL;
+    }
+
+    u32 match_code = match_length == 0 ? 0 : match_length - COMPRESS_MIN_MATCH;
+
+    u8 *token = op++;
+    *token = (u8)(((literal_length < 15 ? literal_length : 15) << 4) | (match_code < 15 ? match_code : 15));
+
+    if (literal_length >= 15) {
+        op = compress_write_length(op, literal_length - 15);
+    }
+
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+
+    if (match_length == 0) {
+        return op;
+    }
+
+    *op++ = (u8)(offset & 0xff);
+    *op++ = (u8)(offset >> 8);
+
+    if (match_code >= 15) {
+        op = compress_write_length(op, match_code - 15);
+    }
+
+    return op;
+}
+
+/**
+ * Compresses single block.
+ * Returns compressed size, or 0 if it didn't fit into the capacity.
+ */
+static u32 compress_block(u8 *src, u32 size, u8 *dest, u32 capacity) {
+    u32 table[1 << COMPRESS_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    u8 *op     = dest;
+    u8 *op_end = dest + capacity;
+
+    u32 ip = 0;
+    u32 anchor = 0;
+
+    while (ip + COMPRESS_MIN_MATCH <= size) {
+        u32 sequence = compress_read32(src + ip);
+        u32 hash = compress_hash(sequence);
+
+        // Positions are stored off by one, so 0 means empty slot.
+        u32 candidate = table[hash];
+        table[hash] = ip + 1;
+
+        if (candidate == 0 || ip - (candidate - 1) > COMPRESS_MAX_OFFSET || compress_read32(src + candidate - 1) != sequence) {
+            ip++;
+            continue;
+        }
+
+        u32 match = candidate - 1;
+        u32 length = COMPRESS_MIN_MATCH;
+        while (ip + length < size && src[match + length] == src[ip + length]) {
+            length++;
+        }
+
+        op = compress_write_sequence(op, op_end, src + anchor, ip - anchor, ip - match, length);
+        if (op == NULL) {
+            return 0;
+        }
+
+        ip += length;
+        anchor = ip;
+    }
+
+    // Last sequence is always literals only, it is how decoder knows block has ended.
+    op = compress_write_sequence(op, op_end, src + anchor, size - anchor, 0, 0);
+    if (op == NULL) {
+        return 0;
+    }
+
+    return (u32)(op - dest);
+}
+
+/**
+ * Decompresses single block.
+ * Returns decompressed size, or -1 if block is corrupted or doesn't fit into the capacity.
+ */
+static s64 decompress_block(u8 *src, u32 size, u8 *dest, u64 capacity) {
+    u8 *ip     = src;
+    u8 *ip_end = src + size;
+    u8 *op     = dest;
+    u8 *op_end = dest + capacity;
+
+    while (ip < ip_end) {
+        u8 token = *ip++;
+
+        u64 literal_length = token >> 4;
+        if (literal_length == 15) {
+            u8 byte;
+            do {
+                if (ip >= ip_end) {
+                    return -1;
+                }
+                byte = *ip++;
+                literal_length += byte;
+            } while (byte == 255);
+        }
+
+        if ((u64)(ip_end - ip) < literal_length || (u64)(op_end - op) < literal_length) {
+            return -1;
+        }
+
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        if (ip == ip_end) {
+            break;
+        }
+
+        if (ip_end - ip < 2) {
+            return -1;
+        }
+
+        u32 offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (offset == 0 || offset > op - dest) {
+            return -1;
+        }
+
+        u64 match_length = (token & 0x0f);
+        if (match_length == 15) {
+            u8 byte;
+            do {
+                if (ip >= ip_end) {
+                    return -1;
+                }
+                byte = *ip++;
+                match_length += byte;
+            } while (byte == 255);
+        }
+        match_length += COMPRESS_MIN_MATCH;
+
+        if ((u64)(op_end - op) < match_length) {
+            return -1;
+        }
+
+        // Match can overlap with the bytes it produces, so it is copied byte by byte.
+        u8 *match = op - offset;
+        for (u64 i = 0; i < match_length; i++) {
+            op[i] = match[i];
+        }
+        op += match_length;
+    }
+
+    return op - dest;
+}
+
+
+
+u8 *compress_buffer(u8 *data, u64 size, u64 *compressed_size) {
+    u64 blocks_count = (size + COMPRESS_BLOCK_SIZE - 1) / COMPRESS_BLOCK_SIZE;
+
+    // Worst case every block is stored raw.
+    u8 *container = malloc(COMPRESS_HEADER_SIZE + blocks_count * 4 + size);
+    if (container == NULL) {
+        printf_err("Memory allocation for compressed buffer failed.\n");
+        return NULL;
+    }
+
+    u8 *op = container;
+    write_u32(&op, COMPRESS_HEADER);
+    write_u32(&op, COMPRESS_BLOCK_SIZE);
+    write_u64(&op, size);
+
+    for (u64 offset = 0; offset < size; offset += COMPRESS_BLOCK_SIZE) {
+        u32 block_size = size - offset < COMPRESS_BLOCK_SIZE ? (u32)(size - offset) : COMPRESS_BLOCK_SIZE;
+
+        u8 *size_ptr = op;
+        op += 4;
+
+        // Anything that doesn't get smaller is stored as it is.
+        u32 packed_size = compress_block(data + offset, block_size, op, block_size - 1);
+        if (packed_size == 0) {
+            memcpy(op, data + offset, block_size);
+            packed_size = block_size;
+            write_u32(&size_ptr, packed_size | COMPRESS_BLOCK_STORED);
+        } else {
+            write_u32(&size_ptr, packed_size);
+        }
+
+        op += packed_size;
+    }
+
+    *compressed_size = op - container;
+    return container;
+}
+
+bool compress_check_header(u8 *data, u64 size) {
+    u8 *ptr = data;
+    return size >= COMPRESS_HEADER_SIZE && read_u32(&ptr) == COMPRESS_HEADER;
+}
+
+
+bool decompress_stream_begin(Decompress_Stream *stream, u8 *data, u64 size) {
+    if (!compress_check_header(data, size)) {
+        return false;
+    }
+
+    u8 *ptr = data + 4;
+    stream->block_size = read_u32(&ptr);
+    stream->raw_size   = read_u64(&ptr);
+    stream->raw_done   = 0;
+    stream->src        = data + COMPRESS_HEADER_SIZE;
+    stream->src_end    = data + size;
+
+    return stream->block_size != 0;
+}
+
+s64 decompress_stream_next(Decompress_Stream *stream, u8 *dest, u64 capacity) {
+    if (stream->raw_done >= stream->raw_size) {
+        return 0;
+    }
+
+    if (stream->src_end - stream->src < 4) {
+        return -1;
+    }
+
+    u32 packed_size = read_u32(&stream->src);
+    bool stored = packed_size & COMPRESS_BLOCK_STORED;
+    packed_size &= ~COMPRESS_BLOCK_STORED;
+
+    if ((u64)(stream->src_end - stream->src) < packed_size) {
+        return -1;
+    }
+
+    u64 expected = stream->raw_size - stream->raw_done < stream->block_size ? stream->raw_size - stream->raw_done : stream->block_size;
+    if (capacity < expected) {
+        return -1;
+    }
+
+    s64 written;
+    if (stored) {
+        if (packed_size != expected) {
+            return -1;
+        }
+        memcpy(dest, stream->src, packed_size);
+        written = packed_size;
+    } else {
+        written = decompress_block(stream->src, packed_size, dest, expected);
+        if (written != (s64)expected) {
+            return -1;
+        }
+    }
+
+    stream->src += packed_size;
+    stream->raw_done += written;
+
+    return written;
+}
+
+u8 *decompress_buffer(u8 *data, u64 size, u64 *raw_size) {
+    Decompress_Stream stream;
+    if (!decompress_stream_begin(&stream, data, size)) {
+        printf_err("Couldn't decompress buffer, container header doesn't match.\n");
+        return NULL;
+    }
+
+    u8 *buffer = malloc(stream.raw_size + 1);
+    if (buffer == NULL) {
+        printf_err("Memory allocation for decompressed buffer failed.\n");
+        return NULL;
+    }
+
+    s64 written;
+    while ((written = decompress_stream_next(&stream, buffer + stream.raw_done, stream.raw_size - stream.raw_done)) > 0);
+
+    if (written < 0) {
+        printf_err("Couldn't decompress buffer, container is corrupted.\n");
+        free(buffer);
+        return NULL;
+    }
+
+    *raw_size = stream.raw_size;
+    return buffer;
+}
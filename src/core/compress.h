@@ -0,0 +1,75 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include "core/core.h"
+#include "core/type.h"
+
+/**
+ * Block compression.
+ *
+ * Byte oriented LZ77 codec in the spirit of LZ4: data is split into independent blocks, each block is a sequence of
+ * literal runs followed by back references into the same block. It doesn't compress as good as entropy coders, but decoding is
+ * little more than a memcpy, which is what matters for loading.
+ *
+ * Container layout (little endian):
+ *  |------------------------|
+ *  | u32 magic              |   COMPRESS_HEADER.
+ *  | u32 block_size         |   Max raw size of the block.
+ *  | u64 raw_size           |   Size of the whole decompressed data.
+ *  |------------------------|
+ *  | u32 packed_size        |   Repeated for each block, if COMPRESS_BLOCK_STORED bit is set, block is stored raw.
+ *  | u8  data[packed_size]  |
+ *  |------------------------|
+ */
+
+// 0x6c7a626b stands for 'lzbk' in ascii.
+#define COMPRESS_HEADER         0x6c7a626b
+#define COMPRESS_HEADER_SIZE    16
+#define COMPRESS_BLOCK_SIZE     (64 * 1024)
+#define COMPRESS_BLOCK_STORED   0x80000000
+
+/**
+ * Compresses data into the container described above.
+ * Returns pointer to malloc'ed container and sets its size in bytes into compressed_size.
+ * Returns NULL on failure.
+ * @Important: Container should be freed manually when not used anymore.
+ */
+u8 *compress_buffer(u8 *data, u64 size, u64 *compressed_size);
+
+/**
+ * Returns true if data starts with the compressed container header.
+ */
+bool compress_check_header(u8 *data, u64 size);
+
+
+typedef struct decompress_stream {
+    u8  *src;           // Next block in the container.
+    u8  *src_end;
+    u32 block_size;
+    u64 raw_size;
+    u64 raw_done;       // Bytes already decompressed.
+} Decompress_Stream;
+
+/**
+ * Begins streaming decompression of the container, container memory is read in place and should stay alive until the stream is done.
+ * Returns false if container header is invalid.
+ */
+bool decompress_stream_begin(Decompress_Stream *stream, u8 *data, u64 size);
+
+/**
+ * Decompresses next block directly into dest, dest should have room for at least "stream->block_size" bytes or the rest of the data.
+ * Returns number of bytes written into dest, 0 if stream is finished.
+ * Returns -1 if container is corrupted.
+ */
+s64 decompress_stream_next(Decompress_Stream *stream, u8 *dest, u64 capacity);
+
+/**
+ * Decompresses whole container into a single malloc'ed buffer, blocks are decoded straight into their place in it.
+ * Returns pointer to the buffer and sets its size in bytes into raw_size.
+ * Returns NULL on failure.
+ * @Important: Buffer should be freed manually when not used anymore.
+ */
+u8 *decompress_buffer(u8 *data, u64 size, u64 *raw_size);
+
+
+#endif
@@ -126,6 +126,7 @@ void ti_reset(T_Interpolator *interpolator) {
     #include <windows.h>
 #elif defined(__APPLE__) || defined(__MACH__) || defined(__linux__) || defined(__unix__)
     #include <time.h>
+    #include <errno.h>
 #else
     #error "No high-resolution timer available for this platform"
 #endif
@@ -163,5 +164,38 @@ u64 get_time_ns() {
 #endif
 }
 
+void sleep_ns(u64 ns) {
+#if defined(_WIN32)
+    // High resolution timer wakes up within a fraction of millisecond, "Sleep()" can oversleep by a whole scheduler tick.
+    // Flag is defined here, since older MinGW headers don't have it.
+    static HANDLE timer = NULL;
+    if (timer == NULL) {
+        timer = CreateWaitableTimerExW(NULL, NULL, 0x00000002 /* CREATE_WAITABLE_TIMER_HIGH_RESOLUTION */, TIMER_ALL_ACCESS);
+        if (timer == NULL) {
+            timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+        }
+    }
+
+    // Due time is relative when negative, in 100 nano second intervals.
+    LARGE_INTEGER due;
+    due.QuadPart = -(LONGLONG)(ns / 100);
+    if (timer == NULL || !SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) {
+        Sleep((DWORD)(ns / 1000000ULL));
+        return;
+    }
+    (void)WaitForSingleObject(timer, INFINITE);
+
+#elif defined(__APPLE__) || defined(__MACH__) || defined(__linux__) || defined(__unix__)
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000ULL);
+    ts.tv_nsec = (long)(ns % 1000000000ULL);
+
+    // Sleep is continued with remaining time if it gets interrupted by a signal.
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+
+#endif
+}
+
 
 
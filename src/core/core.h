@@ -125,6 +125,12 @@ void ti_reset(T_Interpolator *interpolator);
  */
 u64 get_time_ns();
 
+/**
+ * Suspends calling thread for at least given nano seconds, using the finest timer available on the platform.
+ * @Important: Thread can still wake up later than asked by up to the scheduler's granularity, so precise waits should spin for the last part.
+ */
+void sleep_ns(u64 ns);
+
 
 
 
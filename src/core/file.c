@@ -4,6 +4,16 @@
 #include "core/str.h"
 #include <stdio.h>
 
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <errno.h>
+#endif
+
 /**
  * File utils.
  */
@@ -110,8 +120,95 @@ int fwrite_str(String str, FILE *file) {
 }
 
 
+bool file_map(char *file_name, File_Mapping *mapping) {
+    *mapping = (File_Mapping) {0};
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf_err("Couldn't open the file for mapping '%s'.\n", file_name);
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        printf_err("Couldn't map the file '%s', it is empty or its size is unknown.\n", file_name);
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (map == NULL) {
+        printf_err("Couldn't create mapping of the file '%s'.\n", file_name);
+        return false;
+    }
+
+    void *view = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+        printf_err("Couldn't map view of the file '%s'.\n", file_name);
+        CloseHandle(map);
+        return false;
+    }
 
+    mapping->data   = view;
+    mapping->size   = (u64)size.QuadPart;
+    mapping->handle = map;
+#else
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        printf_err("Couldn't open the file for mapping '%s'.\n", file_name);
+        return false;
+    }
 
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        printf_err("Couldn't map the file '%s', it is empty or its size is unknown.\n", file_name);
+        close(fd);
+        return false;
+    }
 
+    void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        printf_err("Couldn't map the file '%s'.\n", file_name);
+        return false;
+    }
 
+    mapping->data   = view;
+    mapping->size   = (u64)st.st_size;
+    mapping->handle = NULL;
+#endif
 
+    return true;
+}
+
+void file_unmap(File_Mapping *mapping) {
+    if (mapping->data == NULL) {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(mapping->data);
+    CloseHandle((HANDLE)mapping->handle);
+#else
+    munmap(mapping->data, (size_t)mapping->size);
+#endif
+
+    *mapping = (File_Mapping) {0};
+}
+
+bool make_directory(char *path) {
+#if defined(_WIN32)
+    if (CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS) {
+        return true;
+    }
+#else
+    if (mkdir(path, 0755) == 0 || errno == EEXIST) {
+        return true;
+    }
+#endif
+
+    printf_err("Couldn't make the directory '%s'.\n", path);
+    return false;
+}
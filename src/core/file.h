@@ -43,6 +43,32 @@ int write_str_to_file(String str, char *file_name);
 int fwrite_str(String str, FILE *file);
 
 
+typedef struct file_mapping {
+    u8      *data;      // Read only view of the file contents.
+    u64     size;       // Size of the mapped view in bytes.
+    void    *handle;    // Platform specific handle that keeps mapping alive.
+} File_Mapping;
+
+/**
+ * Maps contents of the file into read only memory of the process, without copying it into the buffer.
+ * Returns true on success and fills the mapping structure.
+ * Returns false if file couldn't be opened, is empty or mapping failed.
+ * @Important: Mapping should be released with "file_unmap()" when not used anymore.
+ */
+bool file_map(char *file_name, File_Mapping *mapping);
+
+/**
+ * Releases memory mapping previously created with "file_map()".
+ */
+void file_unmap(File_Mapping *mapping);
+
+/**
+ * Makes the directory, parent directory should already exist.
+ * Returns true if the directory was made or already exists.
+ */
+bool make_directory(char *path);
+
+
 /**
  * Writes 32 bit integer to the file, enforcing little endian.
  */
@@ -97,6 +123,31 @@ static inline u8 read_byte(u8 **ptr) {
     return *(*ptr)++;
 }
 
+/**
+ * Following functions are counterparts of read_*() functions, they write value into the buffer, enforcing little endian, and advance the pointer.
+ */
+static inline void write_u32(u8 **ptr, u32 value) {
+    value = to_le32(value);
+    memcpy(*ptr, &value, 4);
+    *ptr += 4;
+}
+
+static inline void write_u64(u8 **ptr, u64 value) {
+    value = to_le64(value);
+    memcpy(*ptr, &value, 8);
+    *ptr += 8;
+}
+
+static inline void write_float(u8 **ptr, float value) {
+    u32 bits;
+    memcpy(&bits, &value, 4);
+    write_u32(ptr, bits);
+}
+
+static inline void write_byte(u8 **ptr, u8 value) {
+    *(*ptr)++ = value;
+}
+
 
 
 
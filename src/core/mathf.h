@@ -306,6 +306,10 @@ static inline bool aabb_touches_point(AABB *box, Vec2f point) {
     return value_inside_domain(box->p0.x, box->p1.x, point.x) && value_inside_domain(box->p0.y, box->p1.y, point.y);
 }
 
+static inline bool aabb_touches_aabb(AABB *box1, AABB *box2) {
+    return box1->p0.x <= box2->p1.x && box2->p0.x <= box1->p1.x && box1->p0.y <= box2->p1.y && box2->p0.y <= box1->p1.y;
+}
+
 
 // Rework obb with static inline functions, NOT macros.
 typedef struct oriented_bounding_box {
@@ -29,7 +29,7 @@ int asset_observer_init(char *directory) {
 bool asset_view_changes(u32 *count, const Asset_Change **changes) {
     *count = array_list_length(&asset_changes_list);
 
-    if (count > 0) {
+    if (*count > 0) {
         *changes = asset_changes_list;
         return true;
     }
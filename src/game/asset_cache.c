@@ -0,0 +1,129 @@
+#include "game/asset_cache.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/file.h"
+#include "core/log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+// Entry header: magic, version, key, size of the contents and hash of the contents, contents follow right after it.
+#define ASSET_CACHE_MAGIC       0x48434341 // "ACCH"
+#define ASSET_CACHE_HEADER_SIZE (4 + 4 + 8 + 8 + 8)
+
+static bool directory_made = false;
+
+u64 asset_cache_hash(void *data, u64 size, u64 seed) {
+    u64 hash = seed;
+    u8 *bytes = data;
+    for (u64 i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static void asset_cache_path(char *path, u64 path_size, char *kind, u64 key) {
+    (void)snprintf(path, path_size, "%s/%s_%016llx.bin", ASSET_CACHE_DIRECTORY, kind, (unsigned long long)key);
+}
+
+void *asset_cache_read(char *kind, u64 key, u64 *size) {
+    char path[256];
+    asset_cache_path(path, sizeof(path), kind, key);
+
+    // Missing entry is the usual case on the first launch, so it isn't reported.
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    long file_size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        file_size = ftell(file);
+    }
+    if (file_size < ASSET_CACHE_HEADER_SIZE || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    u8 header[ASSET_CACHE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+        fclose(file);
+        return NULL;
+    }
+
+    u8 *ptr = header;
+    u32 magic           = read_u32(&ptr);
+    u32 version         = read_u32(&ptr);
+    u64 entry_key       = read_u64(&ptr);
+    u64 contents_size   = read_u64(&ptr);
+    u64 contents_hash   = read_u64(&ptr);
+
+    if (magic != ASSET_CACHE_MAGIC || version != ASSET_CACHE_VERSION || entry_key != key) {
+        fclose(file);
+        return NULL;
+    }
+
+    // Size from the header is only trusted if the file actually holds that much, so corrupted header doesn't make it allocate whatever it says.
+    if (contents_size != (u64)file_size - ASSET_CACHE_HEADER_SIZE) {
+        LOG_WARNING("Asset cache entry '%s' is corrupted, it will be made again.", path);
+        fclose(file);
+        return NULL;
+    }
+
+    u8 *contents = allocator_alloc(&std_allocator, contents_size > 0 ? contents_size : 1);
+    bool complete = fread(contents, 1, contents_size, file) == contents_size;
+    fclose(file);
+
+    if (!complete || asset_cache_hash(contents, contents_size, ASSET_CACHE_SEED) != contents_hash) {
+        LOG_WARNING("Asset cache entry '%s' is corrupted, it will be made again.", path);
+        allocator_free(&std_allocator, contents);
+        return NULL;
+    }
+
+    *size = contents_size;
+    return contents;
+}
+
+bool asset_cache_write(char *kind, u64 key, void *data, u64 size) {
+    if (!directory_made) {
+        directory_made = make_directory(ASSET_CACHE_DIRECTORY);
+        if (!directory_made) {
+            return false;
+        }
+    }
+
+    char path[256];
+    char temporary_path[256 + 4];
+    asset_cache_path(path, sizeof(path), kind, key);
+    (void)snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+
+    FILE *file = fopen(temporary_path, "wb");
+    if (file == NULL) {
+        LOG_WARNING("Couldn't write asset cache entry '%s'.", path);
+        return false;
+    }
+
+    u8 header[ASSET_CACHE_HEADER_SIZE];
+    u8 *ptr = header;
+    write_u32(&ptr, ASSET_CACHE_MAGIC);
+    write_u32(&ptr, ASSET_CACHE_VERSION);
+    write_u64(&ptr, key);
+    write_u64(&ptr, size);
+    write_u64(&ptr, asset_cache_hash(data, size, ASSET_CACHE_SEED));
+
+    bool written = fwrite(header, 1, sizeof(header), file) == sizeof(header) && fwrite(data, 1, size, file) == size;
+    written &= fclose(file) == 0;
+
+    // Entry is written next to its place and moved there when complete, so interrupted write never leaves half of the entry behind.
+    (void)remove(path);
+    if (!written || rename(temporary_path, path) != 0) {
+        LOG_WARNING("Couldn't write asset cache entry '%s'.", path);
+        (void)remove(temporary_path);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include "core/core.h"
+#include "core/type.h"
+
+#include <stdbool.h>
+
+/**
+ * Asset cache.
+ *
+ * Keeps results of slow asset processing on disk, so following launches skip straight to uploading them:
+ * baked font bitmaps with glyph metrics, decoded images and linked program binaries.
+ * Every entry is a file in ASSET_CACHE_DIRECTORY named after its kind and key, key is hash of everything the result depends on,
+ * like contents of the source file, parameters it was processed with and, for program binaries, the driver.
+ * So changed source makes a new entry instead of invalidating the old one, stale entries are left until the directory is cleared.
+ * Entry that is missing, truncated, corrupted or written by another version of the cache is a miss.
+ */
+
+#define ASSET_CACHE_DIRECTORY   "cache"
+#define ASSET_CACHE_VERSION     1
+
+// Seed of the hash, keys of different kinds and parameters are made by hashing them on top of each other.
+#define ASSET_CACHE_SEED        0xcbf29ce484222325ull
+
+/**
+ * Returns 64 bit FNV-1a hash of the data continuing from the seed.
+ */
+u64 asset_cache_hash(void *data, u64 size, u64 seed);
+
+/**
+ * Returns contents of the entry and sets their size, or NULL if there is no valid entry of the kind with the key.
+ * @Important: Contents should be freed with std_allocator when not used anymore.
+ */
+void *asset_cache_read(char *kind, u64 key, u64 *size);
+
+/**
+ * Writes the entry, replacing one with the same kind and key.
+ * Returns false if it couldn't be written, cache is only an optimization so callers may ignore it.
+ */
+bool asset_cache_write(char *kind, u64 key, void *data, u64 size);
+
+
+#endif
@@ -0,0 +1,256 @@
+#include "game/atlas.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/structs.h"
+#include "core/log.h"
+
+#include <GL/glew.h>
+
+#include <string.h>
+
+
+typedef struct atlas_skyline_node {
+    s32 x;
+    s32 y;                  // Height of the filled space over the node.
+    s32 width;
+} Atlas_Skyline_Node;
+
+typedef struct atlas_page {
+    Texture             texture;
+    Atlas_Skyline_Node  *skyline;   // Nodes are sorted by x and cover the whole page width without gaps.
+} Atlas_Page;
+
+
+static Atlas_Page   pages[ATLAS_MAX_PAGES];
+static u32          pages_count;
+
+
+
+static bool atlas_page_make(Atlas_Page *page) {
+    page->texture.width  = ATLAS_PAGE_SIZE;
+    page->texture.height = ATLAS_PAGE_SIZE;
+
+    // Page is cleared to transparent, so padding around the images doesn't bleed when filtered.
+    u8 *clear = calloc(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE, 4);
+    if (clear == NULL) {
+        LOG_ERROR("Couldn't allocate memory to clear atlas page.");
+        return false;
+    }
+
+    gpu->gen_textures(1, &page->texture.id);
+    gl_bind_texture(0, page->texture.id);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gpu->tex_image_2d(GL_TEXTURE_2D, 0, GL_RGBA, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, clear);
+    gl_bind_texture(0, 0);
+
+    free(clear);
+
+    page->skyline = array_list_make(Atlas_Skyline_Node, 32, &std_allocator);
+    array_list_append(&page->skyline, ((Atlas_Skyline_Node) { .x = 0, .y = 0, .width = ATLAS_PAGE_SIZE }));
+
+    return true;
+}
+
+/**
+ * Returns y at which rectangle of specified size fits if its left edge is placed at the node index, or -1 if it doesn't fit.
+ */
+static s32 atlas_skyline_fit(Atlas_Page *page, u32 index, s32 width, s32 height) {
+    Atlas_Skyline_Node *skyline = page->skyline;
+
+    if (skyline[index].x + width > ATLAS_PAGE_SIZE) {
+        return -1;
+    }
+
+    s32 y = 0;
+    s32 remaining = width;
+    for (u32 i = index; remaining > 0; i++) {
+        if (skyline[i].y > y) {
+            y = skyline[i].y;
+        }
+        if (y + height > ATLAS_PAGE_SIZE) {
+            return -1;
+        }
+        remaining -= skyline[i].width;
+    }
+
+    return y;
+}
+
+/**
+ * Finds bottom left position for the rectangle, such that its top is the lowest, ties are broken by the narrowest node.
+ * Raises the skyline over the found position and returns true, or returns false if rectangle doesn't fit into the page.
+ */
+static bool atlas_skyline_insert(Atlas_Page *page, s32 width, s32 height, s32 *x, s32 *y) {
+    s64 best_index = -1;
+    s32 best_top = ATLAS_PAGE_SIZE + 1;
+    s32 best_width = 0;
+
+    for (u32 i = 0; i < array_list_length(&page->skyline); i++) {
+        s32 fit_y = atlas_skyline_fit(page, i, width, height);
+        if (fit_y < 0) {
+            continue;
+        }
+
+        s32 top = fit_y + height;
+        if (top < best_top || (top == best_top && page->skyline[i].width < best_width)) {
+            best_index = i;
+            best_top   = top;
+            best_width = page->skyline[i].width;
+        }
+    }
+
+    if (best_index < 0) {
+        return false;
+    }
+
+    *x = page->skyline[best_index].x;
+    *y = best_top - height;
+
+    array_list_add(&page->skyline, best_index, ((Atlas_Skyline_Node) { .x = *x, .y = best_top, .width = width }));
+
+    // Nodes covered by the new one are shrunk or removed.
+    u32 i = best_index + 1;
+    while (i < array_list_length(&page->skyline)) {
+        Atlas_Skyline_Node *previous = &page->skyline[i - 1];
+        Atlas_Skyline_Node *node = &page->skyline[i];
+
+        s32 overlap = previous->x + previous->width - node->x;
+        if (overlap <= 0) {
+            break;
+        }
+
+        if (node->width > overlap) {
+            node->x     += overlap;
+            node->width -= overlap;
+            break;
+        }
+
+        u32 length = array_list_length(&page->skyline);
+        (void)memmove(&page->skyline[i], &page->skyline[i + 1], (length - i - 1) * sizeof(Atlas_Skyline_Node));
+        array_list_pop(&page->skyline);
+    }
+
+    // Neighbouring nodes at the same height are merged.
+    i = 1;
+    while (i < array_list_length(&page->skyline)) {
+        if (page->skyline[i - 1].y == page->skyline[i].y) {
+            page->skyline[i - 1].width += page->skyline[i].width;
+
+            u32 length = array_list_length(&page->skyline);
+            (void)memmove(&page->skyline[i], &page->skyline[i + 1], (length - i - 1) * sizeof(Atlas_Skyline_Node));
+            array_list_pop(&page->skyline);
+        } else {
+            i++;
+        }
+    }
+
+    return true;
+}
+
+
+
+bool atlas_pack(u8 *pixels, s32 width, s32 height, s32 channels, Atlas_Region *region) {
+    if (channels != 1 && channels != 4) {
+        LOG_ERROR("Atlas can't pack image with %d channels.", channels);
+        return false;
+    }
+
+    s32 padded_width  = width + ATLAS_PADDING * 2;
+    s32 padded_height = height + ATLAS_PADDING * 2;
+    if (padded_width > ATLAS_PAGE_SIZE || padded_height > ATLAS_PAGE_SIZE) {
+        LOG_ERROR("Image of size %dx%d is too big for the atlas page.", width, height);
+        return false;
+    }
+
+    // Looking for space in existing pages first, then starting a new one.
+    Atlas_Page *page = NULL;
+    s32 x, y;
+    for (u32 i = 0; i < pages_count; i++) {
+        if (atlas_skyline_insert(&pages[i], padded_width, padded_height, &x, &y)) {
+            page = &pages[i];
+            break;
+        }
+    }
+
+    if (page == NULL) {
+        if (pages_count == ATLAS_MAX_PAGES) {
+            LOG_ERROR("Atlas is out of pages, couldn't pack image of size %dx%d.", width, height);
+            return false;
+        }
+        if (!atlas_page_make(&pages[pages_count])) {
+            return false;
+        }
+        page = &pages[pages_count++];
+        (void)atlas_skyline_insert(page, padded_width, padded_height, &x, &y);
+    }
+
+    x += ATLAS_PADDING;
+    y += ATLAS_PADDING;
+
+    u8 *rgba = pixels;
+    if (channels == 1) {
+        rgba = malloc(width * height * 4);
+        for (s32 i = 0; i < width * height; i++) {
+            (void)memset(rgba + i * 4, pixels[i], 4);
+        }
+    }
+
+    gl_bind_texture(0, page->texture.id);
+    gpu->tex_sub_image_2d(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    gl_bind_texture(0, 0);
+
+    if (rgba != pixels) {
+        free(rgba);
+    }
+
+    *region = (Atlas_Region) {
+        .texture = &page->texture,
+        .x       = x,
+        .y       = y,
+        .width   = width,
+        .height  = height,
+        .uv      = {
+            .uv0 = vec2f_make((float)x / (float)ATLAS_PAGE_SIZE, (float)y / (float)ATLAS_PAGE_SIZE),
+            .uv1 = vec2f_make((float)(x + width) / (float)ATLAS_PAGE_SIZE, (float)(y + height) / (float)ATLAS_PAGE_SIZE),
+        },
+    };
+
+    return true;
+}
+
+bool atlas_load(char *image_path, Atlas_Region *region) {
+    s32 width, height, channels;
+    u8 *data = image_load(image_path, &width, &height, &channels, 4);
+    if (data == NULL) {
+        LOG_ERROR("Stbi couldn't load image '%s' for the atlas.", image_path);
+        return false;
+    }
+
+    bool result = atlas_pack(data, width, height, 4, region);
+
+    allocator_free(&std_allocator, data);
+
+    return result;
+}
+
+UV_Region atlas_remap_uv(Atlas_Region *region, UV_Region uv) {
+    Vec2f size = vec2f_difference(region->uv.uv1, region->uv.uv0);
+
+    return (UV_Region) {
+        .uv0 = vec2f_sum(region->uv.uv0, vec2f_make(uv.uv0.x * size.x, uv.uv0.y * size.y)),
+        .uv1 = vec2f_sum(region->uv.uv0, vec2f_make(uv.uv1.x * size.x, uv.uv1.y * size.y)),
+    };
+}
+
+void atlas_free() {
+    for (u32 i = 0; i < pages_count; i++) {
+        texture_unload(&pages[i].texture);
+        array_list_free(&pages[i].skyline);
+    }
+
+    pages_count = 0;
+}
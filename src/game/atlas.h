@@ -0,0 +1,57 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "core/core.h"
+#include "core/type.h"
+
+#include "game/graphics.h"
+
+/**
+ * Texture atlas.
+ *
+ * Packs sprites and glyph bitmaps at load time into a few large RGBA pages, so most of the quads drawn in a frame sample the same texture,
+ * and draws of different sprites or fonts can be merged into one draw call instead of filling up texture slots.
+ * Images are placed with skyline bottom left packing, each one is padded by ATLAS_PADDING transparent pixels to avoid bleeding with linear filtering.
+ * Space of the packed images is never reclaimed, pages live until "atlas_free()" is called.
+ * @Important: All functions below should be called with OpenGL context current, while render thread runs it is taken with "graphics_context_acquire()".
+ */
+
+#define ATLAS_PAGE_SIZE         2048
+#define ATLAS_MAX_PAGES         4
+#define ATLAS_PADDING           1
+
+typedef struct atlas_region {
+    Texture     *texture;       // Atlas page the image is packed into.
+    s32         x;              // Pixel position of the image in the page.
+    s32         y;
+    s32         width;
+    s32         height;
+    UV_Region   uv;             // Region of the page that covers the image.
+} Atlas_Region;
+
+
+/**
+ * Packs image into the atlas, pixels are rows of "width" pixels that have 1 or 4 channels.
+ * One channel images (such as glyph bitmaps) are written into all four channels, so they can be used both as mask and as texture.
+ * Returns true and sets region on success, returns false if the image doesn't fit into any page.
+ */
+bool atlas_pack(u8 *pixels, s32 width, s32 height, s32 channels, Atlas_Region *region);
+
+/**
+ * Loads image file and packs it into the atlas.
+ * Returns true and sets region on success.
+ */
+bool atlas_load(char *image_path, Atlas_Region *region);
+
+/**
+ * Maps uv coordinates local to the packed image, for example ones from "uv_slice()", into uv coordinates of the atlas page.
+ */
+UV_Region atlas_remap_uv(Atlas_Region *region, UV_Region uv);
+
+/**
+ * Deletes all of the atlas pages, every region packed before is invalid after this call.
+ */
+void atlas_free();
+
+
+#endif
@@ -0,0 +1,371 @@
+#include "game/capture.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/str.h"
+#include "core/structs.h"
+#include "core/file.h"
+#include "core/log.h"
+
+#include "game/graphics.h"
+#include "game/console.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb/stb_image_write.h"
+
+
+typedef struct capture_job {
+    Frame_Readback  readback;
+    char            *path;          // PNG file of the screenshot, NULL for frames of a sequence.
+    FILE            *sequence;      // Sequence file the frame is appended to.
+    u32             frame;
+    u64             time_ns;
+    bool            close;          // Closes the sequence file, it is queued after every frame of the sequence.
+} Capture_Job;
+
+
+static SDL_Thread   *worker;
+static SDL_mutex    *mutex;
+static SDL_cond     *work_cond;     // Signaled when job is queued or worker should quit.
+
+// Following variables are shared with the worker and are guarded by the mutex.
+static Capture_Job  *jobs;
+static bool         worker_quit;
+
+// Following variables are only used by the main thread.
+// Targets are jobs waiting for their frames to be read back, readback id of the job is 0 for closing jobs.
+static Capture_Job  *targets;
+static char         **screenshot_paths;     // Screenshots of the frame being recorded.
+static FILE         *sequence;
+static u32          sequence_frame;
+static u32          sequence_skipped;
+static u64          sequence_start_ns;
+
+
+
+/**
+ * Writes RGBA pixels read from OpenGL as RGB PNG, alpha isn't written, since blending leaves it meaningless in the framebuffer.
+ * Pixels are packed into RGB in place, rows are read bottom to top, which "stbi_flip_vertically_on_write()" set in "capture_init()" accounts for.
+ */
+static bool png_write(char *path, u8 *rgba, s32 width, s32 height) {
+    u64 pixels = (u64)width * height;
+    for (u64 i = 0; i < pixels; i++) {
+        memmove(rgba + i * 3, rgba + i * 4, 3);
+    }
+
+    return stbi_write_png(path, width, height, 3, rgba, width * 3) != 0;
+}
+
+
+
+static void capture_write(Capture_Job *job) {
+    if (job->close) {
+        (void)fclose(job->sequence);
+        return;
+    }
+
+    if (job->path != NULL) {
+        if (png_write(job->path, job->readback.pixels, job->readback.width, job->readback.height)) {
+            LOG_INFO("Screenshot is written to '%s'.", job->path);
+        } else {
+            LOG_ERROR("Couldn't write screenshot '%s'.", job->path);
+        }
+        free(job->path);
+    } else {
+        u8 header[4 + 4 + 4 + 8];
+        u8 *ptr = header;
+        write_u32(&ptr, job->frame);
+        write_u32(&ptr, (u32)job->readback.width);
+        write_u32(&ptr, (u32)job->readback.height);
+        write_u64(&ptr, job->time_ns);
+
+        u64 bytes = (u64)job->readback.width * job->readback.height * 4;
+        if (fwrite(header, 1, sizeof(header), job->sequence) != sizeof(header) || fwrite(job->readback.pixels, 1, bytes, job->sequence) != bytes) {
+            LOG_ERROR("Couldn't write frame %u of captured sequence.", job->frame);
+        }
+    }
+
+    allocator_free(&std_allocator, job->readback.pixels);
+}
+
+static int capture_worker(void *data) {
+    SDL_LockMutex(mutex);
+
+    while (true) {
+        while (!worker_quit && array_list_length(&jobs) == 0) {
+            SDL_CondWait(work_cond, mutex);
+        }
+
+        // Worker quits only once every queued job is written.
+        if (array_list_length(&jobs) == 0) {
+            break;
+        }
+
+        // Jobs are taken in order, so frames of a sequence are written in order.
+        Capture_Job job = jobs[0];
+        memmove(jobs, jobs + 1, (array_list_length(&jobs) - 1) * sizeof(Capture_Job));
+        array_list_pop(&jobs);
+
+        SDL_UnlockMutex(mutex);
+
+        capture_write(&job);
+
+        SDL_LockMutex(mutex);
+    }
+
+    SDL_UnlockMutex(mutex);
+
+    return 0;
+}
+
+static void capture_init() {
+    if (mutex != NULL) {
+        return;
+    }
+
+    jobs             = array_list_make(Capture_Job, CAPTURE_QUEUE_MAX, &std_allocator);
+    targets          = array_list_make(Capture_Job, CAPTURE_QUEUE_MAX, &std_allocator);
+    screenshot_paths = array_list_make(char *, 4, &std_allocator);
+
+    // Frames are read back bottom to top.
+    stbi_flip_vertically_on_write(true);
+
+    worker_quit = false;
+    mutex     = SDL_CreateMutex();
+    work_cond = SDL_CreateCond();
+    worker    = SDL_CreateThread(capture_worker, "capture", NULL);
+}
+
+static void capture_queue(Capture_Job job) {
+    SDL_LockMutex(mutex);
+    array_list_append(&jobs, job);
+    SDL_CondSignal(work_cond);
+    SDL_UnlockMutex(mutex);
+}
+
+static void targets_remove(u32 index) {
+    memmove(targets + index, targets + index + 1, (array_list_length(&targets) - index - 1) * sizeof(Capture_Job));
+    array_list_pop(&targets);
+}
+
+/**
+ * Hands read back frames to the worker, and closes sequences once all of their frames are handed.
+ */
+static void capture_collect() {
+    Frame_Readback readback;
+    while (graphics_readback_collect(&readback)) {
+        bool taken = false;
+
+        for (u32 i = 0; i < array_list_length(&targets); i++) {
+            if (targets[i].readback.id != readback.id) {
+                continue;
+            }
+
+            Capture_Job job = targets[i];
+            targets_remove(i);
+            i--;
+
+            if (readback.pixels == NULL) {
+                free(job.path);
+                continue;
+            }
+
+            // Frame can be both a screenshot and a frame of the sequence, then each of them gets its own pixels.
+            job.readback = readback;
+            if (taken) {
+                u64 bytes = (u64)readback.width * readback.height * 4;
+                job.readback.pixels = allocator_alloc(&std_allocator, bytes);
+                memcpy(job.readback.pixels, readback.pixels, bytes);
+            }
+            taken = true;
+
+            capture_queue(job);
+        }
+
+        if (!taken) {
+            allocator_free(&std_allocator, readback.pixels);
+        }
+    }
+
+    while (array_list_length(&targets) > 0 && targets[0].close) {
+        capture_queue(targets[0]);
+        targets_remove(0);
+    }
+}
+
+
+
+void capture_screenshot(char *path) {
+    capture_init();
+
+    u64 length = strlen(path);
+    char *copy = malloc(length + 1);
+    memcpy(copy, path, length + 1);
+    array_list_append(&screenshot_paths, copy);
+}
+
+bool capture_sequence_start(char *path) {
+    capture_init();
+    capture_sequence_stop();
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        LOG_ERROR("Couldn't open frame sequence '%s' for writing.", path);
+        return false;
+    }
+
+    u8 header[8];
+    u8 *ptr = header;
+    memcpy(ptr, "RFSQ", 4);
+    ptr += 4;
+    write_u32(&ptr, CAPTURE_SEQUENCE_VERSION);
+    (void)fwrite(header, 1, sizeof(header), file);
+
+    sequence            = file;
+    sequence_frame      = 0;
+    sequence_skipped    = 0;
+    sequence_start_ns   = get_time_ns();
+
+    return true;
+}
+
+void capture_sequence_stop() {
+    if (sequence == NULL) {
+        return;
+    }
+
+    // File is closed by the worker after the frames still being read back.
+    Capture_Job close = {
+        .sequence   = sequence,
+        .close      = true,
+    };
+    array_list_append(&targets, close);
+
+    console_log("Frame capture stopped, %u frames captured, %u skipped.\n", sequence_frame - sequence_skipped, sequence_skipped);
+    sequence = NULL;
+}
+
+void capture_update(s32 width, s32 height) {
+    if (mutex == NULL) {
+        return;
+    }
+
+    if (sequence != NULL) {
+        SDL_LockMutex(mutex);
+        u32 queued = array_list_length(&jobs);
+        SDL_UnlockMutex(mutex);
+
+        // Skipping frames instead of letting the queue grow, if the worker can't keep up.
+        if (queued + array_list_length(&targets) >= CAPTURE_QUEUE_MAX) {
+            sequence_skipped++;
+        } else {
+            Capture_Job job = {
+                .readback.id    = graphics_readback_request(width, height),
+                .sequence       = sequence,
+                .frame          = sequence_frame,
+                .time_ns        = get_time_ns() - sequence_start_ns,
+            };
+            array_list_append(&targets, job);
+        }
+        sequence_frame++;
+    }
+
+    for (u32 i = 0; i < array_list_length(&screenshot_paths); i++) {
+        Capture_Job job = {
+            .readback.id    = graphics_readback_request(width, height),
+            .path           = screenshot_paths[i],
+        };
+        array_list_append(&targets, job);
+    }
+    array_list_clear(&screenshot_paths);
+
+    capture_collect();
+}
+
+void capture_free() {
+    if (mutex == NULL) {
+        return;
+    }
+
+    capture_sequence_stop();
+
+    graphics_readback_finish();
+    capture_collect();
+
+    // Targets left have frames that were never drawn.
+    for (u32 i = 0; i < array_list_length(&targets); i++) {
+        if (targets[i].close) {
+            capture_queue(targets[i]);
+        } else {
+            free(targets[i].path);
+        }
+    }
+    for (u32 i = 0; i < array_list_length(&screenshot_paths); i++) {
+        free(screenshot_paths[i]);
+    }
+
+    SDL_LockMutex(mutex);
+    worker_quit = true;
+    SDL_CondSignal(work_cond);
+    SDL_UnlockMutex(mutex);
+
+    SDL_WaitThread(worker, NULL);
+
+    SDL_DestroyCond(work_cond);
+    SDL_DestroyMutex(mutex);
+    mutex = NULL;
+
+    array_list_free(&jobs);
+    array_list_free(&targets);
+    array_list_free(&screenshot_paths);
+}
+
+
+
+/**
+ * Makes path of the file in the capture directory, returns false if the directory couldn't be made.
+ */
+static bool capture_path(char *path, u64 path_size, String name, char *extension) {
+    if (!make_directory(CAPTURE_DIRECTORY)) {
+        console_error("Couldn't make '%s' directory.\n", CAPTURE_DIRECTORY);
+        return false;
+    }
+
+    (void)snprintf(path, path_size, "%s/%.*s.%s", CAPTURE_DIRECTORY, (int)name.length, name.data, extension);
+    return true;
+}
+
+void screenshot(String name) {
+    char path[256];
+    if (!capture_path(path, sizeof(path), name, "png")) {
+        return;
+    }
+
+    capture_screenshot(path);
+    console_log("Screenshot will be written to '%s'.\n", path);
+}
+
+void capture_start(String name) {
+    char path[256];
+    if (!capture_path(path, sizeof(path), name, "frames")) {
+        return;
+    }
+
+    if (capture_sequence_start(path)) {
+        console_log("Capturing frames into '%s'.\n", path);
+    } else {
+        console_error("Couldn't open '%s'.\n", path);
+    }
+}
+
+void capture_stop() {
+    capture_sequence_stop();
+}
@@ -0,0 +1,78 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/str.h"
+
+/**
+ * Frame capture.
+ *
+ * Screenshots and frame sequences are read back through pixel buffers a few frames after they are drawn, see "graphics_readback_request()",
+ * and written on the capture worker thread, so capturing doesn't stall GPU or the frame.
+ * Screenshots are written as PNG, frame sequences are written raw into a single file, to be converted by external tools:
+ *      header:     magic "RFSQ", u32 version
+ *      per frame:  u32 frame number, u32 width, u32 height, u64 nano seconds since capture started, width * height RGBA pixels, rows from bottom to top.
+ * All numbers are little endian.
+ * If the worker falls behind by CAPTURE_QUEUE_MAX frames, frames of the sequence are skipped, their count is reported once capture stops.
+ * Files are written into CAPTURE_DIRECTORY.
+ * @Important: All functions below should be called from the main thread.
+ */
+
+#define CAPTURE_DIRECTORY           "captures"
+#define CAPTURE_SEQUENCE_VERSION    1
+#define CAPTURE_QUEUE_MAX           8
+
+
+/**
+ * Reads back the frame being recorded and writes it as PNG file to the path.
+ */
+void capture_screenshot(char *path);
+
+/**
+ * Starts reading back every frame into the raw frame sequence file of the path, stopping sequence that is already being captured.
+ * Returns false if the file couldn't be opened.
+ */
+bool capture_sequence_start(char *path);
+
+/**
+ * Stops capturing frame sequence, frames already read back are still written.
+ */
+void capture_sequence_stop();
+
+/**
+ * Asks for the current frame to be read back if anything is captured, and hands read back frames to the worker.
+ * Should be called once per frame, before the frame is ended.
+ */
+void capture_update(s32 width, s32 height);
+
+/**
+ * Waits for all read back frames to be written and stops the worker.
+ * @Important: Should be called after render thread is stopped.
+ */
+void capture_free();
+
+
+/**
+ * Writes screenshot of the next frame to "captures/<name>.png".
+ */
+@Introspect;
+@RegisterCommand;
+void screenshot(String name);
+
+/**
+ * Starts capturing every frame into "captures/<name>.frames".
+ */
+@Introspect;
+@RegisterCommand;
+void capture_start(String name);
+
+/**
+ * Stops capturing frames.
+ */
+@Introspect;
+@RegisterCommand;
+void capture_stop();
+
+
+#endif
@@ -7,6 +7,7 @@
 #include "game/graphics.h"
 #include "game/command.h"
 #include "game/vars.h"
+#include "game/resource.h"
 
 #include "core/structs.h"
 #include "core/arena.h"
@@ -21,8 +22,8 @@
 
 
 
-static Font_Baked font_input;
-static Font_Baked font_output;
+static Font_Baked *font_input;
+static Font_Baked *font_output;
 
 static Matrix4f projection;
 
@@ -205,6 +206,9 @@ void history_return_peeked_message() {
  * Console printing.
  */
 void console_add(char *buffer, s64 length, History_Message_Type type) {
+    // New message is drawn even if the loop is idle.
+    game_request_frame();
+
     // Copy actual string data.
     if (history_buffer_write_index + length > HISTORY_BUFFER_SIZE) {
         if (length > HISTORY_BUFFER_SIZE) {
@@ -324,22 +328,18 @@ void console_init(State *state) {
     quad_drawer_ptr = &state->quad_drawer;
 
     // Load needed font... Hard coded...
-    u8* font_data = read_file_into_buffer("res/font/Consolas-Regular.ttf", NULL, &std_allocator);
-
-    font_input = font_bake(font_data, 18.0f);
-    font_output = font_bake(font_data, 16.0f);
-
-    free(font_data);
+    font_input  = resource_font_get("res/font/Consolas-Regular.ttf", 18.0f);
+    font_output = resource_font_get("res/font/Consolas-Regular.ttf", 16.0f);
 
     // @Important: For metrics we assume that fonts are monospaced!
     // Set input metrics.
-    input_font_top_pad = font_input.line_height * 0.4f;
-    input_height = font_input.line_height + input_font_top_pad;
-    input_block_width = font_input.chars[(s32)' ' - font_input.first_char_code].xadvance;
+    input_font_top_pad = font_input->line_height * 0.4f;
+    input_height = font_input->line_height + input_font_top_pad;
+    input_block_width = font_input->chars[(s32)' ' - font_input->first_char_code].xadvance;
 
     // Set history height.
-    history_font_top_pad = font_output.line_height * 0.2f;
-    history_block_width = font_output.chars[(s32)' ' - font_input.first_char_code].xadvance;
+    history_font_top_pad = font_output->line_height * 0.2f;
+    history_block_width = font_output->chars[(s32)' ' - font_input->first_char_code].xadvance;
 
     // Important not styling, logic vars.
     history = looped_array_make(History_Message, HISTORY_MAX_MESSAGES, &std_allocator);
@@ -423,7 +423,13 @@ void console_update() {
             break;
     }
 
-    c_y0 = lerp(c_y0, c_y0_target, 0.01f * time_ptr->delta_time_milliseconds);
+    // Lerp factor is clamped, so a long frame, like a hitch, can't overshoot the target.
+    c_y0 = lerp(c_y0, c_y0_target, fminf(0.01f * time_ptr->delta_time_milliseconds, 1.0f));
+    if (fabsf(c_y0 - c_y0_target) < 0.5f) {
+        c_y0 = c_y0_target;
+    } else {
+        game_request_frame();
+    }
     
 
     // Checking for input if active.
@@ -544,11 +550,20 @@ void console_update() {
         input_cursor_visible = !input_cursor_visible;
     }
 
+    // Keeping frames coming while cursor fades, and waking idle loop up for the next blink.
+    if (console_active()) {
+        if (input_cursor_activity > 0.0f) {
+            game_request_frame();
+        }
+        game_request_frame_after((u32)(input_cursor_blink_timer.duration - input_cursor_blink_timer.elapsed_t) + 1);
+    }
+
 }
 
 void console_draw() {
     projection = screen_calculate_projection(window_ptr->width, window_ptr->height);
     shader_update_projection(quad_drawer_ptr->program, &projection);
+    render_layer_set(RENDER_LAYER_CONSOLE);
     
 
     draw_begin(quad_drawer_ptr);
@@ -583,10 +598,10 @@ void console_draw() {
         }
 
 
-        history_draw_origin.y += (msg_line_count - msg_cut_lines) * font_output.line_height; 
+        history_draw_origin.y += (msg_line_count - msg_cut_lines) * font_output->line_height; 
         // history_draw_origin.y += history_font_top_pad;
 
-        draw_text(msg_str, history_draw_origin, &font_output, .color = HISTORY_MESSAGE_COLORS[msg->type]);
+        draw_text(msg_str, history_draw_origin, font_output, .color = HISTORY_MESSAGE_COLORS[msg->type]);
     }
     
     display_line_offset = mini(display_line_offset, lines_drawen);
@@ -601,16 +616,16 @@ void console_draw() {
             width = 2;
         }
 
-        draw_rect(vec2f_make(c_x0 + console.text_pad + input_cursor_index * input_block_width, c_y0 + font_input.line_gap), vec2f_make(c_x0 + console.text_pad + input_cursor_index * input_block_width + width, c_y0 + input_height - input_font_top_pad * 0.5f), .color = color);
+        draw_rect(vec2f_make(c_x0 + console.text_pad + input_cursor_index * input_block_width, c_y0 + font_input->line_gap), vec2f_make(c_x0 + console.text_pad + input_cursor_index * input_block_width + width, c_y0 + input_height - input_font_top_pad * 0.5f), .color = color);
     }
 
 
     // Draw input text.
     if (user_input_peeked_message_index != -1) {
         User_Input_Handle handle = user_input_history[user_input_peeked_message_index];
-        draw_text(STR(handle.length, &user_input_history_buffer[handle.index]), vec2f_make(c_x0 + console.text_pad, c_y0 + input_height - input_font_top_pad), &font_input, .color = VEC4F_YELLOW);
+        draw_text(STR(handle.length, &user_input_history_buffer[handle.index]), vec2f_make(c_x0 + console.text_pad, c_y0 + input_height - input_font_top_pad), font_input, .color = VEC4F_YELLOW);
     } else {
-        draw_text(STR(input_length, input), vec2f_make(c_x0 + console.text_pad, c_y0 + input_height - input_font_top_pad), &font_input, .color = VEC4F_CYAN);
+        draw_text(STR(input_length, input), vec2f_make(c_x0 + console.text_pad, c_y0 + input_height - input_font_top_pad), font_input, .color = VEC4F_CYAN);
     }
 
     draw_end();
@@ -620,6 +635,9 @@ void console_draw() {
 
 void console_free() {
     allocator_free(&std_allocator, history_buffers[0]);
+
+    resource_release(font_input);
+    resource_release(font_output);
 }
 
 
@@ -5,11 +5,78 @@
 #include "core/type.h"
 #include "core/mathf.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 
 static const float DOT_SCALE = 6.0f;
 static const float CROSS_SCALE = 8.0f;
 
 
+static inline Quad_Vertex quad_vertex_make(Vec2f position, u32 color, float u, float v, s16 texture_slot, s16 mask_slot) {
+    return (Quad_Vertex) {
+        .position       = position,
+        .color          = color,
+        .uv             = { pack_unorm16(u), pack_unorm16(v) },
+        .texture_slot   = texture_slot,
+        .mask_slot      = mask_slot,
+    };
+}
+
+static inline Line_Vertex line_vertex_make(Vec2f position, u32 color) {
+    return (Line_Vertex) { .position = position, .color = color };
+}
+
+/**
+ * Places 4 packed verticies of the quad either into the vertex stream, or into the buffer if it is specified.
+ */
+static void draw_quad_verticies(Vec2f p0, Vec2f p2, Vec2f p3, Vec2f p1, Vec4f color, Vec2f uv0, Vec2f uv1, float texture_slot, float mask_slot, Vertex_Buffer *buffer) {
+    u32 packed = pack_color(color);
+
+    Quad_Vertex quad_data[VERTICIES_PER_QUAD] = {
+        quad_vertex_make(p0, packed, uv0.x, uv0.y, (s16)texture_slot, (s16)mask_slot),
+        quad_vertex_make(p2, packed, uv1.x, uv0.y, (s16)texture_slot, (s16)mask_slot),
+        quad_vertex_make(p3, packed, uv0.x, uv1.y, (s16)texture_slot, (s16)mask_slot),
+        quad_vertex_make(p1, packed, uv1.x, uv1.y, (s16)texture_slot, (s16)mask_slot),
+    };
+
+    if (buffer == NULL)
+        draw_quad_data(quad_data, 1);
+    else
+        vertex_buffer_append_data(buffer, quad_data, sizeof(quad_data));
+}
+
+/**
+ * Places line verticies either into the vertex stream, or into the buffer if it is specified.
+ */
+static void draw_line_verticies(Line_Vertex *line_data, u32 count, Vertex_Buffer *buffer) {
+    if (buffer == NULL)
+        draw_line_data(line_data, count);
+    else
+        vertex_buffer_append_data(buffer, line_data, count * VERTICIES_PER_LINE * sizeof(Line_Vertex));
+}
+
+/**
+ * Places single quad instance of the rectangle into the vertex stream, "axis" is unit direction of its bottom edge going from p0, p1 is the opposite corner.
+ */
+static void draw_rect_instance(Vec2f p0, Vec2f p1, Vec2f axis, Vec4f color, Vec2f uv0, Vec2f uv1, float texture_slot, float mask_slot) {
+    Vec2f diagonal = vec2f_difference(p1, p0);
+
+    Quad_Instance instance = {
+        .center         = vec2f_make((p0.x + p1.x) * 0.5f, (p0.y + p1.y) * 0.5f),
+        .half_extents   = vec2f_make(vec2f_dot(axis, diagonal) * 0.5f, (axis.x * diagonal.y - axis.y * diagonal.x) * 0.5f),
+        .rot            = atan2f(axis.y, axis.x),
+        .color          = pack_color(color),
+        .uv0            = uv0,
+        .uv1            = uv1,
+        .texture_slot   = (s16)texture_slot,
+        .mask_slot      = (s16)mask_slot,
+    };
+
+    draw_quad_instance_data(&instance, 1);
+}
+
+
 void draw_quad_opt(Vec2f p0, Vec2f p2, Vec2f p3, Vec2f p1, Draw_Quad_Opt_Args opt) {
     float texture_slot = -1.0f; // @Important: -1.0f slot signifies shader to use color, not texture.
     float mask_slot = -1.0f;
@@ -19,18 +86,18 @@ void draw_quad_opt(Vec2f p0, Vec2f p2, Vec2f p3, Vec2f p1, Draw_Quad_Opt_Args op
 
     if (opt.mask != NULL)
         mask_slot = add_texture_to_slots(opt.mask);              
-    
-    float quad_data[44] = {
-        p0.x, p0.y, 0.0f, opt.color.x, opt.color.y, opt.color.z, opt.color.w, opt.uv0.x, opt.uv0.y, texture_slot, mask_slot,
-        p2.x, p2.y, 0.0f, opt.color.x, opt.color.y, opt.color.z, opt.color.w, opt.uv1.x, opt.uv0.y, texture_slot, mask_slot,
-        p3.x, p3.y, 0.0f, opt.color.x, opt.color.y, opt.color.z, opt.color.w, opt.uv0.x, opt.uv1.y, texture_slot, mask_slot,
-        p1.x, p1.y, 0.0f, opt.color.x, opt.color.y, opt.color.z, opt.color.w, opt.uv1.x, opt.uv1.y, texture_slot, mask_slot,
-    };
-    
-    if (opt.buffer == NULL)
-        draw_quad_data(quad_data, 1);
-    else
-        vertex_buffer_append_data(opt.buffer, quad_data, VERTICIES_PER_QUAD * 11);
+
+    if (opt.buffer == NULL && draw_is_instanced()) {
+        // @Important: Instance can only describe a rectangle, p1 is assumed to be the corner opposite to p0.
+        Vec2f edge = vec2f_difference(p2, p0);
+        float length = vec2f_magnitude(edge);
+        Vec2f axis = length > 0.0f ? vec2f_divide_constant(edge, length) : vec2f_make(1.0f, 0.0f);
+
+        draw_rect_instance(p0, p1, axis, opt.color, opt.uv0, opt.uv1, texture_slot, mask_slot);
+        return;
+    }
+
+    draw_quad_verticies(p0, p2, p3, p1, opt.color, opt.uv0, opt.uv1, texture_slot, mask_slot, opt.buffer);
 }
 
 void draw_rect_opt(Vec2f p0, Vec2f p1, Draw_Rect_Opt_Args opt) {
@@ -47,106 +114,201 @@ void draw_rect_opt(Vec2f p0, Vec2f p1, Draw_Rect_Opt_Args opt) {
     // Past me always had stupid shit to come up with.
     // @Todo: Replace this with transformation matrix...
     Vec2f k = vec2f_make(cosf(opt.offset_angle), sinf(opt.offset_angle));
+
+    // Instanced drawer gets center and extents, corners are calculated in the shader.
+    if (opt.buffer == NULL && draw_is_instanced()) {
+        draw_rect_instance(p0, p1, k, opt.color, opt.uv0, opt.uv1, texture_slot, mask_slot);
+        return;
+    }
+
     k = vec2f_multi_constant(k, vec2f_dot(k, vec2f_difference(p1, p0)));
     
     Vec2f p2 = vec2f_sum(p0, k);
     Vec2f p3 = vec2f_difference(p1, k);
-    
-    float quad_data[44] = {
-        p0.x, p0.y, 0.0f, opt.color.x, opt.color.y, opt.color.z, opt.color.w, opt.uv0.x, opt.uv0.y, texture_slot, mask_slot,
-        p2.x, p2.y, 0.0f, opt.color.x, opt.color.y, opt.color.z, opt.color.w, opt.uv1.x, opt.uv0.y, texture_slot, mask_slot,
-        p3.x, p3.y, 0.0f, opt.color.x, opt.color.y, opt.color.z, opt.color.w, opt.uv0.x, opt.uv1.y, texture_slot, mask_slot,
-        p1.x, p1.y, 0.0f, opt.color.x, opt.color.y, opt.color.z, opt.color.w, opt.uv1.x, opt.uv1.y, texture_slot, mask_slot,
-    };
-    
-    if (opt.buffer == NULL)
-        draw_quad_data(quad_data, 1);
-    else
-        vertex_buffer_append_data(opt.buffer, quad_data, VERTICIES_PER_QUAD * 11);
+
+    draw_quad_verticies(p0, p2, p3, p1, opt.color, opt.uv0, opt.uv1, texture_slot, mask_slot, opt.buffer);
 }
 
-void draw_text_opt(String text, Vec2f current_point, Font_Baked *font, Draw_Text_Opt_Args opt) {
-    // Scale and adjust current_point.
-    current_point = vec2f_multi_constant(current_point, (float)opt.unit_scale);
-    float origin_x = current_point.x;
-    current_point.y += (float)font->baseline;
+typedef struct glyph_run_entry {
+    u32         hash;
+    u32         font_id;            // 0 if entry is empty.
+    char        *text;              // Copy of the text run was laid out from.
+    s64         text_length;
+    s64         text_capacity;
+    u64         used;               // Value of the use counter when run was last returned.
+    Glyph_Run   run;
+} Glyph_Run_Entry;
+
+// Every thread drawing text has its own cache, it is freed by "glyph_run_cache_free()" when thread is done with it.
+static _Thread_local Glyph_Run_Entry *glyph_runs = NULL;
+static _Thread_local u64 glyph_runs_used = 0;
+
+static u32 glyph_run_hash(String text, Font_Baked *font) {
+    // FNV-1a.
+    u32 hash = 2166136261u ^ font->id;
+    for (s64 i = 0; i < text.length; i++) {
+        hash ^= (u8)text.data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
 
-    // Text rendering variables.
-    s32 font_char_index;
-    u16 width, height;
+/**
+ * Lays out glyphs of the text into the run, reusing its storage.
+ */
+static void glyph_run_layout(Glyph_Run *run, String text, Font_Baked *font) {
+    if (run->glyphs_capacity < text.length) {
+        run->glyphs_capacity = (u32)text.length;
+        run->glyphs = realloc(run->glyphs, run->glyphs_capacity * sizeof(Glyph_Quad));
+    }
+    run->glyphs_count = 0;
+    run->size = VEC2F_ORIGIN;
+
+    Vec2f current_point = vec2f_make(0.0f, (float)font->baseline);
+    float width, height;
     stbtt_bakedchar *c;
 
     for (s64 i = 0; i < text.length; i++) {
         // @Incomplete: Handle special characters / symbols.
         if (text.data[i] == '\n') {
-            current_point.x = origin_x;
+            run->size.y += (float)font->line_height;
+            if (run->size.x < current_point.x)
+                run->size.x = current_point.x;
+
+            current_point.x = 0.0f;
             current_point.y -= (float)font->line_height;
             continue;
         }
 
-        // Character drawing.
-        font_char_index = (s32)text.data[i] - font->first_char_code;
-        if (font_char_index < font->chars_count) {
-            c = &font->chars[font_char_index];
-            width  = font->chars[font_char_index].x1 - font->chars[font_char_index].x0;
-            height = font->chars[font_char_index].y1 - font->chars[font_char_index].y0;
-
-            // Behold! The most unreadable piece of inlined shit...
-            // But it gets the job done...
-            draw_rect(
-                    vec2f_divide_constant(vec2f_make(current_point.x + c->xoff, current_point.y - c->yoff - height), (float)opt.unit_scale), 
-                    vec2f_divide_constant(vec2f_make(current_point.x + c->xoff + width, current_point.y - c->yoff), (float)opt.unit_scale), 
-                    .color = opt.color, 
-                    .uv0 = vec2f_make(c->x0 / (float)font->bitmap.width, c->y1 / (float)font->bitmap.height), 
-                    .uv1 = vec2f_make(c->x1 / (float)font->bitmap.width, c->y0 / (float)font->bitmap.height), 
-                    .mask = &font->bitmap, 
-                    .buffer = opt.buffer);
-
-            current_point.x += font->chars[font_char_index].xadvance;
-        }
+        s32 font_char_index = (s32)text.data[i] - font->first_char_code;
+        if (font_char_index < 0 || font_char_index >= font->chars_count)
+            continue;
+
+        c = &font->chars[font_char_index];
+        width  = (float)(c->x1 - c->x0) * font->glyph_scale;
+        height = (float)(c->y1 - c->y0) * font->glyph_scale;
+
+        run->glyphs[run->glyphs_count++] = (Glyph_Quad) {
+            .p0     = vec2f_make(current_point.x + c->xoff, current_point.y - c->yoff - height),
+            .p1     = vec2f_make(current_point.x + c->xoff + width, current_point.y - c->yoff),
+            .uv0    = vec2f_make(c->x0 / (float)font->bitmap.width, c->y1 / (float)font->bitmap.height),
+            .uv1    = vec2f_make(c->x1 / (float)font->bitmap.width, c->y0 / (float)font->bitmap.height),
+        };
+
+        current_point.x += c->xadvance;
     }
-}
 
-Vec2f text_size(String text, Font_Baked *font) {
-    // Result.
-    Vec2f result = VEC2F_ORIGIN;
+    // Since last line dimensions is not handled in the loop, it can be done here.
+    if (text.length == 0 || text.data[text.length - 1] != '\n')
+        run->size.y += (float)font->line_height;
 
-    // Scale and adjust current_point.
-    Vec2f current_point = VEC2F_ORIGIN;
-    float origin_x = current_point.x;
-    current_point.y += (float)font->baseline;
+    if (run->size.x < current_point.x)
+        run->size.x = current_point.x;
+}
 
-    // Text rendering variables.
-    s32 font_char_index;
+Glyph_Run *glyph_run_get(String text, Font_Baked *font) {
+    if (glyph_runs == NULL)
+        glyph_runs = calloc(GLYPH_RUN_CACHE_SETS * GLYPH_RUN_CACHE_WAYS, sizeof(Glyph_Run_Entry));
 
-    for (s64 i = 0; i < text.length; i++) {
-        // Handle special characters / symbols.
-        if (text.data[i] == '\n') {
-            result.y += (float)font->line_height;
-            if (result.x < current_point.x)
-                result.x = current_point.x;
+    u32 hash = glyph_run_hash(text, font);
+    Glyph_Run_Entry *set = &glyph_runs[(hash & (GLYPH_RUN_CACHE_SETS - 1)) * GLYPH_RUN_CACHE_WAYS];
+    Glyph_Run_Entry *victim = &set[0];
 
-            current_point.x = origin_x;
-            current_point.y -= (float)font->line_height;
-            continue;
+    glyph_runs_used++;
+
+    for (u32 i = 0; i < GLYPH_RUN_CACHE_WAYS; i++) {
+        Glyph_Run_Entry *entry = &set[i];
+        if (entry->font_id == font->id && entry->hash == hash && entry->text_length == text.length && memcmp(entry->text, text.data, text.length) == 0) {
+            entry->used = glyph_runs_used;
+            return &entry->run;
         }
 
-        // Character iterating.
-        font_char_index = (s32)text.data[i] - font->first_char_code;
-        if (font_char_index < font->chars_count) {
+        if (entry->used < victim->used)
+            victim = entry;
+    }
+
+    // Least recently used entry of the set is replaced, empty ones are never used so they go first.
+    if (victim->text_capacity < text.length) {
+        victim->text_capacity = text.length;
+        victim->text = realloc(victim->text, victim->text_capacity);
+    }
+    memcpy(victim->text, text.data, text.length);
+    victim->text_length = text.length;
+    victim->hash        = hash;
+    victim->font_id     = font->id;
+    victim->used        = glyph_runs_used;
+
+    glyph_run_layout(&victim->run, text, font);
+
+    return &victim->run;
+}
+
+void glyph_run_cache_free() {
+    if (glyph_runs == NULL)
+        return;
+
+    for (u32 i = 0; i < GLYPH_RUN_CACHE_SETS * GLYPH_RUN_CACHE_WAYS; i++) {
+        free(glyph_runs[i].text);
+        free(glyph_runs[i].run.glyphs);
+    }
+
+    free(glyph_runs);
+    glyph_runs = NULL;
+    glyph_runs_used = 0;
+}
+
 
-            current_point.x += font->chars[font_char_index].xadvance;
+// Glyphs are put into the vertex stream in chunks of this many quads.
+#define GLYPH_RUN_CHUNK 64
+
+void draw_text_opt(String text, Vec2f position, Font_Baked *font, Draw_Text_Opt_Args opt) {
+    Glyph_Run *run = glyph_run_get(text, font);
+    if (run->glyphs_count == 0)
+        return;
+
+    float scale = (float)opt.unit_scale;
+    float mask_slot = add_texture_to_slots(&font->bitmap);
+    if (font->sdf && mask_slot != -1.0f)
+        mask_slot += SDF_MASK_SLOT_OFFSET;
+
+    // Run is only translated to the position, every glyph of it is drawn with the same color and mask.
+    if (opt.buffer == NULL && draw_is_instanced()) {
+        Quad_Instance instances[GLYPH_RUN_CHUNK];
+        u32 packed = pack_color(opt.color);
+
+        for (u32 i = 0; i < run->glyphs_count; i += GLYPH_RUN_CHUNK) {
+            u32 count = run->glyphs_count - i < GLYPH_RUN_CHUNK ? run->glyphs_count - i : GLYPH_RUN_CHUNK;
+
+            for (u32 j = 0; j < count; j++) {
+                Glyph_Quad *g = &run->glyphs[i + j];
+                instances[j] = (Quad_Instance) {
+                    .center         = vec2f_make(position.x + (g->p0.x + g->p1.x) * 0.5f / scale, position.y + (g->p0.y + g->p1.y) * 0.5f / scale),
+                    .half_extents   = vec2f_make((g->p1.x - g->p0.x) * 0.5f / scale, (g->p1.y - g->p0.y) * 0.5f / scale),
+                    .rot            = 0.0f,
+                    .color          = packed,
+                    .uv0            = g->uv0,
+                    .uv1            = g->uv1,
+                    .texture_slot   = -1,
+                    .mask_slot      = (s16)mask_slot,
+                };
+            }
+
+            draw_quad_instance_data(instances, count);
         }
+        return;
     }
-    
-    // Since last line dimensions is not handled in the loop, it can be done here.
-    if (text.data[text.length - 1] != '\n') 
-        result.y += (float)font->line_height;
 
-    if (result.x < current_point.x)
-        result.x = current_point.x;
+    for (u32 i = 0; i < run->glyphs_count; i++) {
+        Glyph_Quad *g = &run->glyphs[i];
+        Vec2f p0 = vec2f_make(position.x + g->p0.x / scale, position.y + g->p0.y / scale);
+        Vec2f p1 = vec2f_make(position.x + g->p1.x / scale, position.y + g->p1.y / scale);
 
-    return result;
+        draw_quad_verticies(p0, vec2f_make(p1.x, p0.y), vec2f_make(p0.x, p1.y), p1, opt.color, g->uv0, g->uv1, -1.0f, mask_slot, opt.buffer);
+    }
+}
+
+Vec2f text_size(String text, Font_Baked *font) {
+    return glyph_run_get(text, font)->size;
 }
 
 float text_size_y(String text, Font_Baked *font) {
@@ -174,15 +336,14 @@ float text_size_y(String text, Font_Baked *font) {
 
 
 void draw_line(Vec2f p0, Vec2f p1, Vec4f color, Vertex_Buffer *buffer) {
-    float line_data[14] = {
-        p0.x, p0.y, 0.0f, color.x, color.y, color.z, color.w,
-        p1.x, p1.y, 0.0f, color.x, color.y, color.z, color.w,
+    u32 packed = pack_color(color);
+
+    Line_Vertex line_data[2] = {
+        line_vertex_make(p0, packed),
+        line_vertex_make(p1, packed),
     };
 
-    if (buffer == NULL)
-        draw_line_data(line_data, 1);
-    else
-        vertex_buffer_append_data(buffer, line_data, VERTICIES_PER_LINE * 7);
+    draw_line_verticies(line_data, 1, buffer);
 }
 
 
@@ -193,36 +354,30 @@ void draw_dot(Vec2f position, Vec4f color, Camera *camera, Vertex_Buffer *buffer
 
 void draw_cross(Vec2f position, Vec4f color, Camera *camera, Vertex_Buffer *buffer) {
     float radius = CROSS_SCALE / (float)camera->unit_scale;
-    float line_data[28] = {
-        position.x - radius, position.y - radius, 0.0f, color.x, color.y, color.z, color.w,
-        position.x + radius, position.y + radius, 0.0f, color.x, color.y, color.z, color.w,
-        position.x + radius, position.y - radius, 0.0f, color.x, color.y, color.z, color.w,
-        position.x - radius, position.y + radius, 0.0f, color.x, color.y, color.z, color.w,
+    u32 packed = pack_color(color);
+
+    Line_Vertex line_data[4] = {
+        line_vertex_make(vec2f_make(position.x - radius, position.y - radius), packed),
+        line_vertex_make(vec2f_make(position.x + radius, position.y + radius), packed),
+        line_vertex_make(vec2f_make(position.x + radius, position.y - radius), packed),
+        line_vertex_make(vec2f_make(position.x - radius, position.y + radius), packed),
     };
 
-    if (buffer == NULL)
-        draw_line_data(line_data, 2);
-    else
-        vertex_buffer_append_data(buffer, line_data, VERTICIES_PER_LINE * 2 * 7);
+    draw_line_verticies(line_data, 2, buffer);
 }
 
 
 void draw_quad_outline(Vec2f p0, Vec2f p2, Vec2f p3, Vec2f p1, Vec4f color, Vertex_Buffer *buffer) {
-    float line_data[56] = {
-        p0.x, p0.y, 0.0f, color.x, color.y, color.z, color.w,
-        p2.x, p2.y, 0.0f, color.x, color.y, color.z, color.w,
-        p2.x, p2.y, 0.0f, color.x, color.y, color.z, color.w,
-        p1.x, p1.y, 0.0f, color.x, color.y, color.z, color.w,
-        p1.x, p1.y, 0.0f, color.x, color.y, color.z, color.w,
-        p3.x, p3.y, 0.0f, color.x, color.y, color.z, color.w,
-        p3.x, p3.y, 0.0f, color.x, color.y, color.z, color.w,
-        p0.x, p0.y, 0.0f, color.x, color.y, color.z, color.w,
+    u32 packed = pack_color(color);
+
+    Line_Vertex line_data[8] = {
+        line_vertex_make(p0, packed), line_vertex_make(p2, packed),
+        line_vertex_make(p2, packed), line_vertex_make(p1, packed),
+        line_vertex_make(p1, packed), line_vertex_make(p3, packed),
+        line_vertex_make(p3, packed), line_vertex_make(p0, packed),
     };
 
-    if (buffer == NULL)
-        draw_line_data(line_data, 4);
-    else
-        vertex_buffer_append_data(buffer, line_data, 4 * VERTICIES_PER_LINE * 7);
+    draw_line_verticies(line_data, 4, buffer);
 }
 
 void draw_rect_outline(Vec2f p0, Vec2f p1, Vec4f color, float offset_angle, Vertex_Buffer *buffer) {
@@ -233,141 +388,72 @@ void draw_rect_outline(Vec2f p0, Vec2f p1, Vec4f color, float offset_angle, Vert
     Vec2f p2 = vec2f_sum(p0, k);
     Vec2f p3 = vec2f_difference(p1, k);
     
-    float line_data[56] = {
-        p0.x, p0.y, 0.0f, color.x, color.y, color.z, color.w,
-        p2.x, p2.y, 0.0f, color.x, color.y, color.z, color.w,
-        p2.x, p2.y, 0.0f, color.x, color.y, color.z, color.w,
-        p1.x, p1.y, 0.0f, color.x, color.y, color.z, color.w,
-        p1.x, p1.y, 0.0f, color.x, color.y, color.z, color.w,
-        p3.x, p3.y, 0.0f, color.x, color.y, color.z, color.w,
-        p3.x, p3.y, 0.0f, color.x, color.y, color.z, color.w,
-        p0.x, p0.y, 0.0f, color.x, color.y, color.z, color.w,
+    u32 packed = pack_color(color);
+
+    Line_Vertex line_data[8] = {
+        line_vertex_make(p0, packed), line_vertex_make(p2, packed),
+        line_vertex_make(p2, packed), line_vertex_make(p1, packed),
+        line_vertex_make(p1, packed), line_vertex_make(p3, packed),
+        line_vertex_make(p3, packed), line_vertex_make(p0, packed),
     };
 
-    if (buffer == NULL)
-        draw_line_data(line_data, 4);
-    else
-        vertex_buffer_append_data(buffer, line_data, 4 * VERTICIES_PER_LINE * 7);
+    draw_line_verticies(line_data, 4, buffer);
 }
 
 void draw_circle_outline(Vec2f position, float radius, u32 detail, Vec4f color, Vertex_Buffer *buffer) {
-
-    float line_data[detail * 14];
+    Line_Vertex line_data[detail * VERTICIES_PER_LINE];
+    u32 packed = pack_color(color);
 
     float step = 2*PI / (float)detail;
     for (u32 i = 0; i < detail; i++) {
-        line_data[0  + i * 14] = radius * cosf(step * (float)i) + position.x;
-        line_data[1  + i * 14] = radius * sinf(step * (float)i) + position.y;
-        line_data[2  + i * 14] = 0.0f;
-        line_data[3  + i * 14] = color.x;
-        line_data[4  + i * 14] = color.y;
-        line_data[5  + i * 14] = color.z;
-        line_data[6  + i * 14] = color.w;
-                     
-        line_data[7  + i * 14] = radius * cosf(step * (float)(i + 1)) + position.x;
-        line_data[8  + i * 14] = radius * sinf(step * (float)(i + 1)) + position.y;
-        line_data[9  + i * 14] = 0.0f;
-        line_data[10 + i * 14] = color.x;
-        line_data[11 + i * 14] = color.y;
-        line_data[12 + i * 14] = color.z;
-        line_data[13 + i * 14] = color.w;
+        line_data[0 + i * 2] = line_vertex_make(vec2f_make(radius * cosf(step * (float)i) + position.x, radius * sinf(step * (float)i) + position.y), packed);
+        line_data[1 + i * 2] = line_vertex_make(vec2f_make(radius * cosf(step * (float)(i + 1)) + position.x, radius * sinf(step * (float)(i + 1)) + position.y), packed);
     }
     
-   
-    if (buffer == NULL)
-        draw_line_data(line_data, detail);
-    else
-        vertex_buffer_append_data(buffer, line_data, detail * VERTICIES_PER_LINE * 7);
+    draw_line_verticies(line_data, detail, buffer);
 }
 
 void draw_function(float x0, float x1, Function y, u32 detail, Vec4f color, Vertex_Buffer *buffer) {
-    float line_data[detail * 14];
+    Line_Vertex line_data[detail * VERTICIES_PER_LINE];
+    u32 packed = pack_color(color);
 
     float step = (x1 - x0) / (float)detail;
     for (u32 i = 0; i < detail; i++) {
-        line_data[0  + i * 14] = x0 + step * (float)i;
-        line_data[1  + i * 14] = y(x0 + step * (float)i);
-        line_data[2  + i * 14] = 0.0f;
-        line_data[3  + i * 14] = color.x;
-        line_data[4  + i * 14] = color.y;
-        line_data[5  + i * 14] = color.z;
-        line_data[6  + i * 14] = color.w;
-                     
-        line_data[7  + i * 14] = x0 + step * (float)(i + 1);
-        line_data[8  + i * 14] = y(x0 + step * (float)(i + 1));
-        line_data[9  + i * 14] = 0.0f;
-        line_data[10 + i * 14] = color.x;
-        line_data[11 + i * 14] = color.y;
-        line_data[12 + i * 14] = color.z;
-        line_data[13 + i * 14] = color.w;
+        line_data[0 + i * 2] = line_vertex_make(vec2f_make(x0 + step * (float)i, y(x0 + step * (float)i)), packed);
+        line_data[1 + i * 2] = line_vertex_make(vec2f_make(x0 + step * (float)(i + 1), y(x0 + step * (float)(i + 1))), packed);
     }
     
-   
-    if (buffer == NULL)
-        draw_line_data(line_data, detail);
-    else
-        vertex_buffer_append_data(buffer, line_data, detail * VERTICIES_PER_LINE * 7);
+    draw_line_verticies(line_data, detail, buffer);
 }
 
 void draw_polar(float t0, float t1, Function r, u32 detail, Vec4f color, Vertex_Buffer *buffer) {
-    float line_data[detail * 14];
+    Line_Vertex line_data[detail * VERTICIES_PER_LINE];
+    u32 packed = pack_color(color);
 
     float step = (t1 - t0) / (float)detail;
     float radius;
     for (u32 i = 0; i < detail; i++) {
         radius = r(t0 + step * (float)i);
-        line_data[0  + i * 14] = radius * cosf(t0 + step * (float)i);
-        line_data[1  + i * 14] = radius * sinf(t0 + step * (float)i);
-        line_data[2  + i * 14] = 0.0f;
-        line_data[3  + i * 14] = color.x;
-        line_data[4  + i * 14] = color.y;
-        line_data[5  + i * 14] = color.z;
-        line_data[6  + i * 14] = color.w;
-                     
+        line_data[0 + i * 2] = line_vertex_make(vec2f_make(radius * cosf(t0 + step * (float)i), radius * sinf(t0 + step * (float)i)), packed);
+
         radius = r(t0 + step * (float)(i + 1));
-        line_data[7  + i * 14] = radius * cosf(t0 + step * (float)(i + 1));
-        line_data[8  + i * 14] = radius * sinf(t0 + step * (float)(i + 1));
-        line_data[9  + i * 14] = 0.0f;
-        line_data[10 + i * 14] = color.x;
-        line_data[11 + i * 14] = color.y;
-        line_data[12 + i * 14] = color.z;
-        line_data[13 + i * 14] = color.w;
+        line_data[1 + i * 2] = line_vertex_make(vec2f_make(radius * cosf(t0 + step * (float)(i + 1)), radius * sinf(t0 + step * (float)(i + 1))), packed);
     }
     
-   
-    if (buffer == NULL)
-        draw_line_data(line_data, detail);
-    else
-        vertex_buffer_append_data(buffer, line_data, detail * VERTICIES_PER_LINE * 7);
+    draw_line_verticies(line_data, detail, buffer);
 }
 
 void draw_parametric(float t0, float t1, Function x, Function y, u32 detail, Vec4f color, Vertex_Buffer *buffer) {
-    float line_data[detail * 14];
+    Line_Vertex line_data[detail * VERTICIES_PER_LINE];
+    u32 packed = pack_color(color);
 
     float step = (t1 - t0) / (float)detail;
     for (u32 i = 0; i < detail; i++) {
-        line_data[0  + i * 14] = x(t0 + step * (float)i);
-        line_data[1  + i * 14] = y(t0 + step * (float)i);
-        line_data[2  + i * 14] = 0.0f;
-        line_data[3  + i * 14] = color.x;
-        line_data[4  + i * 14] = color.y;
-        line_data[5  + i * 14] = color.z;
-        line_data[6  + i * 14] = color.w;
-
-        line_data[7  + i * 14] = x(t0 + step * (float)(i + 1));
-        line_data[8  + i * 14] = y(t0 + step * (float)(i + 1));
-        line_data[9  + i * 14] = 0.0f;
-        line_data[10 + i * 14] = color.x;
-        line_data[11 + i * 14] = color.y;
-        line_data[12 + i * 14] = color.z;
-        line_data[13 + i * 14] = color.w;
+        line_data[0 + i * 2] = line_vertex_make(vec2f_make(x(t0 + step * (float)i), y(t0 + step * (float)i)), packed);
+        line_data[1 + i * 2] = line_vertex_make(vec2f_make(x(t0 + step * (float)(i + 1)), y(t0 + step * (float)(i + 1))), packed);
     }
     
-   
-    if (buffer == NULL)
-        draw_line_data(line_data, detail);
-    else
-        vertex_buffer_append_data(buffer, line_data, detail * VERTICIES_PER_LINE * 7);
+    draw_line_verticies(line_data, detail, buffer);
 }
 
 void draw_area_function(float x0, float x1, Function y, u32 rect_count, Vec4f color, Vertex_Buffer *buffer) {
@@ -378,67 +464,18 @@ void draw_area_function(float x0, float x1, Function y, u32 rect_count, Vec4f co
 }
 
 void draw_area_polar(float t0, float t1, Function r, u32 rect_count, Vec4f color, Vertex_Buffer *buffer) {
-    float quad_data[rect_count * VERTICIES_PER_QUAD * 11];
-
     float step = (t1 - t0) / (float)rect_count;
-    float radius;
     for (u32 i = 0; i < rect_count; i++) {
-        quad_data[0  + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[1  + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[2  + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[3  + i * VERTICIES_PER_QUAD * 11] = color.x;
-        quad_data[4  + i * VERTICIES_PER_QUAD * 11] = color.y;
-        quad_data[5  + i * VERTICIES_PER_QUAD * 11] = color.z;
-        quad_data[6  + i * VERTICIES_PER_QUAD * 11] = color.w;
-        quad_data[7  + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[8  + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[9  + i * VERTICIES_PER_QUAD * 11] = -1.0f;
-        quad_data[10 + i * VERTICIES_PER_QUAD * 11] = -1.0f;
-                     
-        quad_data[11 + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[12 + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[13 + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[14 + i * VERTICIES_PER_QUAD * 11] = color.x;
-        quad_data[15 + i * VERTICIES_PER_QUAD * 11] = color.y;
-        quad_data[16 + i * VERTICIES_PER_QUAD * 11] = color.z;
-        quad_data[17 + i * VERTICIES_PER_QUAD * 11] = color.w;
-        quad_data[18 + i * VERTICIES_PER_QUAD * 11] = 1.0f;
-        quad_data[19 + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[20 + i * VERTICIES_PER_QUAD * 11] = -1.0f;
-        quad_data[21 + i * VERTICIES_PER_QUAD * 11] = -1.0f;
-                     
-        radius = r(t0 + step * (float)i);
-        quad_data[22 + i * VERTICIES_PER_QUAD * 11] = radius * cosf(t0 + step * (float)i);
-        quad_data[23 + i * VERTICIES_PER_QUAD * 11] = radius * sinf(t0 + step * (float)i);
-        quad_data[24 + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[25 + i * VERTICIES_PER_QUAD * 11] = color.x;
-        quad_data[26 + i * VERTICIES_PER_QUAD * 11] = color.y;
-        quad_data[27 + i * VERTICIES_PER_QUAD * 11] = color.z;
-        quad_data[28 + i * VERTICIES_PER_QUAD * 11] = color.w;
-        quad_data[29 + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[30 + i * VERTICIES_PER_QUAD * 11] = 1.0f;
-        quad_data[31 + i * VERTICIES_PER_QUAD * 11] = -1.0f;
-        quad_data[32 + i * VERTICIES_PER_QUAD * 11] = -1.0f;
-                     
-        radius = r(t0 + step * (float)(i + 1));
-        quad_data[33 + i * VERTICIES_PER_QUAD * 11] = radius * cosf(t0 + step * (float)(i + 1));
-        quad_data[34 + i * VERTICIES_PER_QUAD * 11] = radius * sinf(t0 + step * (float)(i + 1));
-        quad_data[35 + i * VERTICIES_PER_QUAD * 11] = 0.0f;
-        quad_data[36 + i * VERTICIES_PER_QUAD * 11] = color.x;
-        quad_data[37 + i * VERTICIES_PER_QUAD * 11] = color.y;
-        quad_data[38 + i * VERTICIES_PER_QUAD * 11] = color.z;
-        quad_data[39 + i * VERTICIES_PER_QUAD * 11] = color.w;
-        quad_data[40 + i * VERTICIES_PER_QUAD * 11] = 1.0f;
-        quad_data[41 + i * VERTICIES_PER_QUAD * 11] = 1.0f;
-        quad_data[42 + i * VERTICIES_PER_QUAD * 11] = -1.0f;
-        quad_data[43 + i * VERTICIES_PER_QUAD * 11] = -1.0f;
-    }
-    
-    if (buffer == NULL)
-        draw_quad_data(quad_data, rect_count);
-    else
-        vertex_buffer_append_data(buffer, quad_data, rect_count * VERTICIES_PER_QUAD * 11);
+        float radius0 = r(t0 + step * (float)i);
+        float radius1 = r(t0 + step * (float)(i + 1));
+
+        Vec2f p0 = VEC2F_ORIGIN;
+        Vec2f p2 = VEC2F_ORIGIN;
+        Vec2f p3 = vec2f_make(radius0 * cosf(t0 + step * (float)i), radius0 * sinf(t0 + step * (float)i));
+        Vec2f p1 = vec2f_make(radius1 * cosf(t0 + step * (float)(i + 1)), radius1 * sinf(t0 + step * (float)(i + 1)));
 
+        draw_quad_verticies(p0, p2, p3, p1, color, VEC2F_ORIGIN, VEC2F_UNIT, -1.0f, -1.0f, buffer);
+    }
 }
 
 void draw_area_parametric(float t0, float t1, Function x, Function y, u32 rect_count, Vec4f color, Vertex_Buffer *buffer) {
@@ -450,7 +487,8 @@ void draw_area_parametric(float t0, float t1, Function x, Function y, u32 rect_c
 
 
 void draw_viewport(u32 x, u32 y, u32 width, u32 height, Vec4f color, Camera *camera, Vertex_Buffer *buffer) {
-    glViewport(x, y, width, height);
+    // Commands queued so far are drawn with the previous viewport.
+    render_queue_viewport(x, y, width, height);
     
     Vec2f p1 = vec2f_make((float)width / 2 / (float)camera->unit_scale, (float)height / 2 / (float)camera->unit_scale);
     Vec2f p0 = vec2f_negate(p1);
@@ -460,7 +498,7 @@ void draw_viewport(u32 x, u32 y, u32 width, u32 height, Vec4f color, Camera *cam
 }
 
 void viewport_reset(float window_width, float window_height) {
-    glViewport(0, 0, window_width, window_height);
+    render_queue_viewport(0, 0, window_width, window_height);
 }
 
 Vec2f camera_screen_to_world(Vec2f point, Camera *camera, float window_width, float window_height) {
@@ -54,6 +54,45 @@ void draw_rect_opt(Vec2f p0, Vec2f p1, Draw_Rect_Opt_Args opt);
 
 
 
+/**
+ * Glyph runs.
+ *
+ * Text is laid out once into a run of glyph quads along with its measured size, and the run is reused while the same text is drawn with the same font again,
+ * so console history, HUD text and editor labels, which stay mostly unchanged from frame to frame, are only translated to their position.
+ * Runs are kept in a small set associative cache per thread, keyed by text contents and font, least recently used run of the set is replaced by the new one.
+ */
+
+// Sets of the glyph run cache, power of 2.
+#define GLYPH_RUN_CACHE_SETS    128
+#define GLYPH_RUN_CACHE_WAYS    4
+
+typedef struct glyph_quad {
+    Vec2f   p0;         // Bottom left corner relative to the top left origin of the text, in font pixels.
+    Vec2f   p1;         // Top right corner.
+    Vec2f   uv0;
+    Vec2f   uv1;
+} Glyph_Quad;
+
+typedef struct glyph_run {
+    Glyph_Quad  *glyphs;
+    u32         glyphs_count;
+    u32         glyphs_capacity;
+    Vec2f       size;       // Width and height of the text, in font pixels.
+} Glyph_Run;
+
+/**
+ * Returns run of the text laid out with the font, laying it out only if it isn't cached yet.
+ * @Important: Run stays valid only until the next call, as it may be replaced by another one.
+ */
+Glyph_Run *glyph_run_get(String text, Font_Baked *font);
+
+/**
+ * Frees glyph run cache of the calling thread, threads that draw text should call it before they exit.
+ */
+void glyph_run_cache_free();
+
+
+
 typedef struct draw_text_args_opt {
     Vec4f           color;
     u32             unit_scale;
@@ -7,12 +7,16 @@
 #include "game/graphics.h"
 #include "game/console.h"
 #include "game/level.h"
+#include "game/level_format.h"
+#include "game/level_cache.h"
+#include "game/resource.h"
 
 #include "core/mathf.h"
 #include "core/structs.h"
 #include "core/arena.h"
 #include "core/str.h"
 #include "core/file.h"
+#include "core/compress.h"
 
 
 
@@ -72,6 +76,10 @@ typedef struct editor_params {
     s64 ui_mouse_menu_width;
     s64 ui_mouse_menu_element_height;
     s64 ui_mouse_menu_element_count;
+
+    s64 build_level_bvh;
+    s64 compress_files;
+    float level_chunk_size;
 } Editor_Params;
 
 static Editor_Params editor_params;
@@ -174,8 +182,8 @@ static float rotate_rad_offset;
 
 
 
-static Font_Baked font_small;
-static Font_Baked font_medium;
+static Font_Baked *font_small;
+static bool resources_loaded;
 
 static Camera editor_camera;
 
@@ -183,6 +191,8 @@ static Camera editor_camera;
 
 
 #define EDITOR_ARENA_SIZE 1024
+// Camera move and zoom speeds below this are snapped to 0.
+#define EDITOR_CAMERA_SETTLE_SPEED 0.001f
 
 static Arena arena;
 
@@ -205,7 +215,6 @@ static Line_Drawer *line_drawer_ptr;
 static Window_Info *window_ptr;
 static Mouse_Input *mouse_input_ptr;
 static Time_Info   *time_ptr;
-static Shader      **shader_table_ptr;
 
 
 void editor_init(State *state) {
@@ -220,6 +229,9 @@ void editor_init(State *state) {
     editor_params.ui_mouse_menu_width           = 160;
     editor_params.ui_mouse_menu_element_height  = 20;
     editor_params.ui_mouse_menu_element_count   = 1;
+    editor_params.build_level_bvh               = 1;
+    editor_params.compress_files                = 0;
+    editor_params.level_chunk_size              = 0.0f;
     
     vars_tree_add(TYPE_OF(editor_params), (u8 *)&editor_params, CSTR("editor_params"));
 
@@ -254,7 +266,6 @@ void editor_init(State *state) {
     window_ptr         = &state->window;
     mouse_input_ptr    = &state->events.mouse_input;
     time_ptr           = &state->t;
-    shader_table_ptr   = &state->shader_table;
 
 
 
@@ -266,17 +277,8 @@ void editor_init(State *state) {
     editor_selected_list = array_list_make(Editor_Selected, 8, &std_allocator);
     
     
-    // @Copypasta: From console.c ... 
-    // Get resources.
-
-    // Load needed font... Hard coded...
-    u8* font_data = read_file_into_buffer("res/font/Consolas-Regular.ttf", NULL, &std_allocator);
-
-    font_small  = font_bake(font_data, 14.0f);
-    font_medium = font_bake(font_data, 20.0f);
-
-    free(font_data);
-    
+    // Resources are loaded when editor is first drawn, see "editor_load_resources()".
+    resources_loaded = false;
 
     // Copying main camera for editor.
     editor_camera = state->main_camera;
@@ -320,6 +322,13 @@ void editor_update_camera() {
 
     editor_camera_current_vel = vec2f_lerp(editor_camera_current_vel, vel, editor_params.camera_move_lerp_t);
 
+    // Stopping camera once it barely moves, so idle editor doesn't keep drawing frames for it.
+    if (vec2f_magnitude(editor_camera_current_vel) < EDITOR_CAMERA_SETTLE_SPEED) {
+        editor_camera_current_vel = VEC2F_ORIGIN;
+    } else {
+        game_request_frame();
+    }
+
     editor_camera.center = vec2f_sum(editor_camera.center, vec2f_multi_constant(editor_camera_current_vel, time_ptr->delta_time));
 
 
@@ -327,6 +336,12 @@ void editor_update_camera() {
     // Zoom control.
     editor_camera_current_zoom_vel = lerp(editor_camera_current_zoom_vel, mouse_input_ptr->scrolled_y * editor_params.camera_zoom_speed, editor_params.camera_zoom_lerp_t);
 
+    if (fabsf(editor_camera_current_zoom_vel) < EDITOR_CAMERA_SETTLE_SPEED) {
+        editor_camera_current_zoom_vel = 0.0f;
+    } else {
+        game_request_frame();
+    }
+
     editor_camera_current_zoom += editor_camera_current_zoom_vel * time_ptr->delta_time;
 
     editor_camera_current_zoom = clamp(editor_camera_current_zoom, 0.0f, 1.0f);
@@ -843,7 +858,26 @@ bool editor_update() {
     return false;
 }
 
+/**
+ * Loads font and grid shader on the first call, so they aren't loaded if the editor is never opened.
+ */
+static void editor_load_resources() {
+    if (resources_loaded) {
+        return;
+    }
+    resources_loaded = true;
+
+    // Frame is already being recorded, so OpenGL context is taken from the render thread for the loading.
+    graphics_context_acquire();
+
+    font_small = resource_font_get("res/font/Consolas-Regular.ttf", 14.0f);
+    drawer_init(grid_drawer_ptr, resource_shader_get("res/shader/grid.glsl"));
+
+    graphics_context_release();
+}
+
 void editor_draw() {
+    editor_load_resources();
 
     Matrix4f projection;
 
@@ -852,6 +886,7 @@ void editor_draw() {
     
     // Draw grid, with grid shader.
     shader_update_projection(grid_drawer_ptr->program, &projection);
+    render_layer_set(RENDER_LAYER_BACKGROUND);
 
     draw_begin(grid_drawer_ptr);
 
@@ -873,6 +908,7 @@ void editor_draw() {
 
     // Drawing quads.     
     shader_update_projection(quad_drawer_ptr->program, &projection);
+    render_layer_set(RENDER_LAYER_WORLD);
 
     draw_begin(quad_drawer_ptr);
 
@@ -935,6 +971,7 @@ void editor_draw() {
 
     // Drawing lines. 
     shader_update_projection(line_drawer_ptr->program, &projection);
+    render_layer_set(RENDER_LAYER_WORLD_OVERLAY);
 
     line_draw_begin(line_drawer_ptr);
 
@@ -1035,12 +1072,13 @@ void editor_draw() {
 
 
     // Set ui to use specific font.
-    ui_set_font(&font_small);
+    ui_set_font(font_small);
 
 
 
     projection = screen_calculate_projection(window_ptr->width, window_ptr->height);
     shader_update_projection(ui_quad_drawer_ptr->program, &projection);
+    render_layer_set(RENDER_LAYER_UI);
 
     draw_begin(ui_quad_drawer_ptr);
 
@@ -1095,6 +1133,54 @@ void editor_draw() {
 
 
 
+/**
+ * Writes buffer into the file, compressing it first if it is enabled in editor params.
+ * Returns number of bytes written, 0 on failure.
+ */
+static u64 editor_write_file(u8 *buffer, u64 size, char *file_name) {
+    u8 *packed = NULL;
+
+    if (editor_params.compress_files) {
+        packed = compress_buffer(buffer, size, &size);
+        if (packed == NULL) {
+            return 0;
+        }
+        buffer = packed;
+    }
+
+    int result = write_str_to_file(STR((s64)size, (char *)buffer), file_name);
+    free(packed);
+
+    return result == 0 ? size : 0;
+}
+
+/**
+ * Maps file into the memory, if it is compressed decompresses it straight from the mapping.
+ * Returns pointer to the file contents and sets its size into size, "decompressed" is set to the buffer that should be freed or NULL.
+ * Returns NULL on failure.
+ */
+static u8 *editor_read_file(char *file_name, File_Mapping *mapping, u64 *size, u8 **decompressed) {
+    *decompressed = NULL;
+
+    if (!file_map(file_name, mapping)) {
+        return NULL;
+    }
+
+    *size = mapping->size;
+
+    if (compress_check_header(mapping->data, mapping->size)) {
+        *decompressed = decompress_buffer(mapping->data, mapping->size, size);
+        if (*decompressed == NULL) {
+            file_unmap(mapping);
+        }
+        return *decompressed;
+    }
+
+    return mapping->data;
+}
+
+
+
 const String EDITOR_FILE_PATH   = STR_BUFFER("res/editor/");
 const String EDITOR_FILE_FORMAT = STR_BUFFER(".editor");
 
@@ -1106,40 +1192,50 @@ void editor_write(String name) {
     str_copy_to(EDITOR_FILE_FORMAT, file_name + EDITOR_FILE_PATH.length + name.length);
     file_name[EDITOR_FILE_PATH.length + name.length + EDITOR_FILE_FORMAT.length] = '\0';
 
-    FILE *file = fopen(file_name, "wb");
-    if (file == NULL) {
-        console_log("Couldn't open the editor file for writing '%s'.\n", file_name);
+    u32 edges_count = array_list_length(&edges_list);
+    u32 entities_count = array_list_length(&entity_list);
+
+    u64 size = 4 + 4 + edges_count * 17 + 4 + entities_count * 21;
+    u8 *buffer = malloc(size);
+    if (buffer == NULL) {
+        console_log("Memory allocation for buffer failed while writing the file '%s'.\n", file_name);
         return;
     }
 
-    u64 written = 0; 
+    u8 *ptr = buffer;
     
-    written += fwrite_u32(EDITOR_FORMAT_HEADER, file) * 4;
+    write_u32(&ptr, EDITOR_FORMAT_HEADER);
 
     // Serializing each edge information.
-    written += fwrite_u32(array_list_length(&edges_list), file) * 4;
+    write_u32(&ptr, edges_count);
     
-    for (u32 i = 0; i < array_list_length(&edges_list); i++) {
-        written += fwrite_float(edges_list[i].vertex.x, file) * 4;
-        written += fwrite_float(edges_list[i].vertex.y, file) * 4;
-        written += fwrite_u32(edges_list[i].previous_index, file) * 4;
-        written += fwrite_u32(edges_list[i].next_index, file) * 4;
-        written += fwrite(&edges_list[i].flipped_normal, 1, 1, file);
+    for (u32 i = 0; i < edges_count; i++) {
+        write_float(&ptr, edges_list[i].vertex.x);
+        write_float(&ptr, edges_list[i].vertex.y);
+        write_u32(&ptr, edges_list[i].previous_index);
+        write_u32(&ptr, edges_list[i].next_index);
+        write_byte(&ptr, edges_list[i].flipped_normal);
     }
     
     // Serializing each entity information.
-    written += fwrite_u32(array_list_length(&entity_list), file) * 4;
+    write_u32(&ptr, entities_count);
     
-    for (u32 i = 0; i < array_list_length(&entity_list); i++) {
-        written += fwrite(&entity_list[i].type, 1, 1, file);
-        written += fwrite_float(entity_list[i].bound_box.center.x, file) * 4;
-        written += fwrite_float(entity_list[i].bound_box.center.y, file) * 4;
-        written += fwrite_float(entity_list[i].bound_box.dimensions.x, file) * 4;
-        written += fwrite_float(entity_list[i].bound_box.dimensions.y, file) * 4;
-        written += fwrite_float(entity_list[i].bound_box.rot, file) * 4;
+    for (u32 i = 0; i < entities_count; i++) {
+        write_byte(&ptr, entity_list[i].type);
+        write_float(&ptr, entity_list[i].bound_box.center.x);
+        write_float(&ptr, entity_list[i].bound_box.center.y);
+        write_float(&ptr, entity_list[i].bound_box.dimensions.x);
+        write_float(&ptr, entity_list[i].bound_box.dimensions.y);
+        write_float(&ptr, entity_list[i].bound_box.rot);
     }
 
-    fclose(file);
+    u64 written = editor_write_file(buffer, size, file_name);
+    free(buffer);
+
+    if (written == 0) {
+        console_log("Couldn't open the editor file for writing '%s'.\n", file_name);
+        return;
+    }
 
     console_log("Written %llu bytes to editor file '%s'.\n", written, file_name);
 }
@@ -1151,38 +1247,23 @@ void editor_read(String name) {
     str_copy_to(EDITOR_FILE_FORMAT, file_name + EDITOR_FILE_PATH.length + name.length);
     file_name[EDITOR_FILE_PATH.length + name.length + EDITOR_FILE_FORMAT.length] = '\0';
 
-    FILE *file = fopen(file_name, "rb");
-    if (file == NULL) {
-        console_log("Couldn't open the editor file for reading '%s'.\n", file_name);
-        return;
-    }
-
-    (void)fseek(file, 0, SEEK_END);
-    u64 size = ftell(file);
-    rewind(file);
+    File_Mapping mapping;
+    u64 size;
+    u8 *decompressed;
 
-    u8 *buffer = malloc(size);
+    u8 *buffer = editor_read_file(file_name, &mapping, &size, &decompressed);
     if (buffer == NULL) {
-        console_log("Memory allocation for buffer failed while reading the file '%s'.\n", file_name);
-        (void)fclose(file);
-        return;
-    }
-
-    if (fread(buffer, 1, size, file) != size) {
-        console_log("Failure reading the file '%s'.\n", file_name);
-        (void)fclose(file);
-        free(buffer);
+        console_log("Couldn't open the editor file for reading '%s'.\n", file_name);
         return;
     }
 
-    (void)fclose(file);
-
 
     u8 *ptr = buffer;
 
-    if (read_u32(&ptr) != EDITOR_FORMAT_HEADER) {
+    if (size < 8 || read_u32(&ptr) != EDITOR_FORMAT_HEADER) {
         console_log("Failure reading the editor file '%s', format header doesn't match.\n", file_name);
-        free(buffer);
+        free(decompressed);
+        file_unmap(&mapping);
         return;
     }
 
@@ -1213,9 +1294,10 @@ void editor_read(String name) {
 
 
     
-    free(buffer);
+    free(decompressed);
+    file_unmap(&mapping);
     
-    console_log("Read %llu bytes into the editor from '%s' level file.\n", ptr - buffer, file_name);
+    console_log("Read %llu bytes into the editor from '%s' level file.\n", size, file_name);
 }
 
 
@@ -1227,55 +1309,26 @@ void editor_build(String name) {
     str_copy_to(LEVEL_FILE_FORMAT, file_name + LEVEL_FILE_PATH.length + name.length);
     file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length] = '\0';
 
-    FILE *file = fopen(file_name, "wb");
-    if (file == NULL) {
-        console_log("Couldn't open the level file for building '%s'.\n", file_name);
-        return;
-    }
-
-    u64 written = 0; 
-    
-    written += fwrite_u32(LEVEL_FORMAT_HEADER, file) * 4;
-
-    // Serializing each edge information.
-    written += fwrite_u32(array_list_length(&edges_list), file) * 4;
-    
+    Phys_Edge *edges = array_list_make(Phys_Edge, array_list_length(&edges_list) + 1, &std_allocator);
+    Phys_Polygon *polygons = array_list_make(Phys_Polygon, 8, &std_allocator);
 
-    // @Important: The reason why there are two loops, is only because the first one tells the length of the polygon being serialized and the other serializes the edges themselves.
+    // @Important: Polygons store index of their first edge in place of the pointer until all edges are collected, since edges list might be reallocated.
     Vec2f normal, v0, v1;
-    u32 j, polygon_edge_count;
+    u32 j;
     for (u32 i = 0; i < array_list_length(&edges_list); i++) {  
         if (edges_list[i].flags & EDITOR_EDGE_BUILT) {
             continue;
         }
 
+        array_list_append(&polygons, ((Phys_Polygon) { .edges_count = 0, .edges = (Phys_Edge *)(u64)array_list_length(&edges) }));
 
-        j = i;
-        polygon_edge_count = 0;
-        while (true) {
-            polygon_edge_count++;
-
-            if (edges_list[j].next_index == EDITOR_INVALID_INDEX) {
-                console_log("Couldn't finish polygon building, disconnected edge sequence encountered.\n");
-                break;
-            }
-
-            j = edges_list[j].next_index;
-
-            if (j == i) {
-                break;
-            }
-        }
-
-        written += fwrite_u32(polygon_edge_count, file) * 4;
         j = i;
         while(true) {
-            written += fwrite_float(edges_list[j].vertex.x, file) * 4;
-            written += fwrite_float(edges_list[j].vertex.y, file) * 4;
+            polygons[array_list_length(&polygons) - 1].edges_count++;
 
             if (edges_list[j].next_index == EDITOR_INVALID_INDEX) {
-                written += fwrite_float(0.0f, file) * 4;
-                written += fwrite_float(0.0f, file) * 4;
+                console_log("Couldn't finish polygon building, disconnected edge sequence encountered.\n");
+                array_list_append(&edges, ((Phys_Edge) { .vertex = edges_list[j].vertex, .normal = VEC2F_ORIGIN }));
                 break;
             }
 
@@ -1283,8 +1336,7 @@ void editor_build(String name) {
             v1 = edges_list[edges_list[j].next_index].vertex;
             normal = vec2f_normalize(vec2f_make( (-2 * edges_list[j].flipped_normal + 1) * (v1.y - v0.y), (2 * edges_list[j].flipped_normal - 1) * (v1.x - v0.x) ));
 
-            written += fwrite_float(normal.x, file) * 4;
-            written += fwrite_float(normal.y, file) * 4;
+            array_list_append(&edges, ((Phys_Edge) { .vertex = v0, .normal = normal }));
             
             edges_list[j].flags |= EDITOR_EDGE_BUILT;
 
@@ -1296,27 +1348,85 @@ void editor_build(String name) {
         }
     }
 
-    // Buildin each entity information.
-    written += fwrite_u32(array_list_length(&entity_list), file) * 4;
+    for (u32 i = 0; i < array_list_length(&polygons); i++) {
+        polygons[i].edges = edges + (u64)polygons[i].edges;
+    }
+
+    for (u32 i = 0; i < array_list_length(&edges_list); i++) {  
+        edges_list[i].flags &= ~EDITOR_EDGE_BUILT;
+    }
+
+
+    // Building each entity information.
+    u32 entities_count = array_list_length(&entity_list);
+    Entity_Type *entity_types = malloc(entities_count * sizeof(Entity_Type) + 1);
+    OBB *entity_boxes = malloc(entities_count * sizeof(OBB) + 1);
+
+    if (entity_types == NULL || entity_boxes == NULL) {
+        console_log("Failure allocating entities of level image for '%s'.\n", file_name);
+        free(entity_types);
+        free(entity_boxes);
+        array_list_free(&edges);
+        array_list_free(&polygons);
+        return;
+    }
     
-    for (u32 i = 0; i < array_list_length(&entity_list); i++) {
-        written += fwrite(&entity_list[i].type, 1, 1, file);
-        written += fwrite_float(entity_list[i].bound_box.center.x, file) * 4;
-        written += fwrite_float(entity_list[i].bound_box.center.y, file) * 4;
-        written += fwrite_float(entity_list[i].bound_box.dimensions.x, file) * 4;
-        written += fwrite_float(entity_list[i].bound_box.dimensions.y, file) * 4;
-        written += fwrite_float(entity_list[i].bound_box.rot, file) * 4;
+    for (u32 i = 0; i < entities_count; i++) {
+        entity_types[i] = entity_list[i].type;
+        entity_boxes[i] = entity_list[i].bound_box;
     }
 
 
-    fclose(file);
+    Level_Build_Info info = {
+        .polygons       = polygons,
+        .polygons_count = array_list_length(&polygons),
+        .entity_types   = entity_types,
+        .entity_boxes   = entity_boxes,
+        .entities_count = entities_count,
+        .build_bvh      = editor_params.build_level_bvh != 0,
+    };
 
+    // Chunked levels compress each chunk separately, so they are written as they are.
+    bool chunked = editor_params.level_chunk_size > 0.0f;
 
-    for (u32 i = 0; i < array_list_length(&edges_list); i++) {  
-        edges_list[i].flags &= ~EDITOR_EDGE_BUILT;
+    u64 image_size;
+    u8 *image = chunked ? level_chunked_build(&info, editor_params.level_chunk_size, editor_params.compress_files != 0, &image_size) : level_image_build(&info, &image_size);
+
+    array_list_free(&edges);
+    array_list_free(&polygons);
+    free(entity_types);
+    free(entity_boxes);
+
+    if (image == NULL) {
+        console_log("Failure building level image for '%s'.\n", file_name);
+        return;
+    }
+
+    // Both the streamed level and its cached image keep the file mapped, so they let go of it first, streamed level is loaded again once the file is written.
+    bool reload = level_release_file(file_name);
+    level_cache_evict(file_name);
+
+    u64 written;
+    if (chunked) {
+        written = write_str_to_file(STR((s64)image_size, (char *)image), file_name) == 0 ? image_size : 0;
+    } else {
+        written = editor_write_file(image, image_size, file_name);
+    }
+    free(image);
+
+    if (written == 0) {
+        console_log("Couldn't open the level file for building '%s'.\n", file_name);
+        if (reload) {
+            level_load(name);
+        }
+        return;
     }
 
     console_log("Written %llu bytes to level file '%s'.\n", written, file_name);
+
+    if (reload) {
+        level_load(name);
+    }
 }
 
 
@@ -43,7 +43,8 @@ void event_init_handler(Events_Info *events) {
     }
 }
 
-void event_handle(Events_Info *events, Window_Info *window, Time_Info *t) {
+u32 event_handle(Events_Info *events, Window_Info *window, Time_Info *t) {
+    u32 handled = 0;
 
     // Clear inputs.
     events->mouse_input.left_pressed = false;
@@ -57,6 +58,8 @@ void event_handle(Events_Info *events, Window_Info *window, Time_Info *t) {
 
     // Poll events.
     while (SDL_PollEvent(&event)) {
+        handled++;
+
         switch (event.type) {
             case SDL_QUIT:
                 events->should_quit = true;
@@ -106,6 +109,7 @@ void event_handle(Events_Info *events, Window_Info *window, Time_Info *t) {
         }
     }
 
+    return handled;
 }
 
 
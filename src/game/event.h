@@ -40,8 +40,9 @@ void event_init_handler(Events_Info *events);
 
 /**
  * Handles SDL events recieved.
+ * Returns number of events handled.
  */
-void event_handle(Events_Info *events, Window_Info *window, Time_Info *t);
+u32 event_handle(Events_Info *events, Window_Info *window, Time_Info *t);
 
 
 /**
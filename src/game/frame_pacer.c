@@ -0,0 +1,109 @@
+#include "game/frame_pacer.h"
+
+#include "meta_generated.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/str.h"
+#include "core/log.h"
+
+#include "game/gpu.h"
+#include "game/graphics.h"
+#include "game/vars.h"
+
+
+
+@Introspect;
+typedef struct frame_params {
+    s64 target_fps;
+    float spin_ms;
+    s64 vsync;
+} Frame_Params;
+
+static Frame_Params frame_params;
+
+static u64 frame_start_ns;
+static u64 frame_due_ns;
+static u64 oversleep_ns;        // Recent peak of how late sleeps woke up, decays every frame.
+static s64 vsync_applied;
+
+
+
+void frame_pacer_init() {
+    frame_params.target_fps = FRAME_PACER_DEFAULT_FPS;
+    frame_params.spin_ms    = FRAME_PACER_DEFAULT_SPIN_MS;
+    frame_params.vsync      = 0;
+
+    vars_tree_add(TYPE_OF(frame_params), (u8 *)&frame_params, CSTR("frame_params"));
+
+    // Swap interval is left to the driver until vsync is set, -1 makes sure first setting is applied.
+    vsync_applied = -1;
+    frame_start_ns = get_time_ns();
+    frame_due_ns = frame_start_ns;
+    oversleep_ns = 0;
+}
+
+static void frame_pacer_apply_vsync() {
+    s64 vsync = frame_params.vsync != 0;
+    if (vsync == vsync_applied) {
+        return;
+    }
+    vsync_applied = vsync;
+
+    graphics_context_acquire();
+    bool applied = gpu->swap_interval((int)vsync);
+    graphics_context_release();
+
+    if (!applied) {
+        LOG_WARNING("Couldn't %s vsync: %s", vsync ? "enable" : "disable", SDL_GetError());
+    }
+}
+
+u64 frame_pacer_wait() {
+    frame_pacer_apply_vsync();
+
+    u64 now = get_time_ns();
+
+    if (frame_params.target_fps > 0) {
+        u64 interval = 1000000000ull / (u64)frame_params.target_fps;
+        frame_due_ns += interval;
+
+        // Behind by more than a frame, starting the schedule over instead of rushing frames to catch up.
+        if (now > frame_due_ns + interval) {
+            frame_due_ns = now;
+        }
+
+        u64 spin_ns = (u64)(frame_params.spin_ms * 1000000.0f) + oversleep_ns;
+        oversleep_ns -= oversleep_ns / 16;
+
+        if (frame_due_ns > now + spin_ns) {
+            u64 sleep = frame_due_ns - now - spin_ns;
+            sleep_ns(sleep);
+
+            u64 woke = get_time_ns();
+            u64 late = woke - now > sleep ? woke - now - sleep : 0;
+            if (late > oversleep_ns) {
+                oversleep_ns = late;
+            }
+            now = woke;
+        }
+
+        while (now < frame_due_ns) {
+            now = get_time_ns();
+        }
+    } else {
+        frame_due_ns = now;
+    }
+
+    u64 elapsed = now - frame_start_ns;
+    frame_start_ns = now;
+
+    return elapsed;
+}
+
+void frame_pacer_reset() {
+    u64 interval = frame_params.target_fps > 0 ? 1000000000ull / (u64)frame_params.target_fps : 0;
+
+    frame_start_ns = get_time_ns() - interval;
+    frame_due_ns = frame_start_ns;
+}
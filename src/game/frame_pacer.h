@@ -0,0 +1,42 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "core/core.h"
+#include "core/type.h"
+
+/**
+ * Frame pacing.
+ *
+ * Frame loop waits here for the start of the next frame, instead of spinning on the clock the whole time.
+ * Thread sleeps until shortly before the frame is due and only spins for the rest, since sleeping alone can wake up late.
+ * Time spun before the deadline is the configured spin time plus how late sleeps have been waking up recently, so coarse OS timers are accounted for.
+ * Frames are due at fixed intervals, so occasional late frame doesn't shift the ones after it, but a frame that is behind by more than one interval starts the schedule over.
+ * Tweak vars "frame_params":
+ *      target_fps  frames per second, 0 doesn't limit the rate.
+ *      spin_ms     milliseconds spun before the deadline instead of sleeping.
+ *      vsync       1 synchronizes presenting with the display, frame rate is then also limited by the display refresh rate.
+ */
+
+#define FRAME_PACER_DEFAULT_FPS     100
+#define FRAME_PACER_DEFAULT_SPIN_MS 1.0f
+
+/**
+ * Registers tweak vars, should be called before the vars tree is built.
+ */
+void frame_pacer_init();
+
+/**
+ * Waits until the next frame is due and returns nano seconds since the previous frame started.
+ * Applies changed vsync setting before waiting.
+ * @Important: Should be called from the main thread, once per frame, before updating the game.
+ */
+u64 frame_pacer_wait();
+
+/**
+ * Starts the schedule over, so the next frame is due right away and its delta is one frame interval, no matter how long ago the previous frame was.
+ * Should be called after the loop was blocked, so time spent blocked doesn't count into delta time.
+ */
+void frame_pacer_reset();
+
+
+#endif
@@ -10,6 +10,7 @@
 
 #include "game/graphics.h"
 #include "game/level.h"
+#include "game/level_cache.h"
 #include "game/input.h"
 #include "game/draw.h"
 #include "game/event.h"
@@ -19,9 +20,17 @@
 #include "game/vars.h"
 #include "game/imui.h"
 #include "game/asset.h"
+#include "game/atlas.h"
+#include "game/texture_stream.h"
+#include "game/resource.h"
+#include "game/frame_pacer.h"
+#include "game/capture.h"
+#include "game/profiler.h"
 
 #include <SDL2/SDL_keycode.h>
 #include <SDL2/SDL_keyboard.h>
+#include <SDL2/SDL_events.h>
+#include <SDL2/SDL_timer.h>
 #include <float.h>
 #include <limits.h>
 #include <math.h>
@@ -45,6 +54,24 @@ static State *state;
 
 
 
+/**
+ * Idle frame skipping.
+ * Frame is damaged if anything it draws could have changed: events, held input, asset changes, streaming textures, or requested frame.
+ * After GAME_IDLE_FRAMES frames in a row without damage, editor and menu block in "game_wait_idle()" instead of drawing.
+ */
+
+// Undamaged frames drawn before going idle, so edges of input like "pressed" settle on screen.
+#define GAME_IDLE_FRAMES        2
+// Longest time idle loop blocks for at once, asset changes are polled this often while idle.
+#define GAME_IDLE_POLL_MS       100
+
+static u32  idle_frames;
+static bool frame_requested;
+static u32  frame_wake_ticks;       // SDL ticks requested frame is due at, 0 if none.
+static bool asset_changes_polled;   // Idle loop polled changes that are processed by the next frame.
+
+
+
 // Keybinds (Simple).
 // @Temporary: Will be replaced with meta program + keybinds config solution.
 #define BIND_PRESSED(keybind)   (!SDL_IsTextInputActive() && pressed(keybind))
@@ -107,7 +134,7 @@ void game_init(State *global_state) {
 
 
     // Init SDL and GL.
-    if (init_sdl_gl()) {
+    if (init_sdl_gl(state->headless)) {
         LOG_ERROR("Couldn't init SDL and GL.");
         exit(1);
     }
@@ -146,13 +173,6 @@ void game_init(State *global_state) {
 
 
 
-    /**
-     * Setting hash tables for resources. 
-     * Since they are dynamically allocated pointers will not change after hot reloading.
-     */
-    state->shader_table = hash_table_make(Shader, 8, &std_allocator);
-
-
     /**
      * This just goes through asset changes that are forced by 'asset_force_changes(...).
      * And loads each one using specific loading function.
@@ -160,25 +180,9 @@ void game_init(State *global_state) {
      * And such functions then can simply be called here.
      */
 
-    // Loading Shaders specifically.
+    // Shaders are loaded through resource registry by modules that use them, so their forced changes are only dropped here.
     for (u32 i = 0; i < changes_count; i++) {
         if (str_equals(changes[i].file_format, SHADER_FILE_FORMAT)) {
-            LOG_INFO("Detected Shader Asset: '%.*s'.", UNPACK(changes[i].full_path));
-            char _buffer[changes[i].full_path.length + 1]; 
-            str_copy_to(changes[i].full_path, _buffer);
-            _buffer[changes[i].full_path.length]     = '\0';
-
-            Shader shader = shader_load(_buffer);
-            if (shader.id == 0) {
-                // If id is 0 this means shader failed to load, skipping it.
-                continue;
-            }
-
-            shader_init_uniforms(&shader);
-
-            String shader_name = str_substring(changes[i].file_name, 0, str_find_char_right(changes[i].file_name, '.'));
-            hash_table_put(&state->shader_table, shader, UNPACK(shader_name));
-
             asset_remove_change(i);
             i--;
             changes_count--;
@@ -187,17 +191,21 @@ void game_init(State *global_state) {
         }
     }
 
+    // Loading resources listed to be loaded up front, everything else is loaded when it is first used.
+    u32 prefetched = resource_prefetch(RESOURCE_PREFETCH_LIST);
+    if (prefetched > 0) {
+        LOG_INFO("Prefetched %u resources from '%s'.", prefetched, RESOURCE_PREFETCH_LIST);
+    }
 
 
-    // Drawers init.
-    drawer_init(&state->quad_drawer, hash_table_get(&state->shader_table, UNPACK_LITERAL("quad")));
 
-    drawer_init(&state->grid_drawer, hash_table_get(&state->shader_table, UNPACK_LITERAL("grid")));
+    // Drawers init, grid drawer is only used by the editor, so it is initted by the editor when it is first drawn.
+    instanced_drawer_init(&state->quad_drawer, resource_shader_get("res/shader/quad_instanced.glsl"));
 
-    drawer_init(&state->ui_quad_drawer, hash_table_get(&state->shader_table, UNPACK_LITERAL("ui_quad")));
+    drawer_init(&state->ui_quad_drawer, resource_shader_get("res/shader/ui_quad.glsl"));
 
 
-    line_drawer_init(&state->line_drawer, hash_table_get(&state->shader_table, UNPACK_LITERAL("line")));
+    line_drawer_init(&state->line_drawer, resource_shader_get("res/shader/line.glsl"));
 
 
     // Main camera init.
@@ -222,6 +230,9 @@ void game_init(State *global_state) {
     // Init editor.
     editor_init(state);
 
+    // Init frame pacing.
+    frame_pacer_init();
+
     
 
 
@@ -260,7 +271,10 @@ void game_init(State *global_state) {
 
 
     // Setting clear color.
-    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+    gpu->clear_color(0.2f, 0.2f, 0.2f, 1.0f);
+
+    // Handing OpenGL context to the render thread, frames are submitted by it from now on.
+    (void)graphics_render_thread_start(state->window.ptr);
 
     // Logging hello world to the console.
     console_log("Hello world!\n");
@@ -270,8 +284,11 @@ void game_init(State *global_state) {
 
 
 
-void process_asset_changes() {
-    u32 count;
+/**
+ * Reloads changed assets, returns number of changes.
+ */
+u32 process_asset_changes() {
+    u32 count = 0;
     const Asset_Change *changes;
 
     if (asset_view_changes(&count, &changes)) {
@@ -284,33 +301,20 @@ void process_asset_changes() {
             // Shader files.
             else if (str_equals(changes[i].file_format, SHADER_FILE_FORMAT)) {
                 console_log("Shader detected Asset Change: '%.*s'\n", UNPACK(changes[i].full_path));
-                char _buffer[changes[i].full_path.length + 1]; 
-                str_copy_to(changes[i].full_path, _buffer);
-                _buffer[changes[i].full_path.length]     = '\0';
-
-    
-                Shader shader = shader_load(_buffer);
-                if (shader.id == 0) {
-                    // If id is 0 this means shader failed to load, skipping it.
-                    continue;
-                }
-
 
-                String shader_name = str_substring(changes[i].file_name, 0, str_find_char_right(changes[i].file_name, '.'));
-
-                Shader *existing = hash_table_get(&state->shader_table, UNPACK(shader_name));
-                if (existing != NULL) {
-                    shader_unload(existing);
-                }
-
-
-
-                shader_init_uniforms(&shader);
-
-                hash_table_put(&state->shader_table, shader, UNPACK(shader_name));
+                // Shaders that aren't loaded yet will be loaded from the changed file when they are first used.
+                graphics_context_acquire();
+                (void)resource_reload(changes[i].full_path);
+                graphics_context_release();
+            }
+            // Images of streamed textures, previous image is drawn until the new one is uploaded.
+            else if (texture_stream_reload(changes[i].full_path)) {
+                console_log("Texture detected Asset Change: '%.*s'\n", UNPACK(changes[i].full_path));
             }
         }
     }
+
+    return count;
 }
 
 /**
@@ -319,20 +323,30 @@ void process_asset_changes() {
  * Drawing part is only responsible for putting pixels accrodingly with calculated data in "Updating" part.
  */
 void game_update() {
-    // Polling any asset changes.
-    if (asset_observer_poll_changes() != 0) {
+    profiler_begin(PROFILER_SCOPE_ASSETS);
+
+    // Polling any asset changes, unless idle loop already polled them while waiting.
+    if (!asset_changes_polled && asset_observer_poll_changes() != 0) {
         LOG_ERROR("Couldn't poll asset changes.");
         exit(1);
     }
+    asset_changes_polled = false;
+
+    u32 changes_count = process_asset_changes();
 
-    process_asset_changes();
+    // Uploading decoded textures within the frame budget.
+    texture_stream_update();
+
+    profiler_end(PROFILER_SCOPE_ASSETS);
 
     
     // Handling events
-    event_handle(&state->events, &state->window, &state->t);
+    profiler_begin(PROFILER_SCOPE_EVENTS);
+    u32 events_count = event_handle(&state->events, &state->window, &state->t);
+    profiler_end(PROFILER_SCOPE_EVENTS);
 
     // Clearin screen.
-    glClear(GL_COLOR_BUFFER_BIT);
+    graphics_clear();
     
 
 
@@ -356,6 +370,7 @@ void game_update() {
         case GAME_STATE_EDITOR:
 
             // Updating editor, if console is not active.
+            profiler_begin(PROFILER_SCOPE_UPDATE);
             if (!console_active()) {
                 if (editor_update()) {
                     TODO("Editor exitting.");
@@ -366,17 +381,24 @@ void game_update() {
                     // Switch to GAME_STATE_LEVEL.
                 }
             }
+            profiler_end(PROFILER_SCOPE_UPDATE);
 
             // Editor drawing.
+            profiler_begin(PROFILER_SCOPE_DRAW);
             editor_draw();
+            profiler_end(PROFILER_SCOPE_DRAW);
 
             break;
         case GAME_STATE_LEVEL:
 
             
+            profiler_begin(PROFILER_SCOPE_UPDATE);
             level_update();
+            profiler_end(PROFILER_SCOPE_UPDATE);
 
+            profiler_begin(PROFILER_SCOPE_DRAW);
             level_draw();
+            profiler_end(PROFILER_SCOPE_DRAW);
 
             // Matrix4f projection;
 
@@ -401,32 +423,110 @@ void game_update() {
 
 
 
+    // Frame timeline overlay, under the console.
+    profiler_draw(&state->window, &state->ui_quad_drawer);
+
+
     // Console update.
+    profiler_begin(PROFILER_SCOPE_CONSOLE);
     console_update();
 
     // Console drawing.
     console_draw();
+    profiler_end(PROFILER_SCOPE_CONSOLE);
    
 
 
-    // Checking for gl error.
-    check_gl_error();
+    // Reading back the frame if it is captured, before it is handed off.
+    profiler_begin(PROFILER_SCOPE_SUBMIT);
+    capture_update(state->window.width, state->window.height);
+
+    // Handing off the frame, buffers are swapped to display it once it is submitted.
+    graphics_frame_end(state->window.ptr);
+    profiler_end(PROFILER_SCOPE_SUBMIT);
 
+    profiler_frame_end();
 
-    // Swap buffers to display the rendered image.
-    SDL_GL_SwapWindow(state->window.ptr);
+
+    // Tracking if the next frame could differ from this one, for idle frame skipping.
+    Mouse_Input *mouse = &state->events.mouse_input;
+    bool damaged = frame_requested || events_count > 0 || changes_count > 0 || texture_stream_pending() > 0 ||
+                   hold_any() || mouse->left_hold || mouse->right_hold;
+    frame_requested = false;
+    idle_frames = damaged ? 0 : idle_frames + 1;
 
 
     // Post updating input.
     keyboard_state_old_update();
 }
 
+bool game_wait_idle() {
+    if (state->game_state == GAME_STATE_LEVEL || idle_frames < GAME_IDLE_FRAMES) {
+        return false;
+    }
+
+    bool waited = false;
+    while (true) {
+        u32 timeout = GAME_IDLE_POLL_MS;
+
+        if (frame_wake_ticks != 0) {
+            u32 now = SDL_GetTicks();
+            if (now >= frame_wake_ticks) {
+                frame_wake_ticks = 0;
+                break;
+            }
+            if (frame_wake_ticks - now < timeout) {
+                timeout = frame_wake_ticks - now;
+            }
+        }
+
+        // Event is left in the queue, it is handled by the frame as usual.
+        waited = true;
+        if (SDL_WaitEventTimeout(NULL, (int)timeout)) {
+            break;
+        }
+
+        // Hot reloading wakes the loop too, changes are kept for the next frame.
+        if (asset_observer_poll_changes() != 0) {
+            LOG_ERROR("Couldn't poll asset changes.");
+            exit(1);
+        }
+        u32 count;
+        const Asset_Change *changes;
+        if (asset_view_changes(&count, &changes)) {
+            asset_changes_polled = true;
+            break;
+        }
+    }
+
+    return waited;
+}
+
+void game_request_frame() {
+    frame_requested = true;
+}
+
+void game_request_frame_after(u32 milliseconds) {
+    u32 ticks = SDL_GetTicks() + milliseconds;
+    if (frame_wake_ticks == 0 || ticks < frame_wake_ticks) {
+        frame_wake_ticks = ticks;
+    }
+}
+
 void game_free() {
+    // Taking OpenGL context back, so everything below can be deleted.
+    graphics_render_thread_stop();
+
+    capture_free();
+    profiler_free();
     console_free();
 
-    shader_unload(hash_table_get(&state->shader_table, UNPACK_LITERAL("quad")));
-    shader_unload(hash_table_get(&state->shader_table, UNPACK_LITERAL("ui_quad")));
     drawer_free(&state->quad_drawer);
+
+    level_cache_free();
+    resource_free();
+    texture_stream_free();
+    atlas_free();
 }
 
 void quit() {
@@ -435,6 +535,7 @@ void quit() {
 
 void game_set_state(Game_State game_state) {
     state->game_state = game_state;
+    game_request_frame();
 }
 
 
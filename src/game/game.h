@@ -22,6 +22,8 @@ typedef enum game_state : u8 {
 
 
 typedef struct state {
+    bool headless;              // Rendering into offscreen framebuffer without display, set before "game_init()".
+
     Window_Info window;
     Events_Info events;
     Time_Info t;
@@ -34,7 +36,6 @@ typedef struct state {
     // @TODO: Move this camera to level struct.
     Camera main_camera;
     
-    Shader     *shader_table;
     Font_Baked *font;
 
     Quad_Drawer quad_drawer;
@@ -60,6 +61,24 @@ void game_update();
  */
 void game_free();
 
+/**
+ * Blocks while the next frame would be the same as the previous one, returns true if it did.
+ * Only editor and menu go idle, level is simulated every frame.
+ * Loop wakes up on any event, asset change or requested frame, and draws frames for a little while after the last change.
+ * Frame pacer should be reset when it returns true, so time spent blocked doesn't count into delta time of the next frame.
+ */
+bool game_wait_idle();
+
+/**
+ * Asks for the next frame to be drawn even if nothing else changes, should be called every frame something animates.
+ */
+void game_request_frame();
+
+/**
+ * Asks for a frame to be drawn once the milliseconds pass, wakes up idle loop for it.
+ */
+void game_request_frame_after(u32 milliseconds);
+
 
 /**
  * This function will notify app to quit at the end of the next frame.
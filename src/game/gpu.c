@@ -0,0 +1,720 @@
+#include "game/gpu.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/structs.h"
+#include "core/log.h"
+
+#include "game/graphics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+/**
+ * OpenGL backend.
+ * @Important: Most of OpenGL functions are pointers loaded by GLEW once context is made, so they are called through wrappers instead of being put into the table.
+ */
+
+static void gpu_gl_enable(GLenum cap) { glEnable(cap); }
+static void gpu_gl_blend_func(GLenum source, GLenum destination) { glBlendFunc(source, destination); }
+static void gpu_gl_clear_color(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) { glClearColor(red, green, blue, alpha); }
+static void gpu_gl_clear(GLbitfield mask) { glClear(mask); }
+static void gpu_gl_viewport(GLint x, GLint y, GLsizei width, GLsizei height) { glViewport(x, y, width, height); }
+static void gpu_gl_pixel_store_i(GLenum name, GLint param) { glPixelStorei(name, param); }
+static void gpu_gl_get_integer_v(GLenum name, GLint *data) { glGetIntegerv(name, data); }
+static GLenum gpu_gl_get_error() { return glGetError(); }
+static const GLubyte *gpu_gl_get_string(GLenum name) { return glGetString(name); }
+
+static void gpu_gl_gen_buffers(GLsizei count, GLuint *buffers) { glGenBuffers(count, buffers); }
+static void gpu_gl_delete_buffers(GLsizei count, const GLuint *buffers) { glDeleteBuffers(count, buffers); }
+static void gpu_gl_bind_buffer(GLenum target, GLuint buffer) { glBindBuffer(target, buffer); }
+static void gpu_gl_bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) { glBindBufferRange(target, index, buffer, offset, size); }
+static void gpu_gl_buffer_data(GLenum target, GLsizeiptr size, const void *data, GLenum usage) { glBufferData(target, size, data, usage); }
+static void gpu_gl_buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) { glBufferSubData(target, offset, size, data); }
+static void gpu_gl_buffer_storage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) { glBufferStorage(target, size, data, flags); }
+static void *gpu_gl_map_buffer_range(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) { return glMapBufferRange(target, offset, length, access); }
+static void gpu_gl_flush_mapped_buffer_range(GLenum target, GLintptr offset, GLsizeiptr length) { glFlushMappedBufferRange(target, offset, length); }
+static GLboolean gpu_gl_unmap_buffer(GLenum target) { return glUnmapBuffer(target); }
+
+static void gpu_gl_gen_vertex_arrays(GLsizei count, GLuint *arrays) { glGenVertexArrays(count, arrays); }
+static void gpu_gl_delete_vertex_arrays(GLsizei count, const GLuint *arrays) { glDeleteVertexArrays(count, arrays); }
+static void gpu_gl_bind_vertex_array(GLuint array) { glBindVertexArray(array); }
+static void gpu_gl_vertex_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) { glVertexAttribPointer(index, size, type, normalized, stride, pointer); }
+static void gpu_gl_vertex_attrib_i_pointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void *pointer) { glVertexAttribIPointer(index, size, type, stride, pointer); }
+static void gpu_gl_enable_vertex_attrib_array(GLuint index) { glEnableVertexAttribArray(index); }
+static void gpu_gl_vertex_attrib_divisor(GLuint index, GLuint divisor) { glVertexAttribDivisor(index, divisor); }
+
+static void gpu_gl_gen_textures(GLsizei count, GLuint *textures) { glGenTextures(count, textures); }
+static void gpu_gl_delete_textures(GLsizei count, const GLuint *textures) { glDeleteTextures(count, textures); }
+static void gpu_gl_active_texture(GLenum unit) { glActiveTexture(unit); }
+static void gpu_gl_bind_texture(GLenum target, GLuint texture) { glBindTexture(target, texture); }
+static void gpu_gl_tex_parameter_i(GLenum target, GLenum name, GLint param) { glTexParameteri(target, name, param); }
+static void gpu_gl_tex_image_2d(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels) { glTexImage2D(target, level, internal_format, width, height, border, format, type, pixels); }
+static void gpu_gl_tex_sub_image_2d(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels) { glTexSubImage2D(target, level, x, y, width, height, format, type, pixels); }
+
+static void gpu_gl_gen_framebuffers(GLsizei count, GLuint *framebuffers) { glGenFramebuffers(count, framebuffers); }
+static void gpu_gl_bind_framebuffer(GLenum target, GLuint framebuffer) { glBindFramebuffer(target, framebuffer); }
+static void gpu_gl_gen_renderbuffers(GLsizei count, GLuint *renderbuffers) { glGenRenderbuffers(count, renderbuffers); }
+static void gpu_gl_bind_renderbuffer(GLenum target, GLuint renderbuffer) { glBindRenderbuffer(target, renderbuffer); }
+static void gpu_gl_renderbuffer_storage(GLenum target, GLenum internal_format, GLsizei width, GLsizei height) { glRenderbufferStorage(target, internal_format, width, height); }
+static void gpu_gl_framebuffer_renderbuffer(GLenum target, GLenum attachment, GLenum renderbuffer_target, GLuint renderbuffer) { glFramebufferRenderbuffer(target, attachment, renderbuffer_target, renderbuffer); }
+static GLenum gpu_gl_check_framebuffer_status(GLenum target) { return glCheckFramebufferStatus(target); }
+static void gpu_gl_read_pixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels) { glReadPixels(x, y, width, height, format, type, pixels); }
+
+static GLuint gpu_gl_create_shader(GLenum type) { return glCreateShader(type); }
+static void gpu_gl_shader_source(GLuint shader, GLsizei count, const GLchar *const *strings, const GLint *lengths) { glShaderSource(shader, count, strings, lengths); }
+static void gpu_gl_compile_shader(GLuint shader) { glCompileShader(shader); }
+static void gpu_gl_get_shader_iv(GLuint shader, GLenum name, GLint *params) { glGetShaderiv(shader, name, params); }
+static void gpu_gl_get_shader_info_log(GLuint shader, GLsizei size, GLsizei *length, GLchar *log) { glGetShaderInfoLog(shader, size, length, log); }
+static void gpu_gl_delete_shader(GLuint shader) { glDeleteShader(shader); }
+static GLuint gpu_gl_create_program() { return glCreateProgram(); }
+static void gpu_gl_attach_shader(GLuint program, GLuint shader) { glAttachShader(program, shader); }
+static void gpu_gl_link_program(GLuint program) { glLinkProgram(program); }
+static void gpu_gl_get_program_iv(GLuint program, GLenum name, GLint *params) { glGetProgramiv(program, name, params); }
+static void gpu_gl_get_program_info_log(GLuint program, GLsizei size, GLsizei *length, GLchar *log) { glGetProgramInfoLog(program, size, length, log); }
+static void gpu_gl_program_parameter_i(GLuint program, GLenum name, GLint value) { glProgramParameteri(program, name, value); }
+static void gpu_gl_get_program_binary(GLuint program, GLsizei size, GLsizei *length, GLenum *format, void *binary) { glGetProgramBinary(program, size, length, format, binary); }
+static void gpu_gl_program_binary(GLuint program, GLenum format, const void *binary, GLsizei length) { glProgramBinary(program, format, binary, length); }
+static void gpu_gl_delete_program(GLuint program) { glDeleteProgram(program); }
+static void gpu_gl_use_program(GLuint program) { glUseProgram(program); }
+static void gpu_gl_get_active_attrib(GLuint program, GLuint index, GLsizei size, GLsizei *length, GLint *attribute_size, GLenum *type, GLchar *name) { glGetActiveAttrib(program, index, size, length, attribute_size, type, name); }
+static GLint gpu_gl_get_attrib_location(GLuint program, const GLchar *name) { return glGetAttribLocation(program, name); }
+static GLint gpu_gl_get_uniform_location(GLuint program, const GLchar *name) { return glGetUniformLocation(program, name); }
+static GLuint gpu_gl_get_uniform_block_index(GLuint program, const GLchar *name) { return glGetUniformBlockIndex(program, name); }
+static void gpu_gl_program_uniform_1iv(GLuint program, GLint location, GLsizei count, const GLint *value) { glProgramUniform1iv(program, location, count, value); }
+static void gpu_gl_program_uniform_matrix_4fv(GLuint program, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) { glProgramUniformMatrix4fv(program, location, count, transpose, value); }
+
+static void gpu_gl_multi_draw_arrays(GLenum mode, const GLint *firsts, const GLsizei *counts, GLsizei draws) { glMultiDrawArrays(mode, firsts, counts, draws); }
+static void gpu_gl_multi_draw_elements_base_vertex(GLenum mode, const GLsizei *counts, GLenum type, const void *const *indicies, GLsizei draws, const GLint *base_verticies) { glMultiDrawElementsBaseVertex(mode, counts, type, indicies, draws, base_verticies); }
+static void gpu_gl_draw_arrays_instanced_base_instance(GLenum mode, GLint first, GLsizei count, GLsizei instances, GLuint base_instance) { glDrawArraysInstancedBaseInstance(mode, first, count, instances, base_instance); }
+
+static GLsync gpu_gl_fence_sync(GLenum condition, GLbitfield flags) { return glFenceSync(condition, flags); }
+static GLenum gpu_gl_client_wait_sync(GLsync sync, GLbitfield flags, GLuint64 timeout) { return glClientWaitSync(sync, flags, timeout); }
+static void gpu_gl_delete_sync(GLsync sync) { glDeleteSync(sync); }
+static void gpu_gl_gen_queries(GLsizei count, GLuint *queries) { glGenQueries(count, queries); }
+static void gpu_gl_query_counter(GLuint query, GLenum target) { glQueryCounter(query, target); }
+static void gpu_gl_begin_query(GLenum target, GLuint query) { glBeginQuery(target, query); }
+static void gpu_gl_end_query(GLenum target) { glEndQuery(target); }
+static void gpu_gl_get_query_object_uiv(GLuint query, GLenum name, GLuint *params) { glGetQueryObjectuiv(query, name, params); }
+static void gpu_gl_get_query_object_ui64v(GLuint query, GLenum name, GLuint64 *params) { glGetQueryObjectui64v(query, name, params); }
+
+static void gpu_gl_swap_window(SDL_Window *window) { SDL_GL_SwapWindow(window); }
+static bool gpu_gl_swap_interval(int interval) { return SDL_GL_SetSwapInterval(interval) == 0; }
+
+static Gpu_Backend gpu_gl = {
+    .null                                   = false,
+
+    .enable                                 = gpu_gl_enable,
+    .blend_func                             = gpu_gl_blend_func,
+    .clear_color                            = gpu_gl_clear_color,
+    .clear                                  = gpu_gl_clear,
+    .viewport                               = gpu_gl_viewport,
+    .pixel_store_i                          = gpu_gl_pixel_store_i,
+    .get_integer_v                          = gpu_gl_get_integer_v,
+    .get_error                              = gpu_gl_get_error,
+    .get_string                             = gpu_gl_get_string,
+
+    .gen_buffers                            = gpu_gl_gen_buffers,
+    .delete_buffers                         = gpu_gl_delete_buffers,
+    .bind_buffer                            = gpu_gl_bind_buffer,
+    .bind_buffer_range                      = gpu_gl_bind_buffer_range,
+    .buffer_data                            = gpu_gl_buffer_data,
+    .buffer_sub_data                        = gpu_gl_buffer_sub_data,
+    .buffer_storage                         = gpu_gl_buffer_storage,
+    .map_buffer_range                       = gpu_gl_map_buffer_range,
+    .flush_mapped_buffer_range              = gpu_gl_flush_mapped_buffer_range,
+    .unmap_buffer                           = gpu_gl_unmap_buffer,
+
+    .gen_vertex_arrays                      = gpu_gl_gen_vertex_arrays,
+    .delete_vertex_arrays                   = gpu_gl_delete_vertex_arrays,
+    .bind_vertex_array                      = gpu_gl_bind_vertex_array,
+    .vertex_attrib_pointer                  = gpu_gl_vertex_attrib_pointer,
+    .vertex_attrib_i_pointer                = gpu_gl_vertex_attrib_i_pointer,
+    .enable_vertex_attrib_array             = gpu_gl_enable_vertex_attrib_array,
+    .vertex_attrib_divisor                  = gpu_gl_vertex_attrib_divisor,
+
+    .gen_textures                           = gpu_gl_gen_textures,
+    .delete_textures                        = gpu_gl_delete_textures,
+    .active_texture                         = gpu_gl_active_texture,
+    .bind_texture                           = gpu_gl_bind_texture,
+    .tex_parameter_i                        = gpu_gl_tex_parameter_i,
+    .tex_image_2d                           = gpu_gl_tex_image_2d,
+    .tex_sub_image_2d                       = gpu_gl_tex_sub_image_2d,
+
+    .gen_framebuffers                       = gpu_gl_gen_framebuffers,
+    .bind_framebuffer                       = gpu_gl_bind_framebuffer,
+    .gen_renderbuffers                      = gpu_gl_gen_renderbuffers,
+    .bind_renderbuffer                      = gpu_gl_bind_renderbuffer,
+    .renderbuffer_storage                   = gpu_gl_renderbuffer_storage,
+    .framebuffer_renderbuffer               = gpu_gl_framebuffer_renderbuffer,
+    .check_framebuffer_status               = gpu_gl_check_framebuffer_status,
+    .read_pixels                            = gpu_gl_read_pixels,
+
+    .create_shader                          = gpu_gl_create_shader,
+    .shader_source                          = gpu_gl_shader_source,
+    .compile_shader                         = gpu_gl_compile_shader,
+    .get_shader_iv                          = gpu_gl_get_shader_iv,
+    .get_shader_info_log                    = gpu_gl_get_shader_info_log,
+    .delete_shader                          = gpu_gl_delete_shader,
+    .create_program                         = gpu_gl_create_program,
+    .attach_shader                          = gpu_gl_attach_shader,
+    .link_program                           = gpu_gl_link_program,
+    .get_program_iv                         = gpu_gl_get_program_iv,
+    .get_program_info_log                   = gpu_gl_get_program_info_log,
+    .program_parameter_i                    = gpu_gl_program_parameter_i,
+    .get_program_binary                     = gpu_gl_get_program_binary,
+    .program_binary                         = gpu_gl_program_binary,
+    .delete_program                         = gpu_gl_delete_program,
+    .use_program                            = gpu_gl_use_program,
+    .get_active_attrib                      = gpu_gl_get_active_attrib,
+    .get_attrib_location                    = gpu_gl_get_attrib_location,
+    .get_uniform_location                   = gpu_gl_get_uniform_location,
+    .get_uniform_block_index                = gpu_gl_get_uniform_block_index,
+    .program_uniform_1iv                    = gpu_gl_program_uniform_1iv,
+    .program_uniform_matrix_4fv             = gpu_gl_program_uniform_matrix_4fv,
+
+    .multi_draw_arrays                      = gpu_gl_multi_draw_arrays,
+    .multi_draw_elements_base_vertex        = gpu_gl_multi_draw_elements_base_vertex,
+    .draw_arrays_instanced_base_instance    = gpu_gl_draw_arrays_instanced_base_instance,
+
+    .fence_sync                             = gpu_gl_fence_sync,
+    .client_wait_sync                       = gpu_gl_client_wait_sync,
+    .delete_sync                            = gpu_gl_delete_sync,
+    .gen_queries                            = gpu_gl_gen_queries,
+    .query_counter                          = gpu_gl_query_counter,
+    .begin_query                            = gpu_gl_begin_query,
+    .end_query                              = gpu_gl_end_query,
+    .get_query_object_uiv                   = gpu_gl_get_query_object_uiv,
+    .get_query_object_ui64v                 = gpu_gl_get_query_object_ui64v,
+
+    .swap_window                            = gpu_gl_swap_window,
+    .swap_interval                          = gpu_gl_swap_interval,
+};
+
+Gpu_Backend *gpu = &gpu_gl;
+
+
+
+/**
+ * Null backend.
+ */
+
+typedef struct gpu_null_attribute {
+    char    name[MAX_ATTRIBUTE_NAME_LENGTH];
+    GLenum  type;
+    s32     location;
+} Gpu_Null_Attribute;
+
+typedef struct gpu_null_object {
+    u8                  *data;          // Buffers: storage that mapped ranges point into, only allocated once buffer is mapped.
+    u32                 size;
+    char                *source;        // Shaders: source they were given, attributes are read from it once they are attached.
+    Gpu_Null_Attribute  attributes[MAX_ATTRIBUTES_PER_SHADER];      // Programs.
+    u32                 attributes_count;
+    s32                 width;          // Textures: size of the storage given by the last "tex_image_2d()" while it was bound.
+    s32                 height;
+    bool                live;
+} Gpu_Null_Object;
+
+// Objects of every kind share names, name is the index of the object, 0 is never handed out.
+static Gpu_Null_Object  *null_objects;
+static GLuint           *null_free_names;       // Names of deleted objects, handed out again last deleted first, same as OpenGL can.
+static GLuint           null_textures[32];      // Texture bound to every unit.
+static u32              null_active_unit;
+static GLuint           null_array_buffer;
+static GLuint           null_element_buffer;
+static GLuint           null_uniform_buffer;
+static GLuint           null_pixel_pack_buffer;
+static GLuint           null_pixel_unpack_buffer;
+static u64              null_syncs;
+static Gpu_Stats        null_stats;
+
+static GLuint gpu_null_object_make() {
+    u32 free_count = array_list_length(&null_free_names);
+    if (free_count > 0) {
+        GLuint name = null_free_names[free_count - 1];
+        array_list_pop(&null_free_names);
+        null_objects[name].live = true;
+        return name;
+    }
+
+    array_list_append(&null_objects, ((Gpu_Null_Object) { .live = true }));
+    return array_list_length(&null_objects) - 1;
+}
+
+static Gpu_Null_Object *gpu_null_object(GLuint name) {
+    if (name == 0 || name >= array_list_length(&null_objects) || !null_objects[name].live) {
+        return NULL;
+    }
+    return &null_objects[name];
+}
+
+static void gpu_null_objects_make(GLsizei count, GLuint *names) {
+    for (GLsizei i = 0; i < count; i++) {
+        names[i] = gpu_null_object_make();
+    }
+}
+
+static void gpu_null_objects_delete(GLsizei count, const GLuint *names) {
+    for (GLsizei i = 0; i < count; i++) {
+        Gpu_Null_Object *object = gpu_null_object(names[i]);
+        if (object != NULL) {
+            free(object->data);
+            free(object->source);
+            *object = (Gpu_Null_Object) {0};
+            array_list_append(&null_free_names, names[i]);
+        }
+
+        // Deleted texture is unbound from every unit.
+        for (u32 unit = 0; unit < 32; unit++) {
+            if (null_textures[unit] == names[i]) {
+                null_textures[unit] = 0;
+            }
+        }
+    }
+}
+
+static GLuint *gpu_null_binding(GLenum target) {
+    switch (target) {
+        case GL_ELEMENT_ARRAY_BUFFER: return &null_element_buffer;
+        case GL_UNIFORM_BUFFER: return &null_uniform_buffer;
+        case GL_PIXEL_PACK_BUFFER: return &null_pixel_pack_buffer;
+        case GL_PIXEL_UNPACK_BUFFER: return &null_pixel_unpack_buffer;
+        default: return &null_array_buffer;
+    }
+}
+
+static u32 gpu_null_pixel_size(GLenum format) {
+    switch (format) {
+        case GL_RED: return 1;
+        case GL_RG: return 2;
+        case GL_RGB: return 3;
+        default: return 4;
+    }
+}
+
+static GLenum gpu_null_attribute_type(char *type) {
+    if (strcmp(type, "float") == 0) return GL_FLOAT;
+    if (strcmp(type, "vec2") == 0) return GL_FLOAT_VEC2;
+    if (strcmp(type, "vec3") == 0) return GL_FLOAT_VEC3;
+    if (strcmp(type, "vec4") == 0) return GL_FLOAT_VEC4;
+    if (strcmp(type, "mat4") == 0) return GL_FLOAT_MAT4;
+    if (strcmp(type, "int") == 0) return GL_INT;
+    if (strcmp(type, "ivec2") == 0) return GL_INT_VEC2;
+    if (strcmp(type, "ivec3") == 0) return GL_INT_VEC3;
+    if (strcmp(type, "ivec4") == 0) return GL_INT_VEC4;
+    return 0;
+}
+
+static void gpu_null_counted_state() { null_stats.state_changes++; }
+
+static void gpu_null_enable(GLenum cap) { gpu_null_counted_state(); }
+static void gpu_null_blend_func(GLenum source, GLenum destination) { gpu_null_counted_state(); }
+static void gpu_null_clear_color(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) { gpu_null_counted_state(); }
+static void gpu_null_clear(GLbitfield mask) {}
+static void gpu_null_viewport(GLint x, GLint y, GLsizei width, GLsizei height) { gpu_null_counted_state(); }
+static void gpu_null_pixel_store_i(GLenum name, GLint param) { gpu_null_counted_state(); }
+static GLenum gpu_null_get_error() { return GL_NO_ERROR; }
+static const GLubyte *gpu_null_get_string(GLenum name) { return (const GLubyte *)"null"; }
+
+static void gpu_null_get_integer_v(GLenum name, GLint *data) {
+    *data = name == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT ? 256 : 0;
+}
+
+static void gpu_null_bind_buffer(GLenum target, GLuint buffer) {
+    *gpu_null_binding(target) = buffer;
+    gpu_null_counted_state();
+}
+
+static void gpu_null_bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    *gpu_null_binding(target) = buffer;
+    gpu_null_counted_state();
+}
+
+static void gpu_null_buffer_data(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+    Gpu_Null_Object *object = gpu_null_object(*gpu_null_binding(target));
+    if (object != NULL && object->size != (u32)size) {
+        // Mapped storage is allocated again the next time buffer is mapped.
+        free(object->data);
+        object->data = NULL;
+        object->size = (u32)size;
+    }
+
+    if (data != NULL) {
+        null_stats.bytes_uploaded += size;
+    }
+}
+
+static void gpu_null_buffer_sub_data(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+    null_stats.bytes_uploaded += size;
+}
+
+static void gpu_null_buffer_storage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) {
+    gpu_null_buffer_data(target, size, data, 0);
+}
+
+static void *gpu_null_map_buffer_range(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    Gpu_Null_Object *object = gpu_null_object(*gpu_null_binding(target));
+    if (object == NULL || offset + length > object->size) {
+        return NULL;
+    }
+
+    if (object->data == NULL) {
+        object->data = malloc(object->size);
+    }
+    return object->data + offset;
+}
+
+static void gpu_null_flush_mapped_buffer_range(GLenum target, GLintptr offset, GLsizeiptr length) {
+    null_stats.bytes_uploaded += length;
+}
+
+static GLboolean gpu_null_unmap_buffer(GLenum target) { return GL_TRUE; }
+
+static void gpu_null_bind_vertex_array(GLuint array) { gpu_null_counted_state(); }
+static void gpu_null_vertex_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) { gpu_null_counted_state(); }
+static void gpu_null_vertex_attrib_i_pointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void *pointer) { gpu_null_counted_state(); }
+static void gpu_null_enable_vertex_attrib_array(GLuint index) { gpu_null_counted_state(); }
+static void gpu_null_vertex_attrib_divisor(GLuint index, GLuint divisor) { gpu_null_counted_state(); }
+
+static void gpu_null_active_texture(GLenum unit) {
+    null_active_unit = unit - GL_TEXTURE0;
+    gpu_null_counted_state();
+}
+
+static void gpu_null_bind_texture(GLenum target, GLuint texture) {
+    null_textures[null_active_unit] = texture;
+    gpu_null_counted_state();
+}
+static void gpu_null_tex_parameter_i(GLenum target, GLenum name, GLint param) { gpu_null_counted_state(); }
+
+static void gpu_null_tex_image_2d(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels) {
+    Gpu_Null_Object *texture = gpu_null_object(null_textures[null_active_unit]);
+    if (texture != NULL) {
+        texture->width  = width;
+        texture->height = height;
+    }
+
+    if (pixels != NULL) {
+        null_stats.bytes_uploaded += (u64)width * height * gpu_null_pixel_size(format);
+    }
+}
+
+static void gpu_null_tex_sub_image_2d(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels) {
+    null_stats.bytes_uploaded += (u64)width * height * gpu_null_pixel_size(format);
+}
+
+static void gpu_null_bind_framebuffer(GLenum target, GLuint framebuffer) { gpu_null_counted_state(); }
+static void gpu_null_bind_renderbuffer(GLenum target, GLuint renderbuffer) { gpu_null_counted_state(); }
+static void gpu_null_renderbuffer_storage(GLenum target, GLenum internal_format, GLsizei width, GLsizei height) {}
+static void gpu_null_framebuffer_renderbuffer(GLenum target, GLenum attachment, GLenum renderbuffer_target, GLuint renderbuffer) {}
+static GLenum gpu_null_check_framebuffer_status(GLenum target) { return GL_FRAMEBUFFER_COMPLETE; }
+
+static void gpu_null_read_pixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels) {
+    u64 bytes = (u64)width * height * gpu_null_pixel_size(format);
+
+    // With pixel pack buffer bound, pixels are read into it and pointer is offset into the buffer.
+    if (null_pixel_pack_buffer != 0) {
+        Gpu_Null_Object *object = gpu_null_object(null_pixel_pack_buffer);
+        if (object == NULL || (u64)pixels + bytes > object->size) {
+            return;
+        }
+        if (object->data == NULL) {
+            object->data = malloc(object->size);
+        }
+        (void)memset(object->data + (u64)pixels, 0, bytes);
+        return;
+    }
+
+    (void)memset(pixels, 0, bytes);
+}
+
+static GLuint gpu_null_create_shader(GLenum type) { return gpu_null_object_make(); }
+
+static void gpu_null_shader_source(GLuint shader, GLsizei count, const GLchar *const *strings, const GLint *lengths) {
+    Gpu_Null_Object *object = gpu_null_object(shader);
+    if (object == NULL) {
+        return;
+    }
+
+    u64 length = 0;
+    for (GLsizei i = 0; i < count; i++) {
+        length += lengths != NULL ? (u64)lengths[i] : strlen(strings[i]);
+    }
+
+    free(object->source);
+    object->source = malloc(length + 1);
+
+    char *cursor = object->source;
+    for (GLsizei i = 0; i < count; i++) {
+        u64 part = lengths != NULL ? (u64)lengths[i] : strlen(strings[i]);
+        memcpy(cursor, strings[i], part);
+        cursor += part;
+    }
+    *cursor = '\0';
+}
+
+static void gpu_null_compile_shader(GLuint shader) {}
+
+static void gpu_null_get_shader_iv(GLuint shader, GLenum name, GLint *params) {
+    *params = name == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+static void gpu_null_get_info_log(GLuint object, GLsizei size, GLsizei *length, GLchar *log) {
+    if (size > 0) {
+        log[0] = '\0';
+    }
+    if (length != NULL) {
+        *length = 0;
+    }
+}
+
+static GLuint gpu_null_create_program() { return gpu_null_object_make(); }
+
+/**
+ * Reads vertex attributes declared as "layout(location = <location>) in <type> <name>;" from the shader source into the program.
+ * Both stages are compiled from the same file, so attributes already read from the other stage are skipped.
+ */
+static void gpu_null_attach_shader(GLuint program, GLuint shader) {
+    Gpu_Null_Object *program_object = gpu_null_object(program);
+    Gpu_Null_Object *shader_object = gpu_null_object(shader);
+    if (program_object == NULL || shader_object == NULL || shader_object->source == NULL) {
+        return;
+    }
+
+    char *line = shader_object->source;
+    while (line != NULL) {
+        s32 location;
+        char type[16];
+        char name[MAX_ATTRIBUTE_NAME_LENGTH];
+
+        if (sscanf(line, " layout ( location = %d ) in %15s %127[A-Za-z0-9_]", &location, type, name) == 3) {
+            bool known = false;
+            for (u32 i = 0; i < program_object->attributes_count; i++) {
+                known |= program_object->attributes[i].location == location;
+            }
+
+            if (!known && program_object->attributes_count < MAX_ATTRIBUTES_PER_SHADER) {
+                Gpu_Null_Attribute *attribute = &program_object->attributes[program_object->attributes_count++];
+                attribute->type = gpu_null_attribute_type(type);
+                attribute->location = location;
+                (void)snprintf(attribute->name, sizeof(attribute->name), "%s", name);
+            }
+        }
+
+        line = strchr(line, '\n');
+        if (line != NULL) {
+            line++;
+        }
+    }
+}
+
+static void gpu_null_link_program(GLuint program) {}
+static void gpu_null_program_parameter_i(GLuint program, GLenum name, GLint value) {}
+
+// Program binaries are never made, so nothing is cached for the null backend.
+static void gpu_null_get_program_binary(GLuint program, GLsizei size, GLsizei *length, GLenum *format, void *binary) {
+    if (length != NULL) {
+        *length = 0;
+    }
+}
+
+static void gpu_null_program_binary(GLuint program, GLenum format, const void *binary, GLsizei length) {}
+
+static void gpu_null_get_program_iv(GLuint program, GLenum name, GLint *params) {
+    Gpu_Null_Object *object = gpu_null_object(program);
+
+    switch (name) {
+        case GL_LINK_STATUS: *params = GL_TRUE; break;
+        case GL_ACTIVE_ATTRIBUTES: *params = object != NULL ? (GLint)object->attributes_count : 0; break;
+        default: *params = 0; break;
+    }
+}
+
+static void gpu_null_delete_object(GLuint name) { gpu_null_objects_delete(1, &name); }
+static void gpu_null_use_program(GLuint program) { gpu_null_counted_state(); }
+
+static void gpu_null_get_active_attrib(GLuint program, GLuint index, GLsizei size, GLsizei *length, GLint *attribute_size, GLenum *type, GLchar *name) {
+    Gpu_Null_Object *object = gpu_null_object(program);
+    if (object == NULL || index >= object->attributes_count) {
+        return;
+    }
+
+    Gpu_Null_Attribute *attribute = &object->attributes[index];
+    s32 written = snprintf(name, size, "%s", attribute->name);
+    if (length != NULL) {
+        *length = written < size ? written : size - 1;
+    }
+    *attribute_size = 1;
+    *type = attribute->type;
+}
+
+static GLint gpu_null_get_attrib_location(GLuint program, const GLchar *name) {
+    Gpu_Null_Object *object = gpu_null_object(program);
+    if (object == NULL) {
+        return -1;
+    }
+
+    for (u32 i = 0; i < object->attributes_count; i++) {
+        if (strcmp(object->attributes[i].name, name) == 0) {
+            return object->attributes[i].location;
+        }
+    }
+    return -1;
+}
+
+static GLint gpu_null_get_uniform_location(GLuint program, const GLchar *name) { return 0; }
+static GLuint gpu_null_get_uniform_block_index(GLuint program, const GLchar *name) { return 0; }
+static void gpu_null_program_uniform_1iv(GLuint program, GLint location, GLsizei count, const GLint *value) { gpu_null_counted_state(); }
+static void gpu_null_program_uniform_matrix_4fv(GLuint program, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) { gpu_null_counted_state(); }
+
+static void gpu_null_multi_draw_arrays(GLenum mode, const GLint *firsts, const GLsizei *counts, GLsizei draws) { null_stats.draw_calls++; }
+static void gpu_null_multi_draw_elements_base_vertex(GLenum mode, const GLsizei *counts, GLenum type, const void *const *indicies, GLsizei draws, const GLint *base_verticies) { null_stats.draw_calls++; }
+static void gpu_null_draw_arrays_instanced_base_instance(GLenum mode, GLint first, GLsizei count, GLsizei instances, GLuint base_instance) { null_stats.draw_calls++; }
+
+// Every fence is signaled as soon as it is placed, syncs only have to be told apart from NULL.
+static GLsync gpu_null_fence_sync(GLenum condition, GLbitfield flags) { return (GLsync)(++null_syncs); }
+static GLenum gpu_null_client_wait_sync(GLsync sync, GLbitfield flags, GLuint64 timeout) { return GL_ALREADY_SIGNALED; }
+static void gpu_null_delete_sync(GLsync sync) {}
+static void gpu_null_query_counter(GLuint query, GLenum target) {}
+static void gpu_null_begin_query(GLenum target, GLuint query) {}
+static void gpu_null_end_query(GLenum target) {}
+static void gpu_null_get_query_object_uiv(GLuint query, GLenum name, GLuint *params) { *params = GL_TRUE; }
+static void gpu_null_get_query_object_ui64v(GLuint query, GLenum name, GLuint64 *params) { *params = 0; }
+
+static void gpu_null_swap_window(SDL_Window *window) { null_stats.frames++; }
+static bool gpu_null_swap_interval(int interval) { return true; }
+
+static Gpu_Backend gpu_null = {
+    .null                                   = true,
+
+    .enable                                 = gpu_null_enable,
+    .blend_func                             = gpu_null_blend_func,
+    .clear_color                            = gpu_null_clear_color,
+    .clear                                  = gpu_null_clear,
+    .viewport                               = gpu_null_viewport,
+    .pixel_store_i                          = gpu_null_pixel_store_i,
+    .get_integer_v                          = gpu_null_get_integer_v,
+    .get_error                              = gpu_null_get_error,
+    .get_string                             = gpu_null_get_string,
+
+    .gen_buffers                            = gpu_null_objects_make,
+    .delete_buffers                         = gpu_null_objects_delete,
+    .bind_buffer                            = gpu_null_bind_buffer,
+    .bind_buffer_range                      = gpu_null_bind_buffer_range,
+    .buffer_data                            = gpu_null_buffer_data,
+    .buffer_sub_data                        = gpu_null_buffer_sub_data,
+    .buffer_storage                         = gpu_null_buffer_storage,
+    .map_buffer_range                       = gpu_null_map_buffer_range,
+    .flush_mapped_buffer_range              = gpu_null_flush_mapped_buffer_range,
+    .unmap_buffer                           = gpu_null_unmap_buffer,
+
+    .gen_vertex_arrays                      = gpu_null_objects_make,
+    .delete_vertex_arrays                   = gpu_null_objects_delete,
+    .bind_vertex_array                      = gpu_null_bind_vertex_array,
+    .vertex_attrib_pointer                  = gpu_null_vertex_attrib_pointer,
+    .vertex_attrib_i_pointer                = gpu_null_vertex_attrib_i_pointer,
+    .enable_vertex_attrib_array             = gpu_null_enable_vertex_attrib_array,
+    .vertex_attrib_divisor                  = gpu_null_vertex_attrib_divisor,
+
+    .gen_textures                           = gpu_null_objects_make,
+    .delete_textures                        = gpu_null_objects_delete,
+    .active_texture                         = gpu_null_active_texture,
+    .bind_texture                           = gpu_null_bind_texture,
+    .tex_parameter_i                        = gpu_null_tex_parameter_i,
+    .tex_image_2d                           = gpu_null_tex_image_2d,
+    .tex_sub_image_2d                       = gpu_null_tex_sub_image_2d,
+
+    .gen_framebuffers                       = gpu_null_objects_make,
+    .bind_framebuffer                       = gpu_null_bind_framebuffer,
+    .gen_renderbuffers                      = gpu_null_objects_make,
+    .bind_renderbuffer                      = gpu_null_bind_renderbuffer,
+    .renderbuffer_storage                   = gpu_null_renderbuffer_storage,
+    .framebuffer_renderbuffer               = gpu_null_framebuffer_renderbuffer,
+    .check_framebuffer_status               = gpu_null_check_framebuffer_status,
+    .read_pixels                            = gpu_null_read_pixels,
+
+    .create_shader                          = gpu_null_create_shader,
+    .shader_source                          = gpu_null_shader_source,
+    .compile_shader                         = gpu_null_compile_shader,
+    .get_shader_iv                          = gpu_null_get_shader_iv,
+    .get_shader_info_log                    = gpu_null_get_info_log,
+    .delete_shader                          = gpu_null_delete_object,
+    .create_program                         = gpu_null_create_program,
+    .attach_shader                          = gpu_null_attach_shader,
+    .link_program                           = gpu_null_link_program,
+    .get_program_iv                         = gpu_null_get_program_iv,
+    .get_program_info_log                   = gpu_null_get_info_log,
+    .program_parameter_i                    = gpu_null_program_parameter_i,
+    .get_program_binary                     = gpu_null_get_program_binary,
+    .program_binary                         = gpu_null_program_binary,
+    .delete_program                         = gpu_null_delete_object,
+    .use_program                            = gpu_null_use_program,
+    .get_active_attrib                      = gpu_null_get_active_attrib,
+    .get_attrib_location                    = gpu_null_get_attrib_location,
+    .get_uniform_location                   = gpu_null_get_uniform_location,
+    .get_uniform_block_index                = gpu_null_get_uniform_block_index,
+    .program_uniform_1iv                    = gpu_null_program_uniform_1iv,
+    .program_uniform_matrix_4fv             = gpu_null_program_uniform_matrix_4fv,
+
+    .multi_draw_arrays                      = gpu_null_multi_draw_arrays,
+    .multi_draw_elements_base_vertex        = gpu_null_multi_draw_elements_base_vertex,
+    .draw_arrays_instanced_base_instance    = gpu_null_draw_arrays_instanced_base_instance,
+
+    .fence_sync                             = gpu_null_fence_sync,
+    .client_wait_sync                       = gpu_null_client_wait_sync,
+    .delete_sync                            = gpu_null_delete_sync,
+    .gen_queries                            = gpu_null_objects_make,
+    .query_counter                          = gpu_null_query_counter,
+    .begin_query                            = gpu_null_begin_query,
+    .end_query                              = gpu_null_end_query,
+    .get_query_object_uiv                   = gpu_null_get_query_object_uiv,
+    .get_query_object_ui64v                 = gpu_null_get_query_object_ui64v,
+
+    .swap_window                            = gpu_null_swap_window,
+    .swap_interval                          = gpu_null_swap_interval,
+};
+
+void gpu_use_null() {
+    if (null_objects != NULL) {
+        for (u32 i = 1; i < array_list_length(&null_objects); i++) {
+            free(null_objects[i].data);
+            free(null_objects[i].source);
+        }
+        array_list_free(&null_objects);
+        array_list_free(&null_free_names);
+    }
+
+    null_objects    = array_list_make(Gpu_Null_Object, 64, &std_allocator);     // @Leak
+    null_free_names = array_list_make(GLuint, 64, &std_allocator);              // @Leak
+    (void)gpu_null_object_make();
+    memset(null_textures, 0, sizeof(null_textures));
+    null_active_unit = 0;
+
+    null_array_buffer   = 0;
+    null_element_buffer = 0;
+    null_uniform_buffer = 0;
+    null_pixel_pack_buffer = 0;
+    null_pixel_unpack_buffer = 0;
+    null_syncs          = 0;
+
+    gpu_stats_reset();
+    gpu = &gpu_null;
+}
+
+Gpu_Stats gpu_stats_get() {
+    return null_stats;
+}
+
+void gpu_stats_reset() {
+    null_stats = (Gpu_Stats) {0};
+}
+
+void gpu_null_texture_size(GLuint texture, s32 *width, s32 *height) {
+    Gpu_Null_Object *object = gpu != &gpu_null ? NULL : gpu_null_object(texture);
+    *width  = object != NULL ? object->width : 0;
+    *height = object != NULL ? object->height : 0;
+}
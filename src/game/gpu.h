@@ -0,0 +1,155 @@
+#ifndef GPU_H
+#define GPU_H
+
+#include "core/core.h"
+#include "core/type.h"
+
+#include <stdbool.h>
+#include <GL/glew.h>
+#include <SDL2/SDL_video.h>
+
+/**
+ * GPU backend.
+ *
+ * Thin table of the OpenGL entry points graphics code calls, every call goes through "gpu" instead of calling OpenGL directly.
+ * Entries take the same arguments as the OpenGL functions they are named after, so switching backend doesn't change what graphics code does.
+ * OpenGL backend is the default one, it simply forwards calls, its functions can only be called once "create_gl_window()" made context current.
+ * Null backend draws nothing and needs no OpenGL context, it only counts draw calls, uploaded bytes and state changes,
+ * so CPU side of rendering can be measured on machines without GPU.
+ * Null backend hands out object names, keeps storage of mapped buffers and reads vertex attributes declared with "layout(location = ...) in" from shader sources,
+ * everything else it is asked about is answered as if it succeeded.
+ * @Important: Backend is selected before "init_sdl_gl()" is called and stays the same for the rest of the run.
+ */
+
+typedef struct gpu_backend {
+    bool        null;           // Nothing reaches GPU, there is no OpenGL context and window isn't made for OpenGL.
+
+    // State.
+    void        (*enable)(GLenum cap);
+    void        (*blend_func)(GLenum source, GLenum destination);
+    void        (*clear_color)(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+    void        (*clear)(GLbitfield mask);
+    void        (*viewport)(GLint x, GLint y, GLsizei width, GLsizei height);
+    void        (*pixel_store_i)(GLenum name, GLint param);
+    void        (*get_integer_v)(GLenum name, GLint *data);
+    GLenum      (*get_error)();
+    const GLubyte *(*get_string)(GLenum name);
+
+    // Buffers.
+    void        (*gen_buffers)(GLsizei count, GLuint *buffers);
+    void        (*delete_buffers)(GLsizei count, const GLuint *buffers);
+    void        (*bind_buffer)(GLenum target, GLuint buffer);
+    void        (*bind_buffer_range)(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void        (*buffer_data)(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+    void        (*buffer_sub_data)(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+    void        (*buffer_storage)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+    void        *(*map_buffer_range)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    void        (*flush_mapped_buffer_range)(GLenum target, GLintptr offset, GLsizeiptr length);
+    GLboolean   (*unmap_buffer)(GLenum target);
+
+    // Vertex arrays.
+    void        (*gen_vertex_arrays)(GLsizei count, GLuint *arrays);
+    void        (*delete_vertex_arrays)(GLsizei count, const GLuint *arrays);
+    void        (*bind_vertex_array)(GLuint array);
+    void        (*vertex_attrib_pointer)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+    void        (*vertex_attrib_i_pointer)(GLuint index, GLint size, GLenum type, GLsizei stride, const void *pointer);
+    void        (*enable_vertex_attrib_array)(GLuint index);
+    void        (*vertex_attrib_divisor)(GLuint index, GLuint divisor);
+
+    // Textures.
+    void        (*gen_textures)(GLsizei count, GLuint *textures);
+    void        (*delete_textures)(GLsizei count, const GLuint *textures);
+    void        (*active_texture)(GLenum unit);
+    void        (*bind_texture)(GLenum target, GLuint texture);
+    void        (*tex_parameter_i)(GLenum target, GLenum name, GLint param);
+    void        (*tex_image_2d)(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels);
+    void        (*tex_sub_image_2d)(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+
+    // Framebuffers.
+    void        (*gen_framebuffers)(GLsizei count, GLuint *framebuffers);
+    void        (*bind_framebuffer)(GLenum target, GLuint framebuffer);
+    void        (*gen_renderbuffers)(GLsizei count, GLuint *renderbuffers);
+    void        (*bind_renderbuffer)(GLenum target, GLuint renderbuffer);
+    void        (*renderbuffer_storage)(GLenum target, GLenum internal_format, GLsizei width, GLsizei height);
+    void        (*framebuffer_renderbuffer)(GLenum target, GLenum attachment, GLenum renderbuffer_target, GLuint renderbuffer);
+    GLenum      (*check_framebuffer_status)(GLenum target);
+    void        (*read_pixels)(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels);
+
+    // Shaders.
+    GLuint      (*create_shader)(GLenum type);
+    void        (*shader_source)(GLuint shader, GLsizei count, const GLchar *const *strings, const GLint *lengths);
+    void        (*compile_shader)(GLuint shader);
+    void        (*get_shader_iv)(GLuint shader, GLenum name, GLint *params);
+    void        (*get_shader_info_log)(GLuint shader, GLsizei size, GLsizei *length, GLchar *log);
+    void        (*delete_shader)(GLuint shader);
+    GLuint      (*create_program)();
+    void        (*attach_shader)(GLuint program, GLuint shader);
+    void        (*link_program)(GLuint program);
+    void        (*get_program_iv)(GLuint program, GLenum name, GLint *params);
+    void        (*get_program_info_log)(GLuint program, GLsizei size, GLsizei *length, GLchar *log);
+    void        (*program_parameter_i)(GLuint program, GLenum name, GLint value);
+    void        (*get_program_binary)(GLuint program, GLsizei size, GLsizei *length, GLenum *format, void *binary);
+    void        (*program_binary)(GLuint program, GLenum format, const void *binary, GLsizei length);
+    void        (*delete_program)(GLuint program);
+    void        (*use_program)(GLuint program);
+    void        (*get_active_attrib)(GLuint program, GLuint index, GLsizei size, GLsizei *length, GLint *attribute_size, GLenum *type, GLchar *name);
+    GLint       (*get_attrib_location)(GLuint program, const GLchar *name);
+    GLint       (*get_uniform_location)(GLuint program, const GLchar *name);
+    GLuint      (*get_uniform_block_index)(GLuint program, const GLchar *name);
+    void        (*program_uniform_1iv)(GLuint program, GLint location, GLsizei count, const GLint *value);
+    void        (*program_uniform_matrix_4fv)(GLuint program, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+
+    // Drawing.
+    void        (*multi_draw_arrays)(GLenum mode, const GLint *firsts, const GLsizei *counts, GLsizei draws);
+    void        (*multi_draw_elements_base_vertex)(GLenum mode, const GLsizei *counts, GLenum type, const void *const *indicies, GLsizei draws, const GLint *base_verticies);
+    void        (*draw_arrays_instanced_base_instance)(GLenum mode, GLint first, GLsizei count, GLsizei instances, GLuint base_instance);
+
+    // Synchronization and queries.
+    GLsync      (*fence_sync)(GLenum condition, GLbitfield flags);
+    GLenum      (*client_wait_sync)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+    void        (*delete_sync)(GLsync sync);
+    void        (*gen_queries)(GLsizei count, GLuint *queries);
+    void        (*query_counter)(GLuint query, GLenum target);
+    void        (*begin_query)(GLenum target, GLuint query);
+    void        (*end_query)(GLenum target);
+    void        (*get_query_object_uiv)(GLuint query, GLenum name, GLuint *params);
+    void        (*get_query_object_ui64v)(GLuint query, GLenum name, GLuint64 *params);
+
+    // Window.
+    void        (*swap_window)(SDL_Window *window);
+    bool        (*swap_interval)(int interval);
+} Gpu_Backend;
+
+/**
+ * Backend all graphics calls go through, OpenGL one unless "gpu_use_null()" was called.
+ */
+extern Gpu_Backend *gpu;
+
+/**
+ * Switches to the null backend, clearing its counters and objects.
+ */
+void gpu_use_null();
+
+
+typedef struct gpu_stats {
+    u64 draw_calls;         // Draw calls issued, multi draw call counts as one.
+    u64 bytes_uploaded;     // Bytes of buffer data, flushed mapped ranges and texture pixels handed to GPU.
+    u64 state_changes;      // Binds, enables, viewports and uniforms set.
+    u64 frames;             // Windows swapped.
+} Gpu_Stats;
+
+/**
+ * Returns what null backend counted since the last reset, everything is 0 with OpenGL backend.
+ */
+Gpu_Stats gpu_stats_get();
+
+void gpu_stats_reset();
+
+/**
+ * Outputs size of the storage null backend allocated for the texture, with the last "tex_image_2d()" made while it was bound.
+ * Size is 0 if texture has no storage, isn't alive, or with OpenGL backend.
+ */
+void gpu_null_texture_size(GLuint texture, s32 *width, s32 *height);
+
+
+#endif
@@ -8,9 +8,13 @@
 #include "core/mathf.h"
 #include "core/log.h"
 
+#include "game/atlas.h"
+#include "game/asset_cache.h"
+
 
 #include "SDL2/SDL_video.h"
 #include <GL/glew.h>
+#include <string.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
@@ -26,7 +30,7 @@
 
 
 bool check_gl_error() {
-    s32 error = glGetError();
+    s32 error = gpu->get_error();
     if (error != 0) {
         LOG_ERROR("OpenGL error: %d.", error);
         return false;
@@ -34,7 +38,24 @@ bool check_gl_error() {
     return true;
 }
 
-int init_sdl_gl() {
+// Frames are rendered into the offscreen target in headless mode, instead of the default framebuffer of the window.
+static bool headless;
+static u32  offscreen_fbo;
+static u32  offscreen_color;
+
+int init_sdl_gl(bool headless_mode) {
+    headless = headless_mode;
+    if (gpu->null) {
+        // Null backend needs no OpenGL, dummy driver is enough to make window and get events.
+        (void)SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+        (void)SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+    } else if (headless) {
+        // Offscreen driver renders into EGL pbuffer surfaces, so it works without display, for example on Mesa's llvmpipe.
+        // Variables are only set if they aren't set already, so driver can still be picked from the outside.
+        (void)SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+        (void)SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+    }
+
     // Initialize SDL.
     if (SDL_Init(SDL_INIT_VIDEO) < 0 || SDL_Init(SDL_INIT_AUDIO) < 0) {
         LOG_ERROR("SDL could not initialize! SDL_Error: %s.", SDL_GetError());
@@ -49,9 +70,41 @@ int init_sdl_gl() {
     return 0;
 }
 
+/**
+ * Makes framebuffer with the color renderbuffer of specified size and binds it for the rest of the run.
+ */
+static bool offscreen_target_make(s32 width, s32 height) {
+    gpu->gen_renderbuffers(1, &offscreen_color);
+    gpu->bind_renderbuffer(GL_RENDERBUFFER, offscreen_color);
+    gpu->renderbuffer_storage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    gpu->bind_renderbuffer(GL_RENDERBUFFER, 0);
+
+    gpu->gen_framebuffers(1, &offscreen_fbo);
+    gpu->bind_framebuffer(GL_FRAMEBUFFER, offscreen_fbo);
+    gpu->framebuffer_renderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreen_color);
+
+    if (gpu->check_framebuffer_status(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        LOG_ERROR("Offscreen framebuffer of size %dx%d is incomplete.", width, height);
+        return false;
+    }
+
+    gpu->viewport(0, 0, width, height);
+    return true;
+}
+
 Window_Info create_gl_window(const char *title, int x, int y, int width, int height) {
-    // Create window.
-    SDL_Window *window = SDL_CreateWindow(title, x, y, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+    // Null backend has no OpenGL context, window is only there for the events.
+    if (gpu->null) {
+        SDL_Window *window = SDL_CreateWindow(title, x, y, width, height, SDL_WINDOW_HIDDEN);
+        if (window == NULL) {
+            LOG_ERROR("Window could not be created! SDL_Error: %s.", SDL_GetError());
+        }
+        return (Window_Info) { window, width, height };
+    }
+
+    // Create window, in headless mode it is never shown and can't be resized, since offscreen target has fixed size.
+    u32 flags = headless ? SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN : SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE;
+    SDL_Window *window = SDL_CreateWindow(title, x, y, width, height, flags);
     if (window == NULL) {
         LOG_ERROR("Window could not be created! SDL_Error: %s.", SDL_GetError());
         return (Window_Info) { NULL, 0, 0 };
@@ -75,6 +128,11 @@ Window_Info create_gl_window(const char *title, int x, int y, int width, int hei
         return (Window_Info) { window, width, height };
     }
 
+    if (headless && !offscreen_target_make(width, height)) {
+        LOG_ERROR("Couldn't make offscreen target for headless rendering.");
+        return (Window_Info) { window, width, height };
+    }
+
     return (Window_Info) { window, width, height };
 }
 
@@ -90,6 +148,54 @@ int init_sdl_audio() {
 }
 
 
+typedef struct gl_state {
+    u32 program;
+    u32 vao;
+    u32 array_buffer;
+    u32 uniform_buffer;
+    u32 active_unit;
+    u32 textures[32];
+} Gl_State;
+
+// Objects currently bound in OpenGL context.
+static Gl_State gl_state;
+
+void gl_use_program(u32 program) {
+    if (gl_state.program != program) {
+        gpu->use_program(program);
+        gl_state.program = program;
+    }
+}
+
+void gl_bind_vertex_array(u32 vao) {
+    if (gl_state.vao != vao) {
+        gpu->bind_vertex_array(vao);
+        gl_state.vao = vao;
+    }
+}
+
+void gl_bind_buffer(u32 target, u32 buffer) {
+    u32 *bound = target == GL_UNIFORM_BUFFER ? &gl_state.uniform_buffer : &gl_state.array_buffer;
+    if (*bound != buffer) {
+        gpu->bind_buffer(target, buffer);
+        *bound = buffer;
+    }
+}
+
+void gl_bind_texture(u32 unit, u32 texture) {
+    if (gl_state.textures[unit] == texture) {
+        return;
+    }
+
+    if (gl_state.active_unit != unit) {
+        gpu->active_texture(GL_TEXTURE0 + unit);
+        gl_state.active_unit = unit;
+    }
+    gpu->bind_texture(GL_TEXTURE_2D, texture);
+    gl_state.textures[unit] = texture;
+}
+
+
 // Shader loading key words.
 String shader_version_tag      = CSTR("#version");
 String vertex_shader_defines   = CSTR("#define VERTEX\n");
@@ -110,22 +216,172 @@ Matrix4f shader_uniform_ml_matrix = MATRIX4F_IDENTITY;
 s32 shader_uniform_samplers[32] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31 };
 
 // Drawing variables.
-Vertex_Buffer verticies;
 u32 *quad_indicies;
-u32 texture_ids[32];
+_Thread_local u32 texture_ids[32];
+
+typedef struct vertex_stream_fence {
+    GLsync  sync;
+    u64     position;       // Stream position, all data before it was submitted by the time fence was placed.
+} Vertex_Stream_Fence;
+
+typedef struct vertex_stream {
+    u32     vbo;
+    bool    persistent;
+    u8      *mapped;        // Persistent: whole buffer. Otherwise: currently mapped range starting at "map_offset", or NULL.
+    u32     map_offset;
+    u32     map_end;        // End of the data written into the mapped range, offset in the buffer.
+
+    u64     position;       // Absolute write position, it only grows, offset in the buffer is "position % VERTEX_STREAM_SIZE".
+    u64     retired;        // Position that all data before is known to be read by GPU already.
+
+    Vertex_Stream_Fence fences[VERTEX_STREAM_MAX_FENCES];
+    u32     fences_count;
+
+    // Span of data written since "draw_begin()" or "line_draw_begin()" that wasn't drawn yet.
+    u32     span_offset;
+    u32     span_bytes;
+} Vertex_Stream;
+
+static Vertex_Stream stream;
+
+typedef struct render_command {
+    u64         key;
+    Quad_Drawer *drawer;            // Either quad drawer or line drawer is set.
+    Line_Drawer *line_drawer;
+    u32         offset;             // Offset of the data in the vertex stream.
+    u32         bytes;
+    u16         projection;         // Index into the projections of the frame.
+    u16         textures;           // Index into the texture sets of the frame.
+} Render_Command;
+
+typedef struct render_texture_set {
+    u32 ids[32];
+    u8  count;
+} Render_Texture_Set;
+
+typedef struct render_batch {
+    u32 first;                      // Commands of the batch are sorted among themselves.
+    u32 count;
+    s32 viewport[4];                // Viewport set before the batch is drawn, kept as it is if width is 0.
+} Render_Batch;
+
+typedef struct render_upload {
+    u32     vbo;
+    u32     offset;
+    u32     bytes;
+    u32     data;                   // Offset of the data in the upload data of the packet.
+    bool    allocate;               // Buffer storage is reallocated to fit the data, instead of range of it being overwritten.
+} Render_Upload;
+
+typedef struct render_texture_upload {
+    u32     texture;
+    s32     first_row;
+    s32     width;
+    s32     rows;
+    u32     data;                   // Offset of the RGBA pixels in the upload data of the packet.
+} Render_Texture_Upload;
+
+/**
+ * Frame packet holds everything needed to submit the frame, once it is handed off it is never changed by the update thread.
+ * Vertex data of the commands lives in the vertex stream, which isn't overwritten until render thread retires it.
+ */
+typedef struct frame_packet {
+    Render_Command      *commands;
+    Matrix4f            *projections;
+    Render_Texture_Set  *texture_sets;
+    Render_Batch        *batches;
+    Render_Upload       *uploads;       // Uploads into retained buffers, done before any of the commands are drawn.
+    Render_Texture_Upload *texture_uploads;     // Rows uploaded into textures through the pixel buffer, done along with the buffer uploads.
+    u8                  *upload_data;
+
+    s32                 viewport[4];    // Viewport of the batch being queued.
+    bool                clear;          // Color buffer is cleared before anything is drawn.
+    SDL_Window          *present;       // Window swapped after everything is drawn, NULL for packets handed off in the middle of the frame.
+    u64                 stream_end;     // Stream data before this position is fenced once the packet is submitted.
+    u32                 readback_id;    // Frame is read back before it is presented if not 0.
+    s32                 readback_size[2];
+    bool                busy;           // Handed off and not submitted yet, guarded by the render mutex.
+} Frame_Packet;
+
+static Frame_Packet packets[2];
+static Frame_Packet *packet = &packets[0];     // Packet filled by the update thread.
+static Render_Layer render_layer = RENDER_LAYER_WORLD;
+static _Thread_local Command_List *recording;   // Command list draw calls of the thread are recorded into, instead of the vertex stream.
+static u64          handed_end;                 // Stream position of the last handed off packet, only used by the update thread.
+
+// Render thread owns OpenGL context while it runs, without it packets are submitted on the update thread as soon as they are handed off.
+static bool             render_threaded;
+static SDL_Thread       *render_thread;
+static SDL_Window       *render_window;
+static SDL_GLContext    render_context;
+static SDL_mutex        *render_mutex;
+static SDL_cond         *render_work_cond;      // Signaled when packet is handed off, stream retirement or context is requested.
+static SDL_cond         *render_done_cond;      // Signaled when packet is submitted, stream is retired or context changes hands.
+
+// Following variables are shared with the render thread and are guarded by the render mutex, as is the retired position of the stream.
+static Frame_Packet     *render_handed[2];
+static u32              render_handed_count;
+static u64              render_retire_request;  // Stream position update thread waits to be retired.
+static bool             render_context_requested;
+static bool             render_context_released;
+static bool             render_quit;
+
+// Uniform buffer holding projections of the submission, each one is aligned to be bound as its own range.
+static u32  camera_ubo;
+static u32  camera_stride;
+
+// Pixel unpack buffer texture rows are uploaded through.
+static u32  pixel_buffer;
+
+typedef struct gpu_frame_timer {
+    u32     queries[GPU_TIMER_FRAMES][2];   // Timestamps written before the first packet of the frame is submitted and before it is presented.
+    u32     layer_queries[GPU_TIMER_FRAMES][GPU_TIMER_LAYER_QUERIES];       // Time elapsed around runs of commands of one layer.
+    u8      layer_query_layers[GPU_TIMER_FRAMES][GPU_TIMER_LAYER_QUERIES];
+    u32     layer_query_count[GPU_TIMER_FRAMES];
+    s32     layer;                          // Layer timed by the running query, -1 if none runs.
+    u32     frame;                          // Frame being submitted.
+    u32     collected;                      // Frames before this one have their results read.
+    bool    started;
+    float   last_time;                      // Milliseconds GPU spent on the last collected frame, guarded by the render mutex.
+    float   last_layer_times[RENDER_LAYER_COUNT];   // Guarded by the render mutex, as is the last time.
+} Gpu_Frame_Timer;
+
+// Timestamps are read a few frames later, so waiting for them doesn't stall the pipeline.
+static Gpu_Frame_Timer gpu_timer;
+
+typedef struct readback_slot {
+    u32     buffer;
+    u32     size;           // Bytes allocated for the buffer.
+    GLsync  fence;          // Signaled once pixels are written into the buffer.
+    u32     id;
+    s32     width;
+    s32     height;
+} Readback_Slot;
+
+// Slots are used in order, only by the thread that submits packets.
+static Readback_Slot    readback_slots[GRAPHICS_READBACK_BUFFERS];
+static u32              readback_issued;
+static u32              readback_mapped;
+static u32              readback_next_id;       // Only used by the update thread.
+static u32              readback_requested_id;  // Request for the frame being recorded, only used by the update thread.
+static s32              readback_requested_size[2];
+static Frame_Readback   *readbacks_ready;       // Guarded by the render mutex while render thread runs.
+
+// Arguments of merged multi draw calls, reused every submission.
+static s32  *multi_counts;
+static s32  *multi_firsts;
+static void **multi_indicies;
 
 void graphics_init() {
     // Enable Blending (Rendering with alpha channels in mind).
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gpu->enable(GL_BLEND);
+    gpu->blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     // glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
     // Make stbi flip images vertically when loading.
     stbi_set_flip_vertically_on_load(true);
 
     // Setting drawing variables.
-    verticies = vertex_buffer_make(); // @Leak
-                                      //
     quad_indicies = array_list_make(u32, MAX_QUADS_PER_BATCH * 6, &std_allocator); // @Leak
     
     // Initing quad indicies.
@@ -134,6 +390,332 @@ void graphics_init() {
     for (u32 i = 0; i < MAX_QUADS_PER_BATCH * 6; i++) {
         quad_indicies[i] = i - (i / 3) * 2 + (i / 6) * 2;
     }
+
+    // Creating vertex stream, shared by all drawers.
+    stream = (Vertex_Stream) {0};
+    gpu->gen_buffers(1, &stream.vbo);
+    gl_bind_buffer(GL_ARRAY_BUFFER, stream.vbo);
+
+    // Null backend counts stream uploads when mapped ranges are flushed, so it always takes the orphaning path.
+    stream.persistent = !gpu->null && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) && glBufferStorage != NULL;
+    if (stream.persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        gpu->buffer_storage(GL_ARRAY_BUFFER, VERTEX_STREAM_SIZE, NULL, flags);
+        stream.mapped = gpu->map_buffer_range(GL_ARRAY_BUFFER, 0, VERTEX_STREAM_SIZE, flags);
+
+        if (stream.mapped == NULL) {
+            LOG_ERROR("Couldn't persistently map vertex stream, falling back to orphaning.");
+            gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+            gpu->delete_buffers(1, &stream.vbo);
+            gpu->gen_buffers(1, &stream.vbo);
+            gl_bind_buffer(GL_ARRAY_BUFFER, stream.vbo);
+            stream.persistent = false;
+        }
+    }
+
+    if (!stream.persistent) {
+        gpu->buffer_data(GL_ARRAY_BUFFER, VERTEX_STREAM_SIZE, NULL, GL_STREAM_DRAW);
+    }
+
+    gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+
+    // Creating render queue.
+    for (u32 i = 0; i < 2; i++) {
+        packets[i] = (Frame_Packet) {
+            .commands       = array_list_make(Render_Command, 256, &std_allocator),       // @Leak
+            .projections    = array_list_make(Matrix4f, 8, &std_allocator),               // @Leak
+            .texture_sets   = array_list_make(Render_Texture_Set, 8, &std_allocator),     // @Leak
+            .batches        = array_list_make(Render_Batch, 8, &std_allocator),           // @Leak
+            .uploads        = array_list_make(Render_Upload, 8, &std_allocator),          // @Leak
+            .texture_uploads = array_list_make(Render_Texture_Upload, 8, &std_allocator), // @Leak
+            .upload_data    = array_list_make(u8, 1024, &std_allocator),                  // @Leak
+        };
+    }
+    packet = &packets[0];
+    multi_counts        = array_list_make(s32, 64, &std_allocator);                 // @Leak
+    multi_firsts        = array_list_make(s32, 64, &std_allocator);                 // @Leak
+    multi_indicies      = array_list_make(void *, 64, &std_allocator);              // @Leak
+
+    // Creating camera uniform buffer.
+    s32 alignment = 0;
+    gpu->get_integer_v(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment < 1) {
+        alignment = 256;
+    }
+    camera_stride = ((u32)sizeof(Matrix4f) + alignment - 1) / alignment * alignment;
+
+    gpu->gen_buffers(1, &camera_ubo);
+    gpu->gen_buffers(1, &pixel_buffer);
+
+    gpu->gen_queries(GPU_TIMER_FRAMES * 2, &gpu_timer.queries[0][0]);
+    gpu->gen_queries(GPU_TIMER_FRAMES * GPU_TIMER_LAYER_QUERIES, &gpu_timer.layer_queries[0][0]);
+    gpu_timer.layer = -1;
+
+    readbacks_ready = array_list_make(Frame_Readback, GRAPHICS_READBACK_BUFFERS, &std_allocator);   // @Leak
+}
+
+
+
+/**
+ * Waits for the fence at the index, deletes it and all of the older ones.
+ * Returns stream position before which GPU is done reading all data.
+ */
+static u64 vertex_stream_retire(u32 index) {
+    GLenum result;
+    do {
+        result = gpu->client_wait_sync(stream.fences[index].sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    } while (result == GL_TIMEOUT_EXPIRED);
+
+    if (result == GL_WAIT_FAILED) {
+        LOG_ERROR("Waiting for vertex stream fence failed.");
+    }
+
+    u64 position = stream.fences[index].position;
+
+    // Fence and all the older ones are signaled by now.
+    for (u32 i = 0; i <= index; i++) {
+        gpu->delete_sync(stream.fences[i].sync);
+    }
+    memmove(stream.fences, stream.fences + index + 1, (stream.fences_count - index - 1) * sizeof(Vertex_Stream_Fence));
+    stream.fences_count -= index + 1;
+
+    return position;
+}
+
+/**
+ * Sets retired position of the stream, waking up update thread if it waits for it.
+ */
+static void vertex_stream_set_retired(u64 position) {
+    if (!render_threaded) {
+        stream.retired = position;
+        return;
+    }
+
+    SDL_LockMutex(render_mutex);
+    stream.retired = position;
+    SDL_CondBroadcast(render_done_cond);
+    SDL_UnlockMutex(render_mutex);
+}
+
+/**
+ * Fences stream data before specified position, called with OpenGL context right after commands drawing that data are submitted.
+ */
+static void vertex_stream_fence(u64 position) {
+    if (!stream.persistent) {
+        return;
+    }
+
+    // Fences and retired position are only changed on the thread owning the context, so they are read here without the lock.
+    u64 fenced = stream.fences_count > 0 ? stream.fences[stream.fences_count - 1].position : stream.retired;
+    if (position <= fenced) {
+        return;
+    }
+
+    if (stream.fences_count == VERTEX_STREAM_MAX_FENCES) {
+        vertex_stream_set_retired(vertex_stream_retire(0));
+    }
+
+    stream.fences[stream.fences_count++] = (Vertex_Stream_Fence) { gpu->fence_sync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), position };
+}
+
+/**
+ * Waits until GPU is done reading all stream data before specified position.
+ * If the data is queued in the packet being filled, packet is handed off first, so the data gets fenced.
+ */
+static void vertex_stream_wait(u64 position) {
+    if (render_threaded) {
+        SDL_LockMutex(render_mutex);
+        bool retired = position <= stream.retired;
+        SDL_UnlockMutex(render_mutex);
+
+        if (retired) {
+            return;
+        }
+
+        if (position > handed_end) {
+            render_queue_flush();
+        }
+
+        SDL_LockMutex(render_mutex);
+        if (position > render_retire_request) {
+            render_retire_request = position;
+        }
+        SDL_CondSignal(render_work_cond);
+        while (stream.retired < position) {
+            SDL_CondWait(render_done_cond, render_mutex);
+        }
+        SDL_UnlockMutex(render_mutex);
+        return;
+    }
+
+    if (position <= stream.retired) {
+        return;
+    }
+
+    if (position > handed_end) {
+        render_queue_flush();
+    }
+
+    // Looking for the oldest fence that covers the position.
+    u32 index = 0;
+    while (index < stream.fences_count && stream.fences[index].position < position) {
+        index++;
+    }
+
+    if (index == stream.fences_count) {
+        LOG_ERROR("Vertex stream position %llu isn't fenced.", (unsigned long long)position);
+        return;
+    }
+
+    stream.retired = vertex_stream_retire(index);
+}
+
+/**
+ * Unmaps the mapped range of not persistent stream, flushing everything written to it, so it can be drawn from.
+ */
+static void vertex_stream_unmap() {
+    if (stream.persistent || stream.mapped == NULL) {
+        return;
+    }
+
+    gl_bind_buffer(GL_ARRAY_BUFFER, stream.vbo);
+
+    if (stream.map_end > stream.map_offset) {
+        gpu->flush_mapped_buffer_range(GL_ARRAY_BUFFER, 0, stream.map_end - stream.map_offset);
+    }
+    gpu->unmap_buffer(GL_ARRAY_BUFFER);
+
+    stream.mapped = NULL;
+}
+
+/**
+ * Makes sure that specified number of bytes can be written into the stream contiguously, at the offset aligned to vertex size.
+ * Moves stream position to the start of the region and returns pointer to it, the position should be advanced after the data is written.
+ * Returns NULL if that much data doesn't fit into the stream at all.
+ */
+static u8 *vertex_stream_reserve(u32 bytes, u32 vertex_size) {
+    if (bytes > VERTEX_STREAM_SIZE - vertex_size) {
+        return NULL;
+    }
+
+    u32 offset = (u32)(stream.position % VERTEX_STREAM_SIZE);
+    u32 aligned = (offset + vertex_size - 1) / vertex_size * vertex_size;
+
+    bool wrapped = false;
+    if (stream.position > 0 && offset == 0) {
+        // Position is exactly at the end of the previous lap.
+        wrapped = true;
+    } else if (aligned + bytes > VERTEX_STREAM_SIZE) {
+        stream.position += VERTEX_STREAM_SIZE - offset;
+        aligned = 0;
+        wrapped = true;
+    } else {
+        stream.position += aligned - offset;
+    }
+
+    // Stream is about to overwrite data queued earlier this lap, so it has to be submitted before that.
+    if (wrapped) {
+        render_queue_flush();
+    }
+
+    if (stream.persistent) {
+        vertex_stream_wait(stream.position + bytes > VERTEX_STREAM_SIZE ? stream.position + bytes - VERTEX_STREAM_SIZE : 0);
+        return stream.mapped + aligned;
+    }
+
+    if (wrapped) {
+        // Orphaning the buffer storage, driver gives new one while GPU still reads the old.
+        vertex_stream_unmap();
+        gl_bind_buffer(GL_ARRAY_BUFFER, stream.vbo);
+        gpu->buffer_data(GL_ARRAY_BUFFER, VERTEX_STREAM_SIZE, NULL, GL_STREAM_DRAW);
+    }
+
+    if (stream.mapped == NULL) {
+        // Nothing past the position was written since the storage was orphaned, so the rest of it can be mapped unsynchronized.
+        gl_bind_buffer(GL_ARRAY_BUFFER, stream.vbo);
+        stream.map_offset = aligned;
+        stream.map_end    = aligned;
+        stream.mapped = gpu->map_buffer_range(GL_ARRAY_BUFFER, aligned, VERTEX_STREAM_SIZE - aligned, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+        if (stream.mapped == NULL) {
+            LOG_ERROR("Couldn't map vertex stream range.");
+            return NULL;
+        }
+    }
+
+    stream.map_end = aligned;
+
+    return stream.mapped + (aligned - stream.map_offset);
+}
+
+void graphics_frame_end(SDL_Window *window) {
+    packet->present = window;
+
+    // Readback is attached to the packet that ends the frame, since packets handed off in the middle of the frame don't hold all of it.
+    packet->readback_id         = readback_requested_id;
+    packet->readback_size[0]    = readback_requested_size[0];
+    packet->readback_size[1]    = readback_requested_size[1];
+    readback_requested_id       = 0;
+
+    render_queue_flush();
+    render_layer = RENDER_LAYER_WORLD;
+}
+
+void graphics_clear() {
+    packet->clear = true;
+}
+
+// Decoded image entry is the pixels followed by width, height and channels, so pixels can be used right from the entry.
+#define IMAGE_ENTRY_TRAILER_SIZE (3 * 4)
+
+u8 *image_load(char *image_path, s32 *width, s32 *height, s32 *channels, s32 desired_channels) {
+    u64 file_size;
+    u8 *file = read_file_into_buffer(image_path, &file_size, &std_allocator);
+    if (file == NULL) {
+        return NULL;
+    }
+
+    u64 key = asset_cache_hash(&desired_channels, sizeof(desired_channels), ASSET_CACHE_SEED);
+    key = asset_cache_hash(file, file_size, key);
+
+    u64 entry_size;
+    u8 *entry = asset_cache_read("image", key, &entry_size);
+    if (entry != NULL) {
+        if (entry_size >= IMAGE_ENTRY_TRAILER_SIZE) {
+            u8 *ptr = entry + entry_size - IMAGE_ENTRY_TRAILER_SIZE;
+            *width      = (s32)read_u32(&ptr);
+            *height     = (s32)read_u32(&ptr);
+            *channels   = (s32)read_u32(&ptr);
+
+            s32 stored_channels = desired_channels != 0 ? desired_channels : *channels;
+            if ((u64)*width * (u64)*height * (u64)stored_channels + IMAGE_ENTRY_TRAILER_SIZE == entry_size) {
+                allocator_free(&std_allocator, file);
+                return entry;
+            }
+        }
+        allocator_free(&std_allocator, entry);
+    }
+
+    u8 *pixels = stbi_load_from_memory(file, (s32)file_size, width, height, channels, desired_channels);
+    allocator_free(&std_allocator, file);
+    if (pixels == NULL) {
+        return NULL;
+    }
+
+    // @Important: Stbi allocates with malloc, so pixels can be grown to fit the trailer and freed with std_allocator.
+    s32 stored_channels = desired_channels != 0 ? desired_channels : *channels;
+    u64 pixels_size = (u64)*width * (u64)*height * (u64)stored_channels;
+    u8 *grown = realloc(pixels, pixels_size + IMAGE_ENTRY_TRAILER_SIZE);
+    if (grown == NULL) {
+        return pixels;
+    }
+
+    u8 *ptr = grown + pixels_size;
+    write_u32(&ptr, (u32)*width);
+    write_u32(&ptr, (u32)*height);
+    write_u32(&ptr, (u32)*channels);
+    (void)asset_cache_write("image", key, grown, pixels_size + IMAGE_ENTRY_TRAILER_SIZE);
+
+    return grown;
 }
 
 Texture texture_load(char *texture_path) {
@@ -141,36 +723,55 @@ Texture texture_load(char *texture_path) {
     Texture texture;
     s32 nrChannels;
 
-    u8 *data = stbi_load(texture_path, &texture.width, &texture.height, &nrChannels, 0);
+    u8 *data = image_load(texture_path, &texture.width, &texture.height, &nrChannels, 0);
 
     if (data == NULL) {
         LOG_ERROR("Stbi couldn't load image.");
     }
 
     // Loading a single image into texture example:
-    glGenTextures(1, &texture.id);
-    glBindTexture(GL_TEXTURE_2D, texture.id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture_wrap_s);	
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture_wrap_t);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture_min_filter);  
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture_max_filter);
+    gpu->gen_textures(1, &texture.id);
+    gl_bind_texture(0, texture.id);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture_wrap_s);	
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture_wrap_t);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture_min_filter);  
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture_max_filter);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.width, texture.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    gpu->tex_image_2d(GL_TEXTURE_2D, 0, GL_RGBA, texture.width, texture.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    gl_bind_texture(0, 0);
 
-    stbi_image_free(data);
+    allocator_free(&std_allocator, data);
 
     return texture;
 }
 
 void texture_unload(Texture *texture) {
-    glDeleteTextures(1, &texture->id);
+    // Deleted texture is unbound from all units by OpenGL.
+    for (u32 i = 0; i < 32; i++) {
+        if (gl_state.textures[i] == texture->id) {
+            gl_state.textures[i] = 0;
+        }
+    }
+    gpu->delete_textures(1, &texture->id);
 
     texture->id = 0;
     texture->width = 0;
     texture->height = 0;
 }
 
+void texture_upload_rows(Texture *texture, s32 first_row, s32 rows, u8 *pixels) {
+    Render_Texture_Upload upload = {
+        .texture    = texture->id,
+        .first_row  = first_row,
+        .width      = texture->width,
+        .rows       = rows,
+        .data       = array_list_length(&packet->upload_data),
+    };
+
+    array_list_append_multiple(&packet->upload_data, pixels, (u32)((u64)texture->width * 4 * rows));
+    array_list_append(&packet->texture_uploads, upload);
+}
+
 UV_Region uv_slice(u32 rows, u32 cols, u32 index) {
     UV_Region uv = {
         .uv0 = vec2f_make((1.0f / (float)cols) * (float)(index % cols), (1.0f / (float)rows) * (float)((rows - 1) - (u32)(index / rows)))
@@ -180,51 +781,51 @@ UV_Region uv_slice(u32 rows, u32 cols, u32 index) {
 }
 
 
-const char *shader_uniform_pr_matrix_name = "pr_matrix";
+const char *shader_uniform_camera_block_name = "Camera";
 const char *shader_uniform_ml_matrix_name = "ml_matrix";
 const char *shader_uniform_samplers_name = "u_textures";
 
 /**
- * @Temporary: Later, setting uniforms either will be done more automatically, or simplified to be done by user manually. 
- * But right now it is not neccassary to care about too much, since only one shader is used anyway.
+ * Looks up uniform locations of the linked shader, so they don't have to be queried by name when uniforms are set.
  */
-void shader_init_uniforms(Shader *program) {
-    // Get uniform's locations based on unifrom's name.
-    s32 quad_shader_pr_matrix_loc = glGetUniformLocation(program->id, shader_uniform_pr_matrix_name);
-    if (quad_shader_pr_matrix_loc == -1) {
-        LOG_WARNING("Couldn't get location of %s uniform, in shader with id: %d.", shader_uniform_pr_matrix_name, program->id);
+static void shader_lookup_uniforms(Shader *shader, char *shader_path) {
+    if (gpu->get_uniform_block_index(shader->id, shader_uniform_camera_block_name) == GL_INVALID_INDEX) {
+        LOG_WARNING("Couldn't get index of %s uniform block, in shader %s.", shader_uniform_camera_block_name, shader_path);
     }
 
-    s32 quad_shader_ml_matrix_loc = glGetUniformLocation(program->id, shader_uniform_ml_matrix_name);
-    if (quad_shader_ml_matrix_loc == -1) {
-        LOG_WARNING("Couldn't get location of %s uniform, in shader with id: %d.", shader_uniform_ml_matrix_name, program->id);
+    shader->ml_matrix_location = gpu->get_uniform_location(shader->id, shader_uniform_ml_matrix_name);
+    if (shader->ml_matrix_location == -1) {
+        LOG_WARNING("Couldn't get location of %s uniform, in shader %s.", shader_uniform_ml_matrix_name, shader_path);
     }
 
-    s32 quad_shader_samplers_loc = glGetUniformLocation(program->id, shader_uniform_samplers_name);
-    if (quad_shader_samplers_loc == -1) {
-        LOG_WARNING("Couldn't get location of %s uniform, in shader with id: %d.", shader_uniform_samplers_name, program->id);
+    shader->samplers_location = gpu->get_uniform_location(shader->id, shader_uniform_samplers_name);
+    if (shader->samplers_location == -1) {
+        LOG_WARNING("Couldn't get location of %s uniform, in shader %s.", shader_uniform_samplers_name, shader_path);
     }
-    
-    // Set uniforms.
-    glUseProgram(program->id);
-    glUniformMatrix4fv(quad_shader_pr_matrix_loc, 1, GL_TRUE, shader_uniform_pr_matrix.array);
-    glUniformMatrix4fv(quad_shader_ml_matrix_loc, 1, GL_TRUE, shader_uniform_ml_matrix.array);
-    glUniform1iv(quad_shader_samplers_loc, 32, shader_uniform_samplers);
-    glUseProgram(0);
+}
+
+/**
+ * @Temporary: Later, setting uniforms either will be done more automatically, or simplified to be done by user manually. 
+ * But right now it is not neccassary to care about too much, since only one shader is used anyway.
+ */
+void shader_init_uniforms(Shader *program) {
+    // Set uniforms, through cached locations, without binding the program.
+    gpu->program_uniform_matrix_4fv(program->id, program->ml_matrix_location, 1, GL_TRUE, shader_uniform_ml_matrix.array);
+    gpu->program_uniform_1iv(program->id, program->samplers_location, 32, shader_uniform_samplers);
 }
 
 bool check_program(u32 id, char *shader_path) {
     s32 is_linked = 0;
-    glGetProgramiv(id, GL_LINK_STATUS, &is_linked); 
+    gpu->get_program_iv(id, GL_LINK_STATUS, &is_linked); 
     if (is_linked == GL_FALSE) {
         LOG_ERROR("Program of %s, failed to link.", shader_path);
        
         s32 info_log_length;
-        glGetProgramiv(id, GL_INFO_LOG_LENGTH, &info_log_length);
+        gpu->get_program_iv(id, GL_INFO_LOG_LENGTH, &info_log_length);
         char *buffer = malloc(info_log_length);
         
         s32 buffer_size;
-        glGetProgramInfoLog(id, info_log_length, &buffer_size, buffer);
+        gpu->get_program_info_log(id, info_log_length, &buffer_size, buffer);
         (void)fprintf(stderr, "%s\n", buffer);
         
         free(buffer);
@@ -236,16 +837,16 @@ bool check_program(u32 id, char *shader_path) {
 
 bool check_shader(u32 id, char *shader_path) {
     s32 is_compiled = 0;
-    glGetShaderiv(id, GL_COMPILE_STATUS, &is_compiled); 
+    gpu->get_shader_iv(id, GL_COMPILE_STATUS, &is_compiled); 
     if (is_compiled == GL_FALSE) {
         LOG_ERROR("Shader of %s, failed to compile.", shader_path);
         
         s32 info_log_length;
-        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &info_log_length);
+        gpu->get_shader_iv(id, GL_INFO_LOG_LENGTH, &info_log_length);
         char *buffer = malloc(info_log_length);
         
         s32 buffer_size;
-        glGetShaderInfoLog(id, info_log_length, &buffer_size, buffer);
+        gpu->get_shader_info_log(id, info_log_length, &buffer_size, buffer);
         (void)fprintf(stderr, "%s\n", buffer);
         
         free(buffer);
@@ -262,13 +863,93 @@ s32 components_of(GLenum type) {
         case GL_FLOAT_VEC3: return 3;
         case GL_FLOAT_VEC4: return 4;
         case GL_FLOAT_MAT4: return 16;
+        case GL_INT: return 1;
+        case GL_INT_VEC2: return 2;
+        case GL_INT_VEC3: return 3;
+        case GL_INT_VEC4: return 4;
         default: return 0;
     }
 }
 
-Shader shader_load(char *shader_path) {
-    Shader shader;
+bool is_integer_type(GLenum type) {
+    return type == GL_INT || type == GL_INT_VEC2 || type == GL_INT_VEC3 || type == GL_INT_VEC4;
+}
+
+u32 format_component_size(Attribute_Format format) {
+    switch (format) {
+        case ATTRIBUTE_FORMAT_U8_NORM: return 1;
+        case ATTRIBUTE_FORMAT_U16_NORM: return 2;
+        case ATTRIBUTE_FORMAT_HALF: return 2;
+        case ATTRIBUTE_FORMAT_S16: return 2;
+        default: return 4;
+    }
+}
+
+String shader_format_tag = CSTR("@Format:");
+
+/**
+ * Looks for "// @Format: ..." comment on the line attribute is declared at, and returns the format it specifies.
+ * If there is none, or it doesn't fit attribute type, returns default format for the type.
+ */
+Attribute_Format shader_parse_attribute_format(String shader_code, Attribute *attribute, char *shader_path) {
+    Attribute_Format fallback = is_integer_type(attribute->type) ? ATTRIBUTE_FORMAT_INT : ATTRIBUTE_FORMAT_FLOAT;
+    String name = CSTR(attribute->name);
+
+    while (shader_code.length > 0) {
+        s64 end_of_line = str_find_char_left(shader_code, '\n');
+        String line = str_substring(shader_code, 0, end_of_line < 0 ? shader_code.length : end_of_line);
+        shader_code = str_eat_chars(shader_code, line.length + 1);
+
+        s64 tag = str_find(line, shader_format_tag);
+        if (tag < 0) {
+            continue;
+        }
+
+        // Declared name is the word right before ';'.
+        s64 semicolon = str_find_char_left(line, ';');
+        if (semicolon < name.length + 1 || semicolon > tag) {
+            continue;
+        }
+        String declared = str_substring(line, semicolon - name.length, semicolon);
+        char before = line.data[semicolon - name.length - 1];
+        if (!str_equals(declared, name) || (before != ' ' && before != '\t')) {
+            continue;
+        }
+
+        String format = str_get_until_space(str_eat_spaces(str_eat_chars(line, tag + shader_format_tag.length)));
+
+        bool integer = false;
+        Attribute_Format result;
+        if (str_equals(format, CSTR("u8_norm"))) {
+            result = ATTRIBUTE_FORMAT_U8_NORM;
+        } else if (str_equals(format, CSTR("u16_norm"))) {
+            result = ATTRIBUTE_FORMAT_U16_NORM;
+        } else if (str_equals(format, CSTR("half"))) {
+            result = ATTRIBUTE_FORMAT_HALF;
+        } else if (str_equals(format, CSTR("s16"))) {
+            result = ATTRIBUTE_FORMAT_S16;
+            integer = true;
+        } else {
+            LOG_ERROR("Shader of %s, unknown format '%.*s' of attribute %s.", shader_path, UNPACK(format), attribute->name);
+            return fallback;
+        }
+
+        if (integer != is_integer_type(attribute->type)) {
+            LOG_ERROR("Shader of %s, format '%.*s' doesn't fit type of attribute %s.", shader_path, UNPACK(format), attribute->name);
+            return fallback;
+        }
+
+        return result;
+    }
+
+    return fallback;
+}
 
+/**
+ * Compiles vertex and fragment shaders of the source and links them into the program.
+ * Returns false if compilation or linking failed, errors are logged.
+ */
+static bool shader_compile_program(Shader *shader, String shader_source, char *shader_path) {
     /**
      * @Important: To avoid error while compiling glsl file we need to ensure that "#version ...\n" line comes before anything else in the final shader string. 
      * That said, we can't just have "#define ...\n" come before version tag. 
@@ -276,9 +957,6 @@ Shader shader_load(char *shader_path) {
      * And finally we insert "define ...\n" part in between these two substrings.
      */
 
-    // Getting full shader file.
-    String shader_source = read_file_into_str(shader_path, &std_allocator);
-    
     // Splitting on two substrings, "shader_version" and "shader_code".
     s64 start_of_version_tag = str_find(shader_source, shader_version_tag);
     s64 end_of_version_tag   = str_find_char_left(
@@ -301,75 +979,199 @@ Shader shader_load(char *shader_path) {
 
     shader_strings_lengths[1] = vertex_shader_defines.length;
     u32 vertex_shader;
-    vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 3, vertex_shader_source, shader_strings_lengths);
-    glCompileShader(vertex_shader);
+    vertex_shader = gpu->create_shader(GL_VERTEX_SHADER);
+    gpu->shader_source(vertex_shader, 3, vertex_shader_source, shader_strings_lengths);
+    gpu->compile_shader(vertex_shader);
     
     // Check results for errors.
     if (!check_shader(vertex_shader, shader_path)) {
-        allocator_free(&std_allocator, shader_source.data);
-        return (Shader) {0};
+        return false;
     }
 
     shader_strings_lengths[1] = fragment_shader_defines.length;
     u32 fragment_shader;
-    fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 3, fragment_shader_source, shader_strings_lengths);
-    glCompileShader(fragment_shader);
+    fragment_shader = gpu->create_shader(GL_FRAGMENT_SHADER);
+    gpu->shader_source(fragment_shader, 3, fragment_shader_source, shader_strings_lengths);
+    gpu->compile_shader(fragment_shader);
     
     // Check results for errors.
     if (!check_shader(fragment_shader, shader_path)) {
-        allocator_free(&std_allocator, shader_source.data);
-        return (Shader) {0};
+        return false;
     }
     
 
 
-    shader.id = glCreateProgram();
+    shader->id = gpu->create_program();
 
-    glAttachShader(shader.id, vertex_shader);
-    glAttachShader(shader.id, fragment_shader);
-    glLinkProgram(shader.id);
+    gpu->attach_shader(shader->id, vertex_shader);
+    gpu->attach_shader(shader->id, fragment_shader);
+    gpu->program_parameter_i(shader->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    gpu->link_program(shader->id);
     
     // Check results for errors.
-    if (!check_program(shader.id, shader_path)) {
-        allocator_free(&std_allocator, shader_source.data);
-        return (Shader) {0};
+    if (!check_program(shader->id, shader_path)) {
+        return false;
     }
 
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-    
+    gpu->delete_shader(vertex_shader);
+    gpu->delete_shader(fragment_shader);
 
-    allocator_free(&std_allocator, shader_source.data);
+    return true;
+}
+
+static u64 shader_driver_key = 0;
+
+/**
+ * Returns asset cache key of the program binary made from the source.
+ * Binaries are only valid for the driver that made them, so driver strings are hashed into the key as well.
+ */
+static u64 shader_binary_key(String shader_source) {
+    if (shader_driver_key == 0) {
+        GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+
+        shader_driver_key = ASSET_CACHE_SEED;
+        for (u32 i = 0; i < 3; i++) {
+            const char *string = (const char *)gpu->get_string(names[i]);
+            if (string != NULL) {
+                shader_driver_key = asset_cache_hash((void *)string, strlen(string), shader_driver_key);
+            }
+        }
+        shader_driver_key = asset_cache_hash(vertex_shader_defines.data, vertex_shader_defines.length, shader_driver_key);
+        shader_driver_key = asset_cache_hash(fragment_shader_defines.data, fragment_shader_defines.length, shader_driver_key);
+    }
+
+    return asset_cache_hash(shader_source.data, shader_source.length, shader_driver_key);
+}
+
+/**
+ * Makes the program from the cached binary, entry is binary format followed by the binary.
+ * Returns false if there is no entry or driver rejected the binary.
+ */
+static bool shader_binary_load(Shader *shader, u64 key) {
+    u64 size;
+    u8 *entry = asset_cache_read("program", key, &size);
+    if (entry == NULL) {
+        return false;
+    }
+    if (size <= 4) {
+        allocator_free(&std_allocator, entry);
+        return false;
+    }
+
+    u8 *ptr = entry;
+    GLenum format = read_u32(&ptr);
+
+    shader->id = gpu->create_program();
+    gpu->program_binary(shader->id, format, ptr, (GLsizei)(size - 4));
+    allocator_free(&std_allocator, entry);
+
+    // Driver rejects binaries it doesn't understand anymore, program is compiled from the source then.
+    s32 linked = GL_FALSE;
+    gpu->get_program_iv(shader->id, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        gpu->delete_program(shader->id);
+        shader->id = 0;
+        return false;
+    }
+
+    return true;
+}
+
+static void shader_binary_store(u32 program, u64 key) {
+    s32 length = 0;
+    gpu->get_program_iv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    u8 *entry = allocator_alloc(&std_allocator, 4 + (u64)length);
+    GLenum format = 0;
+    gpu->get_program_binary(program, length, &length, &format, entry + 4);
+
+    u8 *ptr = entry;
+    write_u32(&ptr, format);
+    (void)asset_cache_write("program", key, entry, 4 + (u64)length);
+
+    allocator_free(&std_allocator, entry);
+}
+
+Shader shader_load(char *shader_path) {
+    Shader shader;
+
+    // Getting full shader file.
+    String shader_source = read_file_into_str(shader_path, &std_allocator);
+
+    // Linked program is reused from the asset cache if the same source was linked by the same driver before.
+    // @Important: Null backend reads attributes from attached sources, so it always compiles.
+    u64 binary_key = 0;
+    bool cached = false;
+    if (!gpu->null) {
+        binary_key = shader_binary_key(shader_source);
+        cached = shader_binary_load(&shader, binary_key);
+    }
+
+    if (!cached) {
+        if (!shader_compile_program(&shader, shader_source, shader_path)) {
+            allocator_free(&std_allocator, shader_source.data);
+            return (Shader) {0};
+        }
+
+        if (!gpu->null) {
+            shader_binary_store(shader.id, binary_key);
+        }
+    }
+
+    shader_lookup_uniforms(&shader, shader_path);
     
 
     // Cache all attributes in shader based on shader location as index.
     shader.attributes_count = 0;
     shader.vertex_stride = 0;
-    glGetProgramiv(shader.id, GL_ACTIVE_ATTRIBUTES, &shader.attributes_count);
 
-    if (shader.attributes_count > MAX_ATTRIBUTES_PER_SHADER) {
-        LOG_ERROR("Shader of %s, exceeded maximum attributes per shader limit on loading.", shader_path);
-        return (Shader) {0};
-    }
+    s32 active_count = 0;
+    gpu->get_program_iv(shader.id, GL_ACTIVE_ATTRIBUTES, &active_count);
     
     Attribute attribute;
-    for (s32 i = 0; i < shader.attributes_count; i++) {
-        glGetActiveAttrib(shader.id, i, MAX_ATTRIBUTE_NAME_LENGTH, NULL, &attribute.length, &attribute.type, attribute.name);
+    for (s32 i = 0; i < active_count; i++) {
+        gpu->get_active_attrib(shader.id, i, MAX_ATTRIBUTE_NAME_LENGTH, NULL, &attribute.length, &attribute.type, attribute.name);
+
+        // Built-in inputs like gl_VertexID are listed as well, but they have no location and take no vertex data.
+        s32 location = gpu->get_attrib_location(shader.id, attribute.name);
+        if (location < 0) {
+            continue;
+        }
+
+        if (location >= MAX_ATTRIBUTES_PER_SHADER) {
+            LOG_ERROR("Shader of %s, exceeded maximum attributes per shader limit on loading.", shader_path);
+            allocator_free(&std_allocator, shader_source.data);
+            return (Shader) {0};
+        }
+
         attribute.components = components_of(attribute.type);
-        shader.vertex_stride += attribute.components;
-        shader.attributes[glGetAttribLocation(shader.id, attribute.name)] = attribute;
+        attribute.format = shader_parse_attribute_format(shader_source, &attribute, shader_path);
+        shader.attributes[location] = attribute;
+        shader.attributes_count++;
     }
 
-    
+    // Attributes are laid out one after another in the order of their locations.
+    for (s32 i = 0; i < shader.attributes_count; i++) {
+        shader.attributes[i].offset = shader.vertex_stride;
+        shader.vertex_stride += shader.attributes[i].components * format_component_size(shader.attributes[i].format);
+        shader.vertex_stride = (shader.vertex_stride + ATTRIBUTE_ALIGNMENT - 1) / ATTRIBUTE_ALIGNMENT * ATTRIBUTE_ALIGNMENT;
+    }
+
+    allocator_free(&std_allocator, shader_source.data);
+
+    shader.projection = shader_uniform_pr_matrix;
 
     return shader;
 }
 
 void shader_unload(Shader *shader) {
-    glUseProgram(0);
-    glDeleteProgram(shader->id);
+    if (gl_state.program == shader->id) {
+        gl_use_program(0);
+    }
+    gpu->delete_program(shader->id);
     
     shader->id = 0;
     shader->vertex_stride = 0;
@@ -389,281 +1191,1416 @@ Matrix4f camera_calculate_projection(Camera *camera, float window_width, float w
     return matrix4f_orthographic(camera->center.x - camera_width_offset, camera->center.x + camera_width_offset, camera->center.y - camera_height_offset, camera->center.y + camera_height_offset, -1.0f, 1.0f);
 }
 
+AABB camera_calculate_bounds(Camera *camera, float window_width, float window_height) {
+    float camera_width_offset = (window_width / (float) camera->unit_scale) / 2;
+    float camera_height_offset = (window_height / (float) camera->unit_scale) / 2;
+    return aabb_make(vec2f_make(camera->center.x - camera_width_offset, camera->center.y - camera_height_offset), vec2f_make(camera->center.x + camera_width_offset, camera->center.y + camera_height_offset));
+}
+
 Vec2f screen_to_camera(Vec2f screen_position, Camera *camera, float window_width, float window_height) {
     return vec2f_sum(vec2f_divide_constant(vec2f_difference(screen_position, vec2f_make(window_width / 2.0f, window_height / 2.0f)), camera->unit_scale), camera->center);
 }
 
 
-/**
- * @Todo: When shader loading will be more deterministic, optimize glGetUniformLocation use.
- */
 void shader_update_projection(Shader *shader, Matrix4f *projection) {
-    s32 quad_shader_pr_matrix_loc = glGetUniformLocation(shader->id, shader_uniform_pr_matrix_name);
-    if (quad_shader_pr_matrix_loc == -1) {
-        LOG_ERROR("Couldn't get location of %s uniform, in shader, when updating projection.", shader_uniform_pr_matrix_name);
+    // Uniform itself is only set when render queue is submitted, since shader can be drawn with different projections during the frame.
+    shader->projection = *projection;
+}
+
+
+
+_Thread_local u8 texture_ids_filled_length = 0;
+
+float add_texture_to_slots(Texture *texture) {
+    for (u8 i = 0; i < texture_ids_filled_length; i++) {
+        if (texture_ids[i] == texture->id)
+            return i;
+    }
+    if (texture_ids_filled_length < 32) {
+        texture_ids[texture_ids_filled_length] = texture->id;
+        texture_ids_filled_length++;
+        return texture_ids_filled_length - 1;
+    }
+    LOG_ERROR("Overflow of 32 texture slots limit, can't add texture id: %d, to current draw call texture slots.", texture->id);
+    return -1.0f;
+}
+
+
+
+
+/**
+ * Sets attribute pointers of the bound vertex array for all shader attributes, based on their formats.
+ * Divisor of 1 makes attributes advance once per instance instead of once per vertex.
+ */
+static void drawer_set_attributes(Shader *shader, u32 divisor) {
+    for (s32 i = 0; i < shader->attributes_count; i++) {
+        Attribute *attribute = &shader->attributes[i];
+        void *offset = (void*)(u64)attribute->offset;
+
+        switch (attribute->format) {
+            case ATTRIBUTE_FORMAT_FLOAT:
+                gpu->vertex_attrib_pointer(i, attribute->components, GL_FLOAT, GL_FALSE, shader->vertex_stride, offset);
+                break;
+            case ATTRIBUTE_FORMAT_INT:
+                gpu->vertex_attrib_i_pointer(i, attribute->components, GL_INT, shader->vertex_stride, offset);
+                break;
+            case ATTRIBUTE_FORMAT_U8_NORM:
+                gpu->vertex_attrib_pointer(i, attribute->components, GL_UNSIGNED_BYTE, GL_TRUE, shader->vertex_stride, offset);
+                break;
+            case ATTRIBUTE_FORMAT_U16_NORM:
+                gpu->vertex_attrib_pointer(i, attribute->components, GL_UNSIGNED_SHORT, GL_TRUE, shader->vertex_stride, offset);
+                break;
+            case ATTRIBUTE_FORMAT_HALF:
+                gpu->vertex_attrib_pointer(i, attribute->components, GL_HALF_FLOAT, GL_FALSE, shader->vertex_stride, offset);
+                break;
+            case ATTRIBUTE_FORMAT_S16:
+                gpu->vertex_attrib_i_pointer(i, attribute->components, GL_SHORT, shader->vertex_stride, offset);
+                break;
+        }
+
+        gpu->enable_vertex_attrib_array(i);
+        gpu->vertex_attrib_divisor(i, divisor);
+    }
+}
+
+void drawer_init(Quad_Drawer *drawer, Shader *shader) {
+    drawer->program = shader;
+    drawer->instanced = false;
+
+    // Setting Vertex Objects for render using OpenGL. Also seeting up Element Buffer Object for indices to load.
+    gpu->gen_vertex_arrays(1, &drawer->vao);
+    gpu->gen_buffers(1, &drawer->ebo);
+    drawer->vbo = stream.vbo;
+
+    // 1. Bind Vertex Array Object. [VAO]
+    gl_bind_vertex_array(drawer->vao);
+    
+    // 2. Bind vertex stream, verticies are written into it when drawing. [VBO].
+    gl_bind_buffer(GL_ARRAY_BUFFER, drawer->vbo);
+
+    // 3. Copy indicies array in a buffer for OpenGL to use. [EBO].
+    gpu->bind_buffer(GL_ELEMENT_ARRAY_BUFFER, drawer->ebo);
+    gpu->buffer_data(GL_ELEMENT_ARRAY_BUFFER, array_list_length(&quad_indicies) * sizeof(u32), quad_indicies, GL_STATIC_DRAW);
+    
+    // 3. Set vertex attributes pointers. [VAO, VBO, EBO].
+    drawer_set_attributes(shader, 0);
+
+
+    // 4. Unbind VAO, then EBO and VBO, so element buffer binding stays recorded in the VAO.
+    gl_bind_vertex_array(0);
+    gpu->bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+}
+
+void instanced_drawer_init(Quad_Drawer *drawer, Shader *shader) {
+    drawer->program = shader;
+    drawer->instanced = true;
+
+    // Corners are generated by the shader, so there are no indicies.
+    gpu->gen_vertex_arrays(1, &drawer->vao);
+    drawer->ebo = 0;
+    drawer->vbo = stream.vbo;
+
+    // 1. Bind Vertex Array Object. [VAO]
+    gl_bind_vertex_array(drawer->vao);
+
+    // 2. Bind vertex stream, instances are written into it when drawing. [VBO].
+    gl_bind_buffer(GL_ARRAY_BUFFER, drawer->vbo);
+
+    // 3. Set instance attributes pointers, each attribute advances once per instance. [VAO, VBO].
+    if (shader->vertex_stride != sizeof(Quad_Instance)) {
+        LOG_ERROR("Instanced drawer shader attributes take %u bytes, while quad instance is %u bytes.", shader->vertex_stride, (u32)sizeof(Quad_Instance));
+    }
+    drawer_set_attributes(shader, 1);
+
+    // 4. Unbind VBO and VAO.
+    gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+    gl_bind_vertex_array(0);
+}
+
+void drawer_free(Quad_Drawer *drawer) {
+    // Vertex buffer is the shared vertex stream, it isn't owned by the drawer.
+    if (gl_state.vao == drawer->vao) {
+        gl_bind_vertex_array(0);
+    }
+    gpu->delete_vertex_arrays(1, &drawer->vao); 
+    gpu->delete_buffers(1, &drawer->ebo); 
+
+    drawer->program = NULL;
+    drawer->vao = 0;
+    drawer->vbo = 0;
+    drawer->ebo = 0;
+}
+
+
+void line_drawer_init(Line_Drawer *drawer, Shader *shader) {
+    drawer->program = shader;
+
+    // Setting Vertex Objects for render using OpenGL.
+    gpu->gen_vertex_arrays(1, &drawer->vao);
+    drawer->vbo = stream.vbo;
+
+    // 1. Bind Vertex Array Object. [VAO]
+    gl_bind_vertex_array(drawer->vao);
+    
+    // 2. Bind vertex stream, verticies are written into it when drawing. [VBO].
+    gl_bind_buffer(GL_ARRAY_BUFFER, drawer->vbo);
+
+    // 3. Set vertex attributes pointers. [VAO, VBO].
+    drawer_set_attributes(shader, 0);
+
+    // 4. Unbind VBO and VAO.
+    gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+    gl_bind_vertex_array(0);
+}
+
+void line_drawer_free(Line_Drawer *drawer) {
+    if (gl_state.vao == drawer->vao) {
+        gl_bind_vertex_array(0);
+    }
+    gpu->delete_vertex_arrays(1, &drawer->vao); 
+
+    drawer->program = NULL;
+    drawer->vao = 0;
+    drawer->vbo = 0;
+}
+
+
+
+/**
+ * Advances stream position past the data written into the region returned by "vertex_stream_reserve()".
+ */
+static void vertex_stream_commit(u32 bytes) {
+    stream.position += bytes;
+    stream.map_end  += bytes;
+}
+
+/**
+ * Returns index of the projection in the projections of this frame, adding it if it is new.
+ */
+static u16 render_queue_projection(Matrix4f *projection) {
+    u32 count = array_list_length(&packet->projections);
+    for (u32 i = count; i > 0; i--) {
+        if (memcmp(&packet->projections[i - 1], projection, sizeof(Matrix4f)) == 0) {
+            return i - 1;
+        }
+    }
+
+    array_list_append(&packet->projections, *projection);
+    return count;
+}
+
+/**
+ * Returns index of the texture ids in the texture sets of this frame, adding them if they are new.
+ */
+static u16 render_queue_textures(u32 *ids, u8 count) {
+    u32 sets_count = array_list_length(&packet->texture_sets);
+    for (u32 i = sets_count; i > 0; i--) {
+        Render_Texture_Set *set = &packet->texture_sets[i - 1];
+        if (set->count == count && memcmp(set->ids, ids, count * sizeof(u32)) == 0) {
+            return i - 1;
+        }
+    }
+
+    Render_Texture_Set set = { .count = count };
+    memcpy(set.ids, ids, count * sizeof(u32));
+    array_list_append(&packet->texture_sets, set);
+    return sets_count;
+}
+
+/**
+ * Queues data at specified offset to be drawn with either quad or line drawer, with specified projection, textures and layer.
+ */
+static void render_queue_push_state(Quad_Drawer *drawer, Line_Drawer *line_drawer, u32 offset, u32 bytes, Matrix4f *projection, u32 *textures, u8 textures_count, Render_Layer layer) {
+    Shader *program = drawer != NULL ? drawer->program : line_drawer->program;
+
+    if (array_list_length(&packet->commands) > RENDER_KEY_DEPTH_MASK) {
+        render_queue_flush();
+    }
+
+    Render_Command command = {
+        .drawer         = drawer,
+        .line_drawer    = line_drawer,
+        .offset         = offset,
+        .bytes          = bytes,
+        .projection     = render_queue_projection(projection),
+        .textures       = drawer != NULL ? render_queue_textures(textures, textures_count) : 0,
+    };
+
+    command.key = (u64)layer << RENDER_KEY_LAYER_SHIFT
+                | (u64)(program->id & 0xffff) << RENDER_KEY_SHADER_SHIFT
+                | (u64)command.textures << RENDER_KEY_TEXTURES_SHIFT
+                | (u64)(array_list_length(&packet->commands) & RENDER_KEY_DEPTH_MASK);
+
+    array_list_append(&packet->commands, command);
+}
+
+/**
+ * Queues data at specified offset to be drawn with either quad or line drawer, with projection of its shader, currently filled texture slots and layer.
+ */
+static void render_queue_push(Quad_Drawer *drawer, Line_Drawer *line_drawer, u32 offset, u32 bytes) {
+    Shader *program = drawer != NULL ? drawer->program : line_drawer->program;
+    render_queue_push_state(drawer, line_drawer, offset, bytes, &program->projection, texture_ids, texture_ids_filled_length, render_layer);
+}
+
+static int render_command_compare(const void *a, const void *b) {
+    u64 key_a = ((Render_Command *)a)->key;
+    u64 key_b = ((Render_Command *)b)->key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+static bool render_command_mergeable(Render_Command *a, Render_Command *b) {
+    return a->drawer == b->drawer && a->line_drawer == b->line_drawer && a->projection == b->projection && (a->drawer == NULL || a->textures == b->textures);
+}
+
+/**
+ * Issues draw calls for the merged commands, state is already bound.
+ * Commands that continue each other in the stream become one range, the rest are drawn by one multi draw call.
+ */
+static void render_queue_draw(Render_Command *commands, u32 count) {
+    Shader *program = commands[0].drawer != NULL ? commands[0].drawer->program : commands[0].line_drawer->program;
+    u32 vertex_size = program->vertex_stride;
+    bool instanced = commands[0].drawer != NULL && commands[0].drawer->instanced;
+
+    array_list_clear(&multi_counts);
+    array_list_clear(&multi_firsts);
+    array_list_clear(&multi_indicies);
+
+    for (u32 i = 0; i < count; ) {
+        u32 offset = commands[i].offset;
+        u32 bytes  = commands[i].bytes;
+        for (i++; i < count && commands[i].offset == offset + bytes; i++) {
+            bytes += commands[i].bytes;
+        }
+
+        if (commands[0].line_drawer != NULL) {
+            array_list_append(&multi_firsts, (s32)(offset / vertex_size));
+            array_list_append(&multi_counts, (s32)(bytes / vertex_size));
+        } else if (instanced) {
+            // Each instance is drawn as 4 vertex triangle strip, base instance moves it along the stream.
+            gpu->draw_arrays_instanced_base_instance(GL_TRIANGLE_STRIP, 0, VERTICIES_PER_QUAD, bytes / vertex_size, offset / vertex_size);
+        } else {
+            // Element buffer only has indicies for MAX_QUADS_PER_BATCH quads, base vertex moves it along the stream.
+            u32 quads = bytes / vertex_size / VERTICIES_PER_QUAD;
+            for (u32 first = 0; first < quads; first += MAX_QUADS_PER_BATCH) {
+                u32 batch = quads - first < MAX_QUADS_PER_BATCH ? quads - first : MAX_QUADS_PER_BATCH;
+                array_list_append(&multi_counts, (s32)(batch * INDICIES_PER_QUAD));
+                array_list_append(&multi_firsts, (s32)(offset / vertex_size + first * VERTICIES_PER_QUAD));
+                array_list_append(&multi_indicies, (void *)0);
+            }
+        }
+    }
+
+    u32 draws = array_list_length(&multi_counts);
+    if (draws == 0) {
+        return;
+    }
+
+    if (commands[0].line_drawer != NULL) {
+        gpu->multi_draw_arrays(GL_LINES, multi_firsts, multi_counts, draws);
+    } else {
+        gpu->multi_draw_elements_base_vertex(GL_TRIANGLES, multi_counts, GL_UNSIGNED_INT, (const void * const *)multi_indicies, draws, multi_firsts);
+    }
+}
+
+void render_layer_set(Render_Layer layer) {
+    if (recording != NULL) {
+        recording->layer = layer;
+        return;
+    }
+
+    render_layer = layer;
+}
+
+/**
+ * Sorts commands queued since the previous batch and closes them into a batch with the viewport set for it.
+ */
+static void render_queue_close_batch() {
+    u32 batches_count = array_list_length(&packet->batches);
+    u32 first = batches_count > 0 ? packet->batches[batches_count - 1].first + packet->batches[batches_count - 1].count : 0;
+    u32 count = array_list_length(&packet->commands) - first;
+
+    if (count == 0 && packet->viewport[2] == 0) {
+        return;
+    }
+
+    qsort(packet->commands + first, count, sizeof(Render_Command), render_command_compare);
+
+    Render_Batch batch = { .first = first, .count = count };
+    memcpy(batch.viewport, packet->viewport, sizeof(batch.viewport));
+    array_list_append(&packet->batches, batch);
+
+    packet->viewport[2] = 0;
+}
+
+void render_queue_viewport(s32 x, s32 y, s32 width, s32 height) {
+    if (recording != NULL) {
+        LOG_ERROR("Viewport can't be changed while command list is recorded.");
+        return;
+    }
+
+    render_queue_close_batch();
+
+    packet->viewport[0] = x;
+    packet->viewport[1] = y;
+    packet->viewport[2] = width;
+    packet->viewport[3] = height;
+}
+
+/**
+ * Queues upload of the data into range of the buffer, data is copied into the packet.
+ */
+static void render_queue_upload(u32 vbo, u32 offset, void *data, u32 bytes, bool allocate) {
+    Render_Upload upload = {
+        .vbo        = vbo,
+        .offset     = offset,
+        .bytes      = bytes,
+        .data       = array_list_length(&packet->upload_data),
+        .allocate   = allocate,
+    };
+
+    array_list_append_multiple(&packet->upload_data, data, bytes);
+    array_list_append(&packet->uploads, upload);
+}
+
+/**
+ * Copies queued rows into the texture through the pixel buffer.
+ * @Important: Called on the thread that owns OpenGL context.
+ */
+static void render_upload_texture_rows(Render_Texture_Upload *upload, u8 *pixels) {
+    u64 bytes = (u64)upload->width * 4 * upload->rows;
+
+    gl_bind_texture(0, upload->texture);
+    gpu->pixel_store_i(GL_UNPACK_ALIGNMENT, 4);
+
+    // Buffer is orphaned every strip, so writing it never waits for the previous strip to be copied out of it.
+    gpu->bind_buffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+    gpu->buffer_data(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+    void *mapped = gpu->map_buffer_range(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped != NULL) {
+        memcpy(mapped, pixels, bytes);
+        (void)gpu->unmap_buffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // With pixel unpack buffer bound, pixels argument is the offset into it.
+        gpu->tex_sub_image_2d(GL_TEXTURE_2D, 0, 0, upload->first_row, upload->width, upload->rows, GL_RGBA, GL_UNSIGNED_BYTE, (void *)0);
+    }
+    else {
+        LOG_WARNING("Couldn't map pixel buffer, texture rows are uploaded directly.");
+        gpu->bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        gpu->tex_sub_image_2d(GL_TEXTURE_2D, 0, 0, upload->first_row, upload->width, upload->rows, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
     }
+    gpu->bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/**
+ * Reads timestamps of the oldest frame that isn't collected yet, waiting for them if they aren't available and "wait" is set.
+ * Returns false if they aren't available.
+ */
+static bool gpu_timer_collect(bool wait) {
+    u32 slot = gpu_timer.collected % GPU_TIMER_FRAMES;
+    u32 *queries = gpu_timer.queries[slot];
+    u32 layer_count = gpu_timer.layer_query_count[slot];
+
+    if (!wait) {
+        u32 available = 0;
+        gpu->get_query_object_uiv(queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available && layer_count > 0) {
+            gpu->get_query_object_uiv(gpu_timer.layer_queries[slot][layer_count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        }
+        if (!available) {
+            return false;
+        }
+    }
+
+    GLuint64 start, end;
+    gpu->get_query_object_ui64v(queries[0], GL_QUERY_RESULT, &start);
+    gpu->get_query_object_ui64v(queries[1], GL_QUERY_RESULT, &end);
+
+    float layer_times[RENDER_LAYER_COUNT] = {0};
+    for (u32 i = 0; i < layer_count; i++) {
+        GLuint64 elapsed;
+        gpu->get_query_object_ui64v(gpu_timer.layer_queries[slot][i], GL_QUERY_RESULT, &elapsed);
+        layer_times[gpu_timer.layer_query_layers[slot][i]] += (float)elapsed / 1000000.0f;
+    }
+
+    float time = (float)(end - start) / 1000000.0f;
+    if (render_threaded) {
+        SDL_LockMutex(render_mutex);
+        gpu_timer.last_time = time;
+        memcpy(gpu_timer.last_layer_times, layer_times, sizeof(layer_times));
+        gpu_timer.collected++;
+        SDL_UnlockMutex(render_mutex);
+    } else {
+        gpu_timer.last_time = time;
+        memcpy(gpu_timer.last_layer_times, layer_times, sizeof(layer_times));
+        gpu_timer.collected++;
+    }
+
+    return true;
+}
+
+static void gpu_timer_begin() {
+    if (gpu_timer.frame - gpu_timer.collected == GPU_TIMER_FRAMES) {
+        (void)gpu_timer_collect(true);
+    }
+
+    gpu->query_counter(gpu_timer.queries[gpu_timer.frame % GPU_TIMER_FRAMES][0], GL_TIMESTAMP);
+    gpu_timer.layer_query_count[gpu_timer.frame % GPU_TIMER_FRAMES] = 0;
+    gpu_timer.started = true;
+}
+
+/**
+ * Ends time elapsed query of the layer that was drawn and starts one for the layer drawn next, -1 only ends it.
+ * Only one time elapsed query can run at once, so runs of commands are timed one after another and summed per layer once collected.
+ */
+static void gpu_timer_layer(s32 layer) {
+    if (layer == gpu_timer.layer) {
+        return;
+    }
+
+    if (gpu_timer.layer >= 0) {
+        gpu->end_query(GL_TIME_ELAPSED);
+        gpu_timer.layer = -1;
+    }
+
+    u32 slot = gpu_timer.frame % GPU_TIMER_FRAMES;
+    if (layer >= 0 && gpu_timer.layer_query_count[slot] < GPU_TIMER_LAYER_QUERIES) {
+        u32 index = gpu_timer.layer_query_count[slot]++;
+        gpu_timer.layer_query_layers[slot][index] = (u8)layer;
+        gpu->begin_query(GL_TIME_ELAPSED, gpu_timer.layer_queries[slot][index]);
+        gpu_timer.layer = layer;
+    }
+}
+
+static void gpu_timer_end() {
+    gpu->query_counter(gpu_timer.queries[gpu_timer.frame % GPU_TIMER_FRAMES][1], GL_TIMESTAMP);
+    gpu_timer.started = false;
+    gpu_timer.frame++;
+
+    // Results of the older frames are picked up as soon as they are available.
+    while (gpu_timer.collected < gpu_timer.frame) {
+        if (!gpu_timer_collect(false)) {
+            break;
+        }
+    }
+}
+
+float graphics_gpu_frame_time(u32 *frame) {
+    if (!render_threaded) {
+        *frame = gpu_timer.collected;
+        return gpu_timer.last_time;
+    }
+
+    SDL_LockMutex(render_mutex);
+    *frame = gpu_timer.collected;
+    float time = gpu_timer.last_time;
+    SDL_UnlockMutex(render_mutex);
+
+    return time;
+}
+
+void graphics_gpu_layer_times(float *times, u32 *frame) {
+    if (render_threaded) {
+        SDL_LockMutex(render_mutex);
+    }
+    *frame = gpu_timer.collected;
+    memcpy(times, gpu_timer.last_layer_times, sizeof(gpu_timer.last_layer_times));
+    if (render_threaded) {
+        SDL_UnlockMutex(render_mutex);
+    }
+}
+
+bool graphics_read_pixels(s32 x, s32 y, s32 width, s32 height, u8 *rgba) {
+    graphics_context_acquire();
+
+    gpu->pixel_store_i(GL_PACK_ALIGNMENT, 1);
+    gpu->read_pixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    bool result = check_gl_error();
+
+    graphics_context_release();
+
+    return result;
+}
+
+/**
+ * Copies pixels of the oldest readback that isn't mapped yet out of its buffer, waiting for GPU to write them if "wait" is set.
+ * Returns false if they aren't written yet.
+ */
+static bool readback_map(bool wait) {
+    Readback_Slot *slot = &readback_slots[readback_mapped % GRAPHICS_READBACK_BUFFERS];
+
+    GLenum result;
+    do {
+        result = gpu->client_wait_sync(slot->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000 : 0);
+    } while (wait && result == GL_TIMEOUT_EXPIRED);
+
+    if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    gpu->delete_sync(slot->fence);
+    slot->fence = NULL;
+
+    Frame_Readback readback = {
+        .id     = slot->id,
+        .width  = slot->width,
+        .height = slot->height,
+    };
+
+    u32 bytes = (u32)slot->width * (u32)slot->height * 4;
+    gpu->bind_buffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    void *mapped = result == GL_WAIT_FAILED ? NULL : gpu->map_buffer_range(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+    if (mapped != NULL) {
+        readback.pixels = allocator_alloc(&std_allocator, bytes);
+        memcpy(readback.pixels, mapped, bytes);
+        (void)gpu->unmap_buffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        LOG_ERROR("Couldn't map frame readback %u.", slot->id);
+    }
+    gpu->bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Failed readback is still handed over without pixels, so whoever asked for it isn't left waiting.
+    if (render_threaded) {
+        SDL_LockMutex(render_mutex);
+    }
+    array_list_append(&readbacks_ready, readback);
+    if (render_threaded) {
+        SDL_UnlockMutex(render_mutex);
+    }
+
+    readback_mapped++;
+    return true;
+}
+
+/**
+ * Reads pixels of the drawn frame into the next buffer, they are written by GPU asynchronously.
+ */
+static void readback_issue(u32 id, s32 width, s32 height) {
+    if (readback_issued - readback_mapped == GRAPHICS_READBACK_BUFFERS) {
+        (void)readback_map(true);
+    }
+
+    Readback_Slot *slot = &readback_slots[readback_issued % GRAPHICS_READBACK_BUFFERS];
+    if (slot->buffer == 0) {
+        gpu->gen_buffers(1, &slot->buffer);
+    }
+
+    u32 bytes = (u32)width * (u32)height * 4;
+    gpu->bind_buffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    if (slot->size != bytes) {
+        gpu->buffer_data(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+        slot->size = bytes;
+    }
+
+    // With pack buffer bound, pixels pointer is offset into the buffer.
+    gpu->pixel_store_i(GL_PACK_ALIGNMENT, 1);
+    gpu->read_pixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    gpu->bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot->fence  = gpu->fence_sync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->id     = id;
+    slot->width  = width;
+    slot->height = height;
+    readback_issued++;
+}
+
+u32 graphics_readback_request(s32 width, s32 height) {
+    if (readback_requested_id == 0) {
+        readback_requested_id = ++readback_next_id;
+        if (readback_requested_id == 0) {
+            readback_requested_id = ++readback_next_id;
+        }
+    }
+    readback_requested_size[0] = width;
+    readback_requested_size[1] = height;
+
+    return readback_requested_id;
+}
+
+bool graphics_readback_collect(Frame_Readback *readback) {
+    bool collected = false;
+
+    if (render_threaded) {
+        SDL_LockMutex(render_mutex);
+    }
+    if (readbacks_ready != NULL && array_list_length(&readbacks_ready) > 0) {
+        // Readbacks are kept in order, so frame sequences come out in order.
+        *readback = readbacks_ready[0];
+        memmove(readbacks_ready, readbacks_ready + 1, (array_list_length(&readbacks_ready) - 1) * sizeof(Frame_Readback));
+        array_list_pop(&readbacks_ready);
+        collected = true;
+    }
+    if (render_threaded) {
+        SDL_UnlockMutex(render_mutex);
+    }
+
+    return collected;
+}
+
+void graphics_readback_finish() {
+    while (readback_mapped < readback_issued) {
+        (void)readback_map(true);
+    }
+}
+
+/**
+ * Submits everything in the packet to OpenGL, fences stream data it draws, presents it if it ends the frame and clears it to be filled again.
+ * @Important: Called on the thread that owns OpenGL context.
+ */
+static void frame_packet_submit(Frame_Packet *submitted) {
+    if (!gpu_timer.started) {
+        gpu_timer_begin();
+    }
+
+    if (submitted->clear) {
+        gpu->clear(GL_COLOR_BUFFER_BIT);
+    }
+
+    for (u32 i = 0; i < array_list_length(&submitted->uploads); i++) {
+        Render_Upload *upload = &submitted->uploads[i];
+        gl_bind_buffer(GL_ARRAY_BUFFER, upload->vbo);
+        if (upload->allocate) {
+            gpu->buffer_data(GL_ARRAY_BUFFER, upload->bytes, submitted->upload_data + upload->data, GL_DYNAMIC_DRAW);
+        } else {
+            gpu->buffer_sub_data(GL_ARRAY_BUFFER, upload->offset, upload->bytes, submitted->upload_data + upload->data);
+        }
+    }
+
+    for (u32 i = 0; i < array_list_length(&submitted->texture_uploads); i++) {
+        Render_Texture_Upload *upload = &submitted->texture_uploads[i];
+        render_upload_texture_rows(upload, submitted->upload_data + upload->data);
+    }
+
+    vertex_stream_unmap();
+
+    // Projections of the packet are uploaded at once, every command binds range of the one it uses.
+    u32 projections_count = array_list_length(&submitted->projections);
+    if (projections_count > 0) {
+        gl_bind_buffer(GL_UNIFORM_BUFFER, camera_ubo);
+        gpu->buffer_data(GL_UNIFORM_BUFFER, projections_count * camera_stride, NULL, GL_STREAM_DRAW);
+        for (u32 i = 0; i < projections_count; i++) {
+            gpu->buffer_sub_data(GL_UNIFORM_BUFFER, i * camera_stride, sizeof(Matrix4f), submitted->projections[i].array);
+        }
+    }
+
+    s32 bound_projection = -1;
+    s32 bound_textures = -1;
+
+    for (u32 b = 0; b < array_list_length(&submitted->batches); b++) {
+        Render_Batch *batch = &submitted->batches[b];
+
+        if (batch->viewport[2] > 0) {
+            gpu->viewport(batch->viewport[0], batch->viewport[1], batch->viewport[2], batch->viewport[3]);
+        }
+
+        Render_Command *commands = submitted->commands + batch->first;
+
+        for (u32 first = 0; first < batch->count; ) {
+            Render_Command *command = &commands[first];
+
+            u32 last = first + 1;
+            while (last < batch->count && render_command_mergeable(command, &commands[last])) {
+                last++;
+            }
+
+            Shader *program = command->drawer != NULL ? command->drawer->program : command->line_drawer->program;
+            u32 vao = command->drawer != NULL ? command->drawer->vao : command->line_drawer->vao;
+
+            // Commands of neighbouring layers can be merged into one draw call, it is timed with the layer of the first one.
+            gpu_timer_layer((s32)(command->key >> RENDER_KEY_LAYER_SHIFT));
+
+            // State cache skips binding whatever is bound already, including state left from the previous submission.
+            gl_use_program(program->id);
+
+            if (command->projection != bound_projection) {
+                gpu->bind_buffer_range(GL_UNIFORM_BUFFER, SHADER_CAMERA_BINDING, camera_ubo, command->projection * camera_stride, sizeof(Matrix4f));
+                bound_projection = command->projection;
+            }
+
+            if (command->drawer != NULL && command->textures != bound_textures) {
+                Render_Texture_Set *set = &submitted->texture_sets[command->textures];
+                for (u8 i = 0; i < set->count; i++) {
+                    gl_bind_texture(i, set->ids[i]);
+                }
+                bound_textures = command->textures;
+            }
+
+            gl_bind_vertex_array(vao);
+
+            render_queue_draw(command, last - first);
+
+            first = last;
+        }
+    }
+
+    // Layer query isn't left running between packets, time spent waiting for the next one isn't part of any layer.
+    gpu_timer_layer(-1);
+
+    vertex_stream_fence(submitted->stream_end);
+
+    // Frame is read back even if it isn't presented, so headless runs can capture it too.
+    if (submitted->readback_id != 0) {
+        readback_issue(submitted->readback_id, submitted->readback_size[0], submitted->readback_size[1]);
+    }
+
+    if (submitted->present != NULL) {
+        gpu_timer_end();
+        (void)check_gl_error();
+        gpu->swap_window(submitted->present);
+    }
+
+    // Readbacks of the older frames are picked up as soon as they are written.
+    while (readback_mapped < readback_issued) {
+        if (!readback_map(false)) {
+            break;
+        }
+    }
+
+    array_list_clear(&submitted->commands);
+    array_list_clear(&submitted->projections);
+    array_list_clear(&submitted->texture_sets);
+    array_list_clear(&submitted->batches);
+    array_list_clear(&submitted->uploads);
+    array_list_clear(&submitted->texture_uploads);
+    array_list_clear(&submitted->upload_data);
+    submitted->viewport[2] = 0;
+    submitted->clear       = false;
+    submitted->present     = NULL;
+    submitted->readback_id = 0;
+}
+
+void render_queue_flush() {
+    render_queue_close_batch();
+
+    // Data of the span being written isn't queued yet, so it isn't covered by the packet.
+    packet->stream_end = stream.position - stream.span_bytes;
+    handed_end = packet->stream_end;
+
+    if (!render_threaded) {
+        frame_packet_submit(packet);
+        return;
+    }
+
+    Frame_Packet *next = packet == &packets[0] ? &packets[1] : &packets[0];
+
+    SDL_LockMutex(render_mutex);
+
+    packet->busy = true;
+    render_handed[render_handed_count++] = packet;
+    SDL_CondSignal(render_work_cond);
+
+    // Update thread only waits if it is a whole packet ahead of the render thread.
+    while (next->busy) {
+        SDL_CondWait(render_done_cond, render_mutex);
+    }
+
+    SDL_UnlockMutex(render_mutex);
+
+    packet = next;
+}
+
+static int render_thread_main(void *data) {
+    if (SDL_GL_MakeCurrent(render_window, render_context) < 0) {
+        LOG_ERROR("Render thread couldn't make OpenGL context current! SDL_Error: %s.", SDL_GetError());
+    }
+
+    SDL_LockMutex(render_mutex);
+
+    while (true) {
+        if (render_handed_count > 0) {
+            Frame_Packet *submitted = render_handed[0];
+
+            SDL_UnlockMutex(render_mutex);
+            frame_packet_submit(submitted);
+            SDL_LockMutex(render_mutex);
+
+            render_handed[0] = render_handed[1];
+            render_handed_count--;
+            submitted->busy = false;
+
+            // Fences signaled by now are retired without waiting, so update thread rarely has to ask for it.
+            u32 signaled = 0;
+            while (signaled < stream.fences_count) {
+                GLenum result = gpu->client_wait_sync(stream.fences[signaled].sync, 0, 0);
+                if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+                    break;
+                }
+                signaled++;
+            }
+            if (signaled > 0) {
+                stream.retired = vertex_stream_retire(signaled - 1);
+            }
+
+            SDL_CondBroadcast(render_done_cond);
+            continue;
+        }
+
+        if (render_retire_request > stream.retired && stream.fences_count > 0) {
+            // Waiting on the oldest fence that covers the request, or the newest one if none of them do.
+            u32 index = 0;
+            while (index < stream.fences_count - 1 && stream.fences[index].position < render_retire_request) {
+                index++;
+            }
+
+            SDL_UnlockMutex(render_mutex);
+            u64 retired = vertex_stream_retire(index);
+            SDL_LockMutex(render_mutex);
+
+            stream.retired = retired;
+            SDL_CondBroadcast(render_done_cond);
+            continue;
+        }
+
+        if (render_context_requested) {
+            (void)SDL_GL_MakeCurrent(render_window, NULL);
+            render_context_released = true;
+            SDL_CondBroadcast(render_done_cond);
+
+            while (render_context_requested) {
+                SDL_CondWait(render_work_cond, render_mutex);
+            }
+
+            (void)SDL_GL_MakeCurrent(render_window, render_context);
+            render_context_released = false;
+            SDL_CondBroadcast(render_done_cond);
+            continue;
+        }
+
+        if (render_quit) {
+            break;
+        }
+
+        SDL_CondWait(render_work_cond, render_mutex);
+    }
+
+    SDL_UnlockMutex(render_mutex);
 
-    // Set uniforms.
-    glUseProgram(shader->id);
-    glUniformMatrix4fv(quad_shader_pr_matrix_loc, 1, GL_TRUE, projection->array);
-    glUseProgram(0);
+    (void)SDL_GL_MakeCurrent(render_window, NULL);
+
+    return 0;
 }
 
+bool graphics_render_thread_start(SDL_Window *window) {
+    if (render_threaded) {
+        return true;
+    }
 
+    // Null backend has no context to hand off.
+    if (gpu->null) {
+        return false;
+    }
 
-u8 texture_ids_filled_length = 0;
+    // Orphaned stream is mapped and unmapped by the update thread, so it can only be submitted from it.
+    if (!stream.persistent) {
+        LOG_WARNING("Vertex stream isn't persistently mapped, frames are submitted without render thread.");
+        return false;
+    }
 
-float add_texture_to_slots(Texture *texture) {
-    for (u8 i = 0; i < texture_ids_filled_length; i++) {
-        if (texture_ids[i] == texture->id)
-            return i;
+    render_window  = window;
+    render_context = SDL_GL_GetCurrentContext();
+    if (render_context == NULL) {
+        LOG_ERROR("There is no current OpenGL context to hand to the render thread.");
+        return false;
     }
-    if (texture_ids_filled_length < 32) {
-        texture_ids[texture_ids_filled_length] = texture->id;
-        texture_ids_filled_length++;
-        return texture_ids_filled_length - 1;
+
+    render_mutex     = SDL_CreateMutex();
+    render_work_cond = SDL_CreateCond();
+    render_done_cond = SDL_CreateCond();
+
+    render_handed_count      = 0;
+    render_retire_request    = 0;
+    render_context_requested = false;
+    render_context_released  = false;
+    render_quit              = false;
+
+    // Flags are set before the thread starts, after that context belongs to it.
+    render_threaded = true;
+    (void)SDL_GL_MakeCurrent(window, NULL);
+
+    render_thread = SDL_CreateThread(render_thread_main, "render", NULL);
+    if (render_thread == NULL) {
+        LOG_ERROR("Couldn't create render thread! SDL_Error: %s.", SDL_GetError());
+        render_threaded = false;
+        (void)SDL_GL_MakeCurrent(window, render_context);
+        SDL_DestroyCond(render_done_cond);
+        SDL_DestroyCond(render_work_cond);
+        SDL_DestroyMutex(render_mutex);
+        return false;
     }
-    LOG_ERROR("Overflow of 32 texture slots limit, can't add texture id: %d, to current draw call texture slots.", texture->id);
-    return -1.0f;
+
+    return true;
 }
 
+void graphics_render_thread_stop() {
+    if (!render_threaded) {
+        return;
+    }
 
+    // Render thread submits all handed off packets before quitting.
+    SDL_LockMutex(render_mutex);
+    render_quit = true;
+    SDL_CondSignal(render_work_cond);
+    SDL_UnlockMutex(render_mutex);
 
+    SDL_WaitThread(render_thread, NULL);
+    render_thread   = NULL;
+    render_threaded = false;
 
-// @Incomplete: Finish attributes pointers setting for different types of shaders and strides.
-void drawer_init(Quad_Drawer *drawer, Shader *shader) {
-    drawer->program = shader;
+    SDL_DestroyCond(render_done_cond);
+    SDL_DestroyCond(render_work_cond);
+    SDL_DestroyMutex(render_mutex);
 
-    // Setting Vertex Objects for render using OpenGL. Also seeting up Element Buffer Object for indices to load.
-    glGenVertexArrays(1, &drawer->vao);
-    glGenBuffers(1, &drawer->vbo);
-    glGenBuffers(1, &drawer->ebo);
+    (void)SDL_GL_MakeCurrent(render_window, render_context);
+}
 
-    // 1. Bind Vertex Array Object. [VAO]
-    glBindVertexArray(drawer->vao);
-    
-    // 2. Copy verticies array in a buffer for OpenGL to use. [VBO].
-    glBindBuffer(GL_ARRAY_BUFFER, drawer->vbo);
-    glBufferData(GL_ARRAY_BUFFER, drawer->program->vertex_stride * VERTICIES_PER_QUAD * MAX_QUADS_PER_BATCH * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+void graphics_context_acquire() {
+    if (!render_threaded) {
+        return;
+    }
 
-    // 3. Copy indicies array in a buffer for OpenGL to use. [EBO].
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawer->ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, array_list_length(&quad_indicies) * sizeof(float), quad_indicies, GL_STATIC_DRAW);
-    
-    // 3. Set vertex attributes pointers. [VAO, VBO, EBO]. @Old.
-    // glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, drawer->program->vertex_stride * sizeof(float), (void*)0);
-    // glEnableVertexAttribArray(0);
-
-    // glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, drawer->program->vertex_stride * sizeof(float), (void*)(3 * sizeof(float)));
-    // glEnableVertexAttribArray(1);
-    // 
-    // glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, drawer->program->vertex_stride * sizeof(float), (void*)(7 * sizeof(float)));
-    // glEnableVertexAttribArray(2);
-    // 
-    // glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, drawer->program->vertex_stride * sizeof(float), (void*)(9 * sizeof(float)));
-    // glEnableVertexAttribArray(3);
-    // 
-    // glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, drawer->program->vertex_stride * sizeof(float), (void*)(10 * sizeof(float)));
-    // glEnableVertexAttribArray(4);
+    SDL_LockMutex(render_mutex);
+    render_context_requested = true;
+    SDL_CondSignal(render_work_cond);
+    while (!render_context_released) {
+        SDL_CondWait(render_done_cond, render_mutex);
+    }
+    SDL_UnlockMutex(render_mutex);
 
-    // 3. Set vertex attributes pointers. [VAO, VBO, EBO].
-    u64 offset = 0;
-    for (s32 i = 0; i < shader->attributes_count; i++) {
-        glVertexAttribPointer(i, shader->attributes[i].components, ATTRIBUTE_COMPONENT_TYPE, GL_FALSE, drawer->program->vertex_stride * ATTRIBUTE_COMPONENT_SIZE, (void*)(offset * ATTRIBUTE_COMPONENT_SIZE));
-        glEnableVertexAttribArray(i);
-        offset += shader->attributes[i].components; 
+    (void)SDL_GL_MakeCurrent(render_window, render_context);
+}
+
+void graphics_context_release() {
+    if (!render_threaded) {
+        return;
     }
 
-    
+    (void)SDL_GL_MakeCurrent(render_window, NULL);
+
+    SDL_LockMutex(render_mutex);
+    render_context_requested = false;
+    SDL_CondSignal(render_work_cond);
+    while (render_context_released) {
+        SDL_CondWait(render_done_cond, render_mutex);
+    }
+    SDL_UnlockMutex(render_mutex);
+}
+
+// Active drawers are per thread same as texture slots, so every thread can record its own command list.
+_Thread_local Quad_Drawer *active_drawer = NULL;
+_Thread_local Line_Drawer *active_line_drawer = NULL;
+
+/**
+ * Records command into the list with the projection, texture slots and layer it would be queued with right now.
+ * Offset is in the data of the list, or in the retained buffer the drawer belongs to.
+ */
+static void command_list_record(Command_List *list, Quad_Drawer *drawer, Line_Drawer *line_drawer, u32 offset, u32 bytes, bool retained) {
+    Shader *program = drawer != NULL ? drawer->program : line_drawer->program;
+    u32 entries_count = array_list_length(&list->entries);
+    Command_List_Entry *previous = entries_count > 0 ? &list->entries[entries_count - 1] : NULL;
+
+    Command_List_Entry entry = {
+        .drawer         = drawer,
+        .line_drawer    = line_drawer,
+        .offset         = offset,
+        .bytes          = bytes,
+        .retained       = retained,
+        .layer          = list->layer,
+    };
+
+    // Projections and texture ids are only compared with the previous command, since they rarely change between neighbouring ones.
+    u32 projections_count = array_list_length(&list->projections);
+    if (projections_count > 0 && memcmp(&list->projections[projections_count - 1], &program->projection, sizeof(Matrix4f)) == 0) {
+        entry.projection = projections_count - 1;
+    } else {
+        entry.projection = projections_count;
+        array_list_append(&list->projections, program->projection);
+    }
 
+    if (drawer != NULL) {
+        if (previous != NULL && previous->textures_count == texture_ids_filled_length && memcmp(list->texture_ids + previous->textures, texture_ids, texture_ids_filled_length * sizeof(u32)) == 0) {
+            entry.textures = previous->textures;
+        } else {
+            entry.textures = array_list_length(&list->texture_ids);
+            (void)array_list_append_multiple(&list->texture_ids, texture_ids, texture_ids_filled_length);
+        }
+        entry.textures_count = texture_ids_filled_length;
+    }
 
-    // 4. Unbind EBO, VBO and VAO.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    array_list_append(&list->entries, entry);
 }
 
-void drawer_free(Quad_Drawer *drawer) {
-    glDeleteVertexArrays(1, &drawer->vao); 
-    glDeleteBuffers(1, &drawer->vbo); 
-    glDeleteBuffers(1, &drawer->ebo); 
+static void command_list_span_draw(Command_List *list) {
+    if (list->span_bytes == 0) {
+        return;
+    }
 
-    drawer->program = NULL;
-    drawer->vao = 0;
-    drawer->vbo = 0;
-    drawer->ebo = 0;
+    if (active_drawer != NULL) {
+        command_list_record(list, active_drawer, NULL, list->span_offset, list->span_bytes, false);
+    } else if (active_line_drawer != NULL) {
+        command_list_record(list, NULL, active_line_drawer, list->span_offset, list->span_bytes, false);
+    }
+
+    list->span_bytes = 0;
 }
 
+static void command_list_span_write(Command_List *list, void *data, u32 bytes) {
+    if (list->span_bytes == 0) {
+        list->span_offset = array_list_length(&list->data);
+    }
 
-void line_drawer_init(Line_Drawer *drawer, Shader *shader) {
-    drawer->program = shader;
+    (void)array_list_append_multiple(&list->data, data, bytes);
+    list->span_bytes += bytes;
+}
 
-    // Setting Vertex Objects for render using OpenGL. Also seeting up Element Buffer Object for indices to load.
-    glGenVertexArrays(1, &drawer->vao);
-    glGenBuffers(1, &drawer->vbo);
 
-    // 1. Bind Vertex Array Object. [VAO]
-    glBindVertexArray(drawer->vao);
-    
-    // 2. Copy verticies array in a buffer for OpenGL to use. [VBO].
-    glBindBuffer(GL_ARRAY_BUFFER, drawer->vbo);
-    // printf("max: %d\n", drawer->program->vertex_stride * VERTICIES_PER_QUAD * MAX_QUADS_PER_BATCH);
-    glBufferData(GL_ARRAY_BUFFER, drawer->program->vertex_stride * VERTICIES_PER_LINE * MAX_LINES_PER_BATCH * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+/**
+ * Queues data written since the beginning of the span with the active drawer, span starts over at the current stream position.
+ */
+static void vertex_stream_span_draw() {
+    if (recording != NULL) {
+        command_list_span_draw(recording);
+        return;
+    }
 
-    // 3. Set vertex attributes pointers. [VAO, VBO].
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, drawer->program->vertex_stride * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    if (stream.span_bytes == 0) {
+        return;
+    }
 
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, drawer->program->vertex_stride * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    if (active_drawer != NULL) {
+        render_queue_push(active_drawer, NULL, stream.span_offset, stream.span_bytes);
+    } else if (active_line_drawer != NULL) {
+        render_queue_push(NULL, active_line_drawer, stream.span_offset, stream.span_bytes);
+    }
 
-    // 4. Unbind EBO, VBO and VAO.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    stream.span_bytes = 0;
 }
 
-void line_drawer_free(Line_Drawer *drawer) {
-    glDeleteVertexArrays(1, &drawer->vao); 
-    glDeleteBuffers(1, &drawer->vbo); 
+/**
+ * Writes data into the stream right after the data of the current span.
+ * If it doesn't fit before the end of the stream, current span is drawn first and new one starts at the beginning of the stream.
+ */
+static void vertex_stream_span_write(void *data, u32 bytes, u32 vertex_size) {
+    if (bytes == 0) {
+        return;
+    }
 
-    drawer->program = NULL;
-    drawer->vao = 0;
-    drawer->vbo = 0;
+    if (recording != NULL) {
+        command_list_span_write(recording, data, bytes);
+        return;
+    }
+
+    u8 *ptr;
+    if (stream.span_bytes > 0 && stream.span_offset + stream.span_bytes + bytes <= VERTEX_STREAM_SIZE) {
+        if (stream.persistent) {
+            vertex_stream_wait(stream.position + bytes > VERTEX_STREAM_SIZE ? stream.position + bytes - VERTEX_STREAM_SIZE : 0);
+            ptr = stream.mapped + stream.span_offset + stream.span_bytes;
+        } else {
+            ptr = stream.mapped + (stream.span_offset + stream.span_bytes - stream.map_offset);
+        }
+    } else {
+        vertex_stream_span_draw();
+
+        ptr = vertex_stream_reserve(bytes, vertex_size);
+        if (ptr == NULL) {
+            LOG_ERROR("Couldn't write %u bytes into the vertex stream.", bytes);
+            return;
+        }
+        stream.span_offset = (u32)(stream.position % VERTEX_STREAM_SIZE);
+    }
+
+    memcpy(ptr, data, bytes);
+    vertex_stream_commit(bytes);
+    stream.span_bytes += bytes;
 }
 
 
 
 Vertex_Buffer vertex_buffer_make() {
-    return array_list_make(float, MAX_QUADS_PER_BATCH * VERTICIES_PER_QUAD * 11, &std_allocator);
+    return array_list_make(u8, 32 * VERTICIES_PER_QUAD * sizeof(Quad_Vertex), &std_allocator);
 }
 
 void vertex_buffer_free(Vertex_Buffer *buffer) {
     array_list_free(buffer);
 }
 
-void vertex_buffer_append_data(Vertex_Buffer *buffer, float *vertex_data, u32 length) {
-    (void)array_list_append_multiple(buffer, vertex_data, length);
+void vertex_buffer_append_data(Vertex_Buffer *buffer, void *vertex_data, u32 bytes) {
+    (void)array_list_append_multiple(buffer, vertex_data, bytes);
 }
 
-void vertex_buffer_draw_quads(Vertex_Buffer *buffer, Quad_Drawer *drawer) {
-    u32 length = array_list_length(buffer);
+/**
+ * Copies data into the stream and queues it in parts of at most half of the stream, each part with either quad or line drawer.
+ */
+static void vertex_stream_draw_data(u8 *data, u32 bytes, Quad_Drawer *drawer, Line_Drawer *line_drawer, Matrix4f *projection, u32 *textures, u8 textures_count, Render_Layer layer) {
+    Shader *program = drawer != NULL ? drawer->program : line_drawer->program;
+    u32 vertex_size = program->vertex_stride;
+    u32 primitive_size = vertex_size * (drawer != NULL ? VERTICIES_PER_QUAD : VERTICIES_PER_LINE);
+    u32 max_part = (VERTEX_STREAM_SIZE / 2) / primitive_size * primitive_size;
+
+    for (u32 done = 0; done < bytes; ) {
+        u32 part = bytes - done < max_part ? bytes - done : max_part;
+
+        u8 *ptr = vertex_stream_reserve(part, vertex_size);
+        if (ptr == NULL) {
+            LOG_ERROR("Couldn't write %u bytes into the vertex stream.", part);
+            return;
+        }
+
+        u32 offset = (u32)(stream.position % VERTEX_STREAM_SIZE);
+        memcpy(ptr, data + done, part);
+        vertex_stream_commit(part);
 
-    // Bind buffers, program, textures.
-    glUseProgram(drawer->program->id);
+        render_queue_push_state(drawer, line_drawer, offset, part, projection, textures, textures_count, layer);
 
-    for (u8 i = 0; i < 32; i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, texture_ids[i]);
+        done += part;
     }
+}
 
-    glBindVertexArray(drawer->vao);
-    glBindBuffer(GL_ARRAY_BUFFER, drawer->vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawer->ebo);
+/**
+ * Draws vertex buffer with either quad or line drawer, recording it if command list is recorded.
+ */
+static void vertex_buffer_draw(Vertex_Buffer *buffer, Quad_Drawer *drawer, Line_Drawer *line_drawer) {
+    // Whatever was written by the active span so far is drawn first, so the drawing order stays the same.
+    vertex_stream_span_draw();
 
-    u32 batch_stride = MAX_QUADS_PER_BATCH * VERTICIES_PER_QUAD * drawer->program->vertex_stride;
-    // Spliting all data on equal batches, and processing each batch in each draw call.
-    u32 batches = length / batch_stride;
-    for (u32 i = 0; i < batches; i++) {
-        glBufferSubData(GL_ARRAY_BUFFER, 0, batch_stride * sizeof(float), *buffer + (i * batch_stride));
-        glDrawElements(GL_TRIANGLES, array_list_length(&quad_indicies), GL_UNSIGNED_INT, 0);
+    u32 bytes = array_list_length(buffer);
+    if (bytes == 0) {
+        return;
     }
-    
-    // Data that didn't group into full batch, rendered in last draw call.
-    u32 float_attributes_left = (length - batch_stride * batches);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, float_attributes_left * sizeof(float), *buffer + (batches * batch_stride));
-    glDrawElements(GL_TRIANGLES, float_attributes_left / drawer->program->vertex_stride / VERTICIES_PER_QUAD * INDICIES_PER_QUAD, GL_UNSIGNED_INT, 0);
-
-    // Unbinding of buffers after use.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    
-    // Unbind texture ids.
-    for (u8 i = 0; i < 32; i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (recording != NULL) {
+        u32 offset = array_list_length(&recording->data);
+        (void)array_list_append_multiple(&recording->data, *buffer, bytes);
+        command_list_record(recording, drawer, line_drawer, offset, bytes, false);
+        return;
+    }
+
+    Shader *program = drawer != NULL ? drawer->program : line_drawer->program;
+    vertex_stream_draw_data(*buffer, bytes, drawer, line_drawer, &program->projection, texture_ids, texture_ids_filled_length, render_layer);
+}
+
+void vertex_buffer_draw_quads(Vertex_Buffer *buffer, Quad_Drawer *drawer) {
+    if (drawer->instanced) {
+        LOG_ERROR("Vertex buffer can't be drawn with instanced drawer.");
+        return;
     }
-    texture_ids_filled_length = 0;
 
-    glUseProgram(0);
+    vertex_buffer_draw(buffer, drawer, NULL);
+    texture_ids_filled_length = 0;
 }
 
 void vertex_buffer_draw_lines(Vertex_Buffer *buffer, Line_Drawer *drawer) {
-    u32 length = array_list_length(buffer);
+    vertex_buffer_draw(buffer, NULL, drawer);
+}
+
+void vertex_buffer_clear(Vertex_Buffer *buffer) {
+    array_list_clear(buffer);
+}
 
-    // Bind buffers, program, textures.
-    glUseProgram(drawer->program->id);
 
-    glBindVertexArray(drawer->vao);
-    glBindBuffer(GL_ARRAY_BUFFER, drawer->vbo);
 
+void retained_buffer_make(Retained_Buffer *buffer, Shader *shader, bool lines) {
+    *buffer = (Retained_Buffer) { .lines = lines };
 
-    u32 batch_stride = MAX_LINES_PER_BATCH * VERTICIES_PER_LINE * drawer->program->vertex_stride;
-    // Spliting all data on equal batches, and processing each batch in each draw call.
-    u32 batches = length / batch_stride;
-    for (u32 i = 0; i < batches; i++) {
-        glBufferSubData(GL_ARRAY_BUFFER, 0, batch_stride * sizeof(float), *buffer + (i * batch_stride));
-        glDrawArrays(GL_LINES, 0, MAX_LINES_PER_BATCH * VERTICIES_PER_LINE);
+    u32 vbo;
+    gpu->gen_buffers(1, &vbo);
+
+    // Drawer is made as usual, then its vertex array is pointed at the buffer's own storage instead of the vertex stream.
+    if (lines) {
+        line_drawer_init(&buffer->line_drawer, shader);
+        buffer->line_drawer.vbo = vbo;
+        gl_bind_vertex_array(buffer->line_drawer.vao);
+    } else {
+        drawer_init(&buffer->quad_drawer, shader);
+        buffer->quad_drawer.vbo = vbo;
+        gl_bind_vertex_array(buffer->quad_drawer.vao);
     }
-    
-    // Data that didn't group into full batch, rendered in last draw call.
-    u32 float_attributes_left = (length - batch_stride * batches);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, float_attributes_left * sizeof(float), *buffer + (batches * batch_stride));
-    glDrawArrays(GL_LINES, 0, float_attributes_left / drawer->program->vertex_stride);
 
+    gl_bind_buffer(GL_ARRAY_BUFFER, vbo);
+    drawer_set_attributes(shader, 0);
+    gl_bind_vertex_array(0);
+}
 
-    // Unbinding of buffers after use.
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    
-    glUseProgram(0);
+void retained_buffer_upload(Retained_Buffer *buffer, Vertex_Buffer *data) {
+    u32 bytes = array_list_length(data);
+    u32 vbo = buffer->lines ? buffer->line_drawer.vbo : buffer->quad_drawer.vbo;
+
+    if (bytes > buffer->capacity) {
+        buffer->capacity = bytes;
+        render_queue_upload(vbo, 0, *data, bytes, true);
+    } else if (bytes > 0) {
+        render_queue_upload(vbo, 0, *data, bytes, false);
+    }
+
+    buffer->bytes = bytes;
 }
 
-void vertex_buffer_clear(Vertex_Buffer *buffer) {
-    array_list_clear(buffer);
+void retained_buffer_update(Retained_Buffer *buffer, u32 offset, void *data, u32 bytes) {
+    if (offset + bytes > buffer->bytes) {
+        LOG_ERROR("Updated range %u-%u is outside of %u bytes uploaded into retained buffer.", offset, offset + bytes, buffer->bytes);
+        return;
+    }
+
+    render_queue_upload(buffer->lines ? buffer->line_drawer.vbo : buffer->quad_drawer.vbo, offset, data, bytes, false);
+}
+
+void retained_buffer_draw_range(Retained_Buffer *buffer, u32 offset, u32 bytes) {
+    if (bytes == 0) {
+        return;
+    }
+
+    Quad_Drawer *drawer = buffer->lines ? NULL : &buffer->quad_drawer;
+    Line_Drawer *line_drawer = buffer->lines ? &buffer->line_drawer : NULL;
+
+    if (recording != NULL) {
+        command_list_record(recording, drawer, line_drawer, offset, bytes, true);
+    } else {
+        render_queue_push(drawer, line_drawer, offset, bytes);
+    }
+}
+
+void retained_buffer_draw(Retained_Buffer *buffer) {
+    retained_buffer_draw_range(buffer, 0, buffer->bytes);
+}
+
+void retained_buffer_free(Retained_Buffer *buffer) {
+    gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+
+    if (buffer->lines) {
+        gpu->delete_buffers(1, &buffer->line_drawer.vbo);
+        line_drawer_free(&buffer->line_drawer);
+    } else {
+        gpu->delete_buffers(1, &buffer->quad_drawer.vbo);
+        drawer_free(&buffer->quad_drawer);
+    }
+
+    buffer->bytes = 0;
+    buffer->capacity = 0;
 }
 
 
-Quad_Drawer *active_drawer = NULL;
 
 void draw_begin(Quad_Drawer* drawer) {
     active_drawer = drawer;
+    if (recording != NULL) {
+        recording->span_bytes = 0;
+    } else {
+        stream.span_bytes = 0;
+    }
 }
 
 void draw_end() {
-    vertex_buffer_draw_quads(&verticies, active_drawer);
+    vertex_stream_span_draw();
 
     // Clean up.
     active_drawer = NULL;
-    array_list_clear(&verticies);
+    texture_ids_filled_length = 0;
 }
 
-void draw_quad_data(float *quad_data, u32 count) {
-    vertex_buffer_append_data(&verticies, quad_data, count * VERTICIES_PER_QUAD * active_drawer->program->vertex_stride);
+void draw_quad_data(void *quad_data, u32 count) {
+    if (active_drawer->instanced) {
+        LOG_ERROR("Quad vertex data can't be drawn with instanced drawer.");
+        return;
+    }
+
+    vertex_stream_span_write(quad_data, count * VERTICIES_PER_QUAD * active_drawer->program->vertex_stride, active_drawer->program->vertex_stride);
+}
+
+void draw_quad_instance_data(Quad_Instance *instances, u32 count) {
+    if (!active_drawer->instanced) {
+        LOG_ERROR("Quad instances can only be drawn with instanced drawer.");
+        return;
+    }
+
+    vertex_stream_span_write(instances, count * sizeof(Quad_Instance), active_drawer->program->vertex_stride);
 }
 
+bool draw_is_instanced() {
+    return active_drawer != NULL && active_drawer->instanced;
+}
 
 
 
 
 
-Line_Drawer *active_line_drawer = NULL;
 
 void line_draw_begin(Line_Drawer* drawer) {
     active_line_drawer = drawer;
+    if (recording != NULL) {
+        recording->span_bytes = 0;
+    } else {
+        stream.span_bytes = 0;
+    }
 }
 
 void line_draw_end() {
-    vertex_buffer_draw_lines(&verticies, active_line_drawer);
+    vertex_stream_span_draw();
 
     // Clean up.
     active_line_drawer = NULL;
-    array_list_clear(&verticies);
 }
 
-void draw_line_data(float *line_data, u32 count) {
-    vertex_buffer_append_data(&verticies, line_data, count * VERTICIES_PER_LINE * active_line_drawer->program->vertex_stride);
+void draw_line_data(Line_Vertex *line_data, u32 count) {
+    vertex_stream_span_write(line_data, count * VERTICIES_PER_LINE * sizeof(Line_Vertex), active_line_drawer->program->vertex_stride);
+}
+
+
+
+Command_List command_list_make() {
+    return (Command_List) {
+        .data           = array_list_make(u8, 32 * VERTICIES_PER_QUAD * sizeof(Quad_Vertex), &std_allocator),
+        .entries        = array_list_make(Command_List_Entry, 32, &std_allocator),
+        .projections    = array_list_make(Matrix4f, 4, &std_allocator),
+        .texture_ids    = array_list_make(u32, 32, &std_allocator),
+        .layer          = RENDER_LAYER_WORLD,
+    };
+}
+
+void command_list_free(Command_List *list) {
+    array_list_free(&list->data);
+    array_list_free(&list->entries);
+    array_list_free(&list->projections);
+    array_list_free(&list->texture_ids);
+}
+
+void command_list_begin(Command_List *list) {
+    if (recording != NULL) {
+        LOG_ERROR("Command list is already recorded on this thread.");
+        return;
+    }
+
+    recording = list;
+    list->span_bytes = 0;
+}
+
+void command_list_end() {
+    recording = NULL;
+}
+
+void command_list_submit(Command_List *list) {
+    if (recording != NULL) {
+        LOG_ERROR("Command list can't be submitted while one is recorded on this thread.");
+        return;
+    }
+
+    // Whatever was written by the active span so far is drawn first, so the drawing order stays the same.
+    vertex_stream_span_draw();
+
+    for (u32 i = 0; i < array_list_length(&list->entries); i++) {
+        Command_List_Entry *entry = &list->entries[i];
+        Matrix4f *projection = &list->projections[entry->projection];
+        u32 *textures = list->texture_ids + entry->textures;
+
+        if (entry->retained) {
+            render_queue_push_state(entry->drawer, entry->line_drawer, entry->offset, entry->bytes, projection, textures, entry->textures_count, entry->layer);
+        } else {
+            vertex_stream_draw_data(list->data + entry->offset, entry->bytes, entry->drawer, entry->line_drawer, projection, textures, entry->textures_count, entry->layer);
+        }
+    }
+
+    array_list_clear(&list->data);
+    array_list_clear(&list->entries);
+    array_list_clear(&list->projections);
+    array_list_clear(&list->texture_ids);
+    list->layer = RENDER_LAYER_WORLD;
 }
 
 
@@ -671,29 +2608,37 @@ void draw_line_data(float *line_data, u32 count) {
 void print_verticies() {
     u32 stride = 1;
     if (active_drawer != NULL) {
-        stride = active_drawer->program->vertex_stride;
+        stride = active_drawer->program->vertex_stride / sizeof(u32);
     }
     if (active_line_drawer != NULL) {
-        stride = active_line_drawer->program->vertex_stride;
+        stride = active_line_drawer->program->vertex_stride / sizeof(u32);
+    }
+
+    // Printing data written by the current span, it is still mapped.
+    // Verticies are packed, so they are printed as raw 32 bit words.
+    u32 *data = NULL;
+    u32 length = 0;
+    if (stream.span_bytes > 0 && stream.mapped != NULL) {
+        data = (u32 *)(stream.mapped + stream.span_offset - (stream.persistent ? 0 : stream.map_offset));
+        length = stream.span_bytes / sizeof(u32);
     }
 
     (void)printf("\n---------- VERTICIES -----------\n");
-    u32 length = array_list_length(&verticies);
     if (length == 0) {
         (void)printf("[ ]\n");
     }
     else {
         (void)printf("[ ");
         for (u32 i = 0; i < length - 1; i++) {
-            (void)printf("%6.1f, ", verticies[i]);
+            (void)printf("%08x, ", data[i]);
             if ((i + 1) % stride == 0)
                 (void)printf("\n  ");
         }
-        (void)printf("%6.1f  ]\n", verticies[length - 1]);
+        (void)printf("%08x  ]\n", data[length - 1]);
     }
 
    (void)printf("Length   : %8d\n", length);
-   (void)printf("Capacity : %8d\n\n", array_list_capacity(&verticies));
+   (void)printf("Stream   : %8llu\n\n", stream.position);
     
 }
 
@@ -718,9 +2663,135 @@ void print_indicies() {
 
 
 
-Font_Baked font_bake(u8 *font_data, float font_size) {
+static u32 fonts_baked = 0;
+
+/**
+ * Packs single channel glyph bitmap into the texture atlas and moves char coordinates into the atlas page,
+ * or uploads it as its own texture if it doesn't fit. Returns true if it was packed into the atlas.
+ */
+static bool font_bitmap_upload(u8 *bitmap, s32 rows, stbtt_bakedchar *chars, s32 chars_count, Texture *texture) {
+    // Glyphs are packed into the atlas, so text of all fonts and sprites can be drawn without switching textures.
+    Atlas_Region region;
+    if (atlas_pack(bitmap, texture->width, rows, 1, &region)) {
+        for (s32 i = 0; i < chars_count; i++) {
+            chars[i].x0 += region.x;
+            chars[i].x1 += region.x;
+            chars[i].y0 += region.y;
+            chars[i].y1 += region.y;
+        }
+        *texture = *region.texture;
+
+        return true;
+    }
+
+    // Create an OpenGL texture, if font didn't fit into the atlas.
+    gpu->gen_textures(1, &texture->id);
+    
+    gl_bind_texture(0, texture->id);
+
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture_wrap_s);	
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture_wrap_t);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture_min_filter);  
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture_max_filter);
+
+    gpu->tex_image_2d(GL_TEXTURE_2D, 0, GL_RED, texture->width, texture->height, 0, GL_RED, GL_UNSIGNED_BYTE, bitmap);
+    gl_bind_texture(0, 0);
+
+    return false;
+}
+
+/**
+ * Returns asset cache key of glyphs of the font rasterized with the parameters.
+ * Table directory of the font holds checksums of every table in it, so hashing it stands for hashing the whole font file.
+ * If the file is too short to hold the directory it claims to have, whole file is hashed instead.
+ */
+static u64 font_glyphs_key(u8 *font_data, u64 font_data_size, bool sdf, float font_size, s32 padding) {
+    u64 hashed = font_data_size;
+    if (font_data_size >= 12) {
+        u64 tables = ((u64)font_data[4] << 8) | (u64)font_data[5];
+        if (12 + 16 * tables <= font_data_size) {
+            hashed = 12 + 16 * tables;
+        }
+    }
+
+    u64 key = asset_cache_hash(&sdf, sizeof(sdf), ASSET_CACHE_SEED);
+    key = asset_cache_hash(&font_size, sizeof(font_size), key);
+    key = asset_cache_hash(&padding, sizeof(padding), key);
+    return asset_cache_hash(font_data, hashed, key);
+}
+
+// Glyph entry is number of chars, bitmap width and rows, then chars and bitmap rows.
+#define FONT_GLYPH_ENTRY_HEADER_SIZE    (3 * 4)
+#define FONT_GLYPH_ENTRY_CHAR_SIZE      (7 * 4)
+
+/**
+ * Reads cached chars and bitmap rows into already allocated chars and bitmap.
+ * Returns false if there is no entry, or it was made for different number of chars or bitmap size.
+ */
+static bool font_glyphs_read(u64 key, stbtt_bakedchar *chars, s32 chars_count, u8 *bitmap, s32 width, s32 height, s32 *rows) {
+    u64 size;
+    u8 *entry = asset_cache_read("font", key, &size);
+    if (entry == NULL) {
+        return false;
+    }
+
+    bool valid = size >= FONT_GLYPH_ENTRY_HEADER_SIZE;
+    u8 *ptr = entry;
+    if (valid) {
+        valid &= (s32)read_u32(&ptr) == chars_count;
+        valid &= (s32)read_u32(&ptr) == width;
+        *rows = (s32)read_u32(&ptr);
+        valid &= *rows <= height && size == FONT_GLYPH_ENTRY_HEADER_SIZE + (u64)chars_count * FONT_GLYPH_ENTRY_CHAR_SIZE + (u64)width * (u64)*rows;
+    }
+
+    if (valid) {
+        for (s32 i = 0; i < chars_count; i++) {
+            chars[i].x0         = (u16)read_u32(&ptr);
+            chars[i].y0         = (u16)read_u32(&ptr);
+            chars[i].x1         = (u16)read_u32(&ptr);
+            chars[i].y1         = (u16)read_u32(&ptr);
+            chars[i].xoff       = read_float(&ptr);
+            chars[i].yoff       = read_float(&ptr);
+            chars[i].xadvance   = read_float(&ptr);
+        }
+        memcpy(bitmap, ptr, (u64)width * (u64)*rows);
+    }
+
+    allocator_free(&std_allocator, entry);
+
+    return valid;
+}
+
+static void font_glyphs_write(u64 key, stbtt_bakedchar *chars, s32 chars_count, u8 *bitmap, s32 width, s32 rows) {
+    u64 size = FONT_GLYPH_ENTRY_HEADER_SIZE + (u64)chars_count * FONT_GLYPH_ENTRY_CHAR_SIZE + (u64)width * (u64)rows;
+    u8 *entry = allocator_alloc(&std_allocator, size);
+
+    u8 *ptr = entry;
+    write_u32(&ptr, (u32)chars_count);
+    write_u32(&ptr, (u32)width);
+    write_u32(&ptr, (u32)rows);
+    for (s32 i = 0; i < chars_count; i++) {
+        write_u32(&ptr, chars[i].x0);
+        write_u32(&ptr, chars[i].y0);
+        write_u32(&ptr, chars[i].x1);
+        write_u32(&ptr, chars[i].y1);
+        write_float(&ptr, chars[i].xoff);
+        write_float(&ptr, chars[i].yoff);
+        write_float(&ptr, chars[i].xadvance);
+    }
+    memcpy(ptr, bitmap, (u64)width * (u64)rows);
+
+    (void)asset_cache_write("font", key, entry, size);
+
+    allocator_free(&std_allocator, entry);
+}
+
+Font_Baked font_bake(u8 *font_data, u64 font_data_size, float font_size) {
 
     Font_Baked result;
+    result.id = ++fonts_baked;
+    result.sdf = false;
+    result.glyph_scale = 1.0f;
     
     // Init font info.
     stbtt_fontinfo info;
@@ -745,20 +2816,20 @@ Font_Baked font_bake(u8 *font_data, float font_size) {
     result.chars_count      = 96;  // Number of characters to bake.
                          
     result.chars = malloc(result.chars_count * sizeof(stbtt_bakedchar));
-    (void)stbtt_BakeFontBitmap(font_data, 0, font_size, bitmap, result.bitmap.width, result.bitmap.height, result.first_char_code, result.chars_count, result.chars);
 
-    // Create an OpenGL texture.
-    glGenTextures(1, &result.bitmap.id);
-    
-    glBindTexture(GL_TEXTURE_2D, result.bitmap.id);
+    // Font baked with the same size before is taken from the asset cache.
+    s32 rows;
+    u64 key = font_glyphs_key(font_data, font_data_size, false, font_size, 0);
+    if (!font_glyphs_read(key, result.chars, result.chars_count, bitmap, result.bitmap.width, result.bitmap.height, &rows)) {
+        rows = stbtt_BakeFontBitmap(font_data, 0, font_size, bitmap, result.bitmap.width, result.bitmap.height, result.first_char_code, result.chars_count, result.chars);
+        if (rows <= 0) {
+            rows = result.bitmap.height;
+        }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture_wrap_s);	
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture_wrap_t);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture_min_filter);  
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture_max_filter);
+        font_glyphs_write(key, result.chars, result.chars_count, bitmap, result.bitmap.width, rows);
+    }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, result.bitmap.width, result.bitmap.height, 0, GL_RED, GL_UNSIGNED_BYTE, bitmap);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    result.in_atlas = font_bitmap_upload(bitmap, rows, result.chars, result.chars_count, &result.bitmap);
 
     free(bitmap);
 
@@ -771,5 +2842,161 @@ void font_free(Font_Baked *font) {
     font->baseline = 0;
     font->first_char_code = 0;
     font->chars_count = 0;
-    texture_unload(&font->bitmap);
+    if (!font->in_atlas && !font->sdf) {
+        texture_unload(&font->bitmap);
+    }
+}
+
+
+static Font_Sdf **fonts_sdf = NULL;     // @Leak: Distance field fonts are kept for the whole run.
+
+/**
+ * Renders distance fields of the glyphs at the reference size and packs them into the bitmap row by row.
+ * Returns number of bitmap rows used.
+ */
+static s32 font_sdf_render_glyphs(Font_Sdf *sdf, stbtt_fontinfo *info, float scale, u8 *bitmap) {
+    // Glyphs are placed left to right with a pixel between them, going to the next row when they don't fit.
+    s32 x = 1, y = 1, row_height = 0;
+    for (s32 i = 0; i < sdf->chars_count; i++) {
+        s32 codepoint = sdf->first_char_code + i;
+
+        s32 advance, left_bearing;
+        stbtt_GetCodepointHMetrics(info, codepoint, &advance, &left_bearing);
+        sdf->chars[i].xadvance = (float)advance * scale;
+
+        s32 width, height, xoff, yoff;
+        u8 *glyph = stbtt_GetCodepointSDF(info, scale, codepoint, FONT_SDF_PADDING, 128, 128.0f / FONT_SDF_PADDING, &width, &height, &xoff, &yoff);
+        if (glyph == NULL)
+            continue;
+
+        if (x + width + 1 > sdf->bitmap.width) {
+            x = 1;
+            y += row_height + 1;
+            row_height = 0;
+        }
+        if (y + height + 1 > sdf->bitmap.height) {
+            LOG_WARNING("Distance fields of '%s' don't fit into %dx%d bitmap, glyph '%c' and the rest are skipped.", sdf->path, sdf->bitmap.width, sdf->bitmap.height, (char)codepoint);
+            stbtt_FreeSDF(glyph, NULL);
+            break;
+        }
+
+        for (s32 row = 0; row < height; row++)
+            memcpy(&bitmap[(y + row) * sdf->bitmap.width + x], &glyph[row * width], width);
+        stbtt_FreeSDF(glyph, NULL);
+
+        sdf->chars[i] = (stbtt_bakedchar) {
+            .x0         = (u16)x,
+            .y0         = (u16)y,
+            .x1         = (u16)(x + width),
+            .y1         = (u16)(y + height),
+            .xoff       = (float)xoff,
+            .yoff       = (float)yoff,
+            .xadvance   = sdf->chars[i].xadvance,
+        };
+
+        x += width + 1;
+        if (row_height < height)
+            row_height = height;
+    }
+
+    s32 rows = y + row_height + 1;
+    if (rows > sdf->bitmap.height)
+        rows = sdf->bitmap.height;
+
+    return rows;
+}
+
+static Font_Sdf *font_sdf_render(char *font_path, u8 *font_data, u64 font_data_size) {
+    Font_Sdf *sdf = calloc(1, sizeof(Font_Sdf));
+    sdf->path = malloc(strlen(font_path) + 1);
+    strcpy(sdf->path, font_path);
+
+    stbtt_fontinfo info;
+    (void)stbtt_InitFont(&info, font_data, 0);
+
+    s32 ascent, descent, line_gap;
+    stbtt_GetFontVMetrics(&info, &ascent, &descent, &line_gap);
+
+    float scale = stbtt_ScaleForPixelHeight(&info, FONT_SDF_SIZE);
+    sdf->ascent     = (float)ascent * scale;
+    sdf->descent    = (float)descent * scale;
+    sdf->line_gap   = (float)line_gap * scale;
+
+    sdf->bitmap.width   = 512;
+    sdf->bitmap.height  = 512;
+    u8 *bitmap = calloc(sdf->bitmap.width * sdf->bitmap.height, sizeof(u8));
+
+    sdf->first_char_code    = 32;
+    sdf->chars_count        = 96;
+    sdf->chars = calloc(sdf->chars_count, sizeof(stbtt_bakedchar));
+
+    // Distance fields are slow to render, so they are taken from the asset cache once rendered.
+    s32 rows;
+    u64 key = font_glyphs_key(font_data, font_data_size, true, FONT_SDF_SIZE, FONT_SDF_PADDING);
+    if (!font_glyphs_read(key, sdf->chars, sdf->chars_count, bitmap, sdf->bitmap.width, sdf->bitmap.height, &rows)) {
+        rows = font_sdf_render_glyphs(sdf, &info, scale, bitmap);
+        font_glyphs_write(key, sdf->chars, sdf->chars_count, bitmap, sdf->bitmap.width, rows);
+    }
+
+    sdf->in_atlas = font_bitmap_upload(bitmap, rows, sdf->chars, sdf->chars_count, &sdf->bitmap);
+
+    free(bitmap);
+
+    return sdf;
+}
+
+Font_Sdf *font_sdf_get(char *font_path) {
+    if (fonts_sdf == NULL)
+        fonts_sdf = array_list_make(Font_Sdf *, 4, &std_allocator);
+
+    for (u32 i = 0; i < array_list_length(&fonts_sdf); i++) {
+        if (strcmp(fonts_sdf[i]->path, font_path) == 0)
+            return fonts_sdf[i];
+    }
+
+    u64 font_data_size;
+    u8 *font_data = read_file_into_buffer(font_path, &font_data_size, &std_allocator);
+    if (font_data == NULL) {
+        LOG_ERROR("Couldn't read font file '%s'.", font_path);
+        return NULL;
+    }
+
+    Font_Sdf *sdf = font_sdf_render(font_path, font_data, font_data_size);
+    allocator_free(&std_allocator, font_data);
+
+    array_list_append(&fonts_sdf, sdf);
+
+    return sdf;
+}
+
+Font_Baked font_sdf_sized(Font_Sdf *sdf, float font_size) {
+    Font_Baked result = { 0 };
+    result.id = ++fonts_baked;
+    result.sdf = true;
+
+    if (sdf == NULL) {
+        LOG_ERROR("Can't make font of size %.1f from NULL distance field font.", font_size);
+        return result;
+    }
+
+    // Metrics are scaled from the reference size, atlas coordinates stay the same and quads are scaled by glyph scale instead.
+    float scale = font_size / FONT_SDF_SIZE;
+    result.glyph_scale      = scale;
+    result.line_height      = (s32)((sdf->ascent - sdf->descent + sdf->line_gap) * scale);
+    result.baseline         = (s32)(sdf->ascent * -scale);
+    result.line_gap         = (s32)(sdf->line_gap * scale);
+    result.first_char_code  = sdf->first_char_code;
+    result.chars_count      = sdf->chars_count;
+    result.bitmap           = sdf->bitmap;
+    result.in_atlas         = sdf->in_atlas;
+
+    result.chars = malloc(result.chars_count * sizeof(stbtt_bakedchar));
+    for (s32 i = 0; i < result.chars_count; i++) {
+        result.chars[i] = sdf->chars[i];
+        result.chars[i].xoff        *= scale;
+        result.chars[i].yoff        *= scale;
+        result.chars[i].xadvance    *= scale;
+    }
+
+    return result;
 }
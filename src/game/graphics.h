@@ -20,6 +20,8 @@
 
 #include "stb/stb_truetype.h"
 
+#include "game/gpu.h"
+
 
 /**
  * Simple glGetError() wrapper that outputs OpenGL error code if it detects error at a time of calling.
@@ -30,8 +32,10 @@ bool check_gl_error();
 
 /**
  * Wrapper around SDL Initialization.
+ * In headless mode SDL uses its offscreen video driver, which needs no display and works with Mesa's llvmpipe, audio goes to the dummy driver,
+ * and "create_gl_window()" makes hidden window with the offscreen framebuffer everything is rendered into.
  */
-int init_sdl_gl();
+int init_sdl_gl(bool headless);
 
 
 typedef struct window_info {
@@ -57,6 +61,122 @@ int init_sdl_audio();
  */
 void graphics_init();
 
+/**
+ * Hands off the frame packet, once it is submitted the window is swapped, should be called once per frame after everything was drawn.
+ */
+void graphics_frame_end(SDL_Window *window);
+
+/**
+ * Clears color buffer before anything of the current frame is drawn.
+ */
+void graphics_clear();
+
+#define GPU_TIMER_FRAMES 4
+
+/**
+ * Returns milliseconds GPU spent between the start and the end of the last measured frame, result is a few frames behind.
+ * Sets frame to the number of measured frames, so new result can be told apart from the one returned before.
+ */
+float graphics_gpu_frame_time(u32 *frame);
+
+// Time elapsed queries available to one frame, every run of commands of the same layer takes one, runs past them aren't timed.
+#define GPU_TIMER_LAYER_QUERIES 16
+
+/**
+ * Fills times with milliseconds GPU spent drawing each render layer of the last measured frame, RENDER_LAYER_COUNT of them, see "Render_Layer".
+ * Time of the frame that isn't spent drawing any layer, like clearing, uploads and readbacks, is only part of "graphics_gpu_frame_time()".
+ * Sets frame to the number of measured frames, same as "graphics_gpu_frame_time()".
+ */
+void graphics_gpu_layer_times(float *times, u32 *frame);
+
+/**
+ * Reads RGBA pixels of the last submitted frame, rows go from bottom to top, waits for render thread to submit every handed off packet first.
+ * Meant for headless mode, where frames stay in the offscreen framebuffer after they are presented.
+ * Returns false on OpenGL error.
+ */
+bool graphics_read_pixels(s32 x, s32 y, s32 width, s32 height, u8 *rgba);
+
+// Pixel buffers frames are read back into, readback is mapped once GPU is done with it, usually a frame or two later.
+#define GRAPHICS_READBACK_BUFFERS 3
+
+typedef struct frame_readback {
+    u32 id;             // Returned by "graphics_readback_request()".
+    s32 width;
+    s32 height;
+    u8  *pixels;        // RGBA, rows go from bottom to top, allocated with std allocator and owned by whoever collected it.
+} Frame_Readback;
+
+/**
+ * Asks for the frame being recorded to be read back once it is drawn, without stalling the GPU for it.
+ * Pixels are read into a pixel buffer object right before the frame is presented, and copied out once GPU has written them.
+ * If all buffers are still waiting for GPU, submission waits for the oldest one.
+ * Returns id to tell collected readbacks apart, never 0.
+ */
+u32 graphics_readback_request(s32 width, s32 height);
+
+/**
+ * Takes the oldest finished readback, returns false if there are none.
+ */
+bool graphics_readback_collect(Frame_Readback *readback);
+
+/**
+ * Waits for every readback that is still being read, so they can be collected.
+ * @Important: Should only be called once render thread is stopped.
+ */
+void graphics_readback_finish();
+
+
+/**
+ * Render thread.
+ * Update thread fills a frame packet with render commands and the stream data they draw, and hands it off at the end of the frame,
+ * render thread owns OpenGL context and submits the handed off packet while update thread fills the other one.
+ * Update thread only waits if render thread is still submitting the packet before the previous one, or if vertex stream wraps onto data that wasn't retired yet.
+ * Without render thread, packets are submitted on the update thread as soon as they are handed off.
+ * @Important: While render thread runs, any OpenGL call outside of the render queue, like loading shaders or textures, should be wrapped into "graphics_context_acquire()" and "graphics_context_release()".
+ */
+
+/**
+ * Starts render thread and gives it the OpenGL context current on the calling thread, should be called after everything is initialized.
+ * Returns false if frames stay being submitted on the calling thread, that is the case if vertex stream isn't persistently mapped.
+ */
+bool graphics_render_thread_start(SDL_Window *window);
+
+/**
+ * Waits for render thread to submit every handed off packet, stops it and makes OpenGL context current on the calling thread again.
+ */
+void graphics_render_thread_stop();
+
+/**
+ * Makes OpenGL context current on the calling thread, after render thread submits every handed off packet.
+ * Does nothing without render thread.
+ */
+void graphics_context_acquire();
+
+/**
+ * Gives OpenGL context back to the render thread.
+ */
+void graphics_context_release();
+
+
+/**
+ * OpenGL state cache.
+ * Remembers program, vertex array, array buffer and textures that are currently bound, so binding what is already bound doesn't reach the driver.
+ * @Important: All binds of these objects should go through following functions, otherwise cache gets out of sync with OpenGL.
+ */
+void gl_use_program(u32 program);
+
+void gl_bind_vertex_array(u32 vao);
+
+/**
+ * Binds buffer to GL_ARRAY_BUFFER or GL_UNIFORM_BUFFER target, element array buffer is part of the vertex array state and isn't cached.
+ */
+void gl_bind_buffer(u32 target, u32 buffer);
+
+/**
+ * Binds 2D texture to the texture unit, unit is activated only if texture actually has to be bound.
+ */
+void gl_bind_texture(u32 unit, u32 texture);
+
 
 typedef struct texture {
     u32 id;             // OpenGL texture id.
@@ -71,16 +191,32 @@ typedef struct uv_region {
 
 #define UV_DEFAULT          ((UV_Region)({ .uv0 = VEC2F_ORIGIN, .uv1 = VEC2F_UNIT }))
 
+/**
+ * Decodes the image file, or takes decoded pixels from the asset cache if the same file was decoded before.
+ * Desired channels work the same as in "stbi_load()", 0 keeps channels of the file.
+ * Returns NULL if the image couldn't be loaded.
+ * @Important: Pixels should be freed with std_allocator when not used anymore.
+ */
+u8 *image_load(char *image_path, s32 *width, s32 *height, s32 *channels, s32 desired_channels);
+
 /**
  * Loads texture from image file and returns struct that contains it's OpenGL id with other texture parameters.
  */
 Texture texture_load(char *texture_path);
 
 /**
- * Deletes loaded OpenGL texture.
+ * Deletes loaded OpenGL texture, and forgets it on units it is bound to.
+ * @Important: Textures should always be deleted through it, otherwise recycled name of a deleted texture looks already bound and isn't bound again.
  */
 void texture_unload(Texture *texture);
 
+/**
+ * Queues upload of rows of RGBA pixels into the texture, starting from the first row, texture storage should already be allocated.
+ * Pixels are copied into the frame packet and go through the pixel buffer when the packet is submitted, before any of its commands are drawn,
+ * so it doesn't need OpenGL context, same as "retained_buffer_update()".
+ */
+void texture_upload_rows(Texture *texture, s32 first_row, s32 rows, u8 *pixels);
+
 /**
  * Returns uv region that corresponds to the slice index of the texture that is sliced on grid of specified rows and cols.
  *
@@ -111,14 +247,30 @@ float add_texture_to_slots(Texture *texture);
 
 #define MAX_ATTRIBUTES_PER_SHADER 8
 #define MAX_ATTRIBUTE_NAME_LENGTH 128
-#define ATTRIBUTE_COMPONENT_SIZE 4
-#define ATTRIBUTE_COMPONENT_TYPE GL_FLOAT
+#define ATTRIBUTE_ALIGNMENT 4
+
+/**
+ * Format attribute is stored in per vertex, specified in glsl by the "// @Format: ..." comment on the line the attribute is declared at.
+ * For example:
+ *      layout(location = 1) in vec4 color;     // @Format: u8_norm
+ * Attributes without it are stored as 32 bit floats or ints, depending on their type in glsl.
+ */
+typedef enum attribute_format : u8 {
+    ATTRIBUTE_FORMAT_FLOAT,         // 32 bit float.
+    ATTRIBUTE_FORMAT_INT,           // 32 bit signed integer, for int attributes.
+    ATTRIBUTE_FORMAT_U8_NORM,       // "u8_norm", unsigned byte normalized to [0, 1].
+    ATTRIBUTE_FORMAT_U16_NORM,      // "u16_norm", unsigned short normalized to [0, 1].
+    ATTRIBUTE_FORMAT_HALF,          // "half", 16 bit float.
+    ATTRIBUTE_FORMAT_S16,           // "s16", 16 bit signed integer, for int attributes.
+} Attribute_Format;
 
 typedef struct attribute {
     char name[MAX_ATTRIBUTE_NAME_LENGTH];
     GLenum type;
     s32 length;
     s32 components;
+    Attribute_Format format;
+    u32 offset;         // Offset in bytes from the start of the vertex, aligned to ATTRIBUTE_ALIGNMENT.
 } Attribute;
 
 typedef struct shader {
@@ -126,8 +278,19 @@ typedef struct shader {
     u32 vertex_stride;  // Stride length in bytes needed to be allocated per vertex for shader to run correctly for each vertex.
     s32 attributes_count;
     Attribute attributes[MAX_ATTRIBUTES_PER_SHADER];
+    Matrix4f projection;    // Set by "shader_update_projection()", captured by render commands when they are queued.
+    s32 ml_matrix_location; // Uniform locations, looked up once when shader is loaded.
+    s32 samplers_location;
 } Shader;
 
+/**
+ * Projection matrices are shared by all shaders through uniform block at this binding point, declared in glsl as:
+ *      layout(std140, row_major, binding = 0) uniform Camera {
+ *          mat4 pr_matrix;
+ *      };
+ */
+#define SHADER_CAMERA_BINDING 0
+
 /**
  * Loads shader from .glsl file and returns struct that contains it's OpenGL id.
  */
@@ -138,18 +301,34 @@ Shader shader_load(char *shader_path);
  */
 void shader_unload(Shader *shader);
 
+/**
+ * Sets model matrix and texture samplers uniforms of the shader to their defaults, program doesn't have to be bound.
+ */
 void shader_init_uniforms(Shader *shader);
 
 
 
+/**
+ * Vertex stream.
+ *
+ * All drawers share one large vertex buffer, that vertex data of every draw is written into one after another, wrapping around once the end is reached.
+ * Data between "draw_begin()" and "draw_end()" is written straight into the buffer and queued as a single render command.
+ * If persistent mapping is supported (ARB_buffer_storage), buffer stays mapped for its whole life, and the end of each frame is fenced,
+ * so the region is only written again after GPU is done reading it.
+ * Otherwise unsynchronized ranges of the buffer are mapped for writing, and buffer storage is orphaned every time it wraps around.
+ */
+#define VERTEX_STREAM_SIZE          (8 * 1024 * 1024)
+#define VERTEX_STREAM_MAX_FENCES    8
+
 typedef struct quad_drawer {
     u32     vao;         // OpenGL id of Vertex Array Object.
-    u32     vbo;         // OpenGL id of Vertex Buffer Object.
-    u32     ebo;         // OpenGL id of Element Buffer Object.
+    u32     vbo;         // OpenGL id of Vertex Buffer Object, shared vertex stream.
+    u32     ebo;         // OpenGL id of Element Buffer Object, 0 for instanced drawer.
     Shader  *program;    // Pointer to shader that will be used to draw.
+    bool    instanced;   // Quads are written as "Quad_Instance" records, instead of 4 verticies each.
 } Quad_Drawer;
 
-#define MAX_QUADS_PER_BATCH     32
+#define MAX_QUADS_PER_BATCH     16384       // Quads per single draw call, limited by the size of the element buffer.
 #define VERTICIES_PER_QUAD      4
 #define INDICIES_PER_QUAD       6
 
@@ -158,21 +337,74 @@ typedef struct quad_drawer {
  */
 void drawer_init(Quad_Drawer *drawer, Shader *shader);
 
+/**
+ * Creates vertex array for instanced quad drawer, one "Quad_Instance" in the vertex stream is one quad.
+ * Shader attributes are expected to match "Quad_Instance" fields, and corners are expanded by gl_VertexID.
+ */
+void instanced_drawer_init(Quad_Drawer *drawer, Shader *shader);
+
 /**
  * Properly frees GL buffers from previously initted quad drawer.
  */
 void drawer_free(Quad_Drawer *drawer);
 
 
+/**
+ * Vertex of built-in quad shader, 20 bytes.
+ * @Important: UVs are normalized shorts, so they are clamped to [0, 1].
+ */
+typedef struct quad_vertex {
+    Vec2f   position;
+    u32     color;          // RGBA 8 bits per channel, red in the lowest byte.
+    u16     uv[2];
+    s16     texture_slot;   // @Important: -1 slot signifies shader to use color, not texture.
+    s16     mask_slot;
+} Quad_Vertex;
+
+/**
+ * Vertex of built-in ui quad shader, 24 bytes.
+ */
+typedef struct ui_quad_vertex {
+    Vec2f   position;
+    u32     color;
+    u16     uv[2];
+    u16     size[2];        // Half floats, pixel size of the whole quad.
+    s16     mask_slot;
+    s16     pad;
+} UI_Quad_Vertex;
+
+/**
+ * Per quad data of the instanced drawer, corners are expanded and rotated in the vertex shader.
+ * Takes 44 bytes per quad, versus 4 packed Quad_Vertex of 20 bytes (80 bytes) per quad of the regular quad drawer.
+ */
+typedef struct quad_instance {
+    Vec2f   center;
+    Vec2f   half_extents;   // Half of the width and height before rotation, negative values mirror the corners.
+    float   rot;            // Counter clockwise rotation around the center in radians.
+    u32     color;          // RGBA 8 bits per channel, red in the lowest byte.
+    Vec2f   uv0;            // Bottom left corner uv.
+    Vec2f   uv1;            // Top right corner uv.
+    s16     texture_slot;   // @Important: -1 slot signifies shader to use color, not texture.
+    s16     mask_slot;
+} Quad_Instance;
+
+
+
 
+/**
+ * Vertex of built-in line shader, 12 bytes.
+ */
+typedef struct line_vertex {
+    Vec2f   position;
+    u32     color;
+} Line_Vertex;
 
 typedef struct line_drawer {
     u32     vao;         // OpenGL id of Vertex Array Object.
-    u32     vbo;         // OpenGL id of Vertex Buffer Object.
+    u32     vbo;         // OpenGL id of Vertex Buffer Object, shared vertex stream.
     Shader  *program;    // Pointer to shader that will be used to draw.
 } Line_Drawer;
 
-#define MAX_LINES_PER_BATCH     1024
 #define VERTICIES_PER_LINE      2
 
 /**
@@ -190,7 +422,52 @@ void line_drawer_free(Line_Drawer *drawer);
 
 
 
-typedef float* Vertex_Buffer;
+/**
+ * Packs color into 8 bits per channel RGBA, red in the lowest byte.
+ */
+static inline u32 pack_color(Vec4f color) {
+    return  (u32)(clamp(color.x, 0.0f, 1.0f) * 255.0f + 0.5f)        |
+            (u32)(clamp(color.y, 0.0f, 1.0f) * 255.0f + 0.5f) << 8   |
+            (u32)(clamp(color.z, 0.0f, 1.0f) * 255.0f + 0.5f) << 16  |
+            (u32)(clamp(color.w, 0.0f, 1.0f) * 255.0f + 0.5f) << 24;
+}
+
+/**
+ * Packs [0, 1] value into normalized unsigned short, values outside are clamped.
+ */
+static inline u16 pack_unorm16(float value) {
+    return (u16)(clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+/**
+ * Packs float into half float, values too small are flushed to zero, too large or NaN become infinity.
+ */
+static inline u16 pack_half(float value) {
+    union { float f; u32 u; } bits = { .f = value };
+
+    u32 sign     = (bits.u >> 16) & 0x8000;
+    s32 exponent = (s32)((bits.u >> 23) & 0xff) - 127 + 15;
+    u32 mantissa = bits.u & 0x7fffff;
+
+    if (exponent <= 0) {
+        return (u16)sign;
+    }
+    if (exponent >= 31) {
+        return (u16)(sign | 0x7c00);
+    }
+
+    // Rounding to nearest, carry into the exponent is still correct half.
+    u32 half = sign | ((u32)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) {
+        half++;
+    }
+
+    return (u16)half;
+}
+
+
+
+typedef u8* Vertex_Buffer;
 
 /**
  * Allocates memory on the heap for the vertex buffer, that can be used with the rest of the interface to draw to the screen.
@@ -203,19 +480,19 @@ Vertex_Buffer vertex_buffer_make();
 void vertex_buffer_free(Vertex_Buffer *buffer);
 
 /**
- * Simply adds specified vertex data to the vertex buffer.
+ * Simply adds specified number of bytes of vertex data to the vertex buffer.
  */
-void vertex_buffer_append_data(Vertex_Buffer *buffer, float *vertex_data, u32 length);
+void vertex_buffer_append_data(Vertex_Buffer *buffer, void *vertex_data, u32 bytes);
 
 /**
  * Draws quad data to the screen that is stored in the buffer.
- * For example: "draw_end()" uses this function to draw verticies that are stored inside default vertex buffer.
+ * Buffer is copied into the vertex stream and queued as one render command, unless it is larger than half of the stream.
  */
 void vertex_buffer_draw_quads(Vertex_Buffer *buffer, Quad_Drawer *drawer);
 
 /**
  * Draws line data to the screen that is stored in the buffer.
- * For example: "line_draw_end()" uses this function to draw verticies that are stored inside default vertex buffer.
+ * Buffer is copied into the vertex stream and queued as one render command, unless it is larger than half of the stream.
  */
 void vertex_buffer_draw_lines(Vertex_Buffer *buffer, Line_Drawer *drawer);
 
@@ -226,6 +503,52 @@ void vertex_buffer_clear(Vertex_Buffer *buffer);
 
 
 
+/**
+ * Retained buffer keeps verticies in its own GPU buffer across frames, for geometry that doesn't change every frame, such as level geometry.
+ * Verticies are built once into the Vertex_Buffer, through draw functions with ".buffer" option, and uploaded, later only ranges that change are updated.
+ * Drawing whole buffer or its ranges doesn't copy anything, ranges are queued as render commands, neighbouring ones are merged into one draw call.
+ * @Important: Texture slots of the retained quads refer to the textures added to slots at the time they are drawn, not when they were built.
+ */
+typedef struct retained_buffer {
+    Quad_Drawer quad_drawer;    // Only one of the drawers is used, their vertex array reads from the buffer instead of the vertex stream.
+    Line_Drawer line_drawer;
+    bool        lines;
+    u32         bytes;          // Size of the uploaded data.
+    u32         capacity;       // Size of the GPU buffer storage.
+} Retained_Buffer;
+
+/**
+ * Makes empty retained buffer for quads or lines, drawn with the specified shader.
+ * @Important: Should be called with OpenGL context current, same as "retained_buffer_free()".
+ */
+void retained_buffer_make(Retained_Buffer *buffer, Shader *shader, bool lines);
+
+/**
+ * Replaces all of the buffer data with data from the vertex buffer, storage is grown if needed.
+ * Data is copied into the frame packet and uploaded when the packet is submitted, before any of its commands are drawn.
+ */
+void retained_buffer_upload(Retained_Buffer *buffer, Vertex_Buffer *data);
+
+/**
+ * Overwrites range of uploaded data in place, range should be inside of the uploaded data.
+ * @Important: Update reaches the GPU before any command of the frame packet is drawn, so the range drawn earlier in the frame is drawn updated as well.
+ */
+void retained_buffer_update(Retained_Buffer *buffer, u32 offset, void *data, u32 bytes);
+
+/**
+ * Queues range of the buffer data as render command, offset and bytes should be multiples of quad or line size.
+ */
+void retained_buffer_draw_range(Retained_Buffer *buffer, u32 offset, u32 bytes);
+
+/**
+ * Queues all of the buffer data as render command.
+ */
+void retained_buffer_draw(Retained_Buffer *buffer);
+
+void retained_buffer_free(Retained_Buffer *buffer);
+
+
+
 
 
 
@@ -236,15 +559,27 @@ void vertex_buffer_clear(Vertex_Buffer *buffer);
 void draw_begin(Quad_Drawer *drawer);
 
 /**
- * Wraps around "draw_buffer()" using active drawer as a parameter, and internally inited vertices arraylist as a buffer parameter.
+ * Queues everything that was written into the vertex stream since "draw_begin()" with the active drawer, as one render command.
  * @Important: Essentially all general drawing should happen between draw_begin() and draw_end() calls.
  */
 void draw_end();
 
 /**
- * Simply places specified data directly into the default vertex buffer.
+ * Simply places specified data directly into the vertex stream.
+ * @Important: Active drawer shouldn't be instanced.
  */
-void draw_quad_data(float *quad_data, u32 count);
+void draw_quad_data(void *quad_data, u32 count);
+
+/**
+ * Simply places specified instances directly into the vertex stream.
+ * @Important: Active drawer should be instanced.
+ */
+void draw_quad_instance_data(Quad_Instance *instances, u32 count);
+
+/**
+ * Returns true if active drawer is instanced, so quads should be placed with "draw_quad_instance_data()".
+ */
+bool draw_is_instanced();
 
 
 
@@ -261,15 +596,110 @@ void draw_quad_data(float *quad_data, u32 count);
 void line_draw_begin(Line_Drawer *drawer);
 
 /**
- * Wraps around "line_draw_buffer()" using active line drawer as a parameter, and internally inited vertices arraylist as a buffer parameter.
- * @Important: Essentially all general line drawing should happen between line_draw_begin() and line_draw_end() calls. But it cannot happen inside "draw_begin()" and "draw_end()" since both lines and quads use same default vertex buffer.
+ * Queues everything that was written into the vertex stream since "line_draw_begin()" with the active line drawer, as one render command.
+ * @Important: Essentially all general line drawing should happen between line_draw_begin() and line_draw_end() calls. But it cannot happen inside "draw_begin()" and "draw_end()" since both lines and quads are written into the same vertex stream.
  */
 void line_draw_end();
 
 /**
- * Simply places specified line data directly into the default vertex buffer.
+ * Simply places specified line data directly into the vertex stream.
+ */
+void draw_line_data(Line_Vertex *line_data, u32 count);
+
+
+
+
+/**
+ * Render queue.
+ *
+ * Drawing doesn't happen at "draw_end()", each span of stream data is queued as render command with 64 bit sort key instead:
+ *      | layer 8 bits | shader 16 bits | texture set 16 bits | depth 24 bits |
+ * Once per frame commands are sorted by the key and submitted, neighbouring commands with the same drawer, projection and textures
+ * are merged into one draw call, so program, texture and vertex array are only bound when they change.
+ * Layers are drawn in order, inside of the layer commands are grouped by shader and textures, depth is the order they were queued in.
+ * @Important: Commands inside of one layer can be reordered between different shaders and textures, things that have to overlap in order go into different layers.
  */
-void draw_line_data(float *line_data, u32 count);
+typedef enum render_layer : u8 {
+    RENDER_LAYER_BACKGROUND,
+    RENDER_LAYER_WORLD_STATIC,      // Retained quads of static world, always under whatever is drawn immediately.
+    RENDER_LAYER_WORLD,
+    RENDER_LAYER_WORLD_OVERLAY,     // Lines and gizmos on top of the world.
+    RENDER_LAYER_UI,
+    RENDER_LAYER_CONSOLE,
+    RENDER_LAYER_COUNT,
+} Render_Layer;
+
+#define RENDER_KEY_LAYER_SHIFT      56
+#define RENDER_KEY_SHADER_SHIFT     40
+#define RENDER_KEY_TEXTURES_SHIFT   24
+#define RENDER_KEY_DEPTH_MASK       0xffffff
+
+/**
+ * Sets layer following commands are queued into, it is reset to RENDER_LAYER_WORLD at the end of every frame.
+ */
+void render_layer_set(Render_Layer layer);
+
+/**
+ * Sets viewport commands queued after this call are drawn with, commands queued before it are still drawn with the previous one.
+ */
+void render_queue_viewport(s32 x, s32 y, s32 width, s32 height);
+
+/**
+ * Sorts queued commands and hands off the frame packet, called by "graphics_frame_end()".
+ * Packet is submitted right away without render thread, otherwise it is submitted by the render thread later.
+ */
+void render_queue_flush();
+
+
+/**
+ * Command list.
+ * Draw calls made on a thread between "command_list_begin()" and "command_list_end()" are recorded into the list, instead of the vertex stream and render queue,
+ * so verticies can be generated on several threads at once, each one recording its own list with its own drawers and texture slots.
+ * Lists are merged into the frame by "command_list_submit()" on the update thread, commands are queued in the order lists are submitted,
+ * so the frame doesn't depend on which thread finished recording first.
+ * Every command captures projection of its shader, texture slots and layer at the time it is recorded.
+ * @Important: Drawers and shader projections are only read while recording, they shouldn't be changed by the update thread until recording is done.
+ * Viewport can't be changed and retained buffers can't be uploaded while recording, those stay on the update thread.
+ */
+typedef struct command_list_entry {
+    Quad_Drawer     *drawer;            // Either quad drawer or line drawer is set.
+    Line_Drawer     *line_drawer;
+    u32             offset;             // Offset of the data in the list, or in the retained buffer if it is retained.
+    u32             bytes;
+    bool            retained;
+    u16             projection;         // Index into the projections of the list.
+    u32             textures;           // Index of the first texture id in the texture ids of the list.
+    u8              textures_count;
+    Render_Layer    layer;
+} Command_List_Entry;
+
+typedef struct command_list {
+    u8                  *data;          // Vertex data of all recorded commands.
+    Command_List_Entry  *entries;
+    Matrix4f            *projections;
+    u32                 *texture_ids;
+    u32                 span_offset;    // Data of the span being recorded, same as in the vertex stream.
+    u32                 span_bytes;
+    Render_Layer        layer;
+} Command_List;
+
+Command_List command_list_make();
+
+void command_list_free(Command_List *list);
+
+/**
+ * Starts recording draw calls made on the calling thread into the list, until "command_list_end()" is called on the same thread.
+ * List can be recorded several times before it is submitted, new commands are added after the ones recorded before.
+ */
+void command_list_begin(Command_List *list);
+
+void command_list_end();
+
+/**
+ * Queues every command recorded into the list, copying their verticies into the vertex stream, and clears the list.
+ * @Important: Should be called on the update thread, after the thread recording the list is done with it.
+ */
+void command_list_submit(Command_List *list);
 
 
 
@@ -300,6 +730,11 @@ Camera camera_make(Vec2f center, s32 unit_scale);
  */
 Matrix4f camera_calculate_projection(Camera *camera, float window_width, float window_height);
 
+/**
+ * Calculate world space bounds of everything that is visible through the camera, the same extents "camera_calculate_projection()" uses.
+ */
+AABB camera_calculate_bounds(Camera *camera, float window_width, float window_height);
+
 #define screen_calculate_projection(window_width, window_height) ((Matrix4f) { .array = { 2.0f / (float)(window_width), 0.0f, 0.0f, -1.0f,    0.0f, 2.0f / (float)(window_height), 0.0f, -1.0f,    0.0f, 0.0f, 1.0f, 0.0f,    0.0f, 0.0f, 0.0f, 1.0f } })
 
 /**
@@ -309,7 +744,8 @@ Vec2f screen_to_camera(Vec2f screen_pos, Camera *camera, float window_width, flo
 
 
 /**
- * Sets shader uniform projection matrix to the specified 4x4 matrix.
+ * Sets projection matrix of the shader, that is used by the commands queued with it from now on.
+ * Matrices are uploaded into camera uniform buffer once per render queue submission, each distinct one once, no matter how many shaders use it.
  */
 void shader_update_projection(Shader *shader, Matrix4f *projection);
 
@@ -321,12 +757,60 @@ typedef struct font_baked {
     s32             baseline;
     s32             line_height;
     s32             line_gap;
-    Texture         bitmap;
+    Texture         bitmap;                     // Atlas page glyphs are packed into, or font's own texture if they didn't fit.
+    bool            in_atlas;
+    u32             id;                         // Unique for every baked font, glyph runs laid out with the font are keyed by it.
+    bool            sdf;                        // Bitmap holds distance fields of the glyphs shared by every size of the font, font doesn't own it.
+    float           glyph_scale;                // Size of glyph quads relative to the size of glyphs in the bitmap, 1 unless glyphs are distance fields.
 } Font_Baked;
 
-Font_Baked font_bake(u8 *font_data, float font_size);
+/**
+ * Bakes ASCII glyphs of the font file data and packs them into the texture atlas, char coordinates are in pixels of the atlas page.
+ */
+Font_Baked font_bake(u8 *font_data, u64 font_data_size, float font_size);
 
 void font_free(Font_Baked *font);
 
 
+/**
+ * Signed distance field fonts.
+ *
+ * Glyphs of the font are rendered once as distance fields at the reference size and packed into the texture atlas,
+ * then fonts of any size are made from them without rasterizing anything, so one bitmap serves every size and zoom level.
+ * Distance field masks are told apart from coverage masks by their slot, which is offset by SDF_MASK_SLOT_OFFSET,
+ * quad shaders smooth the edge at 0.5 over the screen space derivative of the distance, so glyphs stay sharp when scaled.
+ */
+
+// Pixel height glyph distance fields are rendered at.
+#define FONT_SDF_SIZE           48.0f
+// Pixels distance field extends outside of the glyph edge, edge itself is at value 128.
+#define FONT_SDF_PADDING        5
+// Added to mask slot of distance field masks, shaders subtract it to get the texture slot.
+#define SDF_MASK_SLOT_OFFSET    32
+
+typedef struct font_sdf {
+    char            *path;                      // Font file the font was loaded from.
+    stbtt_bakedchar *chars;                     // Metrics are in pixels of the reference size.
+    s32             chars_count;
+    s32             first_char_code;
+    float           ascent;                     // Vertical metrics in pixels of the reference size.
+    float           descent;
+    float           line_gap;
+    Texture         bitmap;
+    bool            in_atlas;
+} Font_Sdf;
+
+/**
+ * Returns distance field font of the font file, rendering its glyphs only the first time the file is asked for.
+ * Returns NULL if the file couldn't be read.
+ */
+Font_Sdf *font_sdf_get(char *font_path);
+
+/**
+ * Makes font of the size from the distance field font, glyphs are drawn from the distance field bitmap.
+ * Font should be freed with "font_free()", which leaves the shared bitmap alone.
+ */
+Font_Baked font_sdf_sized(Font_Sdf *sdf, float font_size);
+
+
 #endif
@@ -0,0 +1,766 @@
+#include "game/harness.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/str.h"
+#include "core/structs.h"
+#include "core/log.h"
+#include "core/file.h"
+
+#include "game/graphics.h"
+#include "game/command.h"
+#include "game/draw.h"
+#include "game/imui.h"
+#include "game/console.h"
+#include "game/level.h"
+#include "game/level_format.h"
+#include "game/resource.h"
+#include "game/texture_stream.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+
+#include "stb/stb_image.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define HARNESS_SCRIPT_LINE_MAX 512
+
+typedef struct harness_script_line {
+    s32     frame;
+    String  command;
+} Harness_Script_Line;
+
+static Harness_Script_Line *script_lines;
+
+
+
+bool harness_parse_args(s32 argc, char **argv, Harness_Options *options) {
+    *options = (Harness_Options) {
+        .tolerance      = HARNESS_DEFAULT_TOLERANCE,
+        .capture_frames = array_list_make(s32, 8, &std_allocator),
+    };
+
+    for (s32 i = 1; i < argc; i++) {
+        char *arg = argv[i];
+
+        if (strcmp(arg, "--headless") == 0) {
+            options->headless = true;
+            continue;
+        }
+        if (strcmp(arg, "--update-golden") == 0) {
+            options->update_golden = true;
+            continue;
+        }
+        if (strcmp(arg, "--benchmark") == 0) {
+            options->benchmark = true;
+            continue;
+        }
+        if (strcmp(arg, "--test") == 0) {
+            options->test = true;
+            continue;
+        }
+
+        bool has_value = strcmp(arg, "--frames") == 0 || strcmp(arg, "--script") == 0 || strcmp(arg, "--golden") == 0
+                      || strcmp(arg, "--capture") == 0 || strcmp(arg, "--tolerance") == 0;
+        if (!has_value) {
+            LOG_WARNING("Unknown argument '%s' is ignored.", arg);
+            continue;
+        }
+
+        if (i + 1 == argc) {
+            LOG_ERROR("Argument '%s' is missing its value.", arg);
+            return false;
+        }
+        char *value = argv[++i];
+
+        if (strcmp(arg, "--frames") == 0) {
+            options->frames = (s32)strtol(value, NULL, 10);
+        } else if (strcmp(arg, "--script") == 0) {
+            options->script_path = value;
+        } else if (strcmp(arg, "--golden") == 0) {
+            options->golden_dir = value;
+        } else if (strcmp(arg, "--tolerance") == 0) {
+            options->tolerance = strtof(value, NULL);
+        } else {
+            // Frames are separated by commas, argument can also be repeated.
+            char *cursor = value;
+            while (*cursor != '\0') {
+                char *end;
+                s32 frame = (s32)strtol(cursor, &end, 10);
+                if (end == cursor || (*end != ',' && *end != '\0')) {
+                    LOG_ERROR("Malformed capture frames '%s'.", value);
+                    return false;
+                }
+                array_list_append(&options->capture_frames, frame);
+                cursor = *end == ',' ? end + 1 : end;
+            }
+        }
+    }
+
+    if (array_list_length(&options->capture_frames) > 0 && options->golden_dir == NULL) {
+        LOG_ERROR("Captured frames need golden images directory, specified with '--golden'.");
+        return false;
+    }
+
+    return true;
+}
+
+static bool harness_load_script(char *script_path) {
+    FILE *file = fopen(script_path, "rb");
+    if (file == NULL) {
+        LOG_ERROR("Couldn't open harness script '%s'.", script_path);
+        return false;
+    }
+
+    script_lines = array_list_make(Harness_Script_Line, 32, &std_allocator);
+
+    char line[HARNESS_SCRIPT_LINE_MAX];
+    u32 number = 0;
+    bool result = true;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        number++;
+        line[strcspn(line, "\r\n")] = '\0';
+
+        String str = str_eat_spaces(STR((s64)strlen(line), line));
+        if (str.length == 0 || str.data[0] == '#') {
+            continue;
+        }
+
+        String frame = str_get_until_space(str);
+        if (!str_is_int(frame)) {
+            LOG_ERROR("Line %u of harness script '%s' doesn't start with frame number.", number, script_path);
+            result = false;
+            break;
+        }
+
+        String command = str_eat_spaces(str_eat_chars(str, frame.length));
+        Harness_Script_Line script_line = {
+            .frame   = (s32)str_parse_int(frame),
+            .command = STR(command.length, allocator_alloc(&std_allocator, command.length)),
+        };
+        memcpy(script_line.command.data, command.data, command.length);
+
+        array_list_append(&script_lines, script_line);
+    }
+
+    (void)fclose(file);
+    return result;
+}
+
+static void harness_free_script() {
+    if (script_lines == NULL) {
+        return;
+    }
+
+    for (u32 i = 0; i < array_list_length(&script_lines); i++) {
+        allocator_free(&std_allocator, script_lines[i].command.data);
+    }
+    array_list_free(&script_lines);
+}
+
+/**
+ * Writes RGBA pixels read from OpenGL as binary PPM, rows are flipped, since they are read bottom to top and image goes top to bottom.
+ */
+static bool harness_write_ppm(char *path, u8 *pixels, s32 width, s32 height) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        LOG_ERROR("Couldn't open image '%s' for writing.", path);
+        return false;
+    }
+
+    (void)fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+    u8 *row = malloc(width * 3);
+    for (s32 y = height - 1; y >= 0; y--) {
+        for (s32 x = 0; x < width; x++) {
+            memcpy(row + x * 3, pixels + (y * width + x) * 4, 3);
+        }
+        (void)fwrite(row, 1, width * 3, file);
+    }
+    free(row);
+
+    (void)fclose(file);
+    return true;
+}
+
+/**
+ * Compares captured frame with its golden image, writing golden image if golden images are updated.
+ * Returns false if they don't match or golden image is missing, captured frame is written next to the golden image then.
+ */
+static bool harness_compare(Harness_Options *options, s32 frame, u8 *pixels, s32 width, s32 height) {
+    char path[512];
+    (void)snprintf(path, sizeof(path), "%s/frame_%d.ppm", options->golden_dir, frame);
+
+    if (options->update_golden) {
+        printf("frame %d: golden image '%s' is updated.\n", frame, path);
+        return harness_write_ppm(path, pixels, width, height);
+    }
+
+    // Images are flipped on load by stbi, so their rows go bottom to top, same as the captured ones.
+    s32 golden_width, golden_height, channels;
+    u8 *golden = stbi_load(path, &golden_width, &golden_height, &channels, 4);
+    bool matches;
+    if (golden == NULL) {
+        printf("frame %d: golden image '%s' is MISSING, it is written with '--update-golden'.\n", frame, path);
+        matches = false;
+    } else if (golden_width != width || golden_height != height) {
+        printf("frame %d: golden image is %dx%d, captured frame is %dx%d, MISMATCH.\n", frame, golden_width, golden_height, width, height);
+        matches = false;
+    } else {
+        u64 different = 0;
+        for (s64 i = 0; i < (s64)width * height; i++) {
+            for (u32 c = 0; c < 3; c++) {
+                if (abs((s32)pixels[i * 4 + c] - (s32)golden[i * 4 + c]) > HARNESS_CHANNEL_THRESHOLD) {
+                    different++;
+                    break;
+                }
+            }
+        }
+
+        float fraction = (float)different / (float)((s64)width * height);
+        matches = fraction <= options->tolerance;
+        printf("frame %d: %llu of %d pixels differ (%.4f%%), %s.\n", frame, (unsigned long long)different, width * height, fraction * 100.0f, matches ? "matches" : "MISMATCH");
+    }
+
+    stbi_image_free(golden);
+
+    if (!matches) {
+        (void)snprintf(path, sizeof(path), "%s/frame_%d.actual.ppm", options->golden_dir, frame);
+        (void)harness_write_ppm(path, pixels, width, height);
+    }
+
+    return matches;
+}
+
+static int harness_compare_times(const void *a, const void *b) {
+    float time_a = *(float *)a;
+    float time_b = *(float *)b;
+    return (time_a > time_b) - (time_a < time_b);
+}
+
+static void harness_report_times(char *name, float *times) {
+    u32 count = array_list_length(&times);
+    if (count == 0) {
+        printf("%s frame time: no samples.\n", name);
+        return;
+    }
+
+    qsort(times, count, sizeof(float), harness_compare_times);
+
+    float total = 0.0f;
+    for (u32 i = 0; i < count; i++) {
+        total += times[i];
+    }
+
+    printf("%s frame time ms: avg %.3f, median %.3f, p95 %.3f, max %.3f, %u frames.\n", name, total / count, times[count / 2], times[count * 95 / 100], times[count - 1], count);
+}
+
+s32 harness_run(State *state, Harness_Options *options) {
+    if (options->script_path != NULL && !harness_load_script(options->script_path)) {
+        harness_free_script();
+        return 1;
+    }
+
+    s32 width  = state->window.width;
+    s32 height = state->window.height;
+    u8 *pixels = malloc(width * height * 4);
+
+    float *cpu_times = array_list_make(float, options->frames, &std_allocator);
+    float *gpu_times = array_list_make(float, options->frames, &std_allocator);
+    u32 gpu_measured = 0;
+
+    u64 frequency = SDL_GetPerformanceFrequency();
+    u32 next_line = 0;
+    s32 mismatches = 0;
+
+    for (s32 frame = 0; frame < options->frames && !state->events.should_quit; frame++) {
+        while (script_lines != NULL && next_line < array_list_length(&script_lines) && script_lines[next_line].frame <= frame) {
+            command_run(script_lines[next_line].command);
+            next_line++;
+        }
+
+        // Time step is fixed, so the scene doesn't depend on how fast frames are rendered.
+        state->t.current_time = frame * state->t.update_step_time;
+        state->t.delta_time_milliseconds = (u32)((float)state->t.update_step_time * state->t.delta_time_multi);
+        state->t.delta_time = (float)state->t.delta_time_milliseconds / 1000.0f;
+
+        u64 start = SDL_GetPerformanceCounter();
+        game_update();
+        array_list_append(&cpu_times, (float)(SDL_GetPerformanceCounter() - start) * 1000.0f / (float)frequency);
+
+        u32 measured;
+        float gpu_time = graphics_gpu_frame_time(&measured);
+        if (measured != gpu_measured) {
+            gpu_measured = measured;
+            array_list_append(&gpu_times, gpu_time);
+        }
+
+        for (u32 i = 0; i < array_list_length(&options->capture_frames); i++) {
+            if (options->capture_frames[i] != frame) {
+                continue;
+            }
+
+            if (!graphics_read_pixels(0, 0, width, height, pixels) || !harness_compare(options, frame, pixels, width, height)) {
+                mismatches++;
+            }
+            break;
+        }
+    }
+
+    harness_report_times("CPU", cpu_times);
+    harness_report_times("GPU", gpu_times);
+    if (array_list_length(&options->capture_frames) > 0) {
+        printf("%d of %u captured frames don't match golden images.\n", mismatches, array_list_length(&options->capture_frames));
+    }
+
+    array_list_free(&cpu_times);
+    array_list_free(&gpu_times);
+    free(pixels);
+    harness_free_script();
+
+    return mismatches > 0 ? 1 : 0;
+}
+
+
+
+typedef void (*Harness_Workload)(State *state, s32 frame);
+
+static Font_Baked *benchmark_font;
+
+static void harness_workload_rects(State *state, s32 frame) {
+    Matrix4f projection = camera_calculate_projection(&state->main_camera, state->window.width, state->window.height);
+    shader_update_projection(state->quad_drawer.program, &projection);
+    render_layer_set(RENDER_LAYER_WORLD);
+
+    draw_begin(&state->quad_drawer);
+
+    for (s32 i = 0; i < HARNESS_BENCHMARK_RECTS; i++) {
+        Vec2f p0 = vec2f_make((float)(i % 100) * 0.2f - 10.0f, (float)(i / 100) * 0.1f - 5.0f);
+        Vec2f p1 = vec2f_sum(p0, vec2f_make(0.15f, 0.08f));
+        draw_rect(p0, p1, .color = vec4f_make((float)(i % 7) / 7.0f, (float)(i % 11) / 11.0f, 0.5f, 1.0f), .offset_angle = (float)frame * 0.01f);
+    }
+
+    draw_end();
+}
+
+static void harness_workload_text(State *state, s32 frame) {
+    Matrix4f projection = screen_calculate_projection(state->window.width, state->window.height);
+    shader_update_projection(state->quad_drawer.program, &projection);
+    render_layer_set(RENDER_LAYER_UI);
+
+    draw_begin(&state->quad_drawer);
+
+    String line = CSTR("The quick brown fox jumps over the lazy dog, 0123456789 times a frame. (){}[]<>;:!?");
+    for (s32 i = 0; i < HARNESS_BENCHMARK_LINES; i++) {
+        draw_text(line, vec2f_make(8.0f, (float)i * benchmark_font->line_height), benchmark_font, .color = VEC4F_WHITE);
+    }
+
+    draw_end();
+}
+
+static void harness_workload_imui(State *state, s32 frame) {
+    Matrix4f projection = screen_calculate_projection(state->window.width, state->window.height);
+    shader_update_projection(state->ui_quad_drawer.program, &projection);
+    render_layer_set(RENDER_LAYER_UI);
+
+    draw_begin(&state->ui_quad_drawer);
+
+    ui_set_font(benchmark_font);
+
+    static s32 value;
+    UI_WINDOW(0, 0, state->window.width, state->window.height,
+        for (s32 i = 0; i < HARNESS_BENCHMARK_WIDGETS; i++) {
+            ui_set_prefix(i);
+            (void)ui_button(vec2f_make(120.0f, 24.0f), CSTR("Button"), 0);
+            ui_sameline();
+            (void)ui_slider_int(vec2f_make(160.0f, 24.0f), &value, 0, 100, 1);
+            ui_sameline();
+            ui_text(CSTR("Label of the widget row"));
+        }
+    );
+
+    draw_end();
+}
+
+static void harness_workload_level(State *state, s32 frame) {
+    level_draw();
+}
+
+typedef struct harness_recorder {
+    Command_List    list;
+    State           *state;
+    s32             frame;
+    bool            console;        // Records console, otherwise immediate ui.
+    SDL_Thread      *thread;        // NULL if it couldn't be started, list is recorded on the update thread then.
+    bool            pending;        // Set when the frame should be recorded, cleared by the recorder once it is.
+} Harness_Recorder;
+
+static Harness_Recorder benchmark_recorders[2];
+
+// Recorder threads live for the whole benchmark, so starting them isn't timed and each keeps its glyph run cache between frames.
+// Pending flags and quit are guarded by the mutex.
+static SDL_mutex    *recorder_mutex;
+static SDL_cond     *recorder_work_cond;   // Signaled when frame should be recorded or recorders should quit.
+static SDL_cond     *recorder_done_cond;   // Signaled when recorder finishes its list.
+static bool         recorder_quit;
+
+static void harness_record(Harness_Recorder *recorder) {
+    command_list_begin(&recorder->list);
+    if (recorder->console) {
+        console_draw();
+    } else {
+        harness_workload_imui(recorder->state, recorder->frame);
+    }
+    command_list_end();
+}
+
+static int harness_recorder_main(void *data) {
+    Harness_Recorder *recorder = data;
+
+    SDL_LockMutex(recorder_mutex);
+
+    while (true) {
+        while (!recorder_quit && !recorder->pending) {
+            SDL_CondWait(recorder_work_cond, recorder_mutex);
+        }
+
+        if (recorder_quit) {
+            break;
+        }
+
+        SDL_UnlockMutex(recorder_mutex);
+
+        harness_record(recorder);
+
+        SDL_LockMutex(recorder_mutex);
+
+        recorder->pending = false;
+        SDL_CondBroadcast(recorder_done_cond);
+    }
+
+    SDL_UnlockMutex(recorder_mutex);
+
+    glyph_run_cache_free();
+
+    return 0;
+}
+
+static void harness_recorders_start() {
+    recorder_mutex     = SDL_CreateMutex();
+    recorder_work_cond = SDL_CreateCond();
+    recorder_done_cond = SDL_CreateCond();
+    recorder_quit      = false;
+
+    for (u32 i = 0; i < 2; i++) {
+        benchmark_recorders[i].list    = command_list_make();
+        benchmark_recorders[i].console = i == 0;
+        benchmark_recorders[i].pending = false;
+        benchmark_recorders[i].thread  = SDL_CreateThread(harness_recorder_main, "recorder", &benchmark_recorders[i]);
+        if (benchmark_recorders[i].thread == NULL) {
+            LOG_WARNING("Couldn't create recorder thread, its list is recorded on the update thread. SDL_Error: %s.", SDL_GetError());
+        }
+    }
+}
+
+static void harness_recorders_stop() {
+    SDL_LockMutex(recorder_mutex);
+    recorder_quit = true;
+    SDL_CondBroadcast(recorder_work_cond);
+    SDL_UnlockMutex(recorder_mutex);
+
+    for (u32 i = 0; i < 2; i++) {
+        if (benchmark_recorders[i].thread != NULL) {
+            SDL_WaitThread(benchmark_recorders[i].thread, NULL);
+            benchmark_recorders[i].thread = NULL;
+        }
+        command_list_free(&benchmark_recorders[i].list);
+    }
+
+    SDL_DestroyCond(recorder_done_cond);
+    SDL_DestroyCond(recorder_work_cond);
+    SDL_DestroyMutex(recorder_mutex);
+}
+
+/**
+ * Records console and immediate ui text into command lists on two threads at once, and submits them in the same order every frame.
+ * List is recorded on the update thread instead, if its thread couldn't be started.
+ */
+static void harness_workload_command_lists(State *state, s32 frame) {
+    SDL_LockMutex(recorder_mutex);
+    for (u32 i = 0; i < 2; i++) {
+        benchmark_recorders[i].state   = state;
+        benchmark_recorders[i].frame   = frame;
+        benchmark_recorders[i].pending = benchmark_recorders[i].thread != NULL;
+    }
+    SDL_CondBroadcast(recorder_work_cond);
+    SDL_UnlockMutex(recorder_mutex);
+
+    for (u32 i = 0; i < 2; i++) {
+        if (benchmark_recorders[i].thread == NULL) {
+            harness_record(&benchmark_recorders[i]);
+        }
+    }
+
+    SDL_LockMutex(recorder_mutex);
+    while (benchmark_recorders[0].pending || benchmark_recorders[1].pending) {
+        SDL_CondWait(recorder_done_cond, recorder_mutex);
+    }
+    SDL_UnlockMutex(recorder_mutex);
+
+    for (u32 i = 0; i < 2; i++) {
+        command_list_submit(&benchmark_recorders[i].list);
+    }
+}
+
+static void harness_report_stats(Gpu_Stats stats, s32 frames) {
+    printf("per frame: %.1f draw calls, %.1f KB uploaded, %.1f state changes.\n",
+            (double)stats.draw_calls / frames, (double)stats.bytes_uploaded / 1024.0 / frames, (double)stats.state_changes / frames);
+}
+
+s32 harness_benchmark(State *state, Harness_Options *options) {
+    if (!gpu->null) {
+        LOG_ERROR("Benchmark should be run with null GPU backend.");
+        return 1;
+    }
+
+    benchmark_font = resource_font_get("res/font/Consolas-Regular.ttf", 16.0f);
+    if (benchmark_font == NULL) {
+        LOG_ERROR("Couldn't read font for the benchmark.");
+        return 1;
+    }
+
+    level_load(CSTR(HARNESS_BENCHMARK_LEVEL));
+
+    struct {
+        char                *name;
+        Harness_Workload    workload;
+    } workloads[] = {
+        { "draw_rect",  harness_workload_rects },
+        { "draw_text",  harness_workload_text },
+        { "imui",       harness_workload_imui },
+        { "level_draw", harness_workload_level },
+        { "command_lists", harness_workload_command_lists },
+    };
+
+    harness_recorders_start();
+
+    s32 frames = options->frames > 0 ? options->frames : HARNESS_BENCHMARK_FRAMES;
+    float *times = array_list_make(float, frames, &std_allocator);
+    u64 frequency = SDL_GetPerformanceFrequency();
+
+    for (u32 w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        array_list_clear(&times);
+        gpu_stats_reset();
+
+        for (s32 frame = 0; frame < frames; frame++) {
+            u64 start = SDL_GetPerformanceCounter();
+
+            graphics_clear();
+            workloads[w].workload(state, frame);
+            graphics_frame_end(state->window.ptr);
+
+            array_list_append(&times, (float)(SDL_GetPerformanceCounter() - start) * 1000.0f / (float)frequency);
+        }
+
+        harness_report_times(workloads[w].name, times);
+        harness_report_stats(gpu_stats_get(), frames);
+    }
+
+    array_list_free(&times);
+    harness_recorders_stop();
+    resource_release(benchmark_font);
+
+    return 0;
+}
+
+
+
+#define HARNESS_TEST_DIRECTORY      "cache"
+// Updates waited for the texture stream to upload test image.
+#define HARNESS_TEST_STREAM_UPDATES 1000
+
+typedef bool (*Harness_Test)(State *state);
+
+/**
+ * Writes image of the size with some pattern in it, for the texture stream to load.
+ */
+static bool harness_test_image(char *path, s32 width, s32 height) {
+    u8 *pixels = malloc(width * height * 4);
+    for (s32 i = 0; i < width * height; i++) {
+        pixels[i * 4 + 0] = (u8)(i * 37);
+        pixels[i * 4 + 1] = (u8)(i * 11);
+        pixels[i * 4 + 2] = (u8)(i * 5);
+        pixels[i * 4 + 3] = 255;
+    }
+
+    bool result = harness_write_ppm(path, pixels, width, height);
+    free(pixels);
+    return result;
+}
+
+/**
+ * Updates the texture stream until the texture is uploaded, frames aren't submitted meanwhile, so no other objects are made.
+ */
+static bool harness_test_stream_wait(Texture *texture) {
+    for (u32 i = 0; i < HARNESS_TEST_STREAM_UPDATES && !texture_stream_ready(texture); i++) {
+        texture_stream_update();
+        SDL_Delay(1);
+    }
+    return texture_stream_ready(texture);
+}
+
+/**
+ * Texture deleted while it is still bound is unbound by OpenGL, and its name can be handed out again to the next texture.
+ * Texture the stream allocates under the recycled name should still be bound before its storage is allocated, otherwise storage goes into whatever is bound.
+ */
+static bool harness_test_texture_recycling(State *state) {
+    char *first_path  = HARNESS_TEST_DIRECTORY"/harness_test_first.ppm";
+    char *second_path = HARNESS_TEST_DIRECTORY"/harness_test_second.ppm";
+    if (!make_directory(HARNESS_TEST_DIRECTORY) || !harness_test_image(first_path, 4, 2) || !harness_test_image(second_path, 8, 3)) {
+        printf("couldn't write test images into '%s'.\n", HARNESS_TEST_DIRECTORY);
+        return false;
+    }
+
+    bool result = false;
+
+    Texture *first = texture_stream_load(first_path);
+    if (!harness_test_stream_wait(first)) {
+        printf("first texture wasn't uploaded.\n");
+        texture_stream_unload(first_path);
+        goto end;
+    }
+    u32 first_id = first->id;
+
+    // Drawing with the texture leaves it bound to the first unit.
+    Matrix4f projection = screen_calculate_projection(state->window.width, state->window.height);
+    shader_update_projection(state->quad_drawer.program, &projection);
+    render_layer_set(RENDER_LAYER_UI);
+
+    draw_begin(&state->quad_drawer);
+    draw_rect(VEC2F_ORIGIN, vec2f_make(16.0f, 16.0f), .color = VEC4F_WHITE, .texture = first);
+    draw_end();
+    graphics_frame_end(state->window.ptr);
+
+    texture_stream_unload(first_path);
+    for (u32 i = 0; i < TEXTURE_STREAM_RETIRE_FRAMES; i++) {
+        texture_stream_update();
+    }
+
+    Texture *second = texture_stream_load(second_path);
+    if (!harness_test_stream_wait(second)) {
+        printf("second texture wasn't uploaded.\n");
+        texture_stream_unload(second_path);
+        goto end;
+    }
+
+    s32 width, height;
+    gpu_null_texture_size(second->id, &width, &height);
+
+    if (second->id != first_id) {
+        printf("name %u of the deleted texture wasn't handed out again, second texture is %u.\n", first_id, second->id);
+    } else if (width != 8 || height != 3) {
+        printf("texture %u has %dx%d storage instead of 8x3, it wasn't bound when its storage was allocated.\n", second->id, width, height);
+    } else {
+        result = true;
+    }
+
+    texture_stream_unload(second_path);
+
+end:
+    (void)remove(first_path);
+    (void)remove(second_path);
+    return result;
+}
+
+/**
+ * Bvh read from the level file is traversed as it is, so the one that loops or references polygons out of bounds should be dropped when image is read.
+ */
+static bool harness_test_level_bvh_check(State *state) {
+    Phys_Edge edges[16 * 4];
+    Phys_Polygon polygons[16];
+    for (u32 i = 0; i < 16; i++) {
+        Vec2f origin = vec2f_make((float)(i % 4) * 2.0f, (float)(i / 4) * 2.0f);
+        for (u32 j = 0; j < 4; j++) {
+            edges[i * 4 + j] = (Phys_Edge) { .vertex = vec2f_make(origin.x + (j == 1 || j == 2), origin.y + (j >= 2)), .normal = VEC2F_ORIGIN };
+        }
+        polygons[i] = (Phys_Polygon) { .edges_count = 4, .edges = edges + i * 4 };
+    }
+
+    Level_Build_Info info = { .polygons = polygons, .polygons_count = 16, .build_bvh = true };
+
+    u64 size;
+    u8 *data = level_image_build(&info, &size);
+    if (data == NULL) {
+        printf("level image wasn't built.\n");
+        return false;
+    }
+
+    bool result = false;
+
+    Level_Image image;
+    if (!level_image_from_memory(data, size, &image) || !(image.flags & LEVEL_FILE_HAS_BVH) || image.bvh_nodes[0].count != 0) {
+        printf("built level image doesn't have a valid bvh with the inner root.\n");
+        goto end;
+    }
+
+    Level_BVH_Node *root = image.bvh_nodes;
+    u32 first = root->first;
+
+    // Root that points back to itself.
+    root->first = 0;
+    if (!level_image_from_memory(data, size, &image) || (image.flags & LEVEL_FILE_HAS_BVH)) {
+        printf("bvh with the looping node wasn't dropped.\n");
+        goto end;
+    }
+    root->first = first;
+
+    // Leaf that references more polygons than there are.
+    u32 leaf = 0;
+    while (root[leaf].count == 0) {
+        leaf = root[leaf].first;
+    }
+    root[leaf].count = 17;
+    if (!level_image_from_memory(data, size, &image) || (image.flags & LEVEL_FILE_HAS_BVH)) {
+        printf("bvh with the leaf out of bounds wasn't dropped.\n");
+        goto end;
+    }
+
+    result = true;
+
+end:
+    free(data);
+    return result;
+}
+
+s32 harness_test(State *state, Harness_Options *options) {
+    if (!gpu->null) {
+        LOG_ERROR("Tests should be run with null GPU backend.");
+        return 1;
+    }
+
+    struct {
+        char            *name;
+        Harness_Test    test;
+    } tests[] = {
+        { "texture_recycling", harness_test_texture_recycling },
+        { "level_bvh_check",   harness_test_level_bvh_check },
+    };
+
+    u32 count = sizeof(tests) / sizeof(tests[0]);
+    u32 failed = 0;
+
+    for (u32 i = 0; i < count; i++) {
+        bool passed = tests[i].test(state);
+        printf("test %s: %s.\n", tests[i].name, passed ? "passed" : "FAILED");
+        failed += !passed;
+    }
+
+    printf("%u of %u tests failed.\n", failed, count);
+    return failed > 0 ? 1 : 0;
+}
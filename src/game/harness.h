@@ -0,0 +1,80 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include "core/core.h"
+#include "core/type.h"
+
+#include "game/game.h"
+
+/**
+ * Rendering harness.
+ *
+ * Plays scripted scene for a fixed number of frames with fixed time step, so every run of the same script draws the same frames,
+ * reports CPU and GPU frame times, and compares selected frames against golden images.
+ * Meant to be run headless on build servers, as rendering performance and regression test:
+ *      main --headless --frames 600 --script res/harness/scene.txt --golden res/harness/golden --capture 60,300
+ * Script is a text file, every line is "<frame> <console command>", lines go in frame order, empty lines and lines starting with '#' are skipped.
+ * Commands of the frame are run through the console command handler before the frame is updated.
+ * Golden images are binary PPM files named "frame_<frame>.ppm", missing golden image is a mismatch, they are only written with "--update-golden",
+ * for mismatching and missing ones captured frame is written next to them as "frame_<frame>.actual.ppm".
+ *
+ * Benchmark runs with the null GPU backend, so it needs no GPU and measures only CPU side of rendering:
+ *      main --benchmark --frames 300
+ * Each workload (rects, text, immediate ui, level, and console with immediate ui recorded into command lists on two threads) is drawn and submitted for the number of frames,
+ * CPU frame times are reported along with draw calls, uploaded bytes and state changes per frame counted by the null backend.
+ *
+ * Tests run with the null GPU backend too, they check what graphics hand to the backend, like which texture storage is allocated for:
+ *      main --test
+ */
+
+// Channel difference up to which pixels are still treated as the same.
+#define HARNESS_CHANNEL_THRESHOLD   2
+// Fraction of different pixels up to which frame still matches the golden image.
+#define HARNESS_DEFAULT_TOLERANCE   0.001f
+
+// Frames every benchmark workload is drawn for, if number of frames isn't specified.
+#define HARNESS_BENCHMARK_FRAMES    300
+#define HARNESS_BENCHMARK_RECTS     10000
+#define HARNESS_BENCHMARK_LINES     60
+#define HARNESS_BENCHMARK_WIDGETS   200
+#define HARNESS_BENCHMARK_LEVEL     "demo_1"
+
+typedef struct harness_options {
+    bool    headless;
+    s32     frames;                 // Number of frames to play, harness isn't run if it is 0.
+    char    *script_path;
+    char    *golden_dir;
+    s32     *capture_frames;        // Frames compared against golden images.
+    float   tolerance;
+    bool    update_golden;          // Golden images are overwritten instead of compared.
+    bool    benchmark;              // Rendering workloads are benchmarked with null GPU backend instead.
+    bool    test;                   // Graphics tests are run with null GPU backend instead.
+} Harness_Options;
+
+
+/**
+ * Parses command line arguments into options, unknown arguments are reported and ignored.
+ * Returns false if arguments are malformed.
+ */
+bool harness_parse_args(s32 argc, char **argv, Harness_Options *options);
+
+/**
+ * Plays the scene for specified number of frames, should be called after "game_init()" instead of the regular frame loop.
+ * Returns process exit code, which is 0 if every captured frame matches its golden image.
+ */
+s32 harness_run(State *state, Harness_Options *options);
+
+/**
+ * Draws and submits every benchmark workload for specified number of frames and reports how long it took,
+ * should be called after "game_init()" with the null backend selected before it.
+ */
+s32 harness_benchmark(State *state, Harness_Options *options);
+
+/**
+ * Runs every graphics test and reports which of them failed, should be called after "game_init()" with the null backend selected before it.
+ * Returns process exit code, which is 0 if every test passed.
+ */
+s32 harness_test(State *state, Harness_Options *options);
+
+
+#endif
@@ -166,11 +166,15 @@ void ui_draw_rect(Vec2f position, Vec2f size, Vec4f color) {
     Vec2f p0 = position;
     Vec2f p1 = vec2f_sum(position, size);
 
-    float quad_data[48] = {
-        p0.x, p0.y, 0.0f, color.x, color.y, color.z, color.w, 0.0f, 0.0f, size.x, size.y, -1.0f,
-        p1.x, p0.y, 0.0f, color.x, color.y, color.z, color.w, 1.0f, 0.0f, size.x, size.y, -1.0f,
-        p0.x, p1.y, 0.0f, color.x, color.y, color.z, color.w, 0.0f, 1.0f, size.x, size.y, -1.0f,
-        p1.x, p1.y, 0.0f, color.x, color.y, color.z, color.w, 1.0f, 1.0f, size.x, size.y, -1.0f,
+    u32 packed = pack_color(color);
+    u16 size_x = pack_half(size.x);
+    u16 size_y = pack_half(size.y);
+
+    UI_Quad_Vertex quad_data[4] = {
+        { p0,                       packed, { 0,      0      }, { size_x, size_y }, -1, 0 },
+        { vec2f_make(p1.x, p0.y),   packed, { 0xffff, 0      }, { size_x, size_y }, -1, 0 },
+        { vec2f_make(p0.x, p1.y),   packed, { 0,      0xffff }, { size_x, size_y }, -1, 0 },
+        { p1,                       packed, { 0xffff, 0xffff }, { size_x, size_y }, -1, 0 },
     };
     
     draw_quad_data(quad_data, 1);
@@ -191,54 +195,41 @@ bool ui_is_hover(Vec2f size) {
 }
 
 void ui_draw_text(String text, Vec2f position, Vec4f color) {
-    // Scale and adjust current_point.
-    Vec2f current_point = position;
-    Font_Baked *font = ui->font;
-    float origin_x = current_point.x;
-    current_point.y += (float)font->baseline;
-
-    // Text rendering variables.
-    s32 font_char_index;
-    u16 width, height;
-    stbtt_bakedchar *c;
-
-    for (u64 i = 0; i < text.length; i++) {
-        if (text.data[i] == '\n') {
-            current_point.x = origin_x;
-            current_point.y -= (float)font->line_height;
-            continue;
+    Glyph_Run *run = glyph_run_get(text, ui->font);
+    if (run->glyphs_count == 0)
+        return;
+
+    s16 mask_slot = (s16)add_texture_to_slots(&ui->font->bitmap);
+    if (ui->font->sdf && mask_slot != -1)
+        mask_slot += SDF_MASK_SLOT_OFFSET;
+    u32 packed = pack_color(color);
+    u16 one = pack_half(1.0f);
+
+    // Laid out run is translated to the position and put into the vertex stream in chunks.
+    UI_Quad_Vertex quad_data[64 * 4];
+    u32 count = 0;
+
+    for (u32 i = 0; i < run->glyphs_count; i++) {
+        Glyph_Quad *g = &run->glyphs[i];
+        Vec2f p0 = vec2f_sum(position, g->p0);
+        Vec2f p1 = vec2f_sum(position, g->p1);
+        u16 u0 = pack_unorm16(g->uv0.x), v0 = pack_unorm16(g->uv0.y);
+        u16 u1 = pack_unorm16(g->uv1.x), v1 = pack_unorm16(g->uv1.y);
+
+        UI_Quad_Vertex *q = &quad_data[count * 4];
+        q[0] = (UI_Quad_Vertex) { p0,                       packed, { u0, v0 }, { one, one }, mask_slot, 0 };
+        q[1] = (UI_Quad_Vertex) { vec2f_make(p1.x, p0.y),   packed, { u1, v0 }, { one, one }, mask_slot, 0 };
+        q[2] = (UI_Quad_Vertex) { vec2f_make(p0.x, p1.y),   packed, { u0, v1 }, { one, one }, mask_slot, 0 };
+        q[3] = (UI_Quad_Vertex) { p1,                       packed, { u1, v1 }, { one, one }, mask_slot, 0 };
+
+        if (++count == 64) {
+            draw_quad_data(quad_data, count);
+            count = 0;
         }
-
-        // Character drawing.
-        font_char_index = (s32)text.data[i] - font->first_char_code;
-        if (font_char_index < font->chars_count) {
-            c = &font->chars[font_char_index];
-            width  = font->chars[font_char_index].x1 - font->chars[font_char_index].x0;
-            height = font->chars[font_char_index].y1 - font->chars[font_char_index].y0;
-
-
-            Vec2f p0 = vec2f_make(current_point.x + c->xoff, current_point.y - c->yoff - height);
-            Vec2f p1 = vec2f_make(current_point.x + c->xoff + width, current_point.y - c->yoff);
-
-            Vec2f uv0 = vec2f_make(c->x0 / (float)font->bitmap.width, c->y1 / (float)font->bitmap.height);
-            Vec2f uv1 = vec2f_make(c->x1 / (float)font->bitmap.width, c->y0 / (float)font->bitmap.height);
-
-            float mask_slot = add_texture_to_slots(&font->bitmap);              
-
-            float quad_data[48] = {
-                p0.x, p0.y, 0.0f, color.x, color.y, color.z, color.w, uv0.x, uv0.y, 1.0f, 1.0f, mask_slot,
-                p1.x, p0.y, 0.0f, color.x, color.y, color.z, color.w, uv1.x, uv0.y, 1.0f, 1.0f, mask_slot,
-                p0.x, p1.y, 0.0f, color.x, color.y, color.z, color.w, uv0.x, uv1.y, 1.0f, 1.0f, mask_slot,
-                p1.x, p1.y, 0.0f, color.x, color.y, color.z, color.w, uv1.x, uv1.y, 1.0f, 1.0f, mask_slot,
-            };
-
-            draw_quad_data(quad_data, 1);
-
-
-            current_point.x += font->chars[font_char_index].xadvance;
-        }
-
     }
+
+    if (count > 0)
+        draw_quad_data(quad_data, count);
 }
 
 void ui_draw_text_centered(String text, Vec2f position, Vec2f size, Vec4f color) {
@@ -71,3 +71,13 @@ bool repeat(SDL_KeyCode key, float dt_milliseconds) {
 }
 
 
+
+bool hold_any() {
+    for (u32 i = 0; i < keyboard_number_of_keys; i++) {
+        if (keyboard_state_current[i] == 1) {
+            return true;
+        }
+    }
+
+    return false;
+}
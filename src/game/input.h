@@ -47,6 +47,11 @@ bool unpressed(SDL_KeyCode key);
  */
 bool repeat(SDL_KeyCode key, float dt_milliseconds);
 
+/**
+ * Returns true if any key is currently held.
+ */
+bool hold_any();
+
 
 
 
@@ -8,18 +8,25 @@
 #include "game/console.h"
 #include "game/physics.h"
 #include "game/vars.h"
+#include "game/level_format.h"
+#include "game/level_stream.h"
+#include "game/level_cache.h"
+#include "game/resource.h"
 
 #include "core/mathf.h"
 #include "core/structs.h"
 #include "core/arena.h"
 #include "core/str.h"
 #include "core/file.h"
+#include "core/compress.h"
 
-#define MAX_ENTITIES 16
+#define MAX_ENTITIES 256
 #define LEVEL_ARENA_SIZE 1024
 
-static Font_Baked font_small;
-static Font_Baked font_medium;
+// World units the camera view is extended by when culling what is drawn.
+#define LEVEL_CULL_MARGIN 0.5f
+
+static Font_Baked *font_small;
 static Arena arena;
 static String info_buffer;
 static Entity **entities_free_addresses;
@@ -27,6 +34,49 @@ static Entity *entities_allocation;
 static Phys_Edge *edges_allocation;
 static Phys_Polygon *polygon_list;
 
+// Polygon list is made of ranges, polygons of the level image come first, followed by polygons of every resident chunk.
+// Every range has its own bvh, so a chunk coming in or going out only builds or frees its own one, only polygons that are in view are drawn.
+typedef struct level_polygon_range {
+    Level_Chunk     *chunk;             // NULL for the range of the level image.
+    u32             first;              // Index of the first polygon of the range in the polygon list.
+    u32             count;
+    Level_BVH_Node  *bvh_nodes;
+    u32             *bvh_polygons;      // Indicies relative to the first polygon of the range.
+    u32             lines_offset;       // Bytes of the geometry lines buffer edges and normals of the range were baked into.
+    u32             lines_bytes;
+} Level_Polygon_Range;
+
+static Level_Polygon_Range *polygon_ranges;
+static AABB *polygon_bounds;                // Parallel to the polygon list.
+static u32 *bvh_stack;
+static u32 *visible_polygons;               // Filled every frame by "level_query_visible_polygons()".
+static u32 visible_entities_count;
+
+// Static geometry baked into retained buffers, so it isn't rebuilt every frame, only visible ranges of it are drawn.
+typedef struct level_baked_entity {
+    OBB     box;
+    Vec4f   color;
+    bool    baked;
+} Level_Baked_Entity;
+
+typedef struct level_line_range {
+    u32 offset;
+    u32 bytes;
+} Level_Line_Range;
+
+// Every polygon range is baked into its own part of the geometry lines buffer, which is given back once the range is removed.
+// Buffer data is mirrored, so it is uploaded whole only when it has to grow, otherwise only the part of the new range is updated.
+static Retained_Buffer geometry_lines;                  // Edges and normals of the polygon list, each polygon takes contiguous range.
+static Vertex_Buffer geometry_lines_data;               // Copy of the whole buffer data, free parts included.
+static Level_Line_Range *geometry_lines_free;           // Free parts of the buffer, sorted by offset, neighbouring ones are merged.
+static Level_Line_Range *polygon_lines;                 // Part of the buffer of every polygon, parallel to the polygon list.
+static Retained_Buffer static_entity_quads;             // Quad of every static entity, at its index in the entities array.
+static Level_Baked_Entity baked_entities[MAX_ENTITIES]; // What quads in the buffer were baked from, ranges are updated once entities change.
+static Vertex_Buffer bake_buffer;
+
+// Simulation level of detail.
+static u64 sim_frame;
+
 
 // Player controller related.
 static Entity *player;
@@ -41,6 +91,15 @@ static State *state;
 @Introspect;
 typedef struct level_params {
     float camera_zoom;
+
+    float stream_load_radius;
+    float stream_evict_radius;
+    float stream_budget_ms;
+
+    s64 cache_budget_kb;
+
+    s64 sim_lod_interval;
+    float sim_lod_margin;
 } Level_Params;
 
 static Level_Params level_params;
@@ -50,6 +109,12 @@ static Level_Params level_params;
 void level_manager_init(State *s) {
     // Tweak vars default values.
     level_params.camera_zoom = 1.0f;
+    level_params.stream_load_radius  = 48.0f;
+    level_params.stream_evict_radius = 64.0f;
+    level_params.stream_budget_ms    = 1.0f;
+    level_params.cache_budget_kb     = 8192;
+    level_params.sim_lod_interval    = 0;
+    level_params.sim_lod_margin      = 16.0f;
     
     vars_tree_add(TYPE_OF(level_params), (u8 *)&level_params, CSTR("level_params"));
 
@@ -57,18 +122,9 @@ void level_manager_init(State *s) {
     // Intializing other stuff.
 
     state = s;
-    //
-    // @Copypasta: From editor.c, from console.c ...
-    // Get resources.
 
-    // Load needed font... Hard coded...
-    u8* font_data = read_file_into_buffer("res/font/Consolas-Regular.ttf", NULL, &std_allocator);
-
-    font_small  = font_bake(font_data, 14.0f);
-    font_medium = font_bake(font_data, 20.0f);
-
-    free(font_data);
-    
+    // Get resources, shared with console and editor through resource registry.
+    font_small = resource_font_get("res/font/Consolas-Regular.ttf", 14.0f);
 
 
     // Make arena and allocate space for the buffers.
@@ -84,159 +140,605 @@ void level_manager_init(State *s) {
     edges_allocation = NULL;
     polygon_list = array_list_make(Phys_Polygon, 8, &std_allocator);
 
+    polygon_ranges   = array_list_make(Level_Polygon_Range, 8, &std_allocator);
+    polygon_bounds   = array_list_make(AABB, 8, &std_allocator);
+    bvh_stack        = array_list_make(u32, 32, &std_allocator);
+    visible_polygons = array_list_make(u32, 64, &std_allocator);
+
+    // Making retained buffers for static geometry, entity quads are drawn with quad shader, since they are baked as verticies, not instances.
+    bake_buffer = vertex_buffer_make();
+    geometry_lines_data = vertex_buffer_make();
+    geometry_lines_free = array_list_make(Level_Line_Range, 8, &std_allocator);
+    polygon_lines = array_list_make(Level_Line_Range, 64, &std_allocator);
+
+    retained_buffer_make(&geometry_lines, state->line_drawer.program, true);
+    retained_buffer_make(&static_entity_quads, resource_shader_get("res/shader/quad.glsl"), false);
+
+    Quad_Vertex empty[VERTICIES_PER_QUAD] = {0};
+    for (u32 i = 0; i < MAX_ENTITIES; i++) {
+        vertex_buffer_append_data(&bake_buffer, empty, sizeof(empty));
+    }
+    retained_buffer_upload(&static_entity_quads, &bake_buffer);
+
     // All values in global state are defaulted to 0.
     // state->level.flags = 0;
 }
 
 
 
-const String LEVEL_FILE_PATH   = STR_BUFFER("res/level/");
-const String LEVEL_FILE_FORMAT = STR_BUFFER(".level");
+/**
+ * Creates entity of specified type with specified bounding box and adds it to the level.
+ * Returns pointer to the added entity or NULL if it wasn't added.
+ */
+static Entity *level_spawn_entity(Entity_Type type, OBB obb) {
+    Entity e = { .type = type };
 
-void level_load(String name) {
-    console_log("Loading '%.*s' level.\n", UNPACK(name));
+    switch(e.type) {
+        case PLAYER:
+            if (player != NULL) {
+                return NULL;
+            }
+            e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, 0.0f, 65.0f, 0.0f, 0.7f, 0.4f, true, false, false, true);
+            
+            player = level_add_entity(e);
+            return player;
+        case PROP_PHYSICS:
+            e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, obb.rot, 55.0f, 0.0f, LEVEL_GEOMETRY_STATIC_FRICTION, LEVEL_GEOMETRY_DYNAMIC_FRICTION, true, true, false, true);
+
+            return level_add_entity(e);
+        case RAY_EMITTER:
+            e.ray_emitter.ray_points_list = array_list_make(Vec2f, 4, &std_allocator);
+            e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, obb.rot, 0.0f, 0.0f, LEVEL_GEOMETRY_STATIC_FRICTION, LEVEL_GEOMETRY_DYNAMIC_FRICTION, false, false, false, false);
+
+            return level_add_entity(e);
+        case RAY_HARVESTER:
+            e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, obb.rot, 0.0f, 0.0f, LEVEL_GEOMETRY_STATIC_FRICTION, LEVEL_GEOMETRY_DYNAMIC_FRICTION, false, false, false, false);
+
+            return level_add_entity(e);
+        case MIRROR:
+            e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, obb.rot, 0.0f, 0.0f, LEVEL_GEOMETRY_STATIC_FRICTION, LEVEL_GEOMETRY_DYNAMIC_FRICTION, false, false, false, false);
+
+            return level_add_entity(e);
+        case GLASS:
+            e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, obb.rot, 0.0f, 0.0f, LEVEL_GEOMETRY_STATIC_FRICTION, LEVEL_GEOMETRY_DYNAMIC_FRICTION, false, false, false, false);
+
+            return level_add_entity(e);
+        default:
+            return NULL;
+    }
+}
 
-    state->level = (Level) {0};
-    player = NULL; // Find a better way to reference player?
+/**
+ * Gives part of the geometry lines buffer back, it is merged with free neighbours.
+ */
+static void level_lines_free(u32 offset, u32 bytes) {
+    if (bytes == 0) {
+        return;
+    }
 
-    char file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length + 1];
-    str_copy_to(LEVEL_FILE_PATH, file_name);
-    str_copy_to(name, file_name + LEVEL_FILE_PATH.length);
-    str_copy_to(LEVEL_FILE_FORMAT, file_name + LEVEL_FILE_PATH.length + name.length);
-    file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length] = '\0';
+    u32 index = 0;
+    while (index < array_list_length(&geometry_lines_free) && geometry_lines_free[index].offset < offset) {
+        index++;
+    }
 
-    FILE *file = fopen(file_name, "rb");
-    if (file == NULL) {
-        console_log("Couldn't open the level file for loading in game '%s'.\n", file_name);
-        return;
+    array_list_add(&geometry_lines_free, index, ((Level_Line_Range) { offset, bytes }));
+
+    if (index + 1 < array_list_length(&geometry_lines_free) && offset + bytes == geometry_lines_free[index + 1].offset) {
+        geometry_lines_free[index].bytes += geometry_lines_free[index + 1].bytes;
+        memmove(geometry_lines_free + index + 1, geometry_lines_free + index + 2, (array_list_length(&geometry_lines_free) - index - 2) * sizeof(Level_Line_Range));
+        array_list_pop(&geometry_lines_free);
     }
-    
-    (void)fseek(file, 0, SEEK_END);
-    u64 size = ftell(file);
-    rewind(file);
 
-    u8 *buffer = malloc(size);
-    if (buffer == NULL) {
-        console_log("Memory allocation for buffer failed while reading the file '%s'.\n", file_name);
-        (void)fclose(file);
-        return;
+    if (index > 0 && geometry_lines_free[index - 1].offset + geometry_lines_free[index - 1].bytes == offset) {
+        geometry_lines_free[index - 1].bytes += geometry_lines_free[index].bytes;
+        memmove(geometry_lines_free + index, geometry_lines_free + index + 1, (array_list_length(&geometry_lines_free) - index - 1) * sizeof(Level_Line_Range));
+        array_list_pop(&geometry_lines_free);
     }
+}
 
-    if (fread(buffer, 1, size, file) != size) {
-        console_log("Failure reading the file '%s'.\n", file_name);
-        (void)fclose(file);
-        free(buffer);
+/**
+ * Returns offset of the first free part of the geometry lines buffer that fits the bytes.
+ * If none fits, buffer data is at least doubled, so it is rarely uploaded whole, see "level_lines_upload()".
+ */
+static u32 level_lines_alloc(u32 bytes) {
+    if (bytes == 0) {
+        return 0;
+    }
+
+    for (u32 i = 0; i < array_list_length(&geometry_lines_free); i++) {
+        Level_Line_Range *range = geometry_lines_free + i;
+        if (range->bytes < bytes) {
+            continue;
+        }
+
+        u32 offset = range->offset;
+        range->offset += bytes;
+        range->bytes  -= bytes;
+
+        if (range->bytes == 0) {
+            memmove(range, range + 1, (array_list_length(&geometry_lines_free) - i - 1) * sizeof(Level_Line_Range));
+            array_list_pop(&geometry_lines_free);
+        }
+        return offset;
+    }
+
+    // Free part at the end of the buffer is grown into.
+    u32 used = array_list_length(&geometry_lines_data);
+    u32 tail = 0;
+    u32 free_count = array_list_length(&geometry_lines_free);
+    if (free_count > 0 && geometry_lines_free[free_count - 1].offset + geometry_lines_free[free_count - 1].bytes == used) {
+        tail = geometry_lines_free[free_count - 1].bytes;
+    }
+
+    u32 grow = bytes - tail > used ? bytes - tail : used;
+    u8 *zeros = calloc(grow, 1);
+    vertex_buffer_append_data(&geometry_lines_data, zeros, grow);
+    free(zeros);
+
+    level_lines_free(used, grow);
+    return level_lines_alloc(bytes);
+}
+
+/**
+ * Bakes edges and normals of polygons of the range into its own part of the geometry lines buffer.
+ * Part is updated in place if buffer doesn't have to grow, otherwise it is left to "level_lines_upload()".
+ */
+static void level_bake_lines(Level_Polygon_Range *range) {
+    vertex_buffer_clear(&bake_buffer);
+
+    Vec2f midpoint, v0, v1;
+    for (u32 i = range->first; i < range->first + range->count; i++) {
+        Phys_Polygon *polygon = polygon_list + i;
+        u32 start = array_list_length(&bake_buffer);
+
+        for (u32 j = 0; j < polygon->edges_count; j++) {
+            v0 = polygon->edges[j].vertex;
+            v1 = polygon->edges[(j + 1) % polygon->edges_count].vertex;
+
+            draw_line(v0, v1, VEC4F_WHITE, &bake_buffer);
+
+            midpoint = vec2f_make(v0.x + (v1.x - v0.x) / 2, v0.y + (v1.y - v0.y) / 2);
+
+            draw_line(midpoint, vec2f_sum(midpoint, vec2f_multi_constant(polygon->edges[j].normal, 0.4f)), VEC4F_BLUE, &bake_buffer);
+        }
+
+        // Offsets are relative to the range until its part is allocated.
+        array_list_append(&polygon_lines, ((Level_Line_Range) { start, array_list_length(&bake_buffer) - start }));
+    }
+
+    range->lines_bytes  = array_list_length(&bake_buffer);
+    range->lines_offset = level_lines_alloc(range->lines_bytes);
+
+    for (u32 i = range->first; i < range->first + range->count; i++) {
+        polygon_lines[i].offset += range->lines_offset;
+    }
+
+    memcpy(geometry_lines_data + range->lines_offset, bake_buffer, range->lines_bytes);
+
+    if (range->lines_bytes > 0 && range->lines_offset + range->lines_bytes <= geometry_lines.bytes) {
+        retained_buffer_update(&geometry_lines, range->lines_offset, bake_buffer, range->lines_bytes);
+    }
+}
+
+/**
+ * Uploads the whole geometry lines buffer if it grew since it was last uploaded, parts baked since then are uploaded along with it.
+ */
+static void level_lines_upload() {
+    if (array_list_length(&geometry_lines_data) != geometry_lines.bytes) {
+        retained_buffer_upload(&geometry_lines, &geometry_lines_data);
+    }
+}
+
+/**
+ * Makes a range out of polygons appended to the polygon list starting at first, builds the bvh over them and bakes their lines.
+ * Bounds of the polygons should already be appended to the polygon bounds, they are read from the image rather than computed.
+ * If image is specified and has bvh over the same polygons, it is copied instead of being built.
+ */
+static void level_add_polygon_range(Level_Chunk *chunk, u32 first, Level_Image *image) {
+    Level_Polygon_Range range = { .chunk = chunk, .first = first, .count = array_list_length(&polygon_list) - first };
+    if (range.count == 0) {
         return;
     }
 
-    (void)fclose(file);
+    if (image != NULL && (image->flags & LEVEL_FILE_HAS_BVH) && image->polygons_count == range.count) {
+        range.bvh_nodes = array_list_make(Level_BVH_Node, image->bvh_nodes_count, &std_allocator);
+        array_list_append_multiple(&range.bvh_nodes, image->bvh_nodes, image->bvh_nodes_count);
 
+        range.bvh_polygons = malloc(range.count * sizeof(u32) + 1);
+        if (range.bvh_polygons == NULL) {
+            array_list_free(&range.bvh_nodes);
+        } else {
+            memcpy(range.bvh_polygons, image->bvh_polygons, range.count * sizeof(u32));
+        }
+    } else {
+        range.bvh_nodes = level_bvh_build(polygon_bounds + first, range.count, &range.bvh_polygons);
+    }
 
-    u8 *ptr = buffer;
+    // Polygons are still collided with, they just can't be culled, so they aren't drawn.
+    if (range.bvh_nodes == NULL) {
+        console_log("Couldn't allocate bvh over %u polygons, they won't be drawn.\n", range.count);
+    }
 
-    // @Copypasta from editor.c
-    if (read_u32(&ptr) != LEVEL_FORMAT_HEADER) {
-        console_log("Failure reading the level file '%s' into the game, format header doesn't match.\n", file_name);
-        free(buffer);
+    level_bake_lines(&range);
+    array_list_append(&polygon_ranges, range);
+}
+
+static void level_free_polygon_range(Level_Polygon_Range *range) {
+    if (range->bvh_nodes != NULL) {
+        array_list_free(&range->bvh_nodes);
+    }
+    free(range->bvh_polygons);
+}
+
+/**
+ * Removes the range of the chunk, polygons after it are moved down to close the gap, its part of the geometry lines buffer is given back, nothing is rebuilt.
+ */
+static void level_remove_polygon_range(Level_Chunk *chunk) {
+    for (u32 i = 0; i < array_list_length(&polygon_ranges); i++) {
+        Level_Polygon_Range range = polygon_ranges[i];
+        if (range.chunk != chunk) {
+            continue;
+        }
+
+        u32 tail = array_list_length(&polygon_list) - range.first - range.count;
+        memmove(polygon_list + range.first, polygon_list + range.first + range.count, tail * sizeof(Phys_Polygon));
+        memmove(polygon_bounds + range.first, polygon_bounds + range.first + range.count, tail * sizeof(AABB));
+        memmove(polygon_lines + range.first, polygon_lines + range.first + range.count, tail * sizeof(Level_Line_Range));
+        array_list_pop_multiple(&polygon_list, range.count);
+        array_list_pop_multiple(&polygon_bounds, range.count);
+        array_list_pop_multiple(&polygon_lines, range.count);
+
+        level_lines_free(range.lines_offset, range.lines_bytes);
+
+        level_free_polygon_range(polygon_ranges + i);
+        array_list_unordered_remove(&polygon_ranges, i);
+
+        for (u32 j = 0; j < array_list_length(&polygon_ranges); j++) {
+            if (polygon_ranges[j].first > range.first) {
+                polygon_ranges[j].first -= range.count;
+            }
+        }
         return;
     }
+}
+
+/**
+ * Fills visible polygons list with indicies of polygons which bounds touch the view, bvh of every range is traversed on its own.
+ */
+static void level_query_visible_polygons(AABB view) {
+    array_list_clear(&visible_polygons);
+
+    for (u32 s = 0; s < array_list_length(&polygon_ranges); s++) {
+        Level_Polygon_Range *range = polygon_ranges + s;
+        if (range->bvh_nodes == NULL) {
+            continue;
+        }
+
+        array_list_clear(&bvh_stack);
+        array_list_append(&bvh_stack, 0);
+
+        while (array_list_length(&bvh_stack) > 0) {
+            Level_BVH_Node *node = range->bvh_nodes + bvh_stack[array_list_length(&bvh_stack) - 1];
+            array_list_pop(&bvh_stack);
+
+            if (!aabb_touches_aabb(&node->bounds, &view)) {
+                continue;
+            }
+
+            if (node->count == 0) {
+                array_list_append(&bvh_stack, node->first);
+                array_list_append(&bvh_stack, node->first + 1);
+                continue;
+            }
+
+            for (u32 i = node->first; i < node->first + node->count; i++) {
+                u32 index = range->first + range->bvh_polygons[i];
+                if (aabb_touches_aabb(polygon_bounds + index, &view)) {
+                    array_list_append(&visible_polygons, index);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Returns color static entity is drawn with.
+ */
+static Vec4f level_static_entity_color(Entity *entity) {
+    switch(entity->type) {
+        case RAY_EMITTER:
+            return LEVEL_COLOR_RAY_EMITTER;
+        case RAY_HARVESTER:
+            return entity->ray_harvester.ray_hit ? VEC4F_GREEN : VEC4F_RED;
+        case MIRROR:
+            return LEVEL_COLOR_MIRROR;
+        case GLASS:
+            return LEVEL_COLOR_GLASS;
+        default:
+            return VEC4F_PINK;
+    }
+}
 
-    u32 edge_count = read_u32(&ptr);
+/**
+ * Queues quad of the static entity from the retained buffer, if entity moved or changed color since it was baked, its quad is rebaked first.
+ */
+static void level_draw_static_entity(s64 index) {
+    Entity *entity = state->level.entities + index;
+    Level_Baked_Entity *baked = baked_entities + index;
 
+    OBB box = entity->phys_box.bound_box;
+    Vec4f color = level_static_entity_color(entity);
+    u32 bytes = VERTICIES_PER_QUAD * sizeof(Quad_Vertex);
+
+    if (!baked->baked || memcmp(&baked->box, &box, sizeof(OBB)) != 0 || memcmp(&baked->color, &color, sizeof(Vec4f)) != 0) {
+        vertex_buffer_clear(&bake_buffer);
+        draw_rect(obb_p0(&box), obb_p1(&box), .color = color, .offset_angle = box.rot, .buffer = &bake_buffer);
+        retained_buffer_update(&static_entity_quads, index * bytes, bake_buffer, bytes);
+
+        *baked = (Level_Baked_Entity) { .box = box, .color = color, .baked = true };
+    }
+
+    // Retained quads use the same quad shader, only out of their own buffer, ranges of the entities are still merged into one multi draw.
+    // They go into their own layer to be drawn under the dynamic quad stream, in one layer their order against it would only follow the queue order.
+    render_layer_set(RENDER_LAYER_WORLD_STATIC);
+    retained_buffer_draw_range(&static_entity_quads, index * bytes, bytes);
+    render_layer_set(RENDER_LAYER_WORLD);
+}
+
+static int level_compare_line_offsets(const void *a, const void *b) {
+    u32 offset_a = polygon_lines[*(const u32 *)a].offset;
+    u32 offset_b = polygon_lines[*(const u32 *)b].offset;
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+/**
+ * Freezes far away dynamic entities on most frames, so only every "sim_lod_interval" frame they are simulated, with step time scaled up to keep up.
+ * Frozen entities stay solid, so entities ticked on other frames still collide with them.
+ * Entities near the camera, the player and static entities are always simulated, so everything that can interact with the player stays exact.
+ */
+static void level_update_sim_lod() {
+    sim_frame++;
+
+    s64 interval = level_params.sim_lod_interval;
+
+    AABB near = camera_calculate_bounds(&state->main_camera, state->window.width, state->window.height);
+    near.p0 = vec2f_difference(near.p0, vec2f_make(level_params.sim_lod_margin, level_params.sim_lod_margin));
+    near.p1 = vec2f_sum(near.p1, vec2f_make(level_params.sim_lod_margin, level_params.sim_lod_margin));
+
+    for (s64 i = 0; i < state->level.entities_count; i++) {
+        Entity *entity = state->level.entities + i;
+
+        if (entity->type == NONE) {
+            continue;
+        }
+
+        entity->phys_box.frozen = false;
+        entity->phys_box.time_scale = 1.0f;
+
+        if (interval <= 1 || entity == player || !entity->phys_box.dynamic || !entity->phys_box.active) {
+            continue;
+        }
+
+        AABB bounds = obb_enclose_in_aabb(&entity->phys_box.bound_box);
+        if (aabb_touches_aabb(&bounds, &near)) {
+            continue;
+        }
+
+        // Ticks are spread over frames by entity index, so far entities don't all get simulated on the same frame.
+        if ((sim_frame + i) % interval == 0) {
+            entity->phys_box.time_scale = (float)interval;
+        } else {
+            entity->phys_box.frozen = true;
+        }
+    }
+}
+
+/**
+ * Creates level runtime geometry and entities out of the level image.
+ */
+static void level_load_image(Level_Image *image) {
     // @Temporary: Find better approach for level geometry memory management.
     if (edges_allocation != NULL) {
         console_log("Reallocating memory for level geometry.\n");
-        edges_allocation = realloc(edges_allocation, edge_count * sizeof(Phys_Edge));
+        edges_allocation = realloc(edges_allocation, image->edges_count * sizeof(Phys_Edge));
     } else {
         console_log("Allocating memory for level geometry.\n");
-        edges_allocation = malloc(edge_count * sizeof(Phys_Edge));
+        edges_allocation = malloc(image->edges_count * sizeof(Phys_Edge));
+    }
+
+    for (u32 i = 0; i < image->edges_count; i++) {
+        edges_allocation[i].vertex = vec2f_make(image->edge_vertex_x[i], image->edge_vertex_y[i]);
+        edges_allocation[i].normal = vec2f_make(image->edge_normal_x[i], image->edge_normal_y[i]);
     }
 
+    for (u32 i = 0; i < array_list_length(&polygon_ranges); i++) {
+        level_free_polygon_range(polygon_ranges + i);
+    }
+    array_list_clear(&polygon_ranges);
     array_list_clear(&polygon_list);
+    array_list_clear(&polygon_bounds);
+    array_list_clear(&polygon_lines);
+    array_list_clear(&geometry_lines_data);
+    array_list_clear(&geometry_lines_free);
+
+    for (u32 i = 0; i < image->polygons_count; i++) {
+        array_list_append(&polygon_list, ((Phys_Polygon) { .edges_count = image->polygon_edge_count[i], .edges = edges_allocation + image->polygon_first_edge[i] }));
+        array_list_append(&polygon_bounds, aabb_make(vec2f_make(image->polygon_min_x[i], image->polygon_min_y[i]), vec2f_make(image->polygon_max_x[i], image->polygon_max_y[i])));
+    }
+
+    level_add_polygon_range(NULL, 0, image);
+    level_lines_upload();
+
+
+
+    memset(entities_allocation, 0, sizeof(Entity) * MAX_ENTITIES);
+    memset(baked_entities, 0, sizeof(baked_entities));
+    array_list_clear(&entities_free_addresses);
+    state->level.entities_count = 0;
+    state->level.entities = entities_allocation;
+
+    for (u32 i = 0; i < image->entities_count; i++) {
+        level_spawn_entity(image->entity_type[i], obb_make(vec2f_make(image->entity_center_x[i], image->entity_center_y[i]), image->entity_width[i], image->entity_height[i], image->entity_rot[i]));
+    }
+}
+
+
+
+/**
+ * Spawns entities of the decoded chunk and appends its polygons to the polygon list as a new range.
+ */
+static void level_integrate_chunk(Level_Chunk *chunk) {
+    for (u32 i = 0; i < chunk->entities_count; i++) {
+        chunk->entities[i] = level_spawn_entity(chunk->entity_types[i], chunk->entity_boxes[i]);
+    }
 
-    u32 edge_counter = 0;
-    u32 polygon_edge_count;
-    while (edge_counter < edge_count) {
-        polygon_edge_count = read_u32(&ptr);
-        
-        array_list_append(&polygon_list, ((Phys_Polygon) { .edges_count = polygon_edge_count, .edges = edges_allocation + edge_counter }));
-        for (u32 i = 0; i < polygon_edge_count; i++) {
-            (edges_allocation + edge_counter + i)->vertex.x = read_float(&ptr);
-            (edges_allocation + edge_counter + i)->vertex.y = read_float(&ptr);
-            (edges_allocation + edge_counter + i)->normal.x = read_float(&ptr);
-            (edges_allocation + edge_counter + i)->normal.y = read_float(&ptr);
+    u32 first = array_list_length(&polygon_list);
+    array_list_append_multiple(&polygon_list, chunk->polygons, chunk->polygons_count);
+    array_list_append_multiple(&polygon_bounds, chunk->polygon_bounds, chunk->polygons_count);
+    level_add_polygon_range(chunk, first, NULL);
+}
+
+/**
+ * Removes entities and the range of the chunk and gives chunk back to the stream.
+ */
+static void level_unload_chunk(Level_Chunk *chunk) {
+    for (u32 i = 0; i < chunk->entities_count; i++) {
+        Entity *entity = chunk->entities[i];
+        if (entity == NULL) {
+            continue;
         }
 
-        edge_counter += polygon_edge_count;
+        if (entity->type == RAY_EMITTER) {
+            array_list_free(&entity->ray_emitter.ray_points_list);
+        }
+
+        level_remove_entity(entity);
     }
 
+    level_remove_polygon_range(chunk);
+    level_stream_release(chunk);
+}
 
+/**
+ * Unloads far away chunks and integrates decoded ones into the level, one chunk at a time.
+ * Both share the budget, as soon as it took more than budget_ns, rest of the chunks wait for the next frame.
+ */
+static void level_update_stream(Vec2f center, u64 budget_ns) {
+    level_stream_request(center, level_params.stream_load_radius);
 
+    bool changed = false;
+    u64 start = get_time_ns();
 
+    Level_Chunk *chunk;
+    while (get_time_ns() - start < budget_ns && (chunk = level_stream_next_far(center, level_params.stream_evict_radius)) != NULL) {
+        level_unload_chunk(chunk);
+        changed = true;
+    }
 
-    u32 entity_count = read_u32(&ptr);
+    while (get_time_ns() - start < budget_ns && (chunk = level_stream_pop_decoded()) != NULL) {
+        level_integrate_chunk(chunk);
+        changed = true;
+    }
 
-    OBB obb;
-    Entity e;
+    if (changed) {
+        level_lines_upload();
 
-    memset(entities_allocation, 0, sizeof(Entity) * MAX_ENTITIES);
-    array_list_clear(&entities_free_addresses);
-    state->level.entities_count = 0;
-    state->level.entities = entities_allocation;
+        state->level.phys_polygons_count = array_list_length(&polygon_list);
+        state->level.phys_polygons = polygon_list;
+    }
+}
 
-    for (u32 i = 0; i < entity_count; i++) {
 
-        e.type = read_byte(&ptr);
 
-        obb.center.x = read_float(&ptr);
-        obb.center.y = read_float(&ptr);
-        obb.dimensions.x = read_float(&ptr);
-        obb.dimensions.y = read_float(&ptr);
-        obb.rot = read_float(&ptr);
+/**
+ * Opens chunked level stream over the mapped level file and brings in the chunks around the player.
+ */
+static void level_load_streamed(String name, char *file_name, File_Mapping *mapping) {
+    // Chunked levels are streamed, stream owns the mapping from now on.
+    Level_Image global_image;
+    u8 *global_data;
 
-        switch(e.type) {
-            case PLAYER:
-                if (player != NULL) {
-                    break;
-                }
-                e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, 0.0f, 65.0f, 0.0f, 0.7f, 0.4f, true, false, false, true);
-                
-                player = level_add_entity(e);
-                break;
-            case PROP_PHYSICS:
-                e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, obb.rot, 55.0f, 0.0f, LEVEL_GEOMETRY_STATIC_FRICTION, LEVEL_GEOMETRY_DYNAMIC_FRICTION, true, true, false, true);
+    if (!level_stream_open(mapping, &global_image, &global_data)) {
+        console_log("Failure reading the chunked level file '%s' into the game.\n", file_name);
+        file_unmap(mapping);
+        return;
+    }
 
-                level_add_entity(e);
-                break;
-            case RAY_EMITTER:
-                e.ray_emitter.ray_points_list = array_list_make(Vec2f, 4, &std_allocator);
-                e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, obb.rot, 0.0f, 0.0f, LEVEL_GEOMETRY_STATIC_FRICTION, LEVEL_GEOMETRY_DYNAMIC_FRICTION, false, false, false, false);
+    level_load_image(&global_image);
+    free(global_data);
 
-                level_add_entity(e);
-                break;
-            case RAY_HARVESTER:
-                e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, obb.rot, 0.0f, 0.0f, LEVEL_GEOMETRY_STATIC_FRICTION, LEVEL_GEOMETRY_DYNAMIC_FRICTION, false, false, false, false);
+    // Chunks around the player are brought in right away, so it doesn't start by falling through missing geometry.
+    Vec2f center = player != NULL ? player->phys_box.bound_box.center : VEC2F_ORIGIN;
+    state->main_camera.center = center;
 
-                level_add_entity(e);
-                break;
-            case MIRROR:
-                e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, obb.rot, 0.0f, 0.0f, LEVEL_GEOMETRY_STATIC_FRICTION, LEVEL_GEOMETRY_DYNAMIC_FRICTION, false, false, false, false);
+    level_stream_request(center, level_params.stream_load_radius);
+    level_stream_flush();
+    level_update_stream(center, UINT64_MAX);
 
-                level_add_entity(e);
-                break;
-            case GLASS:
-                e.phys_box = phys_box_make(obb.center, obb.dimensions.x, obb.dimensions.y, obb.rot, 0.0f, 0.0f, LEVEL_GEOMETRY_STATIC_FRICTION, LEVEL_GEOMETRY_DYNAMIC_FRICTION, false, false, false, false);
+    state->level.phys_polygons_count = array_list_length(&polygon_list);
+    state->level.phys_polygons = polygon_list;
 
-                level_add_entity(e);
-                break;
+    console_log("Streaming '%s' level, %lld polygons resident.\n", file_name, state->level.phys_polygons_count);
+
+    state->level.name = name;
+    state->level.flags |= LEVEL_LOADED | LEVEL_STREAMED;
+}
+
+
+
+const String LEVEL_FILE_PATH   = STR_BUFFER("res/level/");
+const String LEVEL_FILE_FORMAT = STR_BUFFER(".level");
+
+void level_load(String name) {
+    console_log("Loading '%.*s' level.\n", UNPACK(name));
+
+    level_stream_close();
+
+    state->level = (Level) {0};
+    player = NULL; // Find a better way to reference player?
+
+    char file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length + 1];
+    str_copy_to(LEVEL_FILE_PATH, file_name);
+    str_copy_to(name, file_name + LEVEL_FILE_PATH.length);
+    str_copy_to(LEVEL_FILE_FORMAT, file_name + LEVEL_FILE_PATH.length + name.length);
+    file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length] = '\0';
+
+    // Recently loaded and preloaded levels are restored straight from the level cache.
+    Level_Image image;
+    if (level_cache_get(file_name, &image)) {
+        level_load_image(&image);
+        level_cache_trim((u64)level_params.cache_budget_kb * 1024);
+
+        console_log("Restored '%s' level from the level cache.\n", file_name);
+    } else {
+        File_Mapping mapping;
+        if (!file_map(file_name, &mapping)) {
+            console_log("Couldn't open the level file for loading in game '%s'.\n", file_name);
+            return;
         }
 
-    }
+        if (level_chunked_check_header(mapping.data, mapping.size)) {
+            level_load_streamed(name, file_name, &mapping);
+            return;
+        }
 
-    free(buffer);
+        bool old_format = !compress_check_header(mapping.data, mapping.size) && !level_image_check_header(mapping.data, mapping.size);
 
+        // Cache takes over the mapping, uncompressed image is loaded straight from it.
+        if (!level_cache_put(file_name, &mapping, &image)) {
+            console_log("Failure reading the level file '%s' into the game, level data is corrupted.\n", file_name);
+            return;
+        }
 
-    console_log("Read %llu bytes into the game from '%s' level file.\n", ptr - buffer, file_name);
+        if (old_format) {
+            console_log("Level file '%s' is in the old format, use 'level_convert' to upgrade it.\n", file_name);
+        }
+
+        level_load_image(&image);
+        level_cache_trim((u64)level_params.cache_budget_kb * 1024);
+
+        console_log("Read %llu bytes into the game from '%s' level file.\n", image.size, file_name);
+    }
 
 
     state->level.name = name;
@@ -298,6 +800,206 @@ void level_load(String name) {
 
 
 
+bool level_release_file(char *file_name) {
+    if (!(state->level.flags & LEVEL_STREAMED)) {
+        return false;
+    }
+
+    String name = state->level.name;
+    char streamed_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length + 1];
+    str_copy_to(LEVEL_FILE_PATH, streamed_name);
+    str_copy_to(name, streamed_name + LEVEL_FILE_PATH.length);
+    str_copy_to(LEVEL_FILE_FORMAT, streamed_name + LEVEL_FILE_PATH.length + name.length);
+    streamed_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length] = '\0';
+
+    if (strcmp(streamed_name, file_name) != 0) {
+        return false;
+    }
+
+    // Nothing in the level should point into chunk data once the stream is closed.
+    u32 chunks_count;
+    Level_Chunk *chunks = level_stream_chunks(&chunks_count);
+    for (u32 i = 0; i < chunks_count; i++) {
+        if (chunks[i].state == LEVEL_CHUNK_RESIDENT) {
+            level_unload_chunk(chunks + i);
+        }
+    }
+    level_lines_upload();
+
+    level_stream_close();
+
+    state->level.phys_polygons_count = array_list_length(&polygon_list);
+    state->level.phys_polygons = polygon_list;
+    state->level.flags &= ~(LEVEL_LOADED | LEVEL_STREAMED);
+
+    return true;
+}
+
+void level_preload(String name) {
+    char file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length + 1];
+    str_copy_to(LEVEL_FILE_PATH, file_name);
+    str_copy_to(name, file_name + LEVEL_FILE_PATH.length);
+    str_copy_to(LEVEL_FILE_FORMAT, file_name + LEVEL_FILE_PATH.length + name.length);
+    file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length] = '\0';
+
+    level_cache_preload(file_name);
+
+    u32 count;
+    u64 usage = level_cache_usage(&count);
+    console_log("Preloading '%s' level, %u levels cached in %llu bytes.\n", file_name, count, usage);
+}
+
+void level_convert(String name) {
+    char file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length + 1];
+    str_copy_to(LEVEL_FILE_PATH, file_name);
+    str_copy_to(name, file_name + LEVEL_FILE_PATH.length);
+    str_copy_to(LEVEL_FILE_FORMAT, file_name + LEVEL_FILE_PATH.length + name.length);
+    file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length] = '\0';
+
+    u64 size;
+    u8 *buffer = read_file_into_buffer(file_name, &size, &std_allocator);
+    if (buffer == NULL) {
+        console_log("Couldn't read the level file for converting '%s'.\n", file_name);
+        return;
+    }
+
+    if (level_image_check_header(buffer, size)) {
+        console_log("Level file '%s' is already in the version %u format.\n", file_name, LEVEL_FORMAT_VERSION);
+        free(buffer);
+        return;
+    }
+
+    u64 image_size;
+    u8 *image = level_image_build_from_v1(buffer, size, true, &image_size);
+    free(buffer);
+
+    if (image == NULL) {
+        console_log("Failure converting the level file '%s', it is not a valid old format level.\n", file_name);
+        return;
+    }
+
+    level_cache_evict(file_name);
+
+    if (write_str_to_file(STR((s64)image_size, (char *)image), file_name) != 0) {
+        console_log("Failure writing converted level file '%s'.\n", file_name);
+        free(image);
+        return;
+    }
+
+    free(image);
+
+    console_log("Converted level file '%s' to the version %u format, %llu bytes written.\n", file_name, LEVEL_FORMAT_VERSION, image_size);
+}
+
+
+
+/**
+ * Maps level file, decompresses it if needed and reads it as an image, the same way "level_load()" does, without instantiating it.
+ * Returns time it took in nanoseconds.
+ */
+static u64 level_benchmark_read(char *file_name) {
+    u64 start = get_time_ns();
+
+    File_Mapping mapping;
+    if (!file_map(file_name, &mapping)) {
+        return 0;
+    }
+
+    u8 *data = mapping.data;
+    u64 size = mapping.size;
+    u8 *decompressed = NULL;
+
+    if (compress_check_header(data, size)) {
+        decompressed = decompress_buffer(mapping.data, mapping.size, &size);
+        data = decompressed;
+    }
+
+    Level_Image image;
+    if (data != NULL && level_image_from_memory(data, size, &image)) {
+        // Touching the vertex data so the mapped pages are actually read.
+        volatile float sum = 0.0f;
+        for (u32 i = 0; i < image.edges_count; i++) {
+            sum += image.edge_vertex_x[i] + image.edge_vertex_y[i];
+        }
+        (void)sum;
+    }
+
+    free(decompressed);
+    file_unmap(&mapping);
+
+    return get_time_ns() - start;
+}
+
+void level_benchmark(String name, s32 iterations) {
+    char file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length + 1];
+    str_copy_to(LEVEL_FILE_PATH, file_name);
+    str_copy_to(name, file_name + LEVEL_FILE_PATH.length);
+    str_copy_to(LEVEL_FILE_FORMAT, file_name + LEVEL_FILE_PATH.length + name.length);
+    file_name[LEVEL_FILE_PATH.length + name.length + LEVEL_FILE_FORMAT.length] = '\0';
+
+    if (iterations <= 0) {
+        iterations = 1;
+    }
+
+    u64 size;
+    u8 *buffer = read_file_into_buffer(file_name, &size, &std_allocator);
+    if (buffer == NULL) {
+        console_log("Couldn't read the level file for benchmark '%s'.\n", file_name);
+        return;
+    }
+
+    // Getting raw version 2 image, whatever the file is stored as.
+    u8 *raw = buffer;
+    u64 raw_size = size;
+    if (compress_check_header(buffer, size)) {
+        raw = decompress_buffer(buffer, size, &raw_size);
+        free(buffer);
+    } else if (!level_image_check_header(buffer, size)) {
+        raw = level_image_build_from_v1(buffer, size, true, &raw_size);
+        free(buffer);
+    }
+
+    if (raw == NULL) {
+        console_log("Failure reading the level file for benchmark '%s'.\n", file_name);
+        return;
+    }
+
+    u64 packed_size;
+    u8 *packed = compress_buffer(raw, raw_size, &packed_size);
+    if (packed == NULL) {
+        free(raw);
+        return;
+    }
+
+    char raw_name[] = "res/level/.benchmark_raw";
+    char packed_name[] = "res/level/.benchmark_packed";
+
+    if (write_str_to_file(STR((s64)raw_size, (char *)raw), raw_name) != 0 || write_str_to_file(STR((s64)packed_size, (char *)packed), packed_name) != 0) {
+        console_log("Couldn't write temporary files for the benchmark.\n");
+        free(raw);
+        free(packed);
+        return;
+    }
+
+    u64 raw_total = 0, packed_total = 0;
+    for (s32 i = 0; i < iterations; i++) {
+        raw_total    += level_benchmark_read(raw_name);
+        packed_total += level_benchmark_read(packed_name);
+    }
+
+    (void)remove(raw_name);
+    (void)remove(packed_name);
+
+    console_log("Level '%.*s' read benchmark, %d iterations:\n", UNPACK(name), iterations);
+    console_log("    raw:        %llu bytes, %.2f us per read.\n", raw_size, (double)raw_total / iterations / 1000.0);
+    console_log("    compressed: %llu bytes (%.1f%%), %.2f us per read.\n", packed_size, 100.0 * packed_size / raw_size, (double)packed_total / iterations / 1000.0);
+
+    free(raw);
+    free(packed);
+}
+
+
+
 void level_update() {
     if (!(state->level.flags & LEVEL_LOADED)) {
         return;
@@ -306,6 +1008,10 @@ void level_update() {
     // Camera setting zoom.
     state->main_camera.unit_scale = level_params.camera_zoom;
 
+    if (state->level.flags & LEVEL_STREAMED) {
+        level_update_stream(state->main_camera.center, (u64)(level_params.stream_budget_ms * 1000000.0f));
+    }
+
     // Player control stuff.
     if (!console_active()) {
         float x_vel = 0.0f;
@@ -337,6 +1043,7 @@ void level_update() {
 
 
     // Simulating physics.
+    level_update_sim_lod();
     phys_update(&state->level.entities->phys_box, state->level.entities_count, sizeof(Entity));
 
 
@@ -445,14 +1152,38 @@ void level_draw() {
     Matrix4f projection;
 
     projection = camera_calculate_projection(&state->main_camera, state->window.width, state->window.height);
+
+    // Only things that touch the camera view are drawn, view is extended a bit so edge normals sticking out of the polygons don't pop.
+    AABB view = camera_calculate_bounds(&state->main_camera, state->window.width, state->window.height);
+    view.p0 = vec2f_difference(view.p0, vec2f_make(LEVEL_CULL_MARGIN, LEVEL_CULL_MARGIN));
+    view.p1 = vec2f_sum(view.p1, vec2f_make(LEVEL_CULL_MARGIN, LEVEL_CULL_MARGIN));
     
-    // Drawing entities.
+    // Drawing entities, dynamic ones are drawn immediately, static ones from the retained buffer.
     shader_update_projection(state->quad_drawer.program, &projection);
+    shader_update_projection(static_entity_quads.quad_drawer.program, &projection);
+    render_layer_set(RENDER_LAYER_WORLD);
 
     draw_begin(&state->quad_drawer);
 
+    visible_entities_count = 0;
 
     for (s64 i = 0; i < state->level.entities_count; i++) {
+        if (state->level.entities[i].type == NONE) {
+            continue;
+        }
+
+        AABB bounds = obb_enclose_in_aabb(&state->level.entities[i].phys_box.bound_box);
+        if (!aabb_touches_aabb(&bounds, &view)) {
+            continue;
+        }
+
+        visible_entities_count++;
+
+        if (!state->level.entities[i].phys_box.dynamic) {
+            level_draw_static_entity(i);
+            continue;
+        }
+
         switch(state->level.entities[i].type) {
             case PLAYER:
                 draw_rect(obb_p0(&state->level.entities[i].phys_box.bound_box), obb_p1(&state->level.entities[i].phys_box.bound_box), .color = LEVEL_COLOR_PLAYER);
@@ -460,22 +1191,6 @@ void level_draw() {
             case PROP_PHYSICS:
                 draw_rect(obb_p0(&state->level.entities[i].phys_box.bound_box), obb_p1(&state->level.entities[i].phys_box.bound_box), .color = LEVEL_COLOR_PROP_PHYSICS, .offset_angle = state->level.entities[i].phys_box.bound_box.rot);
                 break;
-            case RAY_EMITTER:
-                draw_rect(obb_p0(&state->level.entities[i].phys_box.bound_box), obb_p1(&state->level.entities[i].phys_box.bound_box), .color = LEVEL_COLOR_RAY_EMITTER, .offset_angle = state->level.entities[i].phys_box.bound_box.rot);
-                break;
-            case RAY_HARVESTER:
-                if (state->level.entities[i].ray_harvester.ray_hit) {
-                    draw_rect(obb_p0(&state->level.entities[i].phys_box.bound_box), obb_p1(&state->level.entities[i].phys_box.bound_box), .color = VEC4F_GREEN, .offset_angle = state->level.entities[i].phys_box.bound_box.rot);
-                } else {
-                    draw_rect(obb_p0(&state->level.entities[i].phys_box.bound_box), obb_p1(&state->level.entities[i].phys_box.bound_box), .color = VEC4F_RED, .offset_angle = state->level.entities[i].phys_box.bound_box.rot);
-                }
-                break;
-            case MIRROR:
-                draw_rect(obb_p0(&state->level.entities[i].phys_box.bound_box), obb_p1(&state->level.entities[i].phys_box.bound_box), .color = LEVEL_COLOR_MIRROR, .offset_angle = state->level.entities[i].phys_box.bound_box.rot);
-                break;
-            case GLASS:
-                draw_rect(obb_p0(&state->level.entities[i].phys_box.bound_box), obb_p1(&state->level.entities[i].phys_box.bound_box), .color = LEVEL_COLOR_GLASS, .offset_angle = state->level.entities[i].phys_box.bound_box.rot);
-                break;
         }
     }
 
@@ -484,32 +1199,27 @@ void level_draw() {
     draw_end();
 
 
-    // Drawing lines. 
+    // Drawing lines, polygon ranges are queued in the order of the buffer, so neighbouring ones are merged into one draw call.
     shader_update_projection(state->line_drawer.program, &projection);
+    render_layer_set(RENDER_LAYER_WORLD_OVERLAY);
 
-    line_draw_begin(&state->line_drawer);
-
-    Vec2f midpoint, v0, v1;
-    for (u32 i = 0; i < array_list_length(&polygon_list); i++) {
-        for (u32 j = 0; j < polygon_list[i].edges_count; j++) {
-            v0 = polygon_list[i].edges[j].vertex;
-            v1 = polygon_list[i].edges[(j + 1) % polygon_list[i].edges_count].vertex;
-
-            draw_line(v0, v1, VEC4F_WHITE, NULL);
-
-            midpoint = vec2f_make(v0.x + (v1.x - v0.x) / 2, v0.y + (v1.y - v0.y) / 2);
+    level_query_visible_polygons(view);
+    qsort(visible_polygons, array_list_length(&visible_polygons), sizeof(u32), level_compare_line_offsets);
 
-            draw_line(midpoint, vec2f_sum(midpoint, vec2f_multi_constant(polygon_list[i].edges[j].normal, 0.4f)), VEC4F_BLUE, NULL);
-
-        }
+    for (u32 k = 0; k < array_list_length(&visible_polygons); k++) {
+        Level_Line_Range *lines = polygon_lines + visible_polygons[k];
+        retained_buffer_draw_range(&geometry_lines, lines->offset, lines->bytes);
     }
 
+    line_draw_begin(&state->line_drawer);
+
     for (s64 i = 0; i < state->level.entities_count; i++) {
         switch(state->level.entities[i].type) {
             case RAY_EMITTER:
                 Ray_Emitter *e = &state->level.entities[i].ray_emitter;
-                for (u32 i = 0; i < array_list_length(&e->ray_points_list) - 1; i++) {
-                    draw_line(e->ray_points_list[i], e->ray_points_list[i + 1], VEC4F_RED, NULL);
+                // Points are only cast by "level_update()", list is still empty if level is drawn right after it is loaded.
+                for (u32 i = 1; i < array_list_length(&e->ray_points_list); i++) {
+                    draw_line(e->ray_points_list[i - 1], e->ray_points_list[i], VEC4F_RED, NULL);
                 }
                 break;
         }
@@ -523,13 +1233,14 @@ void level_draw() {
 
     projection = screen_calculate_projection(state->window.width, state->window.height);
     shader_update_projection(state->ui_quad_drawer.program, &projection);
+    render_layer_set(RENDER_LAYER_UI);
 
     draw_begin(&state->ui_quad_drawer);
 
     // Draw editor ui.
     
     // Set ui to use specific font.
-    ui_set_font(&font_small);
+    ui_set_font(font_small);
 
     UI_WINDOW(0, 0, state->window.width, state->window.height, 
             
@@ -539,7 +1250,9 @@ void level_draw() {
                     "Level name: %.*s\n"
                     "Entities count: %u\n"
                     "Camera unit scale: %d\n"
-                    , state->window.width, state->window.height, UNPACK(state->level.name), 0, state->main_camera.unit_scale)
+                    "Visible entities: %u\n"
+                    "Visible polygons: %u / %u\n"
+                    , state->window.width, state->window.height, UNPACK(state->level.name), 0, state->main_camera.unit_scale, visible_entities_count, array_list_length(&visible_polygons), array_list_length(&polygon_list))
             );
     );
 
@@ -548,12 +1261,7 @@ void level_draw() {
 
 
 Entity *level_add_entity(Entity entity) {
-    if (state->level.entities_count >= MAX_ENTITIES) {
-        return NULL;
-    }
-
-    state->level.entities_count++;
-
+    // Freed addresses are reused first, they are already counted.
     if (array_list_length(&entities_free_addresses) > 0) {
         Entity *free_ptr = entities_free_addresses[0];
         *free_ptr = entity;
@@ -561,6 +1269,11 @@ Entity *level_add_entity(Entity entity) {
         return free_ptr;
     }
 
+    if (state->level.entities_count >= MAX_ENTITIES) {
+        return NULL;
+    }
+
+    state->level.entities_count++;
 
     state->level.entities[state->level.entities_count - 1] = entity;
     return state->level.entities + (state->level.entities_count - 1);
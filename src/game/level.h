@@ -95,7 +95,8 @@ struct entity {
 
 
 typedef enum level_flags : u8 {
-    LEVEL_LOADED = 0x01,
+    LEVEL_LOADED   = 0x01,
+    LEVEL_STREAMED = 0x02,     // Level geometry and entities are streamed in chunks around the camera.
 } Level_Flags;
 
 
@@ -130,6 +131,34 @@ void level_manager_init(State *state);
 @RegisterCommand;
 void level_load(String name);
 
+/**
+ * Closes the level stream if the loaded level is streamed from the file, unloading its chunks, so the file can be overwritten.
+ * Stream keeps the file mapped, which locks it on Windows, and truncating it under the mapping faults chunk reads elsewhere.
+ * Returns true if stream was closed, level should be loaded again once the file is written.
+ */
+bool level_release_file(char *file_name);
+
+/**
+ * Reads level into the level cache on the background thread, so the following "level_load()" of it doesn't touch the disk.
+ */
+@Introspect;
+@RegisterCommand;
+void level_preload(String name);
+
+/**
+ * Converts level file from the old version 1 format into the current memory mappable one, file is overwritten in place.
+ */
+@Introspect;
+@RegisterCommand;
+void level_convert(String name);
+
+/**
+ * Measures time it takes to read the level image from disk, stored raw versus compressed, and logs it to the console.
+ */
+@Introspect;
+@RegisterCommand;
+void level_benchmark(String name, s32 iterations);
+
 /**
  * Following function updates currently loaded level.
  */
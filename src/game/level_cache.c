@@ -0,0 +1,372 @@
+#include "game/level_cache.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/structs.h"
+#include "core/file.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+
+#include <string.h>
+
+
+typedef enum level_cache_state : u8 {
+    LEVEL_CACHE_QUEUED,         // Waiting for or being read by the worker.
+    LEVEL_CACHE_READY,
+    LEVEL_CACHE_FAILED,         // Worker couldn't read the file, entry is dropped by the main thread.
+} Level_Cache_State;
+
+typedef struct level_cache_entry {
+    char                *file_name;
+    u8                  *data;              // Malloc'ed image data, NULL if image is read straight from the mapped file.
+    u64                 size;
+    Level_Image         image;
+    u64                 last_used;
+    Level_Cache_State   state;
+} Level_Cache_Entry;
+
+
+static SDL_Thread   *worker;
+static SDL_mutex    *mutex;
+static SDL_cond     *work_cond;         // Signaled when file is queued for preload or worker should quit.
+static SDL_cond     *done_cond;         // Signaled when worker finishes reading the file.
+
+// Following variables are shared with the worker and are guarded by the mutex.
+// Entries are only ever freed by the main thread, worker only fills in the queued ones.
+static Level_Cache_Entry    **entries;
+static Level_Cache_Entry    **queue;
+static bool                 worker_quit;
+
+static u64 use_counter;
+
+
+
+static void level_cache_init() {
+    if (mutex != NULL) {
+        return;
+    }
+
+    entries = array_list_make(Level_Cache_Entry *, 8, &std_allocator);
+    queue   = array_list_make(Level_Cache_Entry *, 8, &std_allocator);
+
+    mutex     = SDL_CreateMutex();
+    work_cond = SDL_CreateCond();
+    done_cond = SDL_CreateCond();
+}
+
+static void level_cache_entry_free(Level_Cache_Entry *entry) {
+    free(entry->file_name);
+    free(entry->data);
+    level_image_close(&entry->image);
+    free(entry);
+}
+
+/**
+ * Returns index of the entry of specified level file, or -1 if there is none.
+ * Should be called with the mutex locked.
+ */
+static s64 level_cache_find(char *file_name) {
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        if (strcmp(entries[i]->file_name, file_name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Waits until entry is not queued anymore and returns its index, or -1 if it isn't cached.
+ * Should be called with the mutex locked.
+ */
+static s64 level_cache_find_settled(char *file_name) {
+    s64 index;
+    while ((index = level_cache_find(file_name)) >= 0 && entries[index]->state == LEVEL_CACHE_QUEUED) {
+        SDL_CondWait(done_cond, mutex);
+    }
+
+    return index;
+}
+
+/**
+ * Maps the level file and reads it as an image, see "level_image_from_mapping()", returns false on failure.
+ * Doesn't touch the cache, so it can be called without the mutex.
+ */
+static bool level_cache_read(char *file_name, Level_Image *image, u8 **data) {
+    *data = NULL;
+
+    File_Mapping mapping;
+    if (!file_map(file_name, &mapping)) {
+        printf_err("Couldn't open the level file for preloading '%s'.\n", file_name);
+        return false;
+    }
+
+    if (level_chunked_check_header(mapping.data, mapping.size)) {
+        printf_err("Level file '%s' is chunked, it won't be preloaded.\n", file_name);
+        file_unmap(&mapping);
+        return false;
+    }
+
+    return level_image_from_mapping(&mapping, image, data);
+}
+
+/**
+ * Fills in the queued entry with the read image, or marks it failed if it couldn't be read.
+ * Should be called with the mutex locked.
+ */
+static void level_cache_settle(Level_Cache_Entry *entry, bool read, Level_Image *image, u8 *data) {
+    if (read) {
+        entry->data  = data;
+        entry->size  = image->size;
+        entry->image = *image;
+        entry->state = LEVEL_CACHE_READY;
+    } else {
+        entry->state = LEVEL_CACHE_FAILED;
+    }
+
+    SDL_CondBroadcast(done_cond);
+}
+
+static int level_cache_worker(void *data) {
+    SDL_LockMutex(mutex);
+
+    while (true) {
+        while (!worker_quit && array_list_length(&queue) == 0) {
+            SDL_CondWait(work_cond, mutex);
+        }
+
+        if (worker_quit) {
+            break;
+        }
+
+        Level_Cache_Entry *entry = queue[0];
+        array_list_unordered_remove(&queue, 0);
+
+        SDL_UnlockMutex(mutex);
+
+        Level_Image image;
+        u8 *data;
+        bool read = level_cache_read(entry->file_name, &image, &data);
+
+        SDL_LockMutex(mutex);
+
+        level_cache_settle(entry, read, &image, data);
+    }
+
+    SDL_UnlockMutex(mutex);
+
+    return 0;
+}
+
+
+
+bool level_cache_get(char *file_name, Level_Image *image) {
+    level_cache_init();
+
+    SDL_LockMutex(mutex);
+
+    s64 index = level_cache_find_settled(file_name);
+    if (index < 0) {
+        SDL_UnlockMutex(mutex);
+        return false;
+    }
+
+    Level_Cache_Entry *entry = entries[index];
+    if (entry->state == LEVEL_CACHE_FAILED) {
+        array_list_unordered_remove(&entries, index);
+        level_cache_entry_free(entry);
+        SDL_UnlockMutex(mutex);
+        return false;
+    }
+
+    entry->last_used = ++use_counter;
+    *image = entry->image;
+
+    SDL_UnlockMutex(mutex);
+
+    return true;
+}
+
+bool level_cache_put(char *file_name, File_Mapping *mapping, Level_Image *image) {
+    level_cache_init();
+
+    Level_Image read;
+    u8 *data;
+    if (!level_image_from_mapping(mapping, &read, &data)) {
+        return false;
+    }
+
+    SDL_LockMutex(mutex);
+
+    s64 index = level_cache_find_settled(file_name);
+    if (index >= 0) {
+        level_cache_entry_free(entries[index]);
+        array_list_unordered_remove(&entries, index);
+    }
+
+    Level_Cache_Entry *entry = malloc(sizeof(Level_Cache_Entry));
+    u64 length = strlen(file_name);
+    *entry = (Level_Cache_Entry) {
+        .file_name  = malloc(length + 1),
+        .data       = data,
+        .size       = read.size,
+        .image      = read,
+        .last_used  = ++use_counter,
+        .state      = LEVEL_CACHE_READY,
+    };
+    memcpy(entry->file_name, file_name, length + 1);
+
+    array_list_append(&entries, entry);
+
+    SDL_UnlockMutex(mutex);
+
+    *image = read;
+
+    return true;
+}
+
+void level_cache_preload(char *file_name) {
+    level_cache_init();
+
+    SDL_LockMutex(mutex);
+
+    if (level_cache_find(file_name) >= 0) {
+        SDL_UnlockMutex(mutex);
+        return;
+    }
+
+    Level_Cache_Entry *entry = calloc(1, sizeof(Level_Cache_Entry));
+    u64 length = strlen(file_name);
+    entry->file_name = malloc(length + 1);
+    memcpy(entry->file_name, file_name, length + 1);
+    entry->state = LEVEL_CACHE_QUEUED;
+    entry->last_used = ++use_counter;       // Counts as used, so it isn't trimmed before it is loaded.
+
+    array_list_append(&entries, entry);
+
+    // Worker is only started once something is actually preloaded.
+    if (worker == NULL) {
+        worker = SDL_CreateThread(level_cache_worker, "level_cache", NULL);
+    }
+
+    // Without the worker file is read right away, nothing else touches the cache in the meantime.
+    if (worker == NULL) {
+        printf_err("Couldn't start level cache worker, '%s' is read on the main thread: %s\n", file_name, SDL_GetError());
+
+        Level_Image image;
+        u8 *data;
+        bool read = level_cache_read(entry->file_name, &image, &data);
+        level_cache_settle(entry, read, &image, data);
+
+        SDL_UnlockMutex(mutex);
+        return;
+    }
+
+    array_list_append(&queue, entry);
+    SDL_CondSignal(work_cond);
+
+    SDL_UnlockMutex(mutex);
+}
+
+void level_cache_trim(u64 budget) {
+    level_cache_init();
+
+    SDL_LockMutex(mutex);
+
+    while (true) {
+        u64 total = 0;
+        s64 oldest = -1;
+        u64 newest_used = 0;
+
+        for (u32 i = 0; i < array_list_length(&entries); i++) {
+            if (entries[i]->state != LEVEL_CACHE_READY) {
+                continue;
+            }
+
+            total += entries[i]->size;
+            if (entries[i]->last_used > newest_used) {
+                newest_used = entries[i]->last_used;
+            }
+            if (oldest < 0 || entries[i]->last_used < entries[oldest]->last_used) {
+                oldest = i;
+            }
+        }
+
+        if (total <= budget || oldest < 0 || entries[oldest]->last_used == newest_used) {
+            break;
+        }
+
+        Level_Cache_Entry *entry = entries[oldest];
+        array_list_unordered_remove(&entries, oldest);
+        level_cache_entry_free(entry);
+    }
+
+    SDL_UnlockMutex(mutex);
+}
+
+void level_cache_evict(char *file_name) {
+    level_cache_init();
+
+    SDL_LockMutex(mutex);
+
+    s64 index = level_cache_find_settled(file_name);
+    if (index >= 0) {
+        Level_Cache_Entry *entry = entries[index];
+        array_list_unordered_remove(&entries, index);
+        level_cache_entry_free(entry);
+    }
+
+    SDL_UnlockMutex(mutex);
+}
+
+u64 level_cache_usage(u32 *count) {
+    level_cache_init();
+
+    SDL_LockMutex(mutex);
+
+    u64 total = 0;
+    *count = 0;
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        if (entries[i]->state == LEVEL_CACHE_READY) {
+            total += entries[i]->size;
+            (*count)++;
+        }
+    }
+
+    SDL_UnlockMutex(mutex);
+
+    return total;
+}
+
+void level_cache_free() {
+    if (mutex == NULL) {
+        return;
+    }
+
+    SDL_LockMutex(mutex);
+    worker_quit = true;
+    SDL_CondSignal(work_cond);
+    SDL_UnlockMutex(mutex);
+
+    if (worker != NULL) {
+        SDL_WaitThread(worker, NULL);
+        worker = NULL;
+    }
+
+    // Worker is gone, so entries it didn't get to are simply dropped.
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        level_cache_entry_free(entries[i]);
+    }
+
+    array_list_free(&entries);
+    array_list_free(&queue);
+
+    SDL_DestroyCond(done_cond);
+    SDL_DestroyCond(work_cond);
+    SDL_DestroyMutex(mutex);
+    mutex = NULL;
+
+    worker_quit = false;
+}
@@ -0,0 +1,64 @@
+#ifndef LEVEL_CACHE_H
+#define LEVEL_CACHE_H
+
+#include "core/core.h"
+#include "core/type.h"
+
+#include "game/level_format.h"
+
+/**
+ * Level cache.
+ *
+ * Keeps version 2 images of recently loaded levels in memory, so switching back to them doesn't touch the disk and doesn't decompress or convert anything.
+ * Each cached image holds level geometry and initial entity state, restoring it is a straight copy into the level runtime arrays.
+ * Uncompressed images are kept mapped instead of being copied, others are kept decompressed or converted in memory.
+ * Least recently used images are dropped once all of them together exceed the memory budget.
+ * Images can also be preloaded on the worker thread ahead of time, for example the level that is going to be loaded next.
+ * Chunked levels are streamed and never cached.
+ * @Important: All functions below should be called from the main thread.
+ */
+
+
+/**
+ * Looks up cached image of the level file, if its preload is still in progress waits for it.
+ * Returns true and sets image if it is cached, image stays valid until the next call to "level_cache_trim()" or "level_cache_evict()".
+ */
+bool level_cache_get(char *file_name, Level_Image *image);
+
+/**
+ * Reads mapped level file as an image and puts it into the cache, cache takes ownership of the mapping.
+ * Version 2 image is read straight from the mapping, which is kept until the image is dropped, see "level_image_from_mapping()".
+ * If it was already cached, old image is replaced.
+ * Returns true and sets image on success, on failure mapping is released.
+ */
+bool level_cache_put(char *file_name, File_Mapping *mapping, Level_Image *image);
+
+/**
+ * Queues level file to be read into the cache on the worker thread, does nothing if it is already cached or queued.
+ */
+void level_cache_preload(char *file_name);
+
+/**
+ * Drops least recently used images until all cached images fit into the budget in bytes.
+ * Most recently used image is always kept.
+ */
+void level_cache_trim(u64 budget);
+
+/**
+ * Drops cached image of the level file, should be called before level file is written, as its image might keep it mapped.
+ */
+void level_cache_evict(char *file_name);
+
+/**
+ * Returns total size in bytes of all cached images and sets their number into count.
+ */
+u64 level_cache_usage(u32 *count);
+
+/**
+ * Stops the worker, waits for it to finish the file it is reading and drops all cached images.
+ * Cache can be used again afterwards, it is set up on the next call.
+ */
+void level_cache_free();
+
+
+#endif
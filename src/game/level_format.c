@@ -0,0 +1,777 @@
+#include "game/level_format.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/mathf.h"
+#include "core/structs.h"
+#include "core/file.h"
+#include "core/compress.h"
+
+#include <math.h>
+#include <string.h>
+
+// Level image arrays are used in place, so there is no byte swapping on load.
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#   error "Level format version 2 is used in place and expects little endian host."
+#endif
+
+#define align_up(value, alignment) (((value) + (alignment) - 1) & ~((alignment) - 1))
+
+static const u32 LEVEL_SECTION_ELEMENT_SIZE[LEVEL_SECTION_COUNT] = {
+    [LEVEL_SECTION_EDGE_VERTEX_X]       = sizeof(float),
+    [LEVEL_SECTION_EDGE_VERTEX_Y]       = sizeof(float),
+    [LEVEL_SECTION_EDGE_NORMAL_X]       = sizeof(float),
+    [LEVEL_SECTION_EDGE_NORMAL_Y]       = sizeof(float),
+    [LEVEL_SECTION_POLYGON_FIRST_EDGE]  = sizeof(u32),
+    [LEVEL_SECTION_POLYGON_EDGE_COUNT]  = sizeof(u32),
+    [LEVEL_SECTION_POLYGON_MIN_X]       = sizeof(float),
+    [LEVEL_SECTION_POLYGON_MIN_Y]       = sizeof(float),
+    [LEVEL_SECTION_POLYGON_MAX_X]       = sizeof(float),
+    [LEVEL_SECTION_POLYGON_MAX_Y]       = sizeof(float),
+    [LEVEL_SECTION_ENTITY_TYPE]         = sizeof(u8),
+    [LEVEL_SECTION_ENTITY_CENTER_X]     = sizeof(float),
+    [LEVEL_SECTION_ENTITY_CENTER_Y]     = sizeof(float),
+    [LEVEL_SECTION_ENTITY_WIDTH]        = sizeof(float),
+    [LEVEL_SECTION_ENTITY_HEIGHT]       = sizeof(float),
+    [LEVEL_SECTION_ENTITY_ROT]          = sizeof(float),
+    [LEVEL_SECTION_BVH_NODES]           = sizeof(Level_BVH_Node),
+    [LEVEL_SECTION_BVH_POLYGONS]        = sizeof(u32),
+};
+
+
+static inline AABB level_aabb_union(AABB a, AABB b) {
+    return aabb_make(vec2f_make(fminf(a.p0.x, b.p0.x), fminf(a.p0.y, b.p0.y)), vec2f_make(fmaxf(a.p1.x, b.p1.x), fmaxf(a.p1.y, b.p1.y)));
+}
+
+/**
+ * Recursively splits polygons in range [first, first + count) of indicies, along the longest axis of their centers.
+ */
+static void level_bvh_split(Level_BVH_Node **nodes, u32 node_index, u32 *indicies, AABB *bounds, u32 first, u32 count) {
+    AABB node_bounds = bounds[indicies[first]];
+    Vec2f center = aabb_center(node_bounds);
+    AABB center_bounds = aabb_make(center, center);
+
+    for (u32 i = first + 1; i < first + count; i++) {
+        node_bounds = level_aabb_union(node_bounds, bounds[indicies[i]]);
+        center = aabb_center(bounds[indicies[i]]);
+        center_bounds = level_aabb_union(center_bounds, aabb_make(center, center));
+    }
+
+    (*nodes)[node_index].bounds = node_bounds;
+
+    if (count <= LEVEL_BVH_LEAF_SIZE) {
+        (*nodes)[node_index].first = first;
+        (*nodes)[node_index].count = count;
+        return;
+    }
+
+    bool split_x = center_bounds.p1.x - center_bounds.p0.x >= center_bounds.p1.y - center_bounds.p0.y;
+    float split = split_x ? (center_bounds.p0.x + center_bounds.p1.x) / 2 : (center_bounds.p0.y + center_bounds.p1.y) / 2;
+
+    // Partitioning indicies in place.
+    u32 left_count = 0;
+    for (u32 i = first; i < first + count; i++) {
+        center = aabb_center(bounds[indicies[i]]);
+        if ((split_x ? center.x : center.y) < split) {
+            u32 temp = indicies[i];
+            indicies[i] = indicies[first + left_count];
+            indicies[first + left_count] = temp;
+            left_count++;
+        }
+    }
+
+    // All centers are on one side, just cut the range in half.
+    if (left_count == 0 || left_count == count) {
+        left_count = count / 2;
+    }
+
+    u32 left = array_list_length(nodes);
+    array_list_append(nodes, ((Level_BVH_Node) {0}));
+    array_list_append(nodes, ((Level_BVH_Node) {0}));
+
+    (*nodes)[node_index].first = left;
+    (*nodes)[node_index].count = 0;
+
+    level_bvh_split(nodes, left, indicies, bounds, first, left_count);
+    level_bvh_split(nodes, left + 1, indicies, bounds, first + left_count, count - left_count);
+}
+
+
+AABB level_polygon_bounds(Phys_Polygon *polygon) {
+    if (polygon->edges_count == 0) {
+        return (AABB) {0};
+    }
+
+    AABB bounds = aabb_make(polygon->edges[0].vertex, polygon->edges[0].vertex);
+    for (u32 i = 1; i < polygon->edges_count; i++) {
+        bounds = level_aabb_union(bounds, aabb_make(polygon->edges[i].vertex, polygon->edges[i].vertex));
+    }
+
+    return bounds;
+}
+
+Level_BVH_Node *level_bvh_build(AABB *bounds, u32 count, u32 **indicies) {
+    *indicies = malloc(count * sizeof(u32) + 1);
+    if (*indicies == NULL) {
+        printf_err("Memory allocation for bvh over %u bounds failed.\n", count);
+        return NULL;
+    }
+
+    Level_BVH_Node *nodes = array_list_make(Level_BVH_Node, count * 2 + 1, &std_allocator);
+    for (u32 i = 0; i < count; i++) {
+        (*indicies)[i] = i;
+    }
+
+    array_list_append(&nodes, ((Level_BVH_Node) {0}));
+    if (count > 0) {
+        level_bvh_split(&nodes, 0, *indicies, bounds, 0, count);
+    }
+
+    return nodes;
+}
+
+
+u8 *level_image_build(Level_Build_Info *info, u64 *image_size) {
+    u32 edges_count = 0;
+    for (u32 i = 0; i < info->polygons_count; i++) {
+        edges_count += info->polygons[i].edges_count;
+    }
+
+    // Polygon bounds are needed both for the section and for the bvh.
+    AABB *polygon_bounds = malloc(info->polygons_count * sizeof(AABB) + 1);
+    if (polygon_bounds == NULL) {
+        printf_err("Memory allocation for bounds of %u polygons failed.\n", info->polygons_count);
+        return NULL;
+    }
+
+    for (u32 i = 0; i < info->polygons_count; i++) {
+        polygon_bounds[i] = level_polygon_bounds(info->polygons + i);
+    }
+
+    bool build_bvh = info->build_bvh && info->polygons_count > 0;
+
+    Level_BVH_Node *bvh_nodes = NULL;
+    u32 *bvh_polygons = NULL;
+    if (build_bvh) {
+        bvh_nodes = level_bvh_build(polygon_bounds, info->polygons_count, &bvh_polygons);
+        if (bvh_nodes == NULL) {
+            free(polygon_bounds);
+            return NULL;
+        }
+    }
+
+
+    // Laying out the sections.
+    u32 section_count = build_bvh ? LEVEL_SECTION_COUNT : LEVEL_SECTION_BVH_NODES;
+    Level_Section sections[LEVEL_SECTION_COUNT];
+
+    u64 offset = align_up(sizeof(Level_File_Header) + section_count * sizeof(Level_Section), LEVEL_FORMAT_ALIGNMENT);
+    for (u32 i = 0; i < section_count; i++) {
+        u32 count;
+        if (i <= LEVEL_SECTION_EDGE_NORMAL_Y) {
+            count = edges_count;
+        } else if (i <= LEVEL_SECTION_POLYGON_MAX_Y) {
+            count = info->polygons_count;
+        } else if (i <= LEVEL_SECTION_ENTITY_ROT) {
+            count = info->entities_count;
+        } else if (i == LEVEL_SECTION_BVH_NODES) {
+            count = array_list_length(&bvh_nodes);
+        } else {
+            count = info->polygons_count;
+        }
+
+        sections[i] = (Level_Section) {
+            .id     = i,
+            .count  = count,
+            .offset = offset,
+            .size   = count * LEVEL_SECTION_ELEMENT_SIZE[i],
+        };
+
+        offset = align_up(offset + sections[i].size, LEVEL_FORMAT_ALIGNMENT);
+    }
+
+    u8 *image = calloc(offset, 1);
+    if (image == NULL) {
+        printf_err("Memory allocation for level image of %llu bytes failed.\n", offset);
+        free(polygon_bounds);
+        free(bvh_polygons);
+        if (bvh_nodes != NULL) {
+            array_list_free(&bvh_nodes);
+        }
+        return NULL;
+    }
+
+    *(Level_File_Header *)image = (Level_File_Header) {
+        .magic          = LEVEL_FORMAT_V2_HEADER,
+        .version        = LEVEL_FORMAT_VERSION,
+        .section_count  = section_count,
+        .flags          = build_bvh ? LEVEL_FILE_HAS_BVH : 0,
+    };
+    memcpy(image + sizeof(Level_File_Header), sections, section_count * sizeof(Level_Section));
+
+#define SECTION(id, type) ((type *)(image + sections[id].offset))
+
+    u32 edge_counter = 0;
+    for (u32 i = 0; i < info->polygons_count; i++) {
+        Phys_Polygon *polygon = info->polygons + i;
+
+        SECTION(LEVEL_SECTION_POLYGON_FIRST_EDGE, u32)[i] = edge_counter;
+        SECTION(LEVEL_SECTION_POLYGON_EDGE_COUNT, u32)[i] = polygon->edges_count;
+        SECTION(LEVEL_SECTION_POLYGON_MIN_X, float)[i] = polygon_bounds[i].p0.x;
+        SECTION(LEVEL_SECTION_POLYGON_MIN_Y, float)[i] = polygon_bounds[i].p0.y;
+        SECTION(LEVEL_SECTION_POLYGON_MAX_X, float)[i] = polygon_bounds[i].p1.x;
+        SECTION(LEVEL_SECTION_POLYGON_MAX_Y, float)[i] = polygon_bounds[i].p1.y;
+
+        for (u32 j = 0; j < polygon->edges_count; j++) {
+            SECTION(LEVEL_SECTION_EDGE_VERTEX_X, float)[edge_counter] = polygon->edges[j].vertex.x;
+            SECTION(LEVEL_SECTION_EDGE_VERTEX_Y, float)[edge_counter] = polygon->edges[j].vertex.y;
+            SECTION(LEVEL_SECTION_EDGE_NORMAL_X, float)[edge_counter] = polygon->edges[j].normal.x;
+            SECTION(LEVEL_SECTION_EDGE_NORMAL_Y, float)[edge_counter] = polygon->edges[j].normal.y;
+            edge_counter++;
+        }
+    }
+
+    for (u32 i = 0; i < info->entities_count; i++) {
+        SECTION(LEVEL_SECTION_ENTITY_TYPE, u8)[i] = info->entity_types[i];
+        SECTION(LEVEL_SECTION_ENTITY_CENTER_X, float)[i] = info->entity_boxes[i].center.x;
+        SECTION(LEVEL_SECTION_ENTITY_CENTER_Y, float)[i] = info->entity_boxes[i].center.y;
+        SECTION(LEVEL_SECTION_ENTITY_WIDTH, float)[i] = info->entity_boxes[i].dimensions.x;
+        SECTION(LEVEL_SECTION_ENTITY_HEIGHT, float)[i] = info->entity_boxes[i].dimensions.y;
+        SECTION(LEVEL_SECTION_ENTITY_ROT, float)[i] = info->entity_boxes[i].rot;
+    }
+
+    if (build_bvh) {
+        memcpy(SECTION(LEVEL_SECTION_BVH_NODES, u8), bvh_nodes, sections[LEVEL_SECTION_BVH_NODES].size);
+        memcpy(SECTION(LEVEL_SECTION_BVH_POLYGONS, u8), bvh_polygons, sections[LEVEL_SECTION_BVH_POLYGONS].size);
+
+        array_list_free(&bvh_nodes);
+        free(bvh_polygons);
+    }
+
+#undef SECTION
+
+    free(polygon_bounds);
+
+    *image_size = offset;
+    return image;
+}
+
+
+/**
+ * Returns true if traversing the bvh of the image stays in bounds and terminates.
+ * Children of the inner node have to come after it, and leaves have to reference bvh polygons that exist.
+ */
+static bool level_bvh_check(Level_Image *image) {
+    for (u32 i = 0; i < image->polygons_count; i++) {
+        if (image->bvh_polygons[i] >= image->polygons_count) {
+            return false;
+        }
+    }
+
+    for (u32 i = 0; i < image->bvh_nodes_count; i++) {
+        Level_BVH_Node *node = image->bvh_nodes + i;
+        if (node->count == 0) {
+            if (node->first <= i || (u64)node->first + 1 >= image->bvh_nodes_count) {
+                return false;
+            }
+        } else if ((u64)node->first + node->count > image->polygons_count) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool level_image_from_memory(u8 *data, u64 size, Level_Image *image) {
+    *image = (Level_Image) {0};
+
+    if (!level_image_check_header(data, size)) {
+        printf_err("Level image header doesn't match.\n");
+        return false;
+    }
+
+    Level_File_Header *header = (Level_File_Header *)data;
+    if (header->version != LEVEL_FORMAT_VERSION) {
+        printf_err("Level image version %u is not supported, expected version %u.\n", header->version, LEVEL_FORMAT_VERSION);
+        return false;
+    }
+
+    if (header->section_count > LEVEL_SECTION_COUNT || sizeof(Level_File_Header) + header->section_count * sizeof(Level_Section) > size) {
+        printf_err("Level image section table is corrupted.\n");
+        return false;
+    }
+
+    image->data  = data;
+    image->size  = size;
+    image->flags = header->flags;
+
+    // Counts of the sections that describe same thing should match, 0xffffffff stands for not yet seen.
+    u32 edges_count    = 0xffffffff;
+    u32 polygons_count = 0xffffffff;
+    u32 entities_count = 0xffffffff;
+
+    Level_Section *sections = (Level_Section *)(data + sizeof(Level_File_Header));
+    for (u32 i = 0; i < header->section_count; i++) {
+        Level_Section *section = sections + i;
+
+        if (section->id >= LEVEL_SECTION_COUNT || section->offset % LEVEL_FORMAT_ALIGNMENT != 0 || (u64)section->offset + section->size > size || (u64)section->count * LEVEL_SECTION_ELEMENT_SIZE[section->id] != section->size) {
+            printf_err("Level image section %u is corrupted.\n", i);
+            return false;
+        }
+
+        u32 *expected_count;
+        if (section->id <= LEVEL_SECTION_EDGE_NORMAL_Y) {
+            expected_count = &edges_count;
+        } else if (section->id <= LEVEL_SECTION_POLYGON_MAX_Y || section->id == LEVEL_SECTION_BVH_POLYGONS) {
+            expected_count = &polygons_count;
+        } else if (section->id <= LEVEL_SECTION_ENTITY_ROT) {
+            expected_count = &entities_count;
+        } else {
+            expected_count = NULL;
+        }
+
+        if (expected_count != NULL) {
+            if (*expected_count != 0xffffffff && *expected_count != section->count) {
+                printf_err("Level image section %u element count doesn't match other sections.\n", i);
+                return false;
+            }
+            *expected_count = section->count;
+        }
+
+        void *ptr = data + section->offset;
+        switch ((Level_Section_Id)section->id) {
+            case LEVEL_SECTION_EDGE_VERTEX_X:       image->edge_vertex_x = ptr; break;
+            case LEVEL_SECTION_EDGE_VERTEX_Y:       image->edge_vertex_y = ptr; break;
+            case LEVEL_SECTION_EDGE_NORMAL_X:       image->edge_normal_x = ptr; break;
+            case LEVEL_SECTION_EDGE_NORMAL_Y:       image->edge_normal_y = ptr; break;
+            case LEVEL_SECTION_POLYGON_FIRST_EDGE:  image->polygon_first_edge = ptr; break;
+            case LEVEL_SECTION_POLYGON_EDGE_COUNT:  image->polygon_edge_count = ptr; break;
+            case LEVEL_SECTION_POLYGON_MIN_X:       image->polygon_min_x = ptr; break;
+            case LEVEL_SECTION_POLYGON_MIN_Y:       image->polygon_min_y = ptr; break;
+            case LEVEL_SECTION_POLYGON_MAX_X:       image->polygon_max_x = ptr; break;
+            case LEVEL_SECTION_POLYGON_MAX_Y:       image->polygon_max_y = ptr; break;
+            case LEVEL_SECTION_ENTITY_TYPE:         image->entity_type = ptr; break;
+            case LEVEL_SECTION_ENTITY_CENTER_X:     image->entity_center_x = ptr; break;
+            case LEVEL_SECTION_ENTITY_CENTER_Y:     image->entity_center_y = ptr; break;
+            case LEVEL_SECTION_ENTITY_WIDTH:        image->entity_width = ptr; break;
+            case LEVEL_SECTION_ENTITY_HEIGHT:       image->entity_height = ptr; break;
+            case LEVEL_SECTION_ENTITY_ROT:          image->entity_rot = ptr; break;
+            case LEVEL_SECTION_BVH_NODES:
+                image->bvh_nodes = ptr;
+                image->bvh_nodes_count = section->count;
+                break;
+            case LEVEL_SECTION_BVH_POLYGONS:        image->bvh_polygons = ptr; break;
+            case LEVEL_SECTION_COUNT:               break;
+        }
+    }
+
+    if (image->edge_vertex_x == NULL || image->edge_vertex_y == NULL || image->edge_normal_x == NULL || image->edge_normal_y == NULL ||
+        image->polygon_first_edge == NULL || image->polygon_edge_count == NULL ||
+        image->polygon_min_x == NULL || image->polygon_min_y == NULL || image->polygon_max_x == NULL || image->polygon_max_y == NULL ||
+        image->entity_type == NULL || image->entity_center_x == NULL || image->entity_center_y == NULL ||
+        image->entity_width == NULL || image->entity_height == NULL || image->entity_rot == NULL) {
+        printf_err("Level image is missing required sections.\n");
+        return false;
+    }
+
+    image->edges_count    = edges_count;
+    image->polygons_count = polygons_count;
+    image->entities_count = entities_count;
+
+    for (u32 i = 0; i < image->polygons_count; i++) {
+        if ((u64)image->polygon_first_edge[i] + image->polygon_edge_count[i] > image->edges_count) {
+            printf_err("Level image polygon %u references edges out of bounds.\n", i);
+            return false;
+        }
+    }
+
+    // Bvh is optional, drop it if it is incomplete or corrupted, it is built again on load.
+    bool has_bvh = (image->flags & LEVEL_FILE_HAS_BVH) && image->bvh_nodes != NULL && image->bvh_polygons != NULL && image->bvh_nodes_count > 0;
+    if (has_bvh && !level_bvh_check(image)) {
+        printf_err("Level image bvh is corrupted, it is dropped.\n");
+        has_bvh = false;
+    }
+
+    if (!has_bvh) {
+        image->flags &= ~LEVEL_FILE_HAS_BVH;
+        image->bvh_nodes = NULL;
+        image->bvh_nodes_count = 0;
+        image->bvh_polygons = NULL;
+    }
+
+    return true;
+}
+
+
+bool level_image_open(char *file_name, Level_Image *image) {
+    File_Mapping mapping;
+    if (!file_map(file_name, &mapping)) {
+        return false;
+    }
+
+    if (!level_image_from_memory(mapping.data, mapping.size, image)) {
+        file_unmap(&mapping);
+        return false;
+    }
+
+    image->mapping = mapping;
+    return true;
+}
+
+void level_image_close(Level_Image *image) {
+    file_unmap(&image->mapping);
+    *image = (Level_Image) {0};
+}
+
+bool level_image_from_mapping(File_Mapping *mapping, Level_Image *image, u8 **data) {
+    *data = NULL;
+
+    // Version 2 image is used in place, nothing is copied.
+    if (level_image_check_header(mapping->data, mapping->size)) {
+        if (!level_image_from_memory(mapping->data, mapping->size, image)) {
+            file_unmap(mapping);
+            return false;
+        }
+
+        image->mapping = *mapping;
+        *mapping = (File_Mapping) {0};
+        return true;
+    }
+
+    u64 size;
+    *data = level_image_build_from_data(mapping->data, mapping->size, &size);
+    file_unmap(mapping);
+
+    if (*data == NULL || !level_image_from_memory(*data, size, image)) {
+        free(*data);
+        *data = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+
+u8 *level_image_build_from_v1(u8 *data, u64 size, bool build_bvh, u64 *image_size) {
+    u8 *ptr = data;
+    u8 *end = data + size;
+
+    if (size < 8 || read_u32(&ptr) != LEVEL_FORMAT_HEADER) {
+        printf_err("Level data is not in the version 1 format, header doesn't match.\n");
+        return NULL;
+    }
+
+    u32 edges_count = read_u32(&ptr);
+
+    // Every edge takes 16 bytes, so count that doesn't fit into the data is rejected before anything is allocated for it.
+    if ((u64)(end - ptr) < edges_count * 16ull) {
+        printf_err("Version 1 level data is truncated or corrupted.\n");
+        return NULL;
+    }
+
+    Phys_Edge *edges = malloc(edges_count * sizeof(Phys_Edge) + 1);
+    if (edges == NULL) {
+        printf_err("Memory allocation for %u level edges failed.\n", edges_count);
+        return NULL;
+    }
+
+    Phys_Polygon *polygons = array_list_make(Phys_Polygon, 8, &std_allocator);
+    Entity_Type *entity_types = NULL;
+    OBB *entity_boxes = NULL;
+    u8 *image = NULL;
+
+    u32 edge_counter = 0;
+    while (edge_counter < edges_count) {
+        if (end - ptr < 4) {
+            goto truncated;
+        }
+
+        u32 polygon_edges_count = read_u32(&ptr);
+        if (polygon_edges_count > edges_count - edge_counter || (u64)(end - ptr) < polygon_edges_count * 16ull) {
+            goto truncated;
+        }
+
+        array_list_append(&polygons, ((Phys_Polygon) { .edges_count = polygon_edges_count, .edges = edges + edge_counter }));
+        for (u32 i = 0; i < polygon_edges_count; i++) {
+            edges[edge_counter + i].vertex.x = read_float(&ptr);
+            edges[edge_counter + i].vertex.y = read_float(&ptr);
+            edges[edge_counter + i].normal.x = read_float(&ptr);
+            edges[edge_counter + i].normal.y = read_float(&ptr);
+        }
+
+        edge_counter += polygon_edges_count;
+    }
+
+    if (end - ptr < 4) {
+        goto truncated;
+    }
+
+    u32 entities_count = read_u32(&ptr);
+    if ((u64)(end - ptr) < entities_count * 21ull) {
+        goto truncated;
+    }
+
+    entity_types = malloc(entities_count * sizeof(Entity_Type) + 1);
+    entity_boxes = malloc(entities_count * sizeof(OBB) + 1);
+    if (entity_types == NULL || entity_boxes == NULL) {
+        printf_err("Memory allocation for %u level entities failed.\n", entities_count);
+        goto cleanup;
+    }
+
+    for (u32 i = 0; i < entities_count; i++) {
+        entity_types[i] = read_byte(&ptr);
+        entity_boxes[i].center.x = read_float(&ptr);
+        entity_boxes[i].center.y = read_float(&ptr);
+        entity_boxes[i].dimensions.x = read_float(&ptr);
+        entity_boxes[i].dimensions.y = read_float(&ptr);
+        entity_boxes[i].rot = read_float(&ptr);
+    }
+
+    Level_Build_Info info = {
+        .polygons       = polygons,
+        .polygons_count = array_list_length(&polygons),
+        .entity_types   = entity_types,
+        .entity_boxes   = entity_boxes,
+        .entities_count = entities_count,
+        .build_bvh      = build_bvh,
+    };
+
+    image = level_image_build(&info, image_size);
+    goto cleanup;
+
+truncated:
+    printf_err("Version 1 level data is truncated or corrupted.\n");
+
+cleanup:
+    free(edges);
+    free(entity_types);
+    free(entity_boxes);
+    array_list_free(&polygons);
+
+    return image;
+}
+
+u8 *level_image_build_from_data(u8 *data, u64 size, u64 *image_size) {
+    u8 *decompressed = NULL;
+
+    if (compress_check_header(data, size)) {
+        decompressed = decompress_buffer(data, size, &size);
+        if (decompressed == NULL) {
+            printf_err("Couldn't decompress level data.\n");
+            return NULL;
+        }
+        data = decompressed;
+    }
+
+    if (level_image_check_header(data, size)) {
+        if (decompressed != NULL) {
+            *image_size = size;
+            return decompressed;
+        }
+
+        u8 *image = malloc(size);
+        if (image == NULL) {
+            printf_err("Memory allocation for level image of %llu bytes failed.\n", size);
+            return NULL;
+        }
+        memcpy(image, data, size);
+        *image_size = size;
+        return image;
+    }
+
+    u8 *image = level_image_build_from_v1(data, size, false, image_size);
+    free(decompressed);
+
+    return image;
+}
+
+
+
+/**
+ * Polygon or entity that goes into the chunk of the cell.
+ */
+typedef struct level_cell_item {
+    s32 x;
+    s32 y;
+    u32 index;                  // Index of the polygon, or index of the entity after all of the polygons.
+} Level_Cell_Item;
+
+static int level_compare_cell_items(const void *a, const void *b) {
+    const Level_Cell_Item *item_a = a;
+    const Level_Cell_Item *item_b = b;
+
+    if (item_a->x != item_b->x) {
+        return (item_a->x > item_b->x) - (item_a->x < item_b->x);
+    }
+    if (item_a->y != item_b->y) {
+        return (item_a->y > item_b->y) - (item_a->y < item_b->y);
+    }
+    return (item_a->index > item_b->index) - (item_a->index < item_b->index);
+}
+
+/**
+ * Builds image out of the chunk build info and compresses it if needed.
+ */
+static u8 *level_chunk_image_build(Level_Build_Info *chunk_info, bool compress, u64 *size) {
+    u8 *image = level_image_build(chunk_info, size);
+    if (image == NULL || !compress) {
+        return image;
+    }
+
+    u8 *packed = compress_buffer(image, *size, size);
+    free(image);
+    return packed;
+}
+
+u8 *level_chunked_build(Level_Build_Info *info, float chunk_size, bool compress, u64 *size) {
+    if (chunk_size <= 0.0f) {
+        printf_err("Couldn't build chunked level, chunk size should be positive.\n");
+        return NULL;
+    }
+
+    u8 *result = NULL;
+
+    // Global image goes first, followed by the chunks.
+    u8 **images = array_list_make(u8 *, 16, &std_allocator);
+    u64 *images_size = array_list_make(u64, 16, &std_allocator);
+    s32 *cells = array_list_make(s32, 32, &std_allocator);
+
+    // Every item is put into its cell once, then items are sorted, so each chunk is a run of them.
+    Level_Cell_Item *items = malloc((info->polygons_count + info->entities_count) * sizeof(Level_Cell_Item) + 1);
+    u32 items_count = 0;
+
+    // Chunk build info is filled in these, one chunk after another.
+    Level_Build_Info chunk_info = {
+        .polygons       = malloc(info->polygons_count * sizeof(Phys_Polygon) + 1),
+        .entity_types   = malloc(info->entities_count * sizeof(Entity_Type) + 1),
+        .entity_boxes   = malloc(info->entities_count * sizeof(OBB) + 1),
+        .build_bvh      = info->build_bvh,
+    };
+
+    if (items == NULL || chunk_info.polygons == NULL || chunk_info.entity_types == NULL || chunk_info.entity_boxes == NULL) {
+        printf_err("Memory allocation for building chunked level failed.\n");
+        goto cleanup;
+    }
+
+    for (u32 i = 0; i < info->polygons_count; i++) {
+        Phys_Polygon *polygon = info->polygons + i;
+        Vec2f center = VEC2F_ORIGIN;
+
+        // Polygon belongs to the chunk of its bounds center.
+        if (polygon->edges_count > 0) {
+            AABB bounds = aabb_make(polygon->edges[0].vertex, polygon->edges[0].vertex);
+            for (u32 j = 1; j < polygon->edges_count; j++) {
+                bounds = level_aabb_union(bounds, aabb_make(polygon->edges[j].vertex, polygon->edges[j].vertex));
+            }
+            center = aabb_center(bounds);
+        }
+
+        items[items_count++] = (Level_Cell_Item) { (s32)floorf(center.x / chunk_size), (s32)floorf(center.y / chunk_size), i };
+    }
+
+    // Player goes into the global image, so it is never streamed out.
+    for (u32 i = 0; i < info->entities_count; i++) {
+        if (info->entity_types[i] == PLAYER) {
+            chunk_info.entity_types[chunk_info.entities_count] = info->entity_types[i];
+            chunk_info.entity_boxes[chunk_info.entities_count] = info->entity_boxes[i];
+            chunk_info.entities_count++;
+            continue;
+        }
+
+        Vec2f center = info->entity_boxes[i].center;
+        items[items_count++] = (Level_Cell_Item) { (s32)floorf(center.x / chunk_size), (s32)floorf(center.y / chunk_size), info->polygons_count + i };
+    }
+
+    u64 image_size;
+    u8 *image = level_chunk_image_build(&chunk_info, compress, &image_size);
+    if (image == NULL) {
+        goto cleanup;
+    }
+    array_list_append(&images, image);
+    array_list_append(&images_size, image_size);
+
+    qsort(items, items_count, sizeof(Level_Cell_Item), level_compare_cell_items);
+
+    for (u32 start = 0; start < items_count;) {
+        chunk_info.polygons_count = 0;
+        chunk_info.entities_count = 0;
+
+        u32 end = start;
+        for (; end < items_count && items[end].x == items[start].x && items[end].y == items[start].y; end++) {
+            u32 index = items[end].index;
+
+            if (index < info->polygons_count) {
+                chunk_info.polygons[chunk_info.polygons_count++] = info->polygons[index];
+            } else {
+                chunk_info.entity_types[chunk_info.entities_count] = info->entity_types[index - info->polygons_count];
+                chunk_info.entity_boxes[chunk_info.entities_count] = info->entity_boxes[index - info->polygons_count];
+                chunk_info.entities_count++;
+            }
+        }
+
+        image = level_chunk_image_build(&chunk_info, compress, &image_size);
+        if (image == NULL) {
+            goto cleanup;
+        }
+        array_list_append(&images, image);
+        array_list_append(&images_size, image_size);
+        array_list_append(&cells, items[start].x);
+        array_list_append(&cells, items[start].y);
+
+        start = end;
+    }
+
+    u32 chunk_count = array_list_length(&cells) / 2;
+
+    u64 first_offset = align_up(sizeof(Level_Chunked_Header) + chunk_count * sizeof(Level_Chunk_Entry), LEVEL_FORMAT_ALIGNMENT);
+    u64 offset = first_offset;
+    for (u32 i = 0; i < chunk_count + 1; i++) {
+        offset = align_up(offset + images_size[i], LEVEL_FORMAT_ALIGNMENT);
+    }
+
+    result = calloc(offset, 1);
+    if (result == NULL) {
+        printf_err("Memory allocation for chunked level failed.\n");
+        goto cleanup;
+    }
+    *size = offset;
+
+    *(Level_Chunked_Header *)result = (Level_Chunked_Header) {
+        .magic          = LEVEL_CHUNKED_HEADER,
+        .version        = LEVEL_FORMAT_VERSION,
+        .chunk_size     = chunk_size,
+        .chunk_count    = chunk_count,
+        .global_offset  = first_offset,
+        .global_size    = images_size[0],
+    };
+
+    Level_Chunk_Entry *entries = (Level_Chunk_Entry *)(result + sizeof(Level_Chunked_Header));
+    offset = first_offset;
+    for (u32 i = 0; i < chunk_count + 1; i++) {
+        if (i > 0) {
+            entries[i - 1] = (Level_Chunk_Entry) {
+                .x      = cells[(i - 1) * 2],
+                .y      = cells[(i - 1) * 2 + 1],
+                .offset = offset,
+                .size   = images_size[i],
+            };
+        }
+
+        memcpy(result + offset, images[i], images_size[i]);
+        offset = align_up(offset + images_size[i], LEVEL_FORMAT_ALIGNMENT);
+    }
+
+cleanup:
+    for (u32 i = 0; i < array_list_length(&images); i++) {
+        free(images[i]);
+    }
+    array_list_free(&images);
+    array_list_free(&images_size);
+    array_list_free(&cells);
+    free(items);
+    free(chunk_info.polygons);
+    free(chunk_info.entity_types);
+    free(chunk_info.entity_boxes);
+
+    return result;
+}
@@ -0,0 +1,276 @@
+#ifndef LEVEL_FORMAT_H
+#define LEVEL_FORMAT_H
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/mathf.h"
+#include "core/file.h"
+
+#include "game/level.h"
+#include "game/physics.h"
+
+/**
+ * Level format version 2.
+ *
+ * Unlike the first version, that is parsed value by value, this one is layed out the way it can be memory mapped and used in place.
+ * File starts with the header, followed by the section table, followed by the sections themselves.
+ * Every section is a tightly packed array (struct of arrays) of one component, starting at 16 byte aligned offset from the beginning of the file.
+ * All values are little endian.
+ *
+ *  |--------------------|
+ *  | Level_File_Header  |   16 bytes.
+ *  |--------------------|
+ *  | Level_Section[]    |   16 bytes * section_count.
+ *  |--------------------|
+ *  | section data ...   |   Each aligned to LEVEL_FORMAT_ALIGNMENT.
+ *  |--------------------|
+ *
+ * @Important: Old version 1 files (LEVEL_FORMAT_HEADER) are still readable by the "level_load()", use "level_convert()" to upgrade them.
+ */
+
+// 0x6c65766d stands for 'levm' in ascii, as in mappable level.
+#define LEVEL_FORMAT_V2_HEADER  0x6c65766d
+#define LEVEL_FORMAT_VERSION    2
+#define LEVEL_FORMAT_ALIGNMENT  16
+
+// Max polygons referenced by single leaf node of the bvh.
+#define LEVEL_BVH_LEAF_SIZE     4
+
+typedef enum level_file_flags : u32 {
+    LEVEL_FILE_HAS_BVH = 0x01,
+} Level_File_Flags;
+
+typedef struct level_file_header {
+    u32 magic;              // LEVEL_FORMAT_V2_HEADER.
+    u32 version;            // LEVEL_FORMAT_VERSION.
+    u32 section_count;
+    u32 flags;              // Level_File_Flags.
+} Level_File_Header;
+
+typedef enum level_section_id : u32 {
+    LEVEL_SECTION_EDGE_VERTEX_X,        // float[edges_count]
+    LEVEL_SECTION_EDGE_VERTEX_Y,        // float[edges_count]
+    LEVEL_SECTION_EDGE_NORMAL_X,        // float[edges_count]
+    LEVEL_SECTION_EDGE_NORMAL_Y,        // float[edges_count]
+
+    LEVEL_SECTION_POLYGON_FIRST_EDGE,   // u32[polygons_count]
+    LEVEL_SECTION_POLYGON_EDGE_COUNT,   // u32[polygons_count]
+    LEVEL_SECTION_POLYGON_MIN_X,        // float[polygons_count]
+    LEVEL_SECTION_POLYGON_MIN_Y,        // float[polygons_count]
+    LEVEL_SECTION_POLYGON_MAX_X,        // float[polygons_count]
+    LEVEL_SECTION_POLYGON_MAX_Y,        // float[polygons_count]
+
+    LEVEL_SECTION_ENTITY_TYPE,          // u8[entities_count]
+    LEVEL_SECTION_ENTITY_CENTER_X,      // float[entities_count]
+    LEVEL_SECTION_ENTITY_CENTER_Y,      // float[entities_count]
+    LEVEL_SECTION_ENTITY_WIDTH,         // float[entities_count]
+    LEVEL_SECTION_ENTITY_HEIGHT,        // float[entities_count]
+    LEVEL_SECTION_ENTITY_ROT,           // float[entities_count]
+
+    LEVEL_SECTION_BVH_NODES,            // Level_BVH_Node[bvh_nodes_count], only if LEVEL_FILE_HAS_BVH.
+    LEVEL_SECTION_BVH_POLYGONS,         // u32[polygons_count], polygon indicies referenced by leaves, only if LEVEL_FILE_HAS_BVH.
+
+    LEVEL_SECTION_COUNT,
+} Level_Section_Id;
+
+typedef struct level_section {
+    u32 id;                 // Level_Section_Id.
+    u32 count;              // Number of elements in the section.
+    u32 offset;             // Offset in bytes from the beginning of the file, aligned to LEVEL_FORMAT_ALIGNMENT.
+    u32 size;               // Size in bytes.
+} Level_Section;
+
+/**
+ * Node of the bounding volume hierarchy built over polygon bounds.
+ * Root is always node 0, children of the inner node are always stored next to each other.
+ */
+typedef struct level_bvh_node {
+    AABB bounds;
+    u32  first;             // Inner node: index of the left child, right child is first + 1. Leaf: index into bvh polygons section.
+    u32  count;             // Number of polygons in the leaf, 0 for inner nodes.
+} Level_BVH_Node;
+
+/**
+ * Returns bounds of all polygon vertices.
+ */
+AABB level_polygon_bounds(Phys_Polygon *polygon);
+
+/**
+ * Builds bvh over the array of bounds, leaves reference at most LEVEL_BVH_LEAF_SIZE of them.
+ * Returns array list of nodes and sets malloc'ed array of bounds indicies, referenced by leaves, into indicies.
+ * Returns NULL if memory for the indicies couldn't be allocated.
+ * @Important: Both nodes array list and indicies should be freed manually when not used anymore.
+ */
+Level_BVH_Node *level_bvh_build(AABB *bounds, u32 count, u32 **indicies);
+
+
+/**
+ * Level image is a read only view over the version 2 level data, all pointers point directly into the image memory.
+ */
+typedef struct level_image {
+    u8              *data;
+    u64             size;
+    File_Mapping    mapping;                // Non empty if image is backed by the mapped file.
+
+    u32             flags;                  // Level_File_Flags.
+
+    u32             edges_count;
+    float           *edge_vertex_x;
+    float           *edge_vertex_y;
+    float           *edge_normal_x;
+    float           *edge_normal_y;
+
+    u32             polygons_count;
+    u32             *polygon_first_edge;
+    u32             *polygon_edge_count;
+    float           *polygon_min_x;
+    float           *polygon_min_y;
+    float           *polygon_max_x;
+    float           *polygon_max_y;
+
+    u32             entities_count;
+    u8              *entity_type;
+    float           *entity_center_x;
+    float           *entity_center_y;
+    float           *entity_width;
+    float           *entity_height;
+    float           *entity_rot;
+
+    u32             bvh_nodes_count;
+    Level_BVH_Node  *bvh_nodes;
+    u32             *bvh_polygons;
+} Level_Image;
+
+
+/**
+ * Everything needed to build level image.
+ * Edges of each polygon are serialized in order they are stored in the polygon.
+ */
+typedef struct level_build_info {
+    Phys_Polygon    *polygons;
+    u32             polygons_count;
+
+    Entity_Type     *entity_types;
+    OBB             *entity_boxes;
+    u32             entities_count;
+
+    bool            build_bvh;
+} Level_Build_Info;
+
+/**
+ * Serializes level described by build info into the version 2 level image.
+ * Returns pointer to malloc'ed image and sets its size in bytes into image_size.
+ * Returns NULL on failure.
+ * @Important: Image should be freed manually when not used anymore.
+ */
+u8 *level_image_build(Level_Build_Info *info, u64 *image_size);
+
+/**
+ * Validates version 2 level data in memory and points image arrays into it, data isn't copied.
+ * Returns true on success.
+ * @Important: Data should stay alive and unchanged for as long as image is used.
+ */
+bool level_image_from_memory(u8 *data, u64 size, Level_Image *image);
+
+/**
+ * Memory maps version 2 level file and reads it as an image.
+ * Returns true on success.
+ * @Important: Image should be closed with "level_image_close()" when not used anymore.
+ */
+bool level_image_open(char *file_name, Level_Image *image);
+
+/**
+ * Releases file mapping of the image if it has one.
+ */
+void level_image_close(Level_Image *image);
+
+/**
+ * Reads any non chunked level data of the mapped file as an image.
+ * Version 2 image is read in place and takes over the mapping, it should be closed with "level_image_close()" when not used anymore.
+ * Compressed and version 1 data is built into malloc'ed image data set into data, mapping is released then.
+ * Returns true on success, on failure mapping is released.
+ * @Important: Data should be freed manually when not used anymore.
+ */
+bool level_image_from_mapping(File_Mapping *mapping, Level_Image *image, u8 **data);
+
+/**
+ * Parses version 1 level data (LEVEL_FORMAT_HEADER) and builds version 2 image out of it.
+ * Returns pointer to malloc'ed image and sets its size in bytes into image_size.
+ * Returns NULL if data is not a valid version 1 level.
+ * @Important: Image should be freed manually when not used anymore.
+ */
+u8 *level_image_build_from_v1(u8 *data, u64 size, bool build_bvh, u64 *image_size);
+
+/**
+ * Builds version 2 image out of any non chunked level data: version 2 data is copied, compressed data is decompressed, version 1 data is converted.
+ * Returns pointer to malloc'ed image and sets its size in bytes into image_size.
+ * Returns NULL on failure, image isn't validated beyond the header.
+ * @Important: Image should be freed manually when not used anymore.
+ */
+u8 *level_image_build_from_data(u8 *data, u64 size, u64 *image_size);
+
+/**
+ * Chunked level.
+ *
+ * Large levels are split on the square grid of chunks, so they can be streamed in and out around the camera.
+ * Each chunk is a separate version 2 image (optionally compressed) with polygons and entities which centers lie inside the chunk.
+ * Entities that should always be around, like the player, are put into the global image instead.
+ *
+ *  |----------------------|
+ *  | Level_Chunked_Header |   32 bytes.
+ *  |----------------------|
+ *  | Level_Chunk_Entry[]  |   16 bytes * chunk_count.
+ *  |----------------------|
+ *  | global image         |
+ *  | chunk images ...     |   Each aligned to LEVEL_FORMAT_ALIGNMENT.
+ *  |----------------------|
+ */
+
+// 0x6c65766b stands for 'levk' in ascii, as in chunked level.
+#define LEVEL_CHUNKED_HEADER    0x6c65766b
+
+typedef struct level_chunked_header {
+    u32     magic;              // LEVEL_CHUNKED_HEADER.
+    u32     version;            // LEVEL_FORMAT_VERSION of the chunk images.
+    float   chunk_size;         // Side of the chunk in world units.
+    u32     chunk_count;
+    u32     global_offset;      // Image that is always resident.
+    u32     global_size;
+    u32     reserved[2];
+} Level_Chunked_Header;
+
+typedef struct level_chunk_entry {
+    s32 x;                      // Chunk grid coordinates, chunk covers [x * chunk_size, (x + 1) * chunk_size).
+    s32 y;
+    u32 offset;                 // Offset of the chunk image from the beginning of the file.
+    u32 size;                   // Size of the chunk image, it might be compressed.
+} Level_Chunk_Entry;
+
+/**
+ * Splits level described by build info into the chunks of specified size and serializes it into chunked level.
+ * If compress is true, each chunk image is compressed separately.
+ * Returns pointer to malloc'ed data and sets its size in bytes into size.
+ * Returns NULL on failure.
+ * @Important: Data should be freed manually when not used anymore.
+ */
+u8 *level_chunked_build(Level_Build_Info *info, float chunk_size, bool compress, u64 *size);
+
+/**
+ * Returns true if data starts with the chunked level header.
+ */
+static inline bool level_chunked_check_header(u8 *data, u64 size) {
+    u8 *ptr = data;
+    return size >= sizeof(Level_Chunked_Header) && read_u32(&ptr) == LEVEL_CHUNKED_HEADER;
+}
+
+/**
+ * Returns true if data starts with the version 2 level header.
+ */
+static inline bool level_image_check_header(u8 *data, u64 size) {
+    u8 *ptr = data;
+    return size >= sizeof(Level_File_Header) && read_u32(&ptr) == LEVEL_FORMAT_V2_HEADER;
+}
+
+
+
+#endif
@@ -0,0 +1,412 @@
+#include "game/level_stream.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/mathf.h"
+#include "core/structs.h"
+#include "core/file.h"
+#include "core/compress.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+
+static bool         stream_open = false;
+static File_Mapping stream_mapping;
+
+static Level_Chunk  *chunks;
+static u32          chunks_count;
+
+static SDL_Thread   *worker;
+static SDL_mutex    *mutex;
+static SDL_cond     *work_cond;         // Signaled when chunk is queued or worker should quit.
+static SDL_cond     *idle_cond;         // Signaled when worker finishes decoding the chunk.
+
+// Following variables are shared with the worker and are guarded by the mutex.
+static u32          *queue;             // Indicies of the chunks waiting to be decoded.
+static u32          *decoded;           // Indicies of the chunks that were decoded, but not picked up by the main thread.
+static bool         worker_quit;
+static bool         worker_busy;
+static Vec2f        request_center;
+static float        request_radius;
+
+
+
+static bool level_chunk_in_radius(Level_Chunk *chunk, Vec2f center, float radius) {
+    Vec2f closest = vec2f_make(fmaxf(chunk->bounds.p0.x, fminf(center.x, chunk->bounds.p1.x)), fmaxf(chunk->bounds.p0.y, fminf(center.y, chunk->bounds.p1.y)));
+    return vec2f_distance(closest, center) <= radius;
+}
+
+/**
+ * Decodes chunk image into the runtime arrays, happens on the worker thread, or on the main thread if the worker couldn't be started.
+ */
+static void level_stream_decode(Level_Chunk *chunk) {
+    u8 *data = stream_mapping.data + chunk->entry.offset;
+    u64 size = chunk->entry.size;
+    u8 *decompressed = NULL;
+
+    if (compress_check_header(data, size)) {
+        decompressed = decompress_buffer(data, size, &size);
+        data = decompressed;
+    }
+
+    Level_Image image;
+    if (data == NULL || !level_image_from_memory(data, size, &image)) {
+        printf_err("Couldn't decode level chunk (%d, %d).\n", chunk->entry.x, chunk->entry.y);
+        chunk->failed = true;
+        free(decompressed);
+        return;
+    }
+
+    Phys_Edge       *edges          = malloc(image.edges_count * sizeof(Phys_Edge) + 1);
+    Phys_Polygon    *polygons       = malloc(image.polygons_count * sizeof(Phys_Polygon) + 1);
+    AABB            *polygon_bounds = malloc(image.polygons_count * sizeof(AABB) + 1);
+    Entity_Type     *entity_types   = malloc(image.entities_count * sizeof(Entity_Type) + 1);
+    OBB             *entity_boxes   = malloc(image.entities_count * sizeof(OBB) + 1);
+    Entity          **entities      = calloc(image.entities_count + 1, sizeof(Entity *));
+
+    if (edges == NULL || polygons == NULL || polygon_bounds == NULL || entity_types == NULL || entity_boxes == NULL || entities == NULL) {
+        printf_err("Couldn't allocate memory for level chunk (%d, %d).\n", chunk->entry.x, chunk->entry.y);
+        chunk->failed = true;
+        free(edges);
+        free(polygons);
+        free(polygon_bounds);
+        free(entity_types);
+        free(entity_boxes);
+        free(entities);
+        free(decompressed);
+        return;
+    }
+
+    chunk->edges_count = image.edges_count;
+    chunk->edges = edges;
+    for (u32 i = 0; i < image.edges_count; i++) {
+        chunk->edges[i].vertex = vec2f_make(image.edge_vertex_x[i], image.edge_vertex_y[i]);
+        chunk->edges[i].normal = vec2f_make(image.edge_normal_x[i], image.edge_normal_y[i]);
+    }
+
+    chunk->polygons_count = image.polygons_count;
+    chunk->polygons = polygons;
+    chunk->polygon_bounds = polygon_bounds;
+    for (u32 i = 0; i < image.polygons_count; i++) {
+        chunk->polygons[i] = (Phys_Polygon) { .edges_count = image.polygon_edge_count[i], .edges = chunk->edges + image.polygon_first_edge[i] };
+        chunk->polygon_bounds[i] = aabb_make(vec2f_make(image.polygon_min_x[i], image.polygon_min_y[i]), vec2f_make(image.polygon_max_x[i], image.polygon_max_y[i]));
+    }
+
+    chunk->entities_count = image.entities_count;
+    chunk->entity_types = entity_types;
+    chunk->entity_boxes = entity_boxes;
+    chunk->entities = entities;
+    for (u32 i = 0; i < image.entities_count; i++) {
+        chunk->entity_types[i] = image.entity_type[i];
+        chunk->entity_boxes[i] = obb_make(vec2f_make(image.entity_center_x[i], image.entity_center_y[i]), image.entity_width[i], image.entity_height[i], image.entity_rot[i]);
+    }
+
+    free(decompressed);
+}
+
+/**
+ * Removes the queued chunk closest to the last requested center from the queue and returns its index.
+ * Should be called with the mutex locked and the queue not empty.
+ */
+static u32 level_stream_take_closest() {
+    u32 best = 0;
+    float best_distance = FLT_MAX;
+    for (u32 i = 0; i < array_list_length(&queue); i++) {
+        float distance = vec2f_distance(aabb_center(chunks[queue[i]].bounds), request_center);
+        if (distance < best_distance) {
+            best = i;
+            best_distance = distance;
+        }
+    }
+
+    u32 index = queue[best];
+    array_list_unordered_remove(&queue, best);
+
+    return index;
+}
+
+/**
+ * Decodes the closest queued chunk on the caller thread, used when the worker couldn't be started.
+ * Returns false if nothing is queued.
+ */
+static bool level_stream_decode_next() {
+    if (array_list_length(&queue) == 0) {
+        return false;
+    }
+
+    u32 index = level_stream_take_closest();
+    level_stream_decode(chunks + index);
+    array_list_append(&decoded, index);
+
+    return true;
+}
+
+static int level_stream_worker(void *data) {
+    SDL_LockMutex(mutex);
+
+    while (true) {
+        while (!worker_quit && array_list_length(&queue) == 0) {
+            SDL_CondWait(work_cond, mutex);
+        }
+
+        if (worker_quit) {
+            break;
+        }
+
+        u32 index = level_stream_take_closest();
+        worker_busy = true;
+
+        SDL_UnlockMutex(mutex);
+
+        level_stream_decode(chunks + index);
+
+        SDL_LockMutex(mutex);
+
+        worker_busy = false;
+        array_list_append(&decoded, index);
+        SDL_CondBroadcast(idle_cond);
+    }
+
+    SDL_UnlockMutex(mutex);
+
+    return 0;
+}
+
+
+
+bool level_stream_open(File_Mapping *mapping, Level_Image *global_image, u8 **global_data) {
+    level_stream_close();
+
+    *global_data = NULL;
+
+    if (!level_chunked_check_header(mapping->data, mapping->size)) {
+        printf_err("Couldn't open level stream, chunked level header doesn't match.\n");
+        return false;
+    }
+
+    Level_Chunked_Header *header = (Level_Chunked_Header *)mapping->data;
+    if (header->version != LEVEL_FORMAT_VERSION || !(header->chunk_size > 0.0f) || sizeof(Level_Chunked_Header) + (u64)header->chunk_count * sizeof(Level_Chunk_Entry) > mapping->size || (u64)header->global_offset + header->global_size > mapping->size) {
+        printf_err("Couldn't open level stream, chunked level header is corrupted.\n");
+        return false;
+    }
+
+    Level_Chunk_Entry *entries = (Level_Chunk_Entry *)(mapping->data + sizeof(Level_Chunked_Header));
+    for (u32 i = 0; i < header->chunk_count; i++) {
+        if ((u64)entries[i].offset + entries[i].size > mapping->size) {
+            printf_err("Couldn't open level stream, chunk %u is out of bounds.\n", i);
+            return false;
+        }
+    }
+
+    // Global image is needed right away, so it is decoded on the caller thread.
+    u8 *data = mapping->data + header->global_offset;
+    u64 size = header->global_size;
+
+    if (compress_check_header(data, size)) {
+        *global_data = decompress_buffer(data, size, &size);
+        data = *global_data;
+    }
+
+    if (data == NULL || !level_image_from_memory(data, size, global_image)) {
+        printf_err("Couldn't open level stream, global image is corrupted.\n");
+        free(*global_data);
+        *global_data = NULL;
+        return false;
+    }
+
+    chunks_count = header->chunk_count;
+    chunks = calloc(chunks_count + 1, sizeof(Level_Chunk));
+    for (u32 i = 0; i < chunks_count; i++) {
+        chunks[i].entry  = entries[i];
+        chunks[i].bounds = aabb_make(vec2f_make(entries[i].x * header->chunk_size, entries[i].y * header->chunk_size), vec2f_make((entries[i].x + 1) * header->chunk_size, (entries[i].y + 1) * header->chunk_size));
+        chunks[i].state  = LEVEL_CHUNK_UNLOADED;
+    }
+
+    queue   = array_list_make(u32, 16, &std_allocator);
+    decoded = array_list_make(u32, 16, &std_allocator);
+
+    worker_quit    = false;
+    worker_busy    = false;
+    request_center = VEC2F_ORIGIN;
+    request_radius = 0.0f;
+
+    stream_mapping = *mapping;
+
+    mutex     = SDL_CreateMutex();
+    work_cond = SDL_CreateCond();
+    idle_cond = SDL_CreateCond();
+    worker    = SDL_CreateThread(level_stream_worker, "level_stream", NULL);
+
+    if (worker == NULL) {
+        printf_err("Couldn't start level stream worker, chunks will be decoded on the main thread: %s\n", SDL_GetError());
+    }
+
+    stream_open = true;
+
+    return true;
+}
+
+void level_stream_close() {
+    if (!stream_open) {
+        return;
+    }
+
+    SDL_LockMutex(mutex);
+    worker_quit = true;
+    SDL_CondSignal(work_cond);
+    SDL_UnlockMutex(mutex);
+
+    if (worker != NULL) {
+        SDL_WaitThread(worker, NULL);
+        worker = NULL;
+    }
+
+    SDL_DestroyCond(idle_cond);
+    SDL_DestroyCond(work_cond);
+    SDL_DestroyMutex(mutex);
+
+    for (u32 i = 0; i < chunks_count; i++) {
+        level_stream_release(chunks + i);
+    }
+
+    free(chunks);
+    chunks = NULL;
+    chunks_count = 0;
+
+    array_list_free(&queue);
+    array_list_free(&decoded);
+
+    file_unmap(&stream_mapping);
+
+    stream_open = false;
+}
+
+bool level_stream_active() {
+    return stream_open;
+}
+
+
+void level_stream_request(Vec2f center, float radius) {
+    if (!stream_open) {
+        return;
+    }
+
+    SDL_LockMutex(mutex);
+
+    request_center = center;
+    request_radius = radius;
+
+    bool queued = false;
+    for (u32 i = 0; i < chunks_count; i++) {
+        if (chunks[i].state != LEVEL_CHUNK_UNLOADED || chunks[i].failed || !level_chunk_in_radius(chunks + i, center, radius)) {
+            continue;
+        }
+
+        chunks[i].state = LEVEL_CHUNK_QUEUED;
+        array_list_append(&queue, i);
+        queued = true;
+    }
+
+    if (queued) {
+        SDL_CondSignal(work_cond);
+    }
+
+    SDL_UnlockMutex(mutex);
+}
+
+Level_Chunk *level_stream_pop_decoded() {
+    if (!stream_open) {
+        return NULL;
+    }
+
+    while (true) {
+        SDL_LockMutex(mutex);
+
+        // Without the worker one chunk is decoded per call, so caller's budget still applies.
+        if (worker == NULL && array_list_length(&decoded) == 0) {
+            level_stream_decode_next();
+        }
+
+        if (array_list_length(&decoded) == 0) {
+            SDL_UnlockMutex(mutex);
+            return NULL;
+        }
+
+        u32 index = decoded[0];
+        array_list_unordered_remove(&decoded, 0);
+
+        SDL_UnlockMutex(mutex);
+
+        Level_Chunk *chunk = chunks + index;
+
+        // Camera might have moved away while chunk was being decoded.
+        if (chunk->failed || !level_chunk_in_radius(chunk, request_center, request_radius)) {
+            level_stream_release(chunk);
+            continue;
+        }
+
+        chunk->state = LEVEL_CHUNK_RESIDENT;
+        return chunk;
+    }
+}
+
+Level_Chunk *level_stream_next_far(Vec2f center, float radius) {
+    for (u32 i = 0; i < chunks_count; i++) {
+        if (chunks[i].state == LEVEL_CHUNK_RESIDENT && !level_chunk_in_radius(chunks + i, center, radius)) {
+            return chunks + i;
+        }
+    }
+
+    return NULL;
+}
+
+void level_stream_release(Level_Chunk *chunk) {
+    free(chunk->edges);
+    free(chunk->polygons);
+    free(chunk->polygon_bounds);
+    free(chunk->entity_types);
+    free(chunk->entity_boxes);
+    free(chunk->entities);
+
+    chunk->edges            = NULL;
+    chunk->edges_count      = 0;
+    chunk->polygons         = NULL;
+    chunk->polygon_bounds   = NULL;
+    chunk->polygons_count   = 0;
+    chunk->entity_types     = NULL;
+    chunk->entity_boxes     = NULL;
+    chunk->entities         = NULL;
+    chunk->entities_count   = 0;
+
+    chunk->state = LEVEL_CHUNK_UNLOADED;
+}
+
+void level_stream_flush() {
+    if (!stream_open) {
+        return;
+    }
+
+    SDL_LockMutex(mutex);
+
+    if (worker == NULL) {
+        while (level_stream_decode_next()) {
+        }
+    }
+
+    while (array_list_length(&queue) > 0 || worker_busy) {
+        SDL_CondWait(idle_cond, mutex);
+    }
+
+    SDL_UnlockMutex(mutex);
+}
+
+Level_Chunk *level_stream_chunks(u32 *count) {
+    *count = chunks_count;
+    return chunks;
+}
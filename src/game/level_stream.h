@@ -0,0 +1,103 @@
+#ifndef LEVEL_STREAM_H
+#define LEVEL_STREAM_H
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/mathf.h"
+#include "core/file.h"
+
+#include "game/level.h"
+#include "game/level_format.h"
+#include "game/physics.h"
+
+/**
+ * Level streaming.
+ *
+ * Streams chunks of the chunked level in and out around some point (usually the camera).
+ * Chunks are read and decoded on the worker thread, main thread only picks up chunks that are ready, and decides when to integrate them into the level.
+ * @Important: All functions below should be called from the main thread.
+ */
+
+typedef enum level_chunk_state : u8 {
+    LEVEL_CHUNK_UNLOADED,
+    LEVEL_CHUNK_QUEUED,         // Waiting for or being decoded by the worker.
+    LEVEL_CHUNK_DECODED,        // Decoded, waiting for the main thread to integrate it.
+    LEVEL_CHUNK_RESIDENT,       // Integrated into the level.
+} Level_Chunk_State;
+
+typedef struct level_chunk {
+    Level_Chunk_Entry   entry;
+    AABB                bounds;             // World bounds of the chunk cell.
+    Level_Chunk_State   state;
+
+    // Decoded data, owned by the chunk until it is unloaded.
+    Phys_Edge           *edges;
+    u32                 edges_count;
+    Phys_Polygon        *polygons;          // Point into chunk edges.
+    AABB                *polygon_bounds;    // Parallel to polygons, as stored in the chunk image.
+    u32                 polygons_count;
+    Entity_Type         *entity_types;
+    OBB                 *entity_boxes;
+    u32                 entities_count;
+
+    // Entities instantiated by the level out of this chunk, NULL for ones that weren't spawned.
+    Entity              **entities;
+
+    bool                failed;             // Worker failed to decode the chunk, it won't be requested again.
+} Level_Chunk;
+
+
+/**
+ * Takes ownership of the chunked level file mapping, validates it and starts the worker thread.
+ * Global image is decoded right away into the buffer that is returned in "global_data", it should be freed by the caller after it is used.
+ * Returns true on success, on failure mapping is still owned by the caller.
+ */
+bool level_stream_open(File_Mapping *mapping, Level_Image *global_image, u8 **global_data);
+
+/**
+ * Stops the worker thread, frees all chunks and releases the mapping.
+ * Safe to call if stream isn't open.
+ */
+void level_stream_close();
+
+/**
+ * Returns true if there is an open stream.
+ */
+bool level_stream_active();
+
+/**
+ * Queues all unloaded chunks that intersect the circle of specified radius around center.
+ * Chunks closer to the center are decoded first.
+ */
+void level_stream_request(Vec2f center, float radius);
+
+/**
+ * Returns next chunk that was decoded by the worker and marks it resident, or NULL if there is none.
+ * Decoded chunks that are outside of the radius of the last request by now are discarded right away.
+ * If the worker couldn't be started, one queued chunk is decoded on the calling thread per call instead.
+ */
+Level_Chunk *level_stream_pop_decoded();
+
+/**
+ * Returns next resident chunk that is fully outside of the circle of specified radius around center, or NULL if there is none.
+ * Returned chunk should be released with "level_stream_release()" once the level doesn't reference its data.
+ */
+Level_Chunk *level_stream_next_far(Vec2f center, float radius);
+
+/**
+ * Frees decoded data of the chunk and marks it unloaded.
+ */
+void level_stream_release(Level_Chunk *chunk);
+
+/**
+ * Blocks until worker is done with all queued chunks, or decodes them on the calling thread if there is no worker.
+ */
+void level_stream_flush();
+
+/**
+ * Returns array of all chunks of the stream and sets its length into count.
+ */
+Level_Chunk *level_stream_chunks(u32 *count);
+
+
+#endif
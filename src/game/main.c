@@ -5,7 +5,10 @@
 
 #include "game/game.h"
 #include "game/graphics.h"
+#include "game/gpu.h"
 #include "game/input.h"
+#include "game/harness.h"
+#include "game/frame_pacer.h"
 
 
 
@@ -34,27 +37,62 @@ int main(int argc, char **argv) {
     state->t.delta_time_multi = 1.0f;
     state->t.time_slow_factor = 1;
     state->t.last_update_time = 0; 
-    state->t.update_step_time = 10; // Milliseconds per one update time
+    state->t.update_step_time = 10; // Milliseconds per one update of the harness, frame loop is paced by "frame_pacer.h".
+
+
+    // Parsing command line, it can ask for headless mode and for the harness to be run.
+    Harness_Options harness;
+    if (!harness_parse_args(argc, argv, &harness)) {
+        return 1;
+    }
+    state->headless = harness.headless;
+
+    // Benchmark measures CPU side of rendering and tests check what is handed to GPU, nothing is sent to it.
+    if (harness.benchmark || harness.test) {
+        gpu_use_null();
+    }
 
 
     // Initting game.
     game_init(state);
 
 
+    // Harness plays the scripted scene or benchmarks rendering instead of the frame loop.
+    if (harness.benchmark) {
+        s32 result = harness_benchmark(state, &harness);
+        game_free();
+        return result;
+    }
+
+    if (harness.test) {
+        s32 result = harness_test(state, &harness);
+        game_free();
+        return result;
+    }
+
+    if (harness.frames > 0) {
+        s32 result = harness_run(state, &harness);
+        game_free();
+        return result;
+    }
+
+
     // Entering frame loop.
     while (!state->events.should_quit) {
-        // Time management.
+        // Blocking while nothing would change on screen, editor doesn't draw at all when idle.
+        // Time spent blocked isn't part of the next frame, otherwise everything animated would jump.
+        if (game_wait_idle()) {
+            frame_pacer_reset();
+        }
+
+        // Time management, waiting until the frame is due instead of spinning on the clock.
+        u64 frame_ns = frame_pacer_wait();
+
         state->t.current_time = SDL_GetTicks();
-        state->t.accumilated_time += state->t.current_time - state->t.last_update_time;
         state->t.last_update_time = state->t.current_time;
-        
-        if (state->t.accumilated_time < state->t.update_step_time) {
-            continue;
-        }
-        
-        state->t.delta_time_milliseconds = (u32)((float)state->t.accumilated_time * state->t.delta_time_multi);
-        state->t.delta_time = (float)(state->t.delta_time_milliseconds) / 1000.0f;
-        state->t.accumilated_time = state->t.accumilated_time % state->t.update_step_time;
+
+        state->t.delta_time = (float)((double)frame_ns / 1000000000.0) * state->t.delta_time_multi;
+        state->t.delta_time_milliseconds = (u32)(state->t.delta_time * 1000.0f);
 
         // Updating game.
         game_update();
@@ -854,22 +854,24 @@ void phys_update(Phys_Box *phys_boxes, s64 count, s64 stride) {
                 continue;
             }
 
-            if (!box1->dynamic) {
+            if (!box1->dynamic || box1->frozen) {
                 continue;
             }
 
 
             box1->grounded = false;
 
+            float step_time = time_ptr->delta_time * PHYS_ITERATION_STEP_TIME * box1->time_scale;
+
             // Applying gravity.
             if (box1->gravitable) {
-                box1->body.velocity = vec2f_sum(box1->body.velocity, vec2f_multi_constant(GRAVITY_ACCELERATION, time_ptr->delta_time * PHYS_ITERATION_STEP_TIME ));
+                box1->body.velocity = vec2f_sum(box1->body.velocity, vec2f_multi_constant(GRAVITY_ACCELERATION, step_time));
             }
 
 
             // Applying velocities.
-            box1->bound_box.center = vec2f_sum(box1->bound_box.center, vec2f_multi_constant(box1->body.velocity, time_ptr->delta_time * PHYS_ITERATION_STEP_TIME));
-            box1->bound_box.rot += box1->body.angular_velocity * time_ptr->delta_time * PHYS_ITERATION_STEP_TIME;
+            box1->bound_box.center = vec2f_sum(box1->bound_box.center, vec2f_multi_constant(box1->body.velocity, step_time));
+            box1->bound_box.rot += box1->body.angular_velocity * step_time;
             box1->body.mass_center = box1->bound_box.center;
 
             // @Incomplete: Add proper debugging support (physics visualization).
@@ -895,8 +897,16 @@ void phys_update(Phys_Box *phys_boxes, s64 count, s64 stride) {
 
                 box2 = (Phys_Box *)((char *)(phys_boxes) + j * stride);
 
+                if (!box2->active) {
+                    continue;
+                }
+
+                // Frozen boxes are resolved against as static ones.
+                bool dynamic1 = box1->dynamic && !box1->frozen;
+                bool dynamic2 = box2->dynamic && !box2->frozen;
+
                 // If two boxes are static ignore.
-                if (!box1->dynamic && !box2->dynamic) {
+                if (!dynamic1 && !dynamic2) {
                     continue;
                 }
 
@@ -908,12 +918,12 @@ void phys_update(Phys_Box *phys_boxes, s64 count, s64 stride) {
                     // Calculating dot product to check if any objects are grounded.
                     float grounded_dot = vec2f_dot(vec2f_normalize(GRAVITY_ACCELERATION), normal);
 
-                    if (box1->dynamic && !box2->dynamic) {
+                    if (dynamic1 && !dynamic2) {
                         phys_resolve_static_obb_collision(&box1->bound_box, depth, vec2f_negate(normal));
 
                         if (grounded_dot > 0.7f)
                             box1->grounded = true;
-                    } else if (box2->dynamic && !box1->dynamic) {
+                    } else if (dynamic2 && !dynamic1) {
                         phys_resolve_static_obb_collision(&box2->bound_box, depth, normal);
 
                         if (grounded_dot < -0.7f)
@@ -931,13 +941,21 @@ void phys_update(Phys_Box *phys_boxes, s64 count, s64 stride) {
 
                     // Detailed physics collision response resolution happens here.
                     contacts_count = phys_find_contanct_points_obb(&box1->bound_box, &box2->bound_box, contacts);
-                    phys_resolve_phys_box_collision_with_rotation_friction(box1, box2, normal, contacts, contacts_count);
+
+                    // Frozen box responds as if it had infinite mass, its own velocity is kept for when it is simulated again.
+                    Phys_Box immovable;
+                    if (box1->frozen || box2->frozen) {
+                        immovable = box1->frozen ? *box1 : *box2;
+                        immovable.body.inv_mass    = 0.0f;
+                        immovable.body.inv_inertia = 0.0f;
+                    }
+                    phys_resolve_phys_box_collision_with_rotation_friction(box1->frozen ? &immovable : box1, box2->frozen ? &immovable : box2, normal, contacts, contacts_count);
                 }
             }
 
             s64 polygons_count = *phys_polygons_count_ptr;
             Phys_Polygon *polygons = *phys_polygons_ptr;
-            if (box1->dynamic) {
+            if (box1->dynamic && !box1->frozen) {
                 for (s64 i = 0; i < polygons_count; i++) {
                     if (phys_sat_check_collision_obb_polygon(&box1->bound_box, polygons + i)) {
 
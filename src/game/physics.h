@@ -62,6 +62,9 @@ typedef struct phys_box {
     bool gravitable;
     bool grounded;
     bool active;
+    bool frozen;            // Frozen box isn't moved by the simulation, but it is still solid for the other boxes.
+
+    float time_scale;       // Multiplies step time of the box, lets it tick at reduced rate without slowing down.
 } Phys_Box;
 
 
@@ -104,6 +107,8 @@ static Phys_Box phys_box_make(Vec2f position, float width, float height, float r
     phys_box.destructible   = destructible;
     phys_box.gravitable     = gravitable;
     phys_box.active         = true;
+    phys_box.frozen         = false;
+    phys_box.time_scale     = 1.0f;
 
     return phys_box;
 }
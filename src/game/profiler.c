@@ -0,0 +1,206 @@
+#include "game/profiler.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/str.h"
+#include "core/mathf.h"
+
+#include "game/graphics.h"
+#include "game/draw.h"
+#include "game/imui.h"
+#include "game/resource.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+// GPU graph has a part for every render layer, and one for the rest of the frame, like clearing, uploads and readbacks.
+#define PROFILER_GPU_PARTS (RENDER_LAYER_COUNT + 1)
+#define PROFILER_PARTS_MAX 8
+
+typedef struct profiler_graph {
+    char        *title;
+    char        **names;
+    Vec4f       *colors;
+    u32         parts;
+    float       *history;       // Milliseconds of every part, PROFILER_HISTORY frames of them.
+    u32         recorded;       // Frames recorded, newest one is at "(recorded - 1) % PROFILER_HISTORY".
+} Profiler_Graph;
+
+
+static char *cpu_names[PROFILER_SCOPE_COUNT] = { "assets", "events", "update", "draw", "console", "submit" };
+static char *gpu_names[PROFILER_GPU_PARTS] = { "background", "static", "world", "overlay", "ui", "console", "other" };
+
+static Vec4f part_colors[PROFILER_PARTS_MAX] = {
+    { 0.90f, 0.35f, 0.30f, 1.0f },
+    { 0.95f, 0.65f, 0.25f, 1.0f },
+    { 0.90f, 0.85f, 0.30f, 1.0f },
+    { 0.40f, 0.80f, 0.40f, 1.0f },
+    { 0.35f, 0.65f, 0.95f, 1.0f },
+    { 0.70f, 0.50f, 0.90f, 1.0f },
+    { 0.85f, 0.45f, 0.75f, 1.0f },
+    { 0.60f, 0.60f, 0.60f, 1.0f },
+};
+
+static float cpu_history[PROFILER_HISTORY][PROFILER_SCOPE_COUNT];
+static float gpu_history[PROFILER_HISTORY][PROFILER_GPU_PARTS];
+
+static Profiler_Graph cpu_graph = { "CPU", cpu_names, part_colors, PROFILER_SCOPE_COUNT, &cpu_history[0][0], 0 };
+static Profiler_Graph gpu_graph = { "GPU", gpu_names, part_colors, PROFILER_GPU_PARTS, &gpu_history[0][0], 0 };
+
+static u64   scope_start[PROFILER_SCOPE_COUNT];
+static float scope_times[PROFILER_SCOPE_COUNT];     // Milliseconds of the current frame.
+static u32   gpu_frame;                             // Frames measured by graphics when GPU times were last recorded.
+
+static bool         visible;
+static Font_Baked   *font;
+
+
+
+void profiler_begin(Profiler_Scope scope) {
+    scope_start[scope] = get_time_ns();
+}
+
+void profiler_end(Profiler_Scope scope) {
+    scope_times[scope] += (float)(get_time_ns() - scope_start[scope]) / 1000000.0f;
+}
+
+void profiler_frame_end() {
+    memcpy(cpu_history[cpu_graph.recorded % PROFILER_HISTORY], scope_times, sizeof(scope_times));
+    cpu_graph.recorded++;
+    memset(scope_times, 0, sizeof(scope_times));
+
+    u32 frame;
+    float layer_times[RENDER_LAYER_COUNT];
+    float frame_time = graphics_gpu_frame_time(&frame);
+    graphics_gpu_layer_times(layer_times, &frame);
+    if (frame == gpu_frame) {
+        return;
+    }
+    gpu_frame = frame;
+
+    float *times = gpu_history[gpu_graph.recorded % PROFILER_HISTORY];
+    float rest = frame_time;
+    for (u32 i = 0; i < RENDER_LAYER_COUNT; i++) {
+        times[i] = layer_times[i];
+        rest -= layer_times[i];
+    }
+    times[RENDER_LAYER_COUNT] = fmaxf(rest, 0.0f);
+    gpu_graph.recorded++;
+}
+
+
+
+/**
+ * Draws graph with its top left corner at the origin, returns height it took.
+ * Bars go from the oldest frame on the left to the newest on the right, they are scaled so the longest frame of the history fits.
+ */
+static float profiler_draw_graph(Profiler_Graph *graph, Vec2f origin) {
+    u32 frames = graph->recorded < PROFILER_HISTORY ? graph->recorded : PROFILER_HISTORY;
+    float line_height = (float)font->line_height;
+    char buffer[128];
+
+    // Min, avg and max of every part, last one is the total of the frame.
+    float min[PROFILER_PARTS_MAX + 1], avg[PROFILER_PARTS_MAX + 1], max[PROFILER_PARTS_MAX + 1];
+    for (u32 p = 0; p <= graph->parts; p++) {
+        min[p] = frames > 0 ? INFINITY : 0.0f;
+        avg[p] = 0.0f;
+        max[p] = 0.0f;
+    }
+    for (u32 f = 0; f < frames; f++) {
+        float *times = graph->history + f * graph->parts;
+        float total = 0.0f;
+        for (u32 p = 0; p <= graph->parts; p++) {
+            float time = p < graph->parts ? times[p] : total;
+            total += time;
+            min[p] = fminf(min[p], time);
+            max[p] = fmaxf(max[p], time);
+            avg[p] += time / (float)frames;
+        }
+    }
+
+    float scale = fmaxf(ceilf(max[graph->parts]), 1.0f);
+
+    float margin = 4.0f;
+    float height = line_height * (float)(graph->parts + 1) + PROFILER_GRAPH_HEIGHT;
+    ui_draw_rect(vec2f_make(origin.x - margin, origin.y - height - margin), vec2f_make(PROFILER_GRAPH_WIDTH + margin * 2.0f, height + margin * 2.0f), vec4f_make(0.12f, 0.12f, 0.14f, 0.85f));
+
+    float y = origin.y;
+    snprintf(buffer, sizeof(buffer), "%s ms  min %.2f  avg %.2f  max %.2f  (graph %.0f ms)", graph->title, min[graph->parts], avg[graph->parts], max[graph->parts], scale);
+    ui_draw_text(CSTR(buffer), vec2f_make(origin.x, y), VEC4F_WHITE);
+    y -= line_height;
+
+    // Stacked bars.
+    y -= PROFILER_GRAPH_HEIGHT;
+    ui_draw_rect(vec2f_make(origin.x, y), vec2f_make(PROFILER_GRAPH_WIDTH, PROFILER_GRAPH_HEIGHT), vec4f_make(0.0f, 0.0f, 0.0f, 0.5f));
+
+    float bar_width = PROFILER_GRAPH_WIDTH / PROFILER_HISTORY;
+    for (u32 f = 0; f < frames; f++) {
+        u32 index = (graph->recorded - frames + f) % PROFILER_HISTORY;
+        float *times = graph->history + index * graph->parts;
+        float x = origin.x + (float)(PROFILER_HISTORY - frames + f) * bar_width;
+
+        float bottom = y;
+        for (u32 p = 0; p < graph->parts; p++) {
+            float height = times[p] / scale * PROFILER_GRAPH_HEIGHT;
+            if (height > 0.0f) {
+                ui_draw_rect(vec2f_make(x, bottom), vec2f_make(bar_width, height), graph->colors[p]);
+                bottom += height;
+            }
+        }
+    }
+
+    // Legend.
+    for (u32 p = 0; p < graph->parts; p++) {
+        ui_draw_rect(vec2f_make(origin.x, y - line_height * 0.8f), vec2f_make(line_height * 0.6f, line_height * 0.6f), graph->colors[p]);
+
+        snprintf(buffer, sizeof(buffer), "%-10s min %6.2f  avg %6.2f  max %6.2f", graph->names[p], min[p], avg[p], max[p]);
+        ui_draw_text(CSTR(buffer), vec2f_make(origin.x + line_height, y), VEC4F_WHITE);
+        y -= line_height;
+    }
+
+    return origin.y - y;
+}
+
+void profiler_draw(Window_Info *window, Quad_Drawer *ui_quad_drawer) {
+    if (!visible) {
+        return;
+    }
+
+    if (font == NULL) {
+        graphics_context_acquire();
+        font = resource_font_get("res/font/Consolas-Regular.ttf", 14.0f);
+        graphics_context_release();
+
+        if (font == NULL) {
+            visible = false;
+            return;
+        }
+    }
+
+    Matrix4f projection = screen_calculate_projection(window->width, window->height);
+    shader_update_projection(ui_quad_drawer->program, &projection);
+    render_layer_set(RENDER_LAYER_UI);
+
+    draw_begin(ui_quad_drawer);
+
+    ui_set_font(font);
+
+    float margin = 10.0f;
+    Vec2f origin = vec2f_make(window->width - PROFILER_GRAPH_WIDTH - margin, window->height - margin);
+    origin.y -= profiler_draw_graph(&cpu_graph, origin) + margin;
+    (void)profiler_draw_graph(&gpu_graph, origin);
+
+    draw_end();
+}
+
+void profiler_free() {
+    resource_release(font);
+    font = NULL;
+}
+
+
+
+void profiler_toggle() {
+    visible = !visible;
+}
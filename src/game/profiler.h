@@ -0,0 +1,66 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/str.h"
+
+#include "game/graphics.h"
+
+/**
+ * Frame profiler.
+ *
+ * CPU time of the frame is measured in scopes, parts of the game update marked with "profiler_begin()" and "profiler_end()",
+ * GPU time is measured by graphics for every render layer, see "graphics_gpu_layer_times()", which tells background grid, static and dynamic world quads,
+ * world overlay lines, ui and console apart.
+ * Last PROFILER_HISTORY frames are kept, overlay draws them as stacked bars, one bar per frame, along with min, avg and max of each part over them.
+ * GPU times come a few frames late, they are recorded as soon as graphics collect them.
+ * Overlay is toggled with "profiler_toggle" command.
+ */
+
+#define PROFILER_HISTORY        120
+#define PROFILER_GRAPH_WIDTH    360.0f
+#define PROFILER_GRAPH_HEIGHT   80.0f
+
+typedef enum profiler_scope : u8 {
+    PROFILER_SCOPE_ASSETS,          // Asset changes and texture uploads.
+    PROFILER_SCOPE_EVENTS,
+    PROFILER_SCOPE_UPDATE,          // Level or editor update.
+    PROFILER_SCOPE_DRAW,            // Level or editor drawing.
+    PROFILER_SCOPE_CONSOLE,
+    PROFILER_SCOPE_SUBMIT,          // Handing off the frame, includes waiting for the render thread.
+    PROFILER_SCOPE_COUNT,
+} Profiler_Scope;
+
+
+/**
+ * Starts measuring the scope, time between begin and end is added to the time of the scope in the current frame.
+ */
+void profiler_begin(Profiler_Scope scope);
+
+void profiler_end(Profiler_Scope scope);
+
+/**
+ * Records times of the frame into the history and starts the next frame.
+ * Should be called once per frame, after the frame is handed off.
+ */
+void profiler_frame_end();
+
+/**
+ * Draws the overlay into RENDER_LAYER_UI if it is toggled on, history of the frames before the current one is drawn.
+ * Overlay font is loaded the first time overlay is drawn.
+ */
+void profiler_draw(Window_Info *window, Quad_Drawer *ui_quad_drawer);
+
+void profiler_free();
+
+
+/**
+ * Shows or hides frame timeline overlay.
+ */
+@Introspect;
+@RegisterCommand;
+void profiler_toggle();
+
+
+#endif
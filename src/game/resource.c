@@ -0,0 +1,256 @@
+#include "game/resource.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/str.h"
+#include "core/structs.h"
+#include "core/file.h"
+#include "core/log.h"
+
+#include "game/texture_stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef enum resource_kind : u8 {
+    RESOURCE_FONT,
+    RESOURCE_SHADER,
+    RESOURCE_TEXTURE,
+} Resource_Kind;
+
+typedef struct resource_entry {
+    Resource_Kind   kind;
+    char            *path;
+    float           size;           // Font size, 0 for other kinds.
+    u32             references;
+    void            *data;          // Font_Baked, Shader, or Texture handle owned by the texture stream.
+} Resource_Entry;
+
+
+static Resource_Entry **entries;
+
+
+
+/**
+ * Returns the entry of the resource, or NULL if it isn't loaded.
+ */
+static Resource_Entry *resource_find(Resource_Kind kind, char *path, float size) {
+    if (entries == NULL) {
+        return NULL;
+    }
+
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        if (entries[i]->kind == kind && entries[i]->size == size && strcmp(entries[i]->path, path) == 0) {
+            return entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void *resource_acquire(Resource_Entry *entry) {
+    entry->references++;
+    return entry->data;
+}
+
+static void *resource_add(Resource_Kind kind, char *path, float size, void *data) {
+    if (entries == NULL) {
+        entries = array_list_make(Resource_Entry *, 16, &std_allocator);
+    }
+
+    Resource_Entry *entry = calloc(1, sizeof(Resource_Entry));
+    u64 length = strlen(path);
+    entry->path = malloc(length + 1);
+    memcpy(entry->path, path, length + 1);
+    entry->kind = kind;
+    entry->size = size;
+    entry->data = data;
+
+    array_list_append(&entries, entry);
+
+    return resource_acquire(entry);
+}
+
+static void resource_unload(Resource_Entry *entry) {
+    switch (entry->kind) {
+        case RESOURCE_FONT:
+            font_free(entry->data);
+            free(entry->data);
+            break;
+        case RESOURCE_SHADER:
+            shader_unload(entry->data);
+            free(entry->data);
+            break;
+        case RESOURCE_TEXTURE:
+            texture_stream_unload(entry->path);
+            break;
+    }
+
+    free(entry->path);
+    free(entry);
+}
+
+
+
+Font_Baked *resource_font_get(char *font_path, float font_size) {
+    Resource_Entry *entry = resource_find(RESOURCE_FONT, font_path, font_size);
+    if (entry != NULL) {
+        return resource_acquire(entry);
+    }
+
+    // Every size is made from the same distance field font, so glyphs of the file are only rendered once.
+    Font_Sdf *sdf = font_sdf_get(font_path);
+    if (sdf == NULL) {
+        return NULL;
+    }
+
+    Font_Baked *font = malloc(sizeof(Font_Baked));
+    *font = font_sdf_sized(sdf, font_size);
+
+    return resource_add(RESOURCE_FONT, font_path, font_size, font);
+}
+
+Shader *resource_shader_get(char *shader_path) {
+    Resource_Entry *entry = resource_find(RESOURCE_SHADER, shader_path, 0.0f);
+    if (entry != NULL) {
+        return resource_acquire(entry);
+    }
+
+    Shader loaded = shader_load(shader_path);
+    if (loaded.id == 0) {
+        return NULL;
+    }
+    shader_init_uniforms(&loaded);
+
+    Shader *shader = malloc(sizeof(Shader));
+    *shader = loaded;
+
+    return resource_add(RESOURCE_SHADER, shader_path, 0.0f, shader);
+}
+
+Texture *resource_texture_get(char *image_path) {
+    Resource_Entry *entry = resource_find(RESOURCE_TEXTURE, image_path, 0.0f);
+    if (entry != NULL) {
+        return resource_acquire(entry);
+    }
+
+    return resource_add(RESOURCE_TEXTURE, image_path, 0.0f, texture_stream_load(image_path));
+}
+
+void resource_release(void *resource) {
+    if (resource == NULL || entries == NULL) {
+        return;
+    }
+
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        Resource_Entry *entry = entries[i];
+        if (entry->data != resource) {
+            continue;
+        }
+
+        if (--entry->references == 0) {
+            resource_unload(entry);
+            array_list_unordered_remove(&entries, i);
+        }
+        return;
+    }
+
+    LOG_WARNING("Released resource wasn't loaded through the registry.");
+}
+
+bool resource_reload(String path) {
+    if (entries == NULL) {
+        return false;
+    }
+
+    bool found = false;
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        Resource_Entry *entry = entries[i];
+        if (!str_equals(CSTR(entry->path), path)) {
+            continue;
+        }
+        found = true;
+
+        if (entry->kind != RESOURCE_SHADER) {
+            continue;
+        }
+
+        // If shader fails to load, previous one is kept.
+        Shader shader = shader_load(entry->path);
+        if (shader.id == 0) {
+            continue;
+        }
+        shader_init_uniforms(&shader);
+
+        shader_unload(entry->data);
+        *(Shader *)entry->data = shader;
+    }
+
+    return found;
+}
+
+u32 resource_prefetch(char *list_path) {
+    // List is optional, so missing file isn't an error.
+    FILE *file = fopen(list_path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    fclose(file);
+
+    String list = read_file_into_str(list_path, &std_allocator);
+    String rest = list;
+    u32 loaded = 0;
+
+    while (rest.length > 0) {
+        s64 end_of_line = str_find_char_left(rest, '\n');
+        String line = str_substring(rest, 0, end_of_line < 0 ? rest.length : end_of_line);
+        rest = str_eat_chars(rest, line.length + 1);
+
+        char buffer[512];
+        if (line.length == 0 || line.length >= (s64)sizeof(buffer) || line.data[0] == '#') {
+            continue;
+        }
+        str_copy_to(line, buffer);
+        buffer[line.length] = '\0';
+
+        char kind[16], path[256];
+        float size = 0.0f;
+        s32 fields = sscanf(buffer, " %15s %255s %f", kind, path, &size);
+        if (fields < 2) {
+            continue;
+        }
+
+        void *resource = NULL;
+        if (strcmp(kind, "font") == 0 && fields == 3) {
+            resource = resource_font_get(path, size);
+        } else if (strcmp(kind, "shader") == 0) {
+            resource = resource_shader_get(path);
+        } else if (strcmp(kind, "texture") == 0) {
+            resource = resource_texture_get(path);
+        } else {
+            LOG_WARNING("Prefetch list %s, unknown resource '%s'.", list_path, buffer);
+            continue;
+        }
+
+        loaded += resource != NULL;
+    }
+
+    allocator_free(&std_allocator, list.data);
+
+    return loaded;
+}
+
+void resource_free() {
+    if (entries == NULL) {
+        return;
+    }
+
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        resource_unload(entries[i]);
+    }
+
+    array_list_free(&entries);
+    entries = NULL;
+}
@@ -0,0 +1,67 @@
+#ifndef RESOURCE_H
+#define RESOURCE_H
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/str.h"
+
+#include "game/graphics.h"
+
+/**
+ * Resource registry.
+ *
+ * Single place fonts, shaders and textures are loaded through, keyed by file path and parameters, like font size.
+ * Identical requests share one resource, it is loaded the first time it is asked for and counts references,
+ * resource is unloaded when the last reference is released.
+ * Modules ask for resources where they first need them, so resources of modules that are never used, like the editor, are never loaded.
+ * Prefetch list names resources that should be loaded up front instead, one per line:
+ *      font res/font/Consolas-Regular.ttf 14
+ *      shader res/shader/quad.glsl
+ *      texture res/sprites/player.png
+ * Empty lines and lines starting with '#' are skipped, prefetched resources are held until "resource_free()".
+ * Returned pointers stay the same for as long as resource is loaded, reloaded shaders are replaced in place.
+ * Textures are streamed, see "texture_stream.h", released ones are deleted by the stream a few frames later.
+ * @Important: All functions below should be called from the main thread with OpenGL context current, while render thread runs it is taken with "graphics_context_acquire()".
+ */
+
+#define RESOURCE_PREFETCH_LIST  "res/prefetch.txt"
+
+/**
+ * Returns font of the file baked with the size, NULL if the file couldn't be read.
+ */
+Font_Baked *resource_font_get(char *font_path, float font_size);
+
+/**
+ * Returns shader of the file with its uniforms initialized, NULL if it failed to load.
+ */
+Shader *resource_shader_get(char *shader_path);
+
+/**
+ * Returns handle of the texture of the image file, it holds placeholder until the image is streamed in.
+ */
+Texture *resource_texture_get(char *image_path);
+
+/**
+ * Releases reference to the resource returned by one of the functions above.
+ */
+void resource_release(void *resource);
+
+/**
+ * Loads shaders of the file again, if any are loaded from it, keeping their pointers.
+ * Returns true if the file belongs to a loaded resource.
+ */
+bool resource_reload(String path);
+
+/**
+ * Loads every resource in the list, does nothing if the list file doesn't exist.
+ * Returns number of resources loaded.
+ */
+u32 resource_prefetch(char *list_path);
+
+/**
+ * Unloads every resource regardless of references.
+ */
+void resource_free();
+
+
+#endif
@@ -0,0 +1,491 @@
+#include "game/texture_stream.h"
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/str.h"
+#include "core/structs.h"
+#include "core/log.h"
+
+#include "game/gpu.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+
+#include <GL/glew.h>
+
+#include <string.h>
+
+
+typedef enum texture_stream_state : u8 {
+    TEXTURE_STREAM_QUEUED,          // Waiting for or being decoded by a worker.
+    TEXTURE_STREAM_DECODED,         // Pixels are waiting to be uploaded by the main thread.
+    TEXTURE_STREAM_READY,
+    TEXTURE_STREAM_FAILED,          // Image couldn't be decoded, handle keeps what it held before.
+} Texture_Stream_State;
+
+typedef struct texture_stream_entry {
+    char                    *image_path;
+    Texture                 texture;            // Handle given out, placeholder until the first upload is finished.
+    Texture                 uploading;          // Texture pixels are being uploaded into, swapped into the handle once all rows are uploaded.
+    s32                     rows_uploaded;
+    u8                      *pixels;            // Decoded RGBA pixels.
+    s32                     width;
+    s32                     height;
+    bool                    reload;             // File changed while it was being decoded, it is queued again once decoded.
+    bool                    unloaded;           // Unloaded while a worker was decoding it, it is freed once decoded.
+    Texture_Stream_State    state;
+} Texture_Stream_Entry;
+
+typedef struct texture_stream_retired {
+    u32 id;
+    u32 frames_left;
+} Texture_Stream_Retired;
+
+
+static SDL_Thread   *workers[TEXTURE_STREAM_WORKERS];
+static SDL_mutex    *mutex;
+static SDL_cond     *work_cond;         // Signaled when image is queued or workers should quit.
+
+// Following variables are shared with the workers and are guarded by the mutex.
+// Entries are only ever freed by the main thread, workers only fill in the queued ones.
+static Texture_Stream_Entry **entries;
+static Texture_Stream_Entry **queue;
+static Texture_Stream_Entry **decoded;  // Entries decoded by the workers, that weren't picked up by the main thread yet.
+static bool                 workers_quit;
+
+// Following variables are only used by the main thread.
+static Texture_Stream_Entry     **uploads;
+static Texture_Stream_Retired   *retired;
+static Texture                  placeholder;
+
+
+
+static int texture_stream_worker(void *data) {
+    SDL_LockMutex(mutex);
+
+    while (true) {
+        while (!workers_quit && array_list_length(&queue) == 0) {
+            SDL_CondWait(work_cond, mutex);
+        }
+
+        if (workers_quit) {
+            break;
+        }
+
+        Texture_Stream_Entry *entry = queue[0];
+        array_list_unordered_remove(&queue, 0);
+
+        SDL_UnlockMutex(mutex);
+
+        s32 width, height, channels;
+        u8 *pixels = image_load(entry->image_path, &width, &height, &channels, 4);
+
+        SDL_LockMutex(mutex);
+
+        entry->pixels = pixels;
+        entry->width  = width;
+        entry->height = height;
+        array_list_append(&decoded, entry);
+    }
+
+    SDL_UnlockMutex(mutex);
+
+    return 0;
+}
+
+/**
+ * Makes 1 by 1 grey texture handles hold until their images are uploaded.
+ */
+static void texture_stream_init() {
+    if (mutex != NULL) {
+        return;
+    }
+
+    entries = array_list_make(Texture_Stream_Entry *, 16, &std_allocator);
+    queue   = array_list_make(Texture_Stream_Entry *, 16, &std_allocator);
+    decoded = array_list_make(Texture_Stream_Entry *, 16, &std_allocator);
+    uploads = array_list_make(Texture_Stream_Entry *, 16, &std_allocator);
+    retired = array_list_make(Texture_Stream_Retired, 16, &std_allocator);
+
+    graphics_context_acquire();
+
+    u8 grey[4] = { 128, 128, 128, 255 };
+    placeholder.width  = 1;
+    placeholder.height = 1;
+    gpu->gen_textures(1, &placeholder.id);
+    gl_bind_texture(0, placeholder.id);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gpu->tex_image_2d(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    gl_bind_texture(0, 0);
+
+    graphics_context_release();
+
+    workers_quit = false;
+    mutex     = SDL_CreateMutex();
+    work_cond = SDL_CreateCond();
+    for (u32 i = 0; i < TEXTURE_STREAM_WORKERS; i++) {
+        workers[i] = SDL_CreateThread(texture_stream_worker, "texture_stream", NULL);
+    }
+}
+
+/**
+ * Returns the entry of the image file, or NULL if there is none.
+ */
+static Texture_Stream_Entry *texture_stream_find(String image_path) {
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        if (str_equals(CSTR(entries[i]->image_path), image_path)) {
+            return entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Queues the entry to be decoded, should be called with the mutex locked.
+ */
+static void texture_stream_queue(Texture_Stream_Entry *entry) {
+    entry->state = TEXTURE_STREAM_QUEUED;
+    entry->reload = false;
+    array_list_append(&queue, entry);
+    SDL_CondSignal(work_cond);
+}
+
+/**
+ * Allocates storage of the texture pixels are uploaded into, image is swapped into the handle only once all of it is uploaded.
+ * @Important: Should be called with OpenGL context current.
+ */
+static void texture_stream_allocate(Texture_Stream_Entry *entry) {
+    entry->uploading.width  = entry->width;
+    entry->uploading.height = entry->height;
+    gpu->gen_textures(1, &entry->uploading.id);
+    gl_bind_texture(0, entry->uploading.id);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gpu->tex_parameter_i(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gpu->tex_image_2d(GL_TEXTURE_2D, 0, GL_RGBA, entry->width, entry->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    gl_bind_texture(0, 0);
+}
+
+/**
+ * Queues upload of the next strip of rows of the entry into the frame packet, up to the budget.
+ * Returns number of bytes queued.
+ */
+static u64 texture_stream_upload_rows(Texture_Stream_Entry *entry, u64 budget) {
+    u64 row_bytes = (u64)entry->width * 4;
+
+    s32 rows = (s32)(budget / row_bytes);
+    if (rows < 1) {
+        rows = 1;
+    }
+    if (rows > entry->height - entry->rows_uploaded) {
+        rows = entry->height - entry->rows_uploaded;
+    }
+
+    texture_upload_rows(&entry->uploading, entry->rows_uploaded, rows, entry->pixels + (u64)entry->rows_uploaded * row_bytes);
+
+    entry->rows_uploaded += rows;
+
+    return (u64)rows * row_bytes;
+}
+
+/**
+ * Deletes the texture after a few frames, since frames already submitted to the render thread may still draw with it.
+ */
+static void texture_stream_retire(u32 id) {
+    array_list_append(&retired, ((Texture_Stream_Retired) { .id = id, .frames_left = TEXTURE_STREAM_RETIRE_FRAMES }));
+}
+
+static void texture_stream_entry_free(Texture_Stream_Entry *entry) {
+    allocator_free(&std_allocator, entry->pixels);
+    free(entry->image_path);
+    free(entry);
+}
+
+/**
+ * Swaps uploaded texture into the handle, replaced texture is deleted after a few frames.
+ */
+static void texture_stream_finish(Texture_Stream_Entry *entry) {
+    if (entry->texture.id != placeholder.id) {
+        texture_stream_retire(entry->texture.id);
+    }
+
+    entry->texture = entry->uploading;
+    entry->uploading = (Texture) {0};
+    entry->rows_uploaded = 0;
+
+    allocator_free(&std_allocator, entry->pixels);
+    entry->pixels = NULL;
+}
+
+
+
+Texture *texture_stream_load(char *image_path) {
+    texture_stream_init();
+
+    Texture_Stream_Entry *entry = texture_stream_find(CSTR(image_path));
+    if (entry != NULL) {
+        return &entry->texture;
+    }
+
+    entry = calloc(1, sizeof(Texture_Stream_Entry));
+    u64 length = strlen(image_path);
+    entry->image_path = malloc(length + 1);
+    memcpy(entry->image_path, image_path, length + 1);
+    entry->texture = placeholder;
+
+    SDL_LockMutex(mutex);
+    array_list_append(&entries, entry);
+    texture_stream_queue(entry);
+    SDL_UnlockMutex(mutex);
+
+    return &entry->texture;
+}
+
+bool texture_stream_reload(String image_path) {
+    if (mutex == NULL) {
+        return false;
+    }
+
+    Texture_Stream_Entry *entry = texture_stream_find(image_path);
+    if (entry == NULL) {
+        return false;
+    }
+
+    SDL_LockMutex(mutex);
+    if (entry->state == TEXTURE_STREAM_QUEUED || entry->state == TEXTURE_STREAM_DECODED) {
+        entry->reload = true;
+    }
+    else {
+        texture_stream_queue(entry);
+    }
+    SDL_UnlockMutex(mutex);
+
+    return true;
+}
+
+bool texture_stream_ready(Texture *texture) {
+    return mutex != NULL && texture->id != placeholder.id;
+}
+
+void texture_stream_update() {
+    if (mutex == NULL) {
+        return;
+    }
+
+    // Picking up decoded images.
+    SDL_LockMutex(mutex);
+    for (u32 i = 0; i < array_list_length(&decoded); i++) {
+        Texture_Stream_Entry *entry = decoded[i];
+
+        if (entry->unloaded) {
+            texture_stream_entry_free(entry);
+            continue;
+        }
+
+        if (entry->reload) {
+            allocator_free(&std_allocator, entry->pixels);
+            entry->pixels = NULL;
+            texture_stream_queue(entry);
+            continue;
+        }
+
+        if (entry->pixels == NULL) {
+            LOG_ERROR("Couldn't decode image '%s' for the texture.", entry->image_path);
+            entry->state = TEXTURE_STREAM_FAILED;
+            continue;
+        }
+
+        entry->state = TEXTURE_STREAM_DECODED;
+        array_list_append(&uploads, entry);
+    }
+    array_list_clear(&decoded);
+    SDL_UnlockMutex(mutex);
+
+    u32 retired_count = array_list_length(&retired);
+    if (array_list_length(&uploads) == 0 && retired_count == 0) {
+        return;
+    }
+
+    // Only deleting textures and allocating storage needs the context, strips themselves go into the frame packet and are uploaded by whoever submits it.
+    bool acquired = false;
+
+    for (u32 i = array_list_length(&retired); i > 0; i--) {
+        if (--retired[i - 1].frames_left == 0) {
+            if (!acquired) {
+                graphics_context_acquire();
+                acquired = true;
+            }
+            texture_unload(&(Texture) { .id = retired[i - 1].id });
+            array_list_unordered_remove(&retired, i - 1);
+        }
+    }
+
+    // Images are uploaded in the order they were decoded, partly uploaded one stays first until it is finished.
+    u64 budget = TEXTURE_STREAM_UPLOAD_BUDGET;
+    while (budget > 0 && array_list_length(&uploads) > 0) {
+        Texture_Stream_Entry *entry = uploads[0];
+
+        if (entry->uploading.id == 0) {
+            if (!acquired) {
+                graphics_context_acquire();
+                acquired = true;
+            }
+            texture_stream_allocate(entry);
+        }
+
+        u64 bytes = texture_stream_upload_rows(entry, budget);
+        budget = bytes < budget ? budget - bytes : 0;
+
+        if (entry->rows_uploaded < entry->height) {
+            continue;
+        }
+
+        texture_stream_finish(entry);
+        array_list_unordered_remove(&uploads, 0);
+
+        SDL_LockMutex(mutex);
+        if (entry->reload) {
+            texture_stream_queue(entry);
+        }
+        else {
+            entry->state = TEXTURE_STREAM_READY;
+        }
+        SDL_UnlockMutex(mutex);
+    }
+
+    if (acquired) {
+        graphics_context_release();
+    }
+}
+
+void texture_stream_unload(char *image_path) {
+    if (mutex == NULL) {
+        return;
+    }
+
+    Texture_Stream_Entry *entry = texture_stream_find(CSTR(image_path));
+    if (entry == NULL) {
+        return;
+    }
+
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        if (entries[i] == entry) {
+            array_list_unordered_remove(&entries, i);
+            break;
+        }
+    }
+
+    if (entry->texture.id != placeholder.id) {
+        texture_stream_retire(entry->texture.id);
+    }
+    if (entry->uploading.id != 0) {
+        texture_stream_retire(entry->uploading.id);
+    }
+
+    // Only the first upload can be partly uploaded, so order of the rest doesn't matter.
+    for (u32 i = 0; i < array_list_length(&uploads); i++) {
+        if (uploads[i] == entry) {
+            array_list_unordered_remove(&uploads, i);
+            break;
+        }
+    }
+
+    SDL_LockMutex(mutex);
+
+    // Entry that is still queued is dropped right away, one that is being decoded is left for the worker to finish first.
+    bool decoding = false;
+    if (entry->state == TEXTURE_STREAM_QUEUED) {
+        decoding = true;
+        for (u32 i = 0; i < array_list_length(&queue); i++) {
+            if (queue[i] == entry) {
+                array_list_unordered_remove(&queue, i);
+                decoding = false;
+                break;
+            }
+        }
+    }
+
+    if (decoding) {
+        entry->unloaded = true;
+    }
+
+    SDL_UnlockMutex(mutex);
+
+    if (!decoding) {
+        texture_stream_entry_free(entry);
+    }
+}
+
+u32 texture_stream_pending() {
+    if (mutex == NULL) {
+        return 0;
+    }
+
+    u32 pending = 0;
+
+    SDL_LockMutex(mutex);
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        pending += entries[i]->state == TEXTURE_STREAM_QUEUED || entries[i]->state == TEXTURE_STREAM_DECODED;
+    }
+    SDL_UnlockMutex(mutex);
+
+    return pending;
+}
+
+void texture_stream_free() {
+    if (mutex == NULL) {
+        return;
+    }
+
+    SDL_LockMutex(mutex);
+    workers_quit = true;
+    SDL_CondBroadcast(work_cond);
+    SDL_UnlockMutex(mutex);
+
+    for (u32 i = 0; i < TEXTURE_STREAM_WORKERS; i++) {
+        SDL_WaitThread(workers[i], NULL);
+        workers[i] = NULL;
+    }
+
+    SDL_DestroyCond(work_cond);
+    SDL_DestroyMutex(mutex);
+    mutex = NULL;
+
+    graphics_context_acquire();
+
+    for (u32 i = 0; i < array_list_length(&entries); i++) {
+        Texture_Stream_Entry *entry = entries[i];
+        if (entry->texture.id != placeholder.id) {
+            texture_unload(&entry->texture);
+        }
+        if (entry->uploading.id != 0) {
+            texture_unload(&entry->uploading);
+        }
+        texture_stream_entry_free(entry);
+    }
+
+    // Unloaded entries workers finished decoding aren't in the entries anymore.
+    for (u32 i = 0; i < array_list_length(&decoded); i++) {
+        if (decoded[i]->unloaded) {
+            texture_stream_entry_free(decoded[i]);
+        }
+    }
+
+    for (u32 i = 0; i < array_list_length(&retired); i++) {
+        texture_unload(&(Texture) { .id = retired[i].id });
+    }
+
+    texture_unload(&placeholder);
+
+    graphics_context_release();
+
+    array_list_free(&entries);
+    array_list_free(&queue);
+    array_list_free(&decoded);
+    array_list_free(&uploads);
+    array_list_free(&retired);
+}
@@ -0,0 +1,69 @@
+#ifndef TEXTURE_STREAM_H
+#define TEXTURE_STREAM_H
+
+#include "core/core.h"
+#include "core/type.h"
+#include "core/str.h"
+
+#include "game/graphics.h"
+
+/**
+ * Texture streaming.
+ *
+ * Images are decoded on worker threads and uploaded through a pixel buffer object a strip of rows at a time, so loading a texture doesn't stall the frame.
+ * Loading returns the handle right away, it holds the placeholder texture until the image is uploaded, then its id and size are swapped to the real ones.
+ * So handle can be drawn with from the start, and it stays the same for as long as the texture is loaded.
+ * Strips are queued into the frame packet in "texture_stream_update()" once per frame, see "texture_upload_rows()", and stop for the frame once its byte budget is spent.
+ * OpenGL context is only taken when texture storage is allocated or replaced texture is deleted, not for every strip.
+ * Reloaded texture keeps its previous image until the new one is uploaded, previous texture is deleted a few frames later,
+ * since frames already submitted to the render thread may still draw with it.
+ * @Important: All functions below should be called from the main thread.
+ */
+
+#define TEXTURE_STREAM_WORKERS          2
+// Bytes of pixels uploaded per frame, at least one row of the texture is uploaded even if it is bigger.
+#define TEXTURE_STREAM_UPLOAD_BUDGET    (4 * 1024 * 1024)
+// Frames replaced texture is kept for before it is deleted.
+#define TEXTURE_STREAM_RETIRE_FRAMES    3
+
+
+/**
+ * Returns handle of the texture of the image file, queuing it to be decoded if it isn't loaded yet.
+ * Handle holds the placeholder texture until the image is uploaded, or if it failed to load.
+ */
+Texture *texture_stream_load(char *image_path);
+
+/**
+ * Queues image file to be decoded and uploaded again, if it is loaded.
+ * Returns false if no texture was loaded from the file.
+ */
+bool texture_stream_reload(String image_path);
+
+/**
+ * Unloads texture of the image file, its handle is invalid afterwards.
+ * Texture is deleted a few frames later, same as the replaced one on reload, since frames already submitted to the render thread may still draw with it.
+ */
+void texture_stream_unload(char *image_path);
+
+/**
+ * Returns true if the handle holds the uploaded image, not the placeholder.
+ */
+bool texture_stream_ready(Texture *texture);
+
+/**
+ * Uploads decoded images within the frame budget and swaps finished ones into their handles, should be called once per frame.
+ */
+void texture_stream_update();
+
+/**
+ * Returns number of textures that are still being decoded or uploaded.
+ */
+u32 texture_stream_pending();
+
+/**
+ * Stops the workers and unloads all textures, handles are invalid afterwards.
+ */
+void texture_stream_free();
+
+
+#endif